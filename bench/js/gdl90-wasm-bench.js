@@ -0,0 +1,100 @@
+//
+//  gdl90-wasm-bench.js
+//  gdl90-bench
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares gdl90.wasm and gdl90-simd.wasm on the same capture : the datagrams of a
+// gdl90-replay-bench capture (a 2 byte, LS byte first, length then the datagram) are fed through
+// the ring API (writePacket, processRing, then the records are released unread), and the median
+// MB/s of the timed passes is reported for each module.
+//
+// gdl90-replay-bench -s 64 -f gdl90-replay.bin -k
+// node gdl90-wasm-bench.js path/to/gdl90.js gdl90.wasm gdl90-simd.wasm gdl90-replay.bin [passes]
+
+const fs = require("fs");
+
+const { GDL90 } = require(process.argv[2]);
+const modules = [process.argv[3], process.argv[4]];
+const capture = fs.readFileSync(process.argv[5]);
+const passes = Number(process.argv[6] || 5);
+
+const datagrams = [];
+for (let at = 0; at + 2 <= capture.length;) {
+    const length = capture[at] | (capture[at + 1] << 8);
+    if (!length || at + 2 + length > capture.length) {
+        break;
+    }
+    datagrams.push(capture.subarray(at + 2, at + 2 + length));
+    at += 2 + length;
+}
+const bytes = datagrams.reduce((sum, datagram) => sum + datagram.length, 0);
+
+function replay() {
+    let records = 0;
+    const drain = () => {
+        records += gdl90.processRing();
+        gdl90.setU32("gdl90OutputRingTail", gdl90.u32("gdl90OutputRingHead"));
+    };
+    for (const datagram of datagrams) {
+        while (!gdl90.writePacket(datagram)) {
+            drain();
+        }
+    }
+    do {
+        drain();
+    } while (gdl90.u32("gdl90InputRingTail") !== gdl90.u32("gdl90InputRingHead"));
+    return records;
+}
+
+async function run(path) {
+    const { instance } = await WebAssembly.instantiate(fs.readFileSync(path), GDL90.imports());
+    globalThis.gdl90 = new GDL90(instance);
+    gdl90.init();
+
+    const records = replay();
+    const times = [];
+    for (let i = 0; i < passes; i++) {
+        const start = process.hrtime.bigint();
+        replay();
+        times.push(Number(process.hrtime.bigint() - start) / 1e9);
+    }
+    times.sort((a, b) => a - b);
+    const seconds = times[times.length >> 1];
+    return { path, records, stats: gdl90.ringStats, seconds, mbps: bytes / seconds / 1e6 };
+}
+
+(async () => {
+    console.log(`${datagrams.length} datagrams, ${(bytes / 1e6).toFixed(2)} MB, median of ${passes} passes`);
+    const results = [];
+    for (const path of modules) {
+        const result = await run(path);
+        console.log(`${result.path} : ${result.records} records, ${result.seconds.toFixed(3)} s, ${result.mbps.toFixed(2)} MB/s`);
+        results.push(result);
+    }
+    if (results[0].records !== results[1].records) {
+        throw new Error("the modules decoded a different number of records");
+    }
+    console.log(`speedup : ${(results[0].seconds / results[1].seconds).toFixed(2)}x`);
+})().catch(e => {
+    console.error(e);
+    process.exit(1);
+});
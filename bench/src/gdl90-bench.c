@@ -0,0 +1,714 @@
+//
+//  gdl90-bench.c
+//  gdl90-bench
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Per stage timings (frame encoding, unescape, CRC, decoders, toString, GDL90Stream_process)
+// over a generated corpus with a controlled message mix and escape density.
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
+#include <gdl90.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_RESULTS 64
+#define BENCH_TEXT_SIZE 4096
+
+typedef enum BenchOutput
+{
+    BenchOutputText,
+    BenchOutputCSV,
+    BenchOutputJSON
+} BenchOutput;
+
+typedef struct BenchConfig
+{
+    size_t frameCount;
+    /** Share of message bytes (after the id) replaced by flag/escape bytes */
+    double escapeDensity;
+    /** Relative weight of each message id */
+    uint32_t mix[GDL90MessageType_LongReport + 1];
+    size_t datagramSize;
+    unsigned warmup;
+    unsigned repetitions;
+    int cpu;
+    uint32_t seed;
+    const char *filter;
+    BenchOutput output;
+} BenchConfig;
+
+typedef union BenchMessage BenchMessage;
+
+/** Unframed messages, their frames, their unescaped GDL90Message and decoded message */
+typedef struct BenchCorpus
+{
+    uint8_t *messages;
+    size_t *messageOffsets;
+    size_t *messageLengths;
+    uint8_t *frames;
+    size_t *frameOffsets;
+    size_t *frameLengths;
+    size_t framesLength;
+    GDL90Message *unescaped;
+    BenchMessage *decoded;
+    size_t count;
+} BenchCorpus;
+
+typedef struct BenchResult
+{
+    char name[48];
+    size_t frames;
+    size_t bytes;
+    double nsPerFrameMin;
+    double nsPerFrameMedian;
+    double mbPerSecond;
+} BenchResult;
+
+typedef struct BenchType
+{
+    uint8_t id;
+    const char *name;
+    GDL90Result (*init)(void *, GDL90Message *);
+    char* (*toString)(void *, char *, size_t);
+} BenchType;
+
+#define BENCH_TYPE_WRAPPERS(CLASS) \
+static GDL90Result CLASS ## _benchInit(void *self, GDL90Message *gdl90Message) { return CLASS ## _init((CLASS *)self, gdl90Message); } \
+static char* CLASS ## _benchToString(void *self, char *out, size_t len) { return CLASS ## _toString((CLASS *)self, out, len); }
+
+BENCH_TYPE_WRAPPERS(GDL90Heartbeat)
+BENCH_TYPE_WRAPPERS(GDL90Initialization)
+BENCH_TYPE_WRAPPERS(GDL90UplinkData)
+BENCH_TYPE_WRAPPERS(GDL90HeightAboveTerrain)
+BENCH_TYPE_WRAPPERS(GDL90OwnshipGeometricAltitude)
+BENCH_TYPE_WRAPPERS(GDL90TrafficReport)
+BENCH_TYPE_WRAPPERS(GDL90BasicReport)
+BENCH_TYPE_WRAPPERS(GDL90LongReport)
+
+#define BENCH_TYPE(ID, NAME, CLASS) { ID, NAME, CLASS ## _benchInit, CLASS ## _benchToString }
+
+static const BenchType benchTypes[] = {
+    BENCH_TYPE(GDL90MessageType_Heartbeat, "Heartbeat", GDL90Heartbeat),
+    BENCH_TYPE(GDL90MessageType_Initialization, "Initialization", GDL90Initialization),
+    BENCH_TYPE(GDL90MessageType_UplinkData, "UplinkData", GDL90UplinkData),
+    BENCH_TYPE(GDL90MessageType_HeightAboveTerrain, "HeightAboveTerrain", GDL90HeightAboveTerrain),
+    BENCH_TYPE(GDL90MessageType_OwnshipReport, "OwnshipReport", GDL90TrafficReport),
+    BENCH_TYPE(GDL90MessageType_OwnshipGeometricAltitude, "OwnshipGeometricAltitude", GDL90OwnshipGeometricAltitude),
+    BENCH_TYPE(GDL90MessageType_TrafficReport, "TrafficReport", GDL90TrafficReport),
+    BENCH_TYPE(GDL90MessageType_BasicReport, "BasicReport", GDL90BasicReport),
+    BENCH_TYPE(GDL90MessageType_LongReport, "LongReport", GDL90LongReport)
+};
+#define BENCH_TYPE_COUNT (sizeof(benchTypes) / sizeof(benchTypes[0]))
+
+/** Decoded message of any type */
+union BenchMessage
+{
+    GDL90Heartbeat heartbeat;
+    GDL90Initialization initialization;
+    GDL90UplinkData uplinkData;
+    GDL90HeightAboveTerrain heightAboveTerrain;
+    GDL90OwnshipGeometricAltitude ownshipGeometricAltitude;
+    GDL90TrafficReport trafficReport;
+    GDL90BasicReport basicReport;
+    GDL90LongReport longReport;
+};
+
+/** Keeps the results of the benchmarked calls alive */
+static volatile uint64_t benchSink;
+static uint32_t benchRandom;
+
+static inline uint32_t Bench_random(void)
+{
+    uint32_t x = benchRandom;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    benchRandom = x;
+    return x;
+}
+
+static inline uint64_t Bench_nowNs(void)
+{
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)clock() * (1000000000ull / CLOCKS_PER_SEC);
+#endif
+}
+
+static size_t Bench_messageLength(uint8_t id)
+{
+    switch (id)
+    {
+        case GDL90MessageType_Heartbeat: return 7;
+        case GDL90MessageType_Initialization: return 3;
+        case GDL90MessageType_UplinkData: return 436;
+        case GDL90MessageType_HeightAboveTerrain: return 3;
+        case GDL90MessageType_OwnshipReport: return 28;
+        case GDL90MessageType_OwnshipGeometricAltitude: return 5;
+        case GDL90MessageType_TrafficReport: return 28;
+        case GDL90MessageType_BasicReport: return 22;
+        case GDL90MessageType_LongReport: return 38;
+        default: return 0;
+    }
+}
+
+/** Plausible message bytes of type id, encoded from a struct where there is a _toBytes for it */
+static void Bench_message(uint8_t id, uint8_t *out, size_t len)
+{
+    for (size_t i = 1; i < len; i++)
+    {
+        out[i] = (uint8_t)Bench_random();
+    }
+    out[0] = id;
+
+    if (id == GDL90MessageType_OwnshipReport || id == GDL90MessageType_TrafficReport)
+    {
+        GDL90TrafficReport report = {0};
+        report.id = id;
+        report.participantAddress = Bench_random() & 0xffffff;
+        report.latitude = 44.0 + (double)(Bench_random() % 10000) / 5000.0;
+        report.longitude = -123.0 + (double)(Bench_random() % 10000) / 5000.0;
+        report.hasValidPosition = 1;
+        report.altitude = (int32_t)(Bench_random() % 1600) * 25;
+        report.hasValidAltitude = 1;
+        report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+        report.trackHeading = (double)(Bench_random() % 256) * (360.0 / 256.0);
+        report.airGroundState = 1;
+        report.navigationIntegrityCategory = 8;
+        report.navigationAccuracyCategoryForPosition = 9;
+        report.horizontalVelocity = Bench_random() % 500;
+        report.hasValidHorizontalVelocity = 1;
+        report.verticalVelocity = ((int32_t)(Bench_random() % 41) - 20) * 64;
+        report.hasValidVerticalVelocity = 1;
+        report.emitterCategory = GDL90TrafficReportEmitterCategoryLarge;
+        snprintf(report.callsign, sizeof(report.callsign), "N%u", Bench_random() % 100000);
+        GDL90TrafficReport_toBytes(&report, out);
+    }
+    else if (id == GDL90MessageType_OwnshipGeometricAltitude)
+    {
+        GDL90OwnshipGeometricAltitude geoAltitude = {0};
+        geoAltitude.id = id;
+        geoAltitude.geoAltitude = (int32_t)(Bench_random() % 8000) * 5;
+        geoAltitude.verticalFigureOfMerit = 10;
+        geoAltitude.hasValidVFOM = 1;
+        GDL90OwnshipGeometricAltitude_toBytes(&geoAltitude, out);
+    }
+}
+
+static int Bench_initCorpus(BenchCorpus *corpus, const BenchConfig *config)
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i <= GDL90MessageType_LongReport; i++)
+    {
+        total += Bench_messageLength((uint8_t)i) ? config->mix[i] : 0;
+    }
+    if (total == 0) { return 0; }
+
+    corpus->count = config->frameCount;
+    corpus->messages = malloc(config->frameCount * 436);
+    corpus->messageOffsets = malloc(config->frameCount * sizeof(size_t));
+    corpus->messageLengths = malloc(config->frameCount * sizeof(size_t));
+    corpus->frames = malloc(config->frameCount * GDL90_FRAME_MAX_SIZE);
+    corpus->frameOffsets = malloc(config->frameCount * sizeof(size_t));
+    corpus->frameLengths = malloc(config->frameCount * sizeof(size_t));
+    corpus->unescaped = calloc(config->frameCount, sizeof(GDL90Message));
+    corpus->decoded = calloc(config->frameCount, sizeof(BenchMessage));
+    if (!corpus->messages || !corpus->messageOffsets || !corpus->messageLengths || !corpus->frames
+        || !corpus->frameOffsets || !corpus->frameLengths || !corpus->unescaped || !corpus->decoded)
+    {
+        return 0;
+    }
+
+    GDL90FrameBuilder builder;
+    GDL90FrameBuilder_init(&builder, corpus->frames, config->frameCount * GDL90_FRAME_MAX_SIZE);
+
+    size_t offset = 0;
+    uint32_t escapeThreshold = (uint32_t)(config->escapeDensity * 65536.0);
+    for (size_t i = 0; i < config->frameCount; i++)
+    {
+        // weighted pick
+        uint32_t pick = Bench_random() % total;
+        uint8_t id = 0;
+        for (; id <= GDL90MessageType_LongReport; id++)
+        {
+            uint32_t weight = Bench_messageLength(id) ? config->mix[id] : 0;
+            if (pick < weight) { break; }
+            pick -= weight;
+        }
+
+        size_t len = Bench_messageLength(id);
+        uint8_t *message = corpus->messages + offset;
+        Bench_message(id, message, len);
+        for (size_t j = 1; j < len; j++)
+        {
+            if ((Bench_random() & 0xffff) < escapeThreshold)
+            {
+                message[j] = (Bench_random() & 1) ? 0x7e : 0x7d;
+            }
+        }
+        corpus->messageOffsets[i] = offset;
+        corpus->messageLengths[i] = len;
+        offset += len;
+
+        corpus->frameOffsets[i] = builder.length;
+        GDL90FrameBuilder_append(&builder, message, len);
+        corpus->frameLengths[i] = builder.length - corpus->frameOffsets[i];
+
+        GDL90Message_init(&corpus->unescaped[i], corpus->frames + corpus->frameOffsets[i], (uint16_t)corpus->frameLengths[i]);
+        // decoded once here, so toString is timed alone
+        for (size_t t = 0; t < BENCH_TYPE_COUNT; t++)
+        {
+            if (benchTypes[t].id == id)
+            {
+                benchTypes[t].init(&corpus->decoded[i], &corpus->unescaped[i]);
+                break;
+            }
+        }
+    }
+    corpus->framesLength = builder.length;
+
+    return 1;
+}
+
+static void Bench_freeCorpus(BenchCorpus *corpus)
+{
+    free(corpus->messages);
+    free(corpus->messageOffsets);
+    free(corpus->messageLengths);
+    free(corpus->frames);
+    free(corpus->frameOffsets);
+    free(corpus->frameLengths);
+    free(corpus->unescaped);
+    free(corpus->decoded);
+}
+
+typedef struct BenchContext
+{
+    const BenchConfig *config;
+    const BenchCorpus *corpus;
+    const BenchType *type;
+    uint8_t *buffer;
+    size_t bufferSize;
+    GDL90CRC crc;
+    GDL90Stream stream;
+} BenchContext;
+
+/** One pass over the corpus, returns the frames it processed */
+typedef size_t (BenchFunction)(BenchContext *, size_t *bytes);
+
+static size_t Bench_encode(BenchContext *context, size_t *bytes)
+{
+    const BenchCorpus *corpus = context->corpus;
+    GDL90FrameBuilder builder;
+    GDL90FrameBuilder_init(&builder, context->buffer, context->bufferSize);
+    for (size_t i = 0; i < corpus->count; i++)
+    {
+        if (GDL90FrameBuilder_append(&builder, corpus->messages + corpus->messageOffsets[i], corpus->messageLengths[i]) != GDL90ResultOK)
+        {
+            *bytes += builder.length;
+            GDL90FrameBuilder_reset(&builder);
+            GDL90FrameBuilder_append(&builder, corpus->messages + corpus->messageOffsets[i], corpus->messageLengths[i]);
+        }
+    }
+    *bytes += builder.length;
+    benchSink += builder.buffer[0];
+    return corpus->count;
+}
+
+/** Calls function with whole frames per datagram of the corpus, as received */
+static void Bench_datagrams(BenchContext *context, void (*function)(BenchContext *, const uint8_t *, uint16_t))
+{
+    const BenchCorpus *corpus = context->corpus;
+    size_t datagramSize = context->config->datagramSize;
+    size_t start = 0;
+    for (size_t i = 0; i < corpus->count; i++)
+    {
+        size_t end = corpus->frameOffsets[i] + corpus->frameLengths[i];
+        if (i + 1 == corpus->count || corpus->frameOffsets[i + 1] + corpus->frameLengths[i + 1] - start > datagramSize)
+        {
+            function(context, corpus->frames + start, (uint16_t)(end - start));
+            start = end;
+        }
+    }
+}
+
+/** Flag scan and deframing of GDL90Stream_process, without the CRC check and decoding */
+static void Bench_deframeDatagram(BenchContext *context, const uint8_t *data, uint16_t length)
+{
+    (void)context;
+    GDL90Message gdl90Message;
+    size_t start = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (data[i] != 0x7e) { continue; }
+        if (i > start)
+        {
+            gdl90Message.dataLength = 0;
+            GDL90Message_init(&gdl90Message, &data[start], (uint16_t)(i - start + 1));
+            benchSink += gdl90Message.dataLength;
+        }
+        start = i + 1;
+    }
+}
+
+static size_t Bench_framing(BenchContext *context, size_t *bytes)
+{
+    Bench_datagrams(context, Bench_deframeDatagram);
+    *bytes += context->corpus->framesLength;
+    return context->corpus->count;
+}
+
+static size_t Bench_unescape(BenchContext *context, size_t *bytes)
+{
+    const BenchCorpus *corpus = context->corpus;
+    GDL90Message gdl90Message;
+    for (size_t i = 0; i < corpus->count; i++)
+    {
+        gdl90Message.dataLength = 0;
+        GDL90Message_init(&gdl90Message, corpus->frames + corpus->frameOffsets[i], (uint16_t)corpus->frameLengths[i]);
+        benchSink += gdl90Message.dataLength;
+    }
+    *bytes += corpus->framesLength;
+    return corpus->count;
+}
+
+static size_t Bench_crc(BenchContext *context, size_t *bytes)
+{
+    const BenchCorpus *corpus = context->corpus;
+    for (size_t i = 0; i < corpus->count; i++)
+    {
+        GDL90Message *gdl90Message = &corpus->unescaped[i];
+        benchSink += GDL90CRC_isValid(&context->crc, gdl90Message->data, gdl90Message->dataLength);
+        *bytes += gdl90Message->dataLength;
+    }
+    return corpus->count;
+}
+
+static size_t Bench_init(BenchContext *context, size_t *bytes)
+{
+    const BenchCorpus *corpus = context->corpus;
+    BenchMessage message;
+    size_t count = 0;
+    for (size_t i = 0; i < corpus->count; i++)
+    {
+        GDL90Message *gdl90Message = &corpus->unescaped[i];
+        if (gdl90Message->id != context->type->id) { continue; }
+        benchSink += context->type->init(&message, gdl90Message);
+        benchSink += message.heartbeat.id;
+        *bytes += gdl90Message->dataLength;
+        count++;
+    }
+    return count;
+}
+
+static size_t Bench_toString(BenchContext *context, size_t *bytes)
+{
+    const BenchCorpus *corpus = context->corpus;
+    size_t count = 0;
+    for (size_t i = 0; i < corpus->count; i++)
+    {
+        if (corpus->unescaped[i].id != context->type->id) { continue; }
+        char *text = context->type->toString(&corpus->decoded[i], (char *)context->buffer, BENCH_TEXT_SIZE);
+        size_t len = strlen(text);
+        benchSink += len;
+        *bytes += len;
+        count++;
+    }
+    return count;
+}
+
+static void Bench_handleMessage(GDL90Message *gdl90Message, void *message)
+{
+    (void)message;
+    benchSink += gdl90Message->id;
+}
+
+static void Bench_handleError(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    benchSink += (uint64_t)error + 1;
+}
+
+static void Bench_streamDatagram(BenchContext *context, const uint8_t *data, uint16_t length)
+{
+    GDL90Stream_process(&context->stream, data, length);
+}
+
+static size_t Bench_stream(BenchContext *context, size_t *bytes)
+{
+    Bench_datagrams(context, Bench_streamDatagram);
+    *bytes += context->corpus->framesLength;
+    return context->corpus->count;
+}
+
+static int Bench_compareDouble(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static int Bench_run(BenchContext *context, const char *name, BenchFunction *function, BenchResult *result)
+{
+    const BenchConfig *config = context->config;
+    if (config->filter && !strstr(name, config->filter)) { return 0; }
+
+    size_t frames = 0, bytes = 0;
+    for (unsigned i = 0; i < config->warmup; i++)
+    {
+        bytes = 0;
+        frames = function(context, &bytes);
+    }
+    if (frames == 0 && config->warmup > 0) { return 0; }
+
+    double ns[256];
+    unsigned repetitions = config->repetitions > 256 ? 256 : config->repetitions;
+    for (unsigned i = 0; i < repetitions; i++)
+    {
+        bytes = 0;
+        uint64_t start = Bench_nowNs();
+        frames = function(context, &bytes);
+        ns[i] = (double)(Bench_nowNs() - start);
+    }
+    if (frames == 0) { return 0; }
+    qsort(ns, repetitions, sizeof(double), Bench_compareDouble);
+
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->frames = frames;
+    result->bytes = bytes;
+    result->nsPerFrameMin = ns[0] / (double)frames;
+    result->nsPerFrameMedian = ns[repetitions / 2] / (double)frames;
+    result->mbPerSecond = ns[repetitions / 2] > 0.0 ? (double)bytes / ns[repetitions / 2] * 1e3 : 0.0;
+
+    return 1;
+}
+
+static void Bench_print(const BenchConfig *config, const BenchResult *results, size_t count)
+{
+    if (config->output == BenchOutputCSV)
+    {
+        printf("benchmark,frames,bytes,ns_per_frame_min,ns_per_frame_median,mb_per_s\n");
+        for (size_t i = 0; i < count; i++)
+        {
+            printf("%s,%zu,%zu,%.2f,%.2f,%.2f\n", results[i].name, results[i].frames, results[i].bytes,
+                results[i].nsPerFrameMin, results[i].nsPerFrameMedian, results[i].mbPerSecond);
+        }
+    }
+    else if (config->output == BenchOutputJSON)
+    {
+        printf("{\"config\":{\"frames\":%zu,\"escapeDensity\":%.3f,\"datagramSize\":%zu,\"warmup\":%u,\"repetitions\":%u,\"cpu\":%d,\"seed\":%u,\"mix\":{",
+            config->frameCount, config->escapeDensity, config->datagramSize, config->warmup, config->repetitions, config->cpu, config->seed);
+        const char *separator = "";
+        for (size_t i = 0; i <= GDL90MessageType_LongReport; i++)
+        {
+            if (!config->mix[i] || !Bench_messageLength((uint8_t)i)) { continue; }
+            printf("%s\"%zu\":%u", separator, i, config->mix[i]);
+            separator = ",";
+        }
+        printf("}},\"results\":[");
+        for (size_t i = 0; i < count; i++)
+        {
+            printf("%s{\"benchmark\":\"%s\",\"frames\":%zu,\"bytes\":%zu,\"nsPerFrameMin\":%.2f,\"nsPerFrameMedian\":%.2f,\"mbPerSecond\":%.2f}",
+                i ? "," : "", results[i].name, results[i].frames, results[i].bytes,
+                results[i].nsPerFrameMin, results[i].nsPerFrameMedian, results[i].mbPerSecond);
+        }
+        printf("]}\n");
+    }
+    else
+    {
+        printf("%-40s %10s %12s %12s %12s %10s\n", "benchmark", "frames", "bytes", "ns/frame", "(min)", "MB/s");
+        for (size_t i = 0; i < count; i++)
+        {
+            printf("%-40s %10zu %12zu %12.2f %12.2f %10.2f\n", results[i].name, results[i].frames, results[i].bytes,
+                results[i].nsPerFrameMedian, results[i].nsPerFrameMin, results[i].mbPerSecond);
+        }
+    }
+}
+
+/** id:weight[,id:weight...] */
+static int Bench_parseMix(BenchConfig *config, const char *str)
+{
+    memset(config->mix, 0, sizeof(config->mix));
+    while (*str)
+    {
+        char *end = NULL;
+        unsigned long id = strtoul(str, &end, 10);
+        unsigned long weight = 1;
+        if (end == str || id > GDL90MessageType_LongReport || !Bench_messageLength((uint8_t)id)) { return 0; }
+        str = end;
+        if (*str == ':')
+        {
+            weight = strtoul(str + 1, &end, 10);
+            str = end;
+        }
+        config->mix[id] = (uint32_t)weight;
+        if (*str == ',') { str++; }
+        else if (*str) { return 0; }
+    }
+    return 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "gdl90-bench [options]\n"
+        "  -n frames       corpus size (default 10000)\n"
+        "  -m mix          id:weight,... (default 0:1,7:4,9:1,10:1,11:1,20:20,30:5,31:5)\n"
+        "  -e density      share of message bytes that need escaping, 0-1 (default 0)\n"
+        "  -d size         datagram size for GDL90Stream_process (default 1400)\n"
+        "  -w warmup       warmup passes (default 2)\n"
+        "  -r repetitions  timed passes, the median is reported (default 11, max 256)\n"
+        "  -c cpu          pin to cpu (linux)\n"
+        "  -s seed         corpus seed\n"
+        "  -b name         only the benchmarks containing name\n"
+        "  -o format       text, csv or json (default text)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config;
+    memset(&config, 0, sizeof(config));
+    config.frameCount = 10000;
+    config.datagramSize = 1400;
+    config.warmup = 2;
+    config.repetitions = 11;
+    config.cpu = -1;
+    config.seed = 0x2545f491;
+    Bench_parseMix(&config, "0:1,7:4,9:1,10:1,11:1,20:20,30:5,31:5");
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "-h") == 0) { usage(); return EXIT_SUCCESS; }
+        if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0' || !value) { usage(); return EXIT_FAILURE; }
+        i++;
+
+        switch (arg[1])
+        {
+            case 'n': config.frameCount = strtoul(value, NULL, 10); break;
+            case 'm': if (!Bench_parseMix(&config, value)) { usage(); return EXIT_FAILURE; } break;
+            case 'e': config.escapeDensity = strtod(value, NULL); break;
+            case 'd': config.datagramSize = strtoul(value, NULL, 10); break;
+            case 'w': config.warmup = (unsigned)strtoul(value, NULL, 10); break;
+            case 'r': config.repetitions = (unsigned)strtoul(value, NULL, 10); break;
+            case 'c': config.cpu = (int)strtol(value, NULL, 10); break;
+            case 's': config.seed = (uint32_t)strtoul(value, NULL, 10) | 1; break;
+            case 'b': config.filter = value; break;
+            case 'o':
+                if (strcmp(value, "text") == 0) { config.output = BenchOutputText; }
+                else if (strcmp(value, "csv") == 0) { config.output = BenchOutputCSV; }
+                else if (strcmp(value, "json") == 0) { config.output = BenchOutputJSON; }
+                else { usage(); return EXIT_FAILURE; }
+                break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    if (config.frameCount == 0 || config.repetitions == 0 || config.escapeDensity < 0.0 || config.escapeDensity > 1.0
+        || config.datagramSize < GDL90_FRAME_MAX_SIZE || config.datagramSize > UINT16_MAX)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (config.cpu >= 0)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config.cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            perror("sched_setaffinity");
+            return EXIT_FAILURE;
+        }
+#else
+        fprintf(stderr, "CPU pinning is only supported on linux\n");
+#endif
+    }
+
+    benchRandom = config.seed;
+    BenchCorpus corpus;
+    memset(&corpus, 0, sizeof(corpus));
+    if (!Bench_initCorpus(&corpus, &config))
+    {
+        fprintf(stderr, "Failed to create the corpus\n");
+        Bench_freeCorpus(&corpus);
+        return EXIT_FAILURE;
+    }
+
+    BenchContext context;
+    memset(&context, 0, sizeof(context));
+    context.config = &config;
+    context.corpus = &corpus;
+    context.bufferSize = config.datagramSize > BENCH_TEXT_SIZE ? config.datagramSize : BENCH_TEXT_SIZE;
+    context.buffer = malloc(context.bufferSize);
+    GDL90CRC_init(&context.crc);
+    GDL90StreamConfig streamConfig;
+    GDL90StreamConfig_init(&streamConfig, Bench_handleMessage, Bench_handleError);
+    GDL90Stream_init(&context.stream, &streamConfig);
+    if (!context.buffer)
+    {
+        Bench_freeCorpus(&corpus);
+        return EXIT_FAILURE;
+    }
+
+    static BenchResult results[BENCH_MAX_RESULTS];
+    size_t count = 0;
+    char name[48];
+
+    count += (size_t)Bench_run(&context, "encode", Bench_encode, &results[count]);
+    count += (size_t)Bench_run(&context, "framing", Bench_framing, &results[count]);
+    count += (size_t)Bench_run(&context, "unescape", Bench_unescape, &results[count]);
+    count += (size_t)Bench_run(&context, "crc", Bench_crc, &results[count]);
+    for (size_t i = 0; i < BENCH_TYPE_COUNT; i++)
+    {
+        context.type = &benchTypes[i];
+        snprintf(name, sizeof(name), "init.%s", benchTypes[i].name);
+        count += (size_t)Bench_run(&context, name, Bench_init, &results[count]);
+    }
+    for (size_t i = 0; i < BENCH_TYPE_COUNT; i++)
+    {
+        context.type = &benchTypes[i];
+        snprintf(name, sizeof(name), "toString.%s", benchTypes[i].name);
+        count += (size_t)Bench_run(&context, name, Bench_toString, &results[count]);
+    }
+    count += (size_t)Bench_run(&context, "stream", Bench_stream, &results[count]);
+
+    Bench_print(&config, results, count);
+
+    free(context.buffer);
+    Bench_freeCorpus(&corpus);
+
+    return benchSink == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
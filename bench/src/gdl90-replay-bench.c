@@ -0,0 +1,594 @@
+//
+//  gdl90-replay-bench.c
+//  gdl90-bench
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// End to end throughput : a deterministic synthetic capture of datagrams is written to a file,
+// then read back through GDL90Stream_process into a target table, spatial grid and ownship state.
+// Compares the frames/s against a baseline file, failing on a regression past the tolerance, or
+// skipped when the baseline was measured with another build type.
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
+#include <gdl90.h>
+#include <gdl90-traffic.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#define REPLAY_DATAGRAM_SIZE 1400
+#define REPLAY_CAPACITY 8192
+#define REPLAY_GRID_BUCKETS 4096
+#define REPLAY_UPLINKS_PER_SECOND 4
+/** Exit code of a baseline check skipped for another build type (SKIP_RETURN_CODE of the test) */
+#define REPLAY_SKIPPED 77
+#define REPLAY_NO_BUILD_TYPE "(no CMAKE_BUILD_TYPE)"
+/** Log-linear latency histogram : 16 sub buckets per power of 2 ns */
+#define REPLAY_HISTOGRAM_SUB_BUCKETS 16
+#define REPLAY_HISTOGRAM_BUCKETS (64 * REPLAY_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct ReplayTarget
+{
+    uint32_t address;
+    double latitude;
+    double longitude;
+    double latitudeRate;
+    double longitudeRate;
+    int32_t altitude;
+    uint8_t basicLong;
+} ReplayTarget;
+
+typedef struct Replay
+{
+    // consumer
+    GDL90TargetTable table;
+    GDL90TargetTableSlot slots[REPLAY_CAPACITY];
+    GDL90Target targets[REPLAY_CAPACITY];
+    GDL90SpatialGrid grid;
+    uint32_t buckets[REPLAY_GRID_BUCKETS];
+    GDL90SpatialGridNode nodes[REPLAY_CAPACITY];
+    GDL90OwnshipState ownship;
+    uint64_t timeMs;
+
+    // measurements
+    uint64_t datagramStartNs;
+    uint64_t frameCount;
+    uint64_t errorCount;
+    uint64_t histogram[REPLAY_HISTOGRAM_BUCKETS];
+} Replay;
+
+static Replay replay;
+static uint32_t replayRandom = 0x2545f491;
+
+static inline uint32_t Replay_random(void)
+{
+    uint32_t x = replayRandom;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    replayRandom = x;
+    return x;
+}
+
+static inline uint64_t Replay_nowNs(void)
+{
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)clock() * (1000000000ull / CLOCKS_PER_SEC);
+#endif
+}
+
+static inline uint32_t Replay_histogramIndex(uint64_t ns)
+{
+    if (ns < REPLAY_HISTOGRAM_SUB_BUCKETS) { return (uint32_t)ns; }
+    uint32_t exponent = 63;
+    while (!(ns >> exponent)) { exponent--; }
+    // exponent >= 4 here
+    uint32_t sub = (uint32_t)(ns >> (exponent - 4)) & (REPLAY_HISTOGRAM_SUB_BUCKETS - 1);
+    return (exponent - 3) * REPLAY_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+/** Upper bound (ns) of the bucket */
+static uint64_t Replay_histogramValue(uint32_t index)
+{
+    if (index < REPLAY_HISTOGRAM_SUB_BUCKETS) { return index; }
+    uint32_t exponent = index / REPLAY_HISTOGRAM_SUB_BUCKETS + 3;
+    uint64_t sub = index % REPLAY_HISTOGRAM_SUB_BUCKETS;
+    return ((REPLAY_HISTOGRAM_SUB_BUCKETS + sub + 1) << (exponent - 4)) - 1;
+}
+
+static uint64_t Replay_percentile(double percentile)
+{
+    uint64_t rank = (uint64_t)((double)replay.frameCount * percentile);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < REPLAY_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += replay.histogram[i];
+        if (seen > rank) { return Replay_histogramValue(i); }
+    }
+    return 0;
+}
+
+static inline void Replay_record(void)
+{
+    replay.frameCount++;
+    replay.histogram[Replay_histogramIndex(Replay_nowNs() - replay.datagramStartNs)]++;
+}
+
+static void Replay_handleMessage(GDL90Message *gdl90Message, void *message)
+{
+    switch (gdl90Message->id)
+    {
+        case GDL90MessageType_Heartbeat:
+            replay.timeMs += 1000;
+            GDL90OwnshipState_setTime(&replay.ownship, replay.timeMs);
+            GDL90TargetTable_evict(&replay.table, replay.timeMs > 10000 ? replay.timeMs - 10000 : 0);
+            break;
+        case GDL90MessageType_TrafficReport:
+        {
+            GDL90Target *target = NULL;
+            if (GDL90TargetTable_update(&replay.table, replay.timeMs, (GDL90TrafficReport *)message, &target) == GDL90ResultOK)
+            {
+                GDL90SpatialGrid_updateTarget(&replay.grid, &replay.table, target);
+            }
+            break;
+        }
+        case GDL90MessageType_OwnshipReport:
+        case GDL90MessageType_OwnshipGeometricAltitude:
+            GDL90OwnshipState_update(&replay.ownship, replay.timeMs, gdl90Message);
+            break;
+        default:
+            break;
+    }
+    Replay_record();
+}
+
+static void Replay_handleError(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    (void)error;
+    replay.errorCount++;
+    Replay_record();
+}
+
+typedef struct ReplayWriter
+{
+    FILE *file;
+    GDL90FrameBuilder builder;
+    uint8_t datagram[REPLAY_DATAGRAM_SIZE];
+    uint64_t bytes;
+    uint64_t frames;
+} ReplayWriter;
+
+/** Records are a 2 byte (LS byte first) length followed by the datagram */
+static void ReplayWriter_flush(ReplayWriter *self)
+{
+    if (self->builder.length == 0) { return; }
+    uint8_t length[2] = { (uint8_t)self->builder.length, (uint8_t)(self->builder.length >> 8) };
+    fwrite(length, 1, sizeof(length), self->file);
+    fwrite(self->datagram, 1, self->builder.length, self->file);
+    self->bytes += self->builder.length;
+    GDL90FrameBuilder_reset(&self->builder);
+}
+
+static void ReplayWriter_emit(ReplayWriter *self, const uint8_t *message, size_t len)
+{
+    if (GDL90FrameBuilder_append(&self->builder, message, len) != GDL90ResultOK)
+    {
+        ReplayWriter_flush(self);
+        GDL90FrameBuilder_append(&self->builder, message, len);
+    }
+    self->frames++;
+}
+
+static void Replay_report(GDL90TrafficReport *report, uint8_t id, const ReplayTarget *target)
+{
+    memset(report, 0, sizeof(*report));
+    report->id = id;
+    report->participantAddress = target->address;
+    report->latitude = target->latitude;
+    report->longitude = target->longitude;
+    report->hasValidPosition = 1;
+    report->altitude = target->altitude;
+    report->hasValidAltitude = 1;
+    report->trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report->trackHeading = (double)(target->address % 256) * (360.0 / 256.0);
+    report->airGroundState = 1;
+    report->navigationIntegrityCategory = 8;
+    report->navigationAccuracyCategoryForPosition = 9;
+    report->horizontalVelocity = 120 + target->address % 300;
+    report->hasValidHorizontalVelocity = 1;
+    report->hasValidVerticalVelocity = 1;
+    report->emitterCategory = GDL90TrafficReportEmitterCategoryLarge;
+    snprintf(report->callsign, sizeof(report->callsign), "N%u", target->address % 100000);
+}
+
+/**
+ * Per simulated second : Heartbeat, Ownship Report, Ownship Geometric Altitude, uplinks and one
+ * Traffic Report per target, plus a Basic or Long Report for a fifth of them.
+ */
+static int Replay_generate(const char *path, uint64_t size, uint32_t targetCount)
+{
+    static ReplayWriter writer;
+    static ReplayTarget targets[REPLAY_CAPACITY];
+
+    writer.file = fopen(path, "wb");
+    if (!writer.file) { return 0; }
+    GDL90FrameBuilder_init(&writer.builder, writer.datagram, sizeof(writer.datagram));
+
+    for (uint32_t i = 0; i < targetCount; i++)
+    {
+        targets[i].address = (i * 0x9e3779b1u) & 0xffffff;
+        targets[i].latitude = 44.0 + (double)(Replay_random() % 20000) / 10000.0;
+        targets[i].longitude = -123.0 + (double)(Replay_random() % 20000) / 10000.0;
+        targets[i].latitudeRate = ((double)(Replay_random() % 2001) - 1000.0) / 1e6;
+        targets[i].longitudeRate = ((double)(Replay_random() % 2001) - 1000.0) / 1e6;
+        targets[i].altitude = (int32_t)(Replay_random() % 1600) * 25;
+        targets[i].basicLong = Replay_random() % 5 == 0;
+    }
+    ReplayTarget ownship = { 0xabcdef, 45.0, -122.0, 0.0005, 0.0005, 5500, 0 };
+
+    uint8_t bytes[436];
+    GDL90TrafficReport report;
+    for (uint32_t second = 0; writer.bytes < size; second++)
+    {
+        GDL90Heartbeat heartbeat = { GDL90MessageType_Heartbeat, 0x81, 0x01, second % 86400, REPLAY_UPLINKS_PER_SECOND, 0 };
+        ReplayWriter_emit(&writer, GDL90Heartbeat_toBytes(&heartbeat, bytes), 7);
+
+        ownship.latitude += ownship.latitudeRate;
+        ownship.longitude += ownship.longitudeRate;
+        Replay_report(&report, GDL90MessageType_OwnshipReport, &ownship);
+        ReplayWriter_emit(&writer, GDL90TrafficReport_toBytes(&report, bytes), 28);
+
+        GDL90OwnshipGeometricAltitude geoAltitude = { GDL90MessageType_OwnshipGeometricAltitude, 0, 1, 10, ownship.altitude + 150 };
+        ReplayWriter_emit(&writer, GDL90OwnshipGeometricAltitude_toBytes(&geoAltitude, bytes), 5);
+
+        GDL90UplinkData uplink;
+        memset(&uplink, 0, sizeof(uplink));
+        uplink.id = GDL90MessageType_UplinkData;
+        uplink.hasValidTor = 1;
+        for (uint32_t i = 0; i < REPLAY_UPLINKS_PER_SECOND; i++)
+        {
+            for (size_t j = 0; j < sizeof(uplink.payload); j++)
+            {
+                uplink.payload[j] = (uint8_t)Replay_random();
+            }
+            uplink.timeOfReception = i * 80000;
+            ReplayWriter_emit(&writer, GDL90UplinkData_toBytes(&uplink, bytes), 436);
+        }
+
+        for (uint32_t i = 0; i < targetCount; i++)
+        {
+            ReplayTarget *target = &targets[i];
+            target->latitude += target->latitudeRate;
+            target->longitude += target->longitudeRate;
+            Replay_report(&report, GDL90MessageType_TrafficReport, target);
+            ReplayWriter_emit(&writer, GDL90TrafficReport_toBytes(&report, bytes), 28);
+
+            if (target->basicLong && (i & 1))
+            {
+                GDL90LongReport longReport = { GDL90MessageType_LongReport, (i % 12500) * 80, {0}, 1 };
+                for (size_t j = 0; j < sizeof(longReport.payload); j++)
+                {
+                    longReport.payload[j] = (uint8_t)Replay_random();
+                }
+                ReplayWriter_emit(&writer, GDL90LongReport_toBytes(&longReport, bytes), 38);
+            }
+            else if (target->basicLong)
+            {
+                GDL90BasicReport basicReport = { GDL90MessageType_BasicReport, (i % 12500) * 80, {0}, 1 };
+                for (size_t j = 0; j < sizeof(basicReport.payload); j++)
+                {
+                    basicReport.payload[j] = (uint8_t)Replay_random();
+                }
+                ReplayWriter_emit(&writer, GDL90BasicReport_toBytes(&basicReport, bytes), 22);
+            }
+        }
+    }
+    ReplayWriter_flush(&writer);
+
+    int ok = ferror(writer.file) == 0;
+    fclose(writer.file);
+    return ok;
+}
+
+static uint64_t Replay_peakRSSKB(void)
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss / 1024;
+#else
+    return (uint64_t)usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+/**
+ * framesPerSecond of a baseline file, 0 if missing. Lines starting with # describe how it was
+ * measured, buildType gets the "# build" one (empty if none)
+ */
+static double Replay_readBaseline(const char *path, char *buildType, size_t buildTypeSize)
+{
+    buildType[0] = '\0';
+    FILE *file = fopen(path, "r");
+    if (!file) { return 0.0; }
+    char line[256];
+    double value = 0.0;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (strncmp(line, "# build ", 8) == 0)
+        {
+            size_t length = strcspn(line + 8, "\r\n");
+            if (length >= buildTypeSize) { length = buildTypeSize - 1; }
+            memcpy(buildType, line + 8, length);
+            buildType[length] = '\0';
+        }
+        if (sscanf(line, "framesPerSecond %lf", &value) == 1) { break; }
+        value = 0.0;
+    }
+    fclose(file);
+    return value;
+}
+
+/** Writes the machine (cpu model on linux), build type and compiler a baseline was measured with */
+static void Replay_writeBaselineHeader(FILE *file)
+{
+    char cpu[128] = "unknown";
+#ifdef __linux__
+    FILE *cpuinfo = fopen("/proc/cpuinfo", "r");
+    if (cpuinfo)
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), cpuinfo))
+        {
+            const char *colon = strchr(line, ':');
+            if (strncmp(line, "model name", 10) == 0 && colon)
+            {
+                snprintf(cpu, sizeof(cpu), "%s", colon + 2);
+                cpu[strcspn(cpu, "\n")] = 0;
+                break;
+            }
+        }
+        fclose(cpuinfo);
+    }
+#endif
+    fprintf(file, "# machine %s\n", cpu);
+#ifdef GDL90_BUILD_TYPE
+    fprintf(file, "# build %s\n", GDL90_BUILD_TYPE[0] ? GDL90_BUILD_TYPE : REPLAY_NO_BUILD_TYPE);
+#endif
+#if defined(__GNUC__) && !defined(__clang__)
+    fprintf(file, "# compiler gcc %s\n", __VERSION__);
+#elif defined(__VERSION__)
+    fprintf(file, "# compiler %s\n", __VERSION__);
+#endif
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "gdl90-replay-bench [options]\n"
+        "  -s MB           capture size (default 256)\n"
+        "  -n targets      simulated targets (1-%u, default 2000)\n"
+        "  -f path         capture file (default gdl90-replay.bin)\n"
+        "  -k              keep and reuse the capture file if it exists\n"
+        "  -c cpu          pin to cpu (linux)\n"
+        "  -o format       text or json (default text)\n"
+        "  -B path         baseline file to check (or write with -W) the frames/s against\n"
+        "  -t tolerance    allowed regression from the baseline (default 0.25)\n"
+        "  -W              write the measured frames/s to the baseline file\n"
+        , REPLAY_CAPACITY * 7 / 8);
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t sizeMB = 256;
+    uint32_t targetCount = 2000;
+    const char *path = "gdl90-replay.bin";
+    const char *baselinePath = NULL;
+    double tolerance = 0.25;
+    int keep = 0, writeBaseline = 0, json = 0, cpu = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "-k") == 0) { keep = 1; continue; }
+        if (strcmp(arg, "-W") == 0) { writeBaseline = 1; continue; }
+        if (strcmp(arg, "-h") == 0) { usage(); return EXIT_SUCCESS; }
+        if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0' || !value) { usage(); return EXIT_FAILURE; }
+        i++;
+
+        switch (arg[1])
+        {
+            case 's': sizeMB = strtoull(value, NULL, 10); break;
+            case 'n': targetCount = (uint32_t)strtoul(value, NULL, 10); break;
+            case 'f': path = value; break;
+            case 'c': cpu = (int)strtol(value, NULL, 10); break;
+            case 'o': json = strcmp(value, "json") == 0; break;
+            case 'B': baselinePath = value; break;
+            case 't': tolerance = strtod(value, NULL); break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+    if (sizeMB == 0 || targetCount == 0 || targetCount > REPLAY_CAPACITY * 7 / 8 || (writeBaseline && !baselinePath))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // a baseline only holds for the build type it was measured with
+    double baseline = 0.0;
+    if (baselinePath && !writeBaseline)
+    {
+        char buildType[64];
+        baseline = Replay_readBaseline(baselinePath, buildType, sizeof(buildType));
+        if (baseline <= 0.0)
+        {
+            fprintf(stderr, "No framesPerSecond in %s\n", baselinePath);
+            return EXIT_FAILURE;
+        }
+#ifdef GDL90_BUILD_TYPE
+        const char *currentBuildType = GDL90_BUILD_TYPE[0] ? GDL90_BUILD_TYPE : REPLAY_NO_BUILD_TYPE;
+        if (buildType[0] && strcmp(buildType, currentBuildType) != 0)
+        {
+            fprintf(stderr, "%s was measured with a %s build, this is a %s one : skipped\n", baselinePath, buildType, currentBuildType);
+            return REPLAY_SKIPPED;
+        }
+#endif
+    }
+
+    if (cpu >= 0)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            perror("sched_setaffinity");
+            return EXIT_FAILURE;
+        }
+#else
+        fprintf(stderr, "CPU pinning is only supported on linux\n");
+#endif
+    }
+
+    FILE *file = keep ? fopen(path, "rb") : NULL;
+    if (!file)
+    {
+        if (!Replay_generate(path, sizeMB * 1000000, targetCount))
+        {
+            fprintf(stderr, "Failed to create %s\n", path);
+            return EXIT_FAILURE;
+        }
+        file = fopen(path, "rb");
+    }
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    GDL90TargetTable_init(&replay.table, replay.slots, replay.targets, REPLAY_CAPACITY);
+    GDL90SpatialGrid_init(&replay.grid, 0.25, replay.buckets, REPLAY_GRID_BUCKETS, replay.nodes, REPLAY_CAPACITY);
+    GDL90TargetTable_setRemovalHandler(&replay.table, GDL90SpatialGrid_handleTargetRemoval, &replay.grid);
+    GDL90OwnshipState_init(&replay.ownship);
+
+    GDL90StreamConfig streamConfig;
+    GDL90Stream stream;
+    GDL90StreamConfig_init(&streamConfig, Replay_handleMessage, Replay_handleError);
+    GDL90Stream_init(&stream, &streamConfig);
+
+    // read in large blocks, datagrams are processed in place
+    static uint8_t block[1<<20];
+    size_t blockLength = 0, offset = 0;
+    uint64_t bytes = 0;
+    uint64_t startNs = Replay_nowNs();
+    for (;;)
+    {
+        if (blockLength - offset < 2 + REPLAY_DATAGRAM_SIZE)
+        {
+            memmove(block, block + offset, blockLength - offset);
+            blockLength -= offset;
+            offset = 0;
+            blockLength += fread(block + blockLength, 1, sizeof(block) - blockLength, file);
+            if (blockLength < 2) { break; }
+        }
+
+        uint16_t length = (uint16_t)(block[offset] | block[offset + 1] << 8);
+        if (offset + 2 + length > blockLength) { break; }
+        replay.datagramStartNs = Replay_nowNs();
+        GDL90Stream_process(&stream, block + offset + 2, length);
+        bytes += length;
+        offset += 2 + (size_t)length;
+    }
+    double seconds = (double)(Replay_nowNs() - startNs) / 1e9;
+    fclose(file);
+
+    double framesPerSecond = seconds > 0.0 ? (double)replay.frameCount / seconds : 0.0;
+    double bytesPerSecond = seconds > 0.0 ? (double)bytes / seconds : 0.0;
+    uint64_t p50 = Replay_percentile(0.50);
+    uint64_t p99 = Replay_percentile(0.99);
+    uint64_t peakRSSKB = Replay_peakRSSKB();
+
+    if (json)
+    {
+        printf("{\"frames\":%llu,\"errors\":%llu,\"bytes\":%llu,\"seconds\":%.3f,\"framesPerSecond\":%.0f,\"bytesPerSecond\":%.0f,\"p50Ns\":%llu,\"p99Ns\":%llu,\"peakRSSKB\":%llu,\"targets\":%u}\n",
+            (unsigned long long)replay.frameCount, (unsigned long long)replay.errorCount, (unsigned long long)bytes, seconds,
+            framesPerSecond, bytesPerSecond, (unsigned long long)p50, (unsigned long long)p99, (unsigned long long)peakRSSKB, replay.table.count);
+    }
+    else
+    {
+        printf("%llu frames (%llu errors), %llu bytes in %.3f s\n"
+               "%.0f frames/s, %.2f MB/s\n"
+               "latency from datagram to frame : p50 %llu ns, p99 %llu ns\n"
+               "peak RSS %llu KB, %u targets\n",
+            (unsigned long long)replay.frameCount, (unsigned long long)replay.errorCount, (unsigned long long)bytes, seconds,
+            framesPerSecond, bytesPerSecond / 1e6, (unsigned long long)p50, (unsigned long long)p99, (unsigned long long)peakRSSKB, replay.table.count);
+    }
+
+    if (replay.errorCount != 0 || replay.frameCount == 0)
+    {
+        fprintf(stderr, "Unexpected errors replaying %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    if (baselinePath && writeBaseline)
+    {
+        FILE *baseline = fopen(baselinePath, "w");
+        if (!baseline)
+        {
+            fprintf(stderr, "Failed to write %s\n", baselinePath);
+            return EXIT_FAILURE;
+        }
+        Replay_writeBaselineHeader(baseline);
+        fprintf(baseline, "framesPerSecond %.0f\n", framesPerSecond);
+        fclose(baseline);
+    }
+    else if (baselinePath)
+    {
+        if (framesPerSecond < baseline * (1.0 - tolerance))
+        {
+            fprintf(stderr, "Regression : %.0f frames/s, baseline %.0f frames/s (tolerance %.0f%%)\n", framesPerSecond, baseline, tolerance * 100.0);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -23,13 +23,19 @@
 // SOFTWARE.
 
 #include <gdl90.h>
+#include <gdl90-capture.h>
 
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
 #define MAX_PACKET_SIZE 1024
+#define MS_PER_DAY (24ULL * 60 * 60 * 1000)
 
 static char textbuf[1024] = {0};
 
@@ -84,6 +90,57 @@ static void handleGDL90Error(GDL90Message *gdl90Message, GDL90StreamProcessingEr
     }
 }
 
+/** Either ms since the epoch, or HH:MM[:SS] (UTC) on the day of the first record */
+static uint64_t getReplayTime(const char *str, uint64_t firstTimeMs)
+{
+    unsigned hh = 0, mm = 0, ss = 0;
+    if (strchr(str, ':') && sscanf(str, "%u:%u:%u", &hh, &mm, &ss) >= 2)
+    {
+        uint64_t timeMs = firstTimeMs - firstTimeMs % MS_PER_DAY + ((uint64_t)hh * 3600 + mm * 60 + ss) * 1000;
+        return timeMs < firstTimeMs ? timeMs + MS_PER_DAY : timeMs;
+    }
+    return strtoull(str, NULL, 10);
+}
+
+static int replayCapture(GDL90Stream *gdl90Stream, const char *path, const char *from)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        printf("Failed to open %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    static GDL90CaptureRecord record;
+    GDL90CaptureReader reader = {0};
+    if (GDL90CaptureReader_init(&reader, file) != GDL90ResultOK)
+    {
+        printf("Not a GDL90 capture : %s\n", path);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    if (from)
+    {
+        if (GDL90CaptureReader_next(&reader, &record) != GDL90ResultOK
+            || GDL90CaptureReader_seek(&reader, getReplayTime(from, record.timeMs)) != GDL90ResultOK)
+        {
+            printf("Failed to seek to %s (capture without index?)\n", from);
+            fclose(file);
+            return EXIT_FAILURE;
+        }
+    }
+
+    while (GDL90CaptureReader_next(&reader, &record) == GDL90ResultOK)
+    {
+        printf("@%llu (source %u)\n", (unsigned long long)record.timeMs, record.sourceId);
+        GDL90Stream_handleUnescapedMessage(gdl90Stream, &record.message);
+    }
+
+    fclose(file);
+    return EXIT_SUCCESS;
+}
+
 uint16_t getPacketFromHexStr(char *buf, uint16_t buflen, uint8_t packet[MAX_PACKET_SIZE])
 {
     uint16_t packetLength = 0;
@@ -132,7 +189,47 @@ int main(int argc, char *argv[])
     GDL90StreamConfig_init(&gdl90StreamConfig, handleGDL90Message, handleGDL90Error);
     GDL90Stream_init(&gdl90Stream, &gdl90StreamConfig);
 
-    if (argc > 1)
+    if (argc > 2 && strcmp(argv[1], "-r") == 0)
+    {
+        return replayCapture(&gdl90Stream, argv[2], argc > 3 ? argv[3] : NULL);
+    }
+#ifndef _WIN32
+    else if (argc > 2 && strcmp(argv[1], "-w") == 0)
+    {
+        static GDL90CaptureIndexEntry captureIndex[4096];
+        GDL90CaptureWriter captureWriter = {0};
+        FILE *file = fopen(argv[2], "wb");
+        if (!file || GDL90CaptureWriter_init(&captureWriter, file, captureIndex, sizeof(captureIndex)/sizeof(captureIndex[0])) != GDL90ResultOK)
+        {
+            printf("Failed to create %s\n", argv[2]);
+            if (file) { fclose(file); }
+            return EXIT_FAILURE;
+        }
+        GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, GDL90CaptureWriter_handleFrame, &captureWriter);
+        GDL90Stream_init(&gdl90Stream, &gdl90StreamConfig);
+
+        char* buf = NULL;
+        size_t buflen = 0;
+        ssize_t nread = 0;
+        while ((nread = getline(&buf, (size_t*)&buflen, stdin)) > 3)
+        {
+            packetLength = getPacketFromHexStr(buf, (uint16_t)nread, packet);
+            if (packetLength && packet[0] == 0x7e && packet[packetLength-1] == 0x7e)
+            {
+                struct timeval tv;
+                gettimeofday(&tv, NULL);
+                GDL90CaptureWriter_setReceiveInfo(&captureWriter, (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000, 0);
+                GDL90Stream_process(&gdl90Stream, packet, packetLength);
+            }
+        }
+        free(buf);
+        buf = NULL;
+
+        GDL90CaptureWriter_close(&captureWriter);
+        fclose(file);
+    }
+#endif
+    else if (argc > 1)
     {
         packetLength = getPacketFromHexStr(argv[1], (uint16_t)strlen(argv[1]), packet);
         if (packetLength && packet[0] == 0x7e && packet[packetLength-1] == 0x7e)
@@ -0,0 +1,594 @@
+//
+//  main.c
+//  gdl90-gen
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Synthetic GDL90 traffic : N simulated targets, ownship, heartbeats and uplinks framed
+// into datagrams, written to a file/stdout or sent to a UDP port on the loopback.
+
+#include <gdl90.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define MAX_TARGETS 100000
+#define TICKS_PER_SECOND 10
+/** Uplink payload after the UAT-Specific Header and one Information Frame header */
+#define MAX_UPLINK_FRAME_SIZE (432 - 8 - 2)
+#define DEG2RAD (3.14159265358979323846 / 180.0)
+#define RAD2DEG (180.0 / 3.14159265358979323846)
+
+typedef struct Target
+{
+    uint32_t address;
+    double latitude;
+    double longitude;
+    /** ft */
+    double altitude;
+    /** kt */
+    double speed;
+    /** Degrees */
+    double track;
+    /** Degrees/s */
+    double turnRate;
+    /** ft/min */
+    double verticalVelocity;
+    /** Simulated time of the state (s) */
+    double timeS;
+    uint8_t emitterCategory;
+    char callsign[8];
+} Target;
+
+typedef struct Generator
+{
+    // options
+    uint32_t targetCount;
+    uint32_t trafficRate;
+    double uplinkRate;
+    uint16_t uplinkSize;
+    uint32_t crcErrorPerMille;
+    uint8_t escapeHeavy;
+    uint8_t hex;
+    uint8_t fast;
+    double latitude;
+    double longitude;
+    /** nm */
+    double radius;
+
+    Target *targets;
+    Target ownship;
+    uint32_t nextTarget;
+    uint32_t random;
+
+    FILE *file;
+    int socket;
+#ifndef _WIN32
+    struct sockaddr_in address;
+#endif
+
+    GDL90FrameBuilder builder;
+    uint8_t *datagram;
+
+    // stats
+    uint64_t messageCount[GDL90MessageType_LongReport + 1];
+    uint64_t frameCount;
+    uint64_t datagramCount;
+    uint64_t byteCount;
+    uint64_t crcErrorCount;
+} Generator;
+
+/** xorshift32 */
+static inline uint32_t Generator_random(Generator *self)
+{
+    uint32_t x = self->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    self->random = x;
+    return x;
+}
+
+/** [0, 1) */
+static inline double Generator_uniform(Generator *self)
+{
+    return (double)(Generator_random(self) >> 8) / (double)(1<<24);
+}
+
+static void Generator_flush(Generator *self)
+{
+    if (self->builder.length == 0) { return; }
+
+#ifndef _WIN32
+    if (self->socket >= 0)
+    {
+        if (sendto(self->socket, self->datagram, self->builder.length, 0, (struct sockaddr *)&self->address, sizeof(self->address)) < 0)
+        {
+            perror("sendto");
+        }
+    }
+    else
+#endif
+    if (!self->hex)
+    {
+        fwrite(self->datagram, 1, self->builder.length, self->file);
+    }
+
+    self->datagramCount++;
+    self->byteCount += self->builder.length;
+    GDL90FrameBuilder_reset(&self->builder);
+}
+
+/** Flips a bit of the frame's FCS, keeping the framing valid */
+static void Generator_injectCRCError(Generator *self)
+{
+    uint8_t *b = &self->datagram[self->builder.length - 2];
+    *b ^= 0x01;
+    if (*b == 0x7d || *b == 0x7e)
+    {
+        *b ^= 0x02;
+    }
+    self->crcErrorCount++;
+}
+
+static void Generator_emit(Generator *self, const uint8_t *message, size_t len)
+{
+    size_t length = self->builder.length;
+    if (GDL90FrameBuilder_append(&self->builder, message, len) != GDL90ResultOK)
+    {
+        Generator_flush(self);
+        length = 0;
+        if (GDL90FrameBuilder_append(&self->builder, message, len) != GDL90ResultOK) { return; }
+    }
+
+    if (self->crcErrorPerMille && Generator_random(self) % 1000 < self->crcErrorPerMille)
+    {
+        Generator_injectCRCError(self);
+    }
+
+    if (self->hex)
+    {
+        for (size_t i = length; i < self->builder.length; i++)
+        {
+            fprintf(self->file, "%02x", self->datagram[i]);
+        }
+        fputc('\n', self->file);
+    }
+
+    self->messageCount[message[0]]++;
+    self->frameCount++;
+}
+
+/** Distinct 24 bit addresses (odd multiplier mod 2^n), escape heavy ones start with a flag/escape byte */
+static uint32_t Generator_address(Generator *self, uint32_t i)
+{
+    if (self->escapeHeavy)
+    {
+        return (i & 1 ? 0x7e0000u : 0x7d0000u) | (((i >> 1) * 0x9e3779b1u) & 0xffff);
+    }
+    return (i * 0x9e3779b1u + 0x1234u) & 0xffffff;
+}
+
+static void Generator_initTarget(Generator *self, Target *target, uint32_t i)
+{
+    static const uint8_t emitterCategories[] = {
+        GDL90TrafficReportEmitterCategoryLightICAO,
+        GDL90TrafficReportEmitterCategoryLightICAO,
+        GDL90TrafficReportEmitterCategoryLarge,
+        GDL90TrafficReportEmitterCategoryLarge,
+        GDL90TrafficReportEmitterCategoryHeavyICAO,
+        GDL90TrafficReportEmitterCategoryRotorcraft
+    };
+    static const char *airlines[] = { "UAL", "DAL", "AAL", "SWA", "ASA" };
+
+    double r = self->radius * sqrt(Generator_uniform(self));
+    double bearing = 360.0 * Generator_uniform(self);
+    target->address = Generator_address(self, i);
+    target->latitude = self->latitude + r * cos(bearing * DEG2RAD) / 60.0;
+    target->longitude = self->longitude + r * sin(bearing * DEG2RAD) / (60.0 * cos(self->latitude * DEG2RAD));
+    target->emitterCategory = emitterCategories[Generator_random(self) % sizeof(emitterCategories)];
+    target->track = 360.0 * Generator_uniform(self);
+    target->turnRate = 0.0;
+    target->timeS = 0.0;
+
+    switch (target->emitterCategory)
+    {
+        case GDL90TrafficReportEmitterCategoryLightICAO:
+            target->speed = 60.0 + 100.0 * Generator_uniform(self);
+            target->altitude = 500.0 + 12000.0 * Generator_uniform(self);
+            snprintf(target->callsign, sizeof(target->callsign), "N%u", 100 + Generator_random(self) % 99900);
+            break;
+        case GDL90TrafficReportEmitterCategoryRotorcraft:
+            target->speed = 20.0 + 100.0 * Generator_uniform(self);
+            target->altitude = 300.0 + 3000.0 * Generator_uniform(self);
+            snprintf(target->callsign, sizeof(target->callsign), "N%uH", 10 + Generator_random(self) % 9990);
+            break;
+        default:
+            target->speed = 250.0 + 250.0 * Generator_uniform(self);
+            target->altitude = 2000.0 + 39000.0 * Generator_uniform(self);
+            snprintf(target->callsign, sizeof(target->callsign), "%s%u", airlines[Generator_random(self) % 5], 1 + Generator_random(self) % 9999);
+            break;
+    }
+    target->verticalVelocity = 64.0 * (double)((int32_t)(Generator_random(self) % 41) - 20);
+}
+
+/** Advances a target to timeS : coordinated turns, climbs/descents, kept within radius of the center */
+static void Generator_move(Generator *self, Target *target, double timeS)
+{
+    double dt = timeS - target->timeS;
+    if (dt <= 0.0) { return; }
+    target->timeS = timeS;
+
+    // new manoeuvre every ~2 min
+    if (Generator_uniform(self) < dt / 120.0)
+    {
+        target->turnRate = Generator_uniform(self) < 0.5 ? 0.0 : 3.0 * (Generator_uniform(self) - 0.5);
+        target->verticalVelocity = 64.0 * (double)((int32_t)(Generator_random(self) % 41) - 20);
+    }
+
+    double dLat = (target->latitude - self->latitude) * 60.0;
+    double dLon = (target->longitude - self->longitude) * 60.0 * cos(self->latitude * DEG2RAD);
+    if (dLat * dLat + dLon * dLon > self->radius * self->radius)
+    {
+        // head back to the center
+        target->track = fmod(atan2(-dLon, -dLat) * RAD2DEG + 360.0, 360.0);
+        target->turnRate = 0.0;
+    }
+
+    target->track = fmod(target->track + target->turnRate * dt + 360.0, 360.0);
+    double distance = target->speed * dt / 3600.0;
+    target->latitude += distance * cos(target->track * DEG2RAD) / 60.0;
+    target->longitude += distance * sin(target->track * DEG2RAD) / (60.0 * cos(target->latitude * DEG2RAD));
+    target->altitude += target->verticalVelocity * dt / 60.0;
+    if (target->altitude < 300.0 || target->altitude > 45000.0)
+    {
+        target->verticalVelocity = -target->verticalVelocity;
+        target->altitude = target->altitude < 300.0 ? 300.0 : 45000.0;
+    }
+}
+
+static void Generator_emitTargetReport(Generator *self, Target *target, uint8_t id)
+{
+    GDL90TrafficReport report = {0};
+    uint8_t bytes[28];
+
+    report.id = id;
+    report.addressType = GDL90TrafficReportAddressTypeADSBWithICAO;
+    report.participantAddress = target->address;
+    report.latitude = target->latitude;
+    report.longitude = target->longitude;
+    report.hasValidPosition = 1;
+    report.altitude = (int32_t)(target->altitude / 25.0) * 25;
+    report.hasValidAltitude = 1;
+    report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report.trackHeading = target->track;
+    report.airGroundState = 1;
+    report.navigationIntegrityCategory = 8;
+    report.navigationAccuracyCategoryForPosition = 9;
+    report.horizontalVelocity = (uint32_t)target->speed;
+    report.hasValidHorizontalVelocity = 1;
+    report.verticalVelocity = (int32_t)target->verticalVelocity;
+    report.hasValidVerticalVelocity = 1;
+    report.emitterCategory = target->emitterCategory;
+    memcpy(report.callsign, target->callsign, sizeof(report.callsign));
+
+    Generator_emit(self, GDL90TrafficReport_toBytes(&report, bytes), sizeof(bytes));
+}
+
+static void Generator_emitSecond(Generator *self, double timeS, time_t startTime)
+{
+    uint8_t bytes[7];
+    uint32_t secondsOfDay = (uint32_t)((startTime + (time_t)timeS) % 86400);
+
+    GDL90Heartbeat heartbeat = {0};
+    heartbeat.id = GDL90MessageType_Heartbeat;
+    heartbeat.status1 = 1<<GDL90HeartbeatStatusByte1BitGPSPosValid | 1<<GDL90HeartbeatStatusByte1BitUATInitialized;
+    heartbeat.status2 = 1<<GDL90HeartbeatStatusByte2BitUTCOK;
+    heartbeat.timestamp = secondsOfDay;
+    heartbeat.uplinkMessageCount = (uint8_t)(self->uplinkRate > 31 ? 31 : self->uplinkRate);
+    heartbeat.basicLongMessageCount = (uint16_t)(self->trafficRate > 1023 ? 1023 : self->trafficRate);
+    Generator_emit(self, GDL90Heartbeat_toBytes(&heartbeat, bytes), sizeof(bytes));
+
+    Generator_move(self, &self->ownship, timeS);
+    Generator_emitTargetReport(self, &self->ownship, GDL90MessageType_OwnshipReport);
+
+    GDL90OwnshipGeometricAltitude geoAltitude = {0};
+    geoAltitude.id = GDL90MessageType_OwnshipGeometricAltitude;
+    geoAltitude.geoAltitude = ((int32_t)self->ownship.altitude + 150) / 5 * 5;
+    geoAltitude.verticalFigureOfMerit = 10;
+    geoAltitude.hasValidVFOM = 1;
+    Generator_emit(self, GDL90OwnshipGeometricAltitude_toBytes(&geoAltitude, bytes), 5);
+}
+
+/** UAT-Specific Header of a ground station near the center, and one FIS-B frame of uplinkSize bytes */
+static void Generator_emitUplink(Generator *self, double timeS)
+{
+    static const double latlonRes = 360.0 / (double)(1<<24);
+    uint8_t bytes[436];
+
+    GDL90UplinkData uplink = {0};
+    uplink.id = GDL90MessageType_UplinkData;
+    uplink.timeOfReception = (uint32_t)(fmod(timeS, 1.0) * 1e9) / 80 * 80;
+    uplink.hasValidTor = 1;
+
+    uint32_t lat = (uint32_t)(self->latitude / latlonRes) & 0x7fffff;
+    uint32_t lon = (uint32_t)((self->longitude < 0 ? self->longitude + 360.0 : self->longitude) / latlonRes) & 0xffffff;
+    uplink.payload[0] = (uint8_t)(lat >> 15);
+    uplink.payload[1] = (uint8_t)(lat >> 7);
+    uplink.payload[2] = (uint8_t)(lat << 1 | lon >> 23);
+    uplink.payload[3] = (uint8_t)(lon >> 15);
+    uplink.payload[4] = (uint8_t)(lon >> 7);
+    uplink.payload[5] = (uint8_t)(lon << 1 | 1);
+    // application data valid, slot id
+    uplink.payload[6] = (uint8_t)(0x20 | (Generator_random(self) & 0x1f));
+
+    uint16_t length = self->uplinkSize;
+    if (length > 0)
+    {
+        // Information Frame : 9 bit length, 4 bit type (FIS-B)
+        uplink.payload[8] = (uint8_t)(length >> 1);
+        uplink.payload[9] = (uint8_t)((length & 1) << 7);
+        for (uint16_t i = 0; i < length; i++)
+        {
+            uplink.payload[10 + i] = self->escapeHeavy ? (i & 1 ? 0x7e : 0x7d) : (uint8_t)Generator_random(self);
+        }
+    }
+
+    Generator_emit(self, GDL90UplinkData_toBytes(&uplink, bytes), sizeof(bytes));
+}
+
+static double monotonicSeconds(void)
+{
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void sleepSeconds(double s)
+{
+    if (s <= 0.0) { return; }
+#ifndef _WIN32
+    struct timespec ts;
+    ts.tv_sec = (time_t)s;
+    ts.tv_nsec = (long)((s - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "gdl90-gen [options]\n"
+        "  -n targets      simulated targets (1-%u, default 100)\n"
+        "  -r rate         Traffic Reports per second (default : one per target)\n"
+        "  -u rate         Uplinks per second (default 1)\n"
+        "  -U size         FIS-B frame bytes per uplink (0-%u, default 256)\n"
+        "  -t seconds      simulated duration (default 60)\n"
+        "  -e permille     frames with an injected CRC error (default 0)\n"
+        "  -x              escape heavy addresses and payloads\n"
+        "  -m size         datagram size (default 1400)\n"
+        "  -s seed         random seed\n"
+        "  -c lat,lon      center (default 45.0,-122.0)\n"
+        "  -R nm           radius (default 100)\n"
+        "  -F              as fast as possible instead of real time\n"
+        "  -o path         output file (default - for stdout)\n"
+        "  -X              one hex line per frame (gdl90-cli input)\n"
+#ifndef _WIN32
+        "  -p port         send the datagrams to 127.0.0.1:port\n"
+#endif
+        , MAX_TARGETS, MAX_UPLINK_FRAME_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    static Generator generator;
+    Generator *self = &generator;
+    const char *path = "-";
+    double duration = 60.0;
+    size_t datagramSize = 1400;
+    long port = 0;
+    int trafficRateSet = 0;
+
+    self->targetCount = 100;
+    self->uplinkRate = 1.0;
+    self->uplinkSize = 256;
+    self->latitude = 45.0;
+    self->longitude = -122.0;
+    self->radius = 100.0;
+    self->random = 0x2545f491;
+    self->socket = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0') { usage(); return EXIT_FAILURE; }
+
+        switch (arg[1])
+        {
+            case 'x': self->escapeHeavy = 1; continue;
+            case 'F': self->fast = 1; continue;
+            case 'X': self->hex = 1; continue;
+            case 'h': usage(); return EXIT_SUCCESS;
+            default: break;
+        }
+
+        if (!value) { usage(); return EXIT_FAILURE; }
+        i++;
+        switch (arg[1])
+        {
+            case 'n': self->targetCount = (uint32_t)strtoul(value, NULL, 10); break;
+            case 'r': self->trafficRate = (uint32_t)strtoul(value, NULL, 10); trafficRateSet = 1; break;
+            case 'u': self->uplinkRate = strtod(value, NULL); break;
+            case 'U': self->uplinkSize = (uint16_t)strtoul(value, NULL, 10); break;
+            case 't': duration = strtod(value, NULL); break;
+            case 'e': self->crcErrorPerMille = (uint32_t)strtoul(value, NULL, 10); break;
+            case 'm': datagramSize = strtoul(value, NULL, 10); break;
+            case 's': self->random = (uint32_t)strtoul(value, NULL, 10) | 1; break;
+            case 'c': if (sscanf(value, "%lf,%lf", &self->latitude, &self->longitude) != 2) { usage(); return EXIT_FAILURE; } break;
+            case 'R': self->radius = strtod(value, NULL); break;
+            case 'o': path = value; break;
+            case 'p': port = strtol(value, NULL, 10); break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    if (self->targetCount < 1 || self->targetCount > MAX_TARGETS
+        || self->uplinkSize > MAX_UPLINK_FRAME_SIZE || self->crcErrorPerMille > 1000
+        || duration <= 0.0 || self->radius <= 0.0)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (!trafficRateSet)
+    {
+        self->trafficRate = self->targetCount;
+    }
+    // a datagram fits at least any one frame
+    datagramSize = datagramSize < GDL90_FRAME_MAX_SIZE ? GDL90_FRAME_MAX_SIZE : datagramSize;
+
+    self->targets = calloc(self->targetCount, sizeof(Target));
+    self->datagram = malloc(datagramSize);
+    if (!self->targets || !self->datagram)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    GDL90FrameBuilder_init(&self->builder, self->datagram, datagramSize);
+
+    if (port > 0)
+    {
+#ifndef _WIN32
+        self->socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (self->socket < 0)
+        {
+            perror("socket");
+            return EXIT_FAILURE;
+        }
+        memset(&self->address, 0, sizeof(self->address));
+        self->address.sin_family = AF_INET;
+        self->address.sin_port = htons((uint16_t)port);
+        self->address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        self->hex = 0;
+#endif
+    }
+    else
+    {
+        self->file = strcmp(path, "-") == 0 ? stdout : fopen(path, self->hex ? "w" : "wb");
+        if (!self->file)
+        {
+            fprintf(stderr, "Failed to create %s\n", path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (uint32_t i = 0; i < self->targetCount; i++)
+    {
+        Generator_initTarget(self, &self->targets[i], i);
+    }
+    Generator_initTarget(self, &self->ownship, self->targetCount);
+    self->ownship.address = 0xabcdef;
+    memcpy(self->ownship.callsign, "N12345", 7);
+
+    time_t startTime = time(NULL);
+    double startS = monotonicSeconds();
+    uint64_t ticks = (uint64_t)(duration * TICKS_PER_SECOND);
+    for (uint64_t tick = 0; tick < ticks; tick++)
+    {
+        double timeS = (double)tick / TICKS_PER_SECOND;
+
+        if (tick % TICKS_PER_SECOND == 0)
+        {
+            Generator_emitSecond(self, timeS, startTime);
+        }
+
+        // spread over the ticks of each second
+        uint64_t uplinks = (uint64_t)((double)(tick + 1) * self->uplinkRate / TICKS_PER_SECOND) - (uint64_t)((double)tick * self->uplinkRate / TICKS_PER_SECOND);
+        for (uint64_t i = 0; i < uplinks; i++)
+        {
+            Generator_emitUplink(self, timeS);
+        }
+
+        uint64_t reports = (tick + 1) * self->trafficRate / TICKS_PER_SECOND - tick * self->trafficRate / TICKS_PER_SECOND;
+        for (uint64_t i = 0; i < reports; i++)
+        {
+            Target *target = &self->targets[self->nextTarget];
+            self->nextTarget = (self->nextTarget + 1) % self->targetCount;
+            Generator_move(self, target, timeS);
+            Generator_emitTargetReport(self, target, GDL90MessageType_TrafficReport);
+        }
+
+        Generator_flush(self);
+
+        if (!self->fast)
+        {
+            sleepSeconds(startS + (double)(tick + 1) / TICKS_PER_SECOND - monotonicSeconds());
+        }
+    }
+
+    double elapsed = monotonicSeconds() - startS;
+    fprintf(stderr,
+        "%llu frames (%llu heartbeat, %llu ownship, %llu geometric altitude, %llu traffic, %llu uplink), %llu CRC errors\n"
+        "%llu datagrams, %llu bytes in %.3f s (%.0f frames/s, %.2f MB/s)\n"
+        , (unsigned long long)self->frameCount
+        , (unsigned long long)self->messageCount[GDL90MessageType_Heartbeat]
+        , (unsigned long long)self->messageCount[GDL90MessageType_OwnshipReport]
+        , (unsigned long long)self->messageCount[GDL90MessageType_OwnshipGeometricAltitude]
+        , (unsigned long long)self->messageCount[GDL90MessageType_TrafficReport]
+        , (unsigned long long)self->messageCount[GDL90MessageType_UplinkData]
+        , (unsigned long long)self->crcErrorCount
+        , (unsigned long long)self->datagramCount
+        , (unsigned long long)self->byteCount
+        , elapsed
+        , elapsed > 0.0 ? (double)self->frameCount / elapsed : 0.0
+        , elapsed > 0.0 ? (double)self->byteCount / elapsed / 1e6 : 0.0
+    );
+
+#ifndef _WIN32
+    if (self->socket >= 0)
+    {
+        close(self->socket);
+    }
+#endif
+    if (self->file && self->file != stdout)
+    {
+        fclose(self->file);
+    }
+    free(self->datagram);
+    free(self->targets);
+
+    return EXIT_SUCCESS;
+}
@@ -28,6 +28,20 @@ class GDL90 {
         this.memory = gdl90Instance.exports.memory;
     }
 
+    // gdl90 wasm module to load : gdl90-simd.wasm if the runtime supports wasm SIMD128 (validates
+    // a function using i8x16.splat and i8x16.popcnt), gdl90.wasm otherwise
+
+    static simdSupported() {
+        return WebAssembly.validate(new Uint8Array([
+            0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x05, 0x01, 0x60, 0x00, 0x01, 0x7b, 0x03,
+            0x02, 0x01, 0x00, 0x0a, 0x0a, 0x01, 0x08, 0x00, 0x41, 0x00, 0xfd, 0x0f, 0xfd, 0x62, 0x0b
+        ]));
+    }
+
+    static moduleName() {
+        return GDL90.simdSupported() ? "gdl90-simd.wasm" : "gdl90.wasm";
+    }
+
     // gdl90 wasm module imports
 
     static imports() {
@@ -38,13 +52,12 @@ class GDL90 {
                     console.log(`${text}`);
                 },
                 EXT_handleGDL90Message(/* GDL90Message* */_, /* void* */data) {
-                    switch (new DataView(gdl90.memory.buffer, data, 1).getUint8(0))
+                    // Ownship and Traffic Reports are returned in bulk by processData
+                    const view = new DataView(gdl90.memory.buffer);
+                    switch (view.getUint8(data))
                     {
-                        case 0x14:
-                            console.log(new GDL90TrafficReport(data));
-                            break;
                         case 0x0b:
-                            console.log(new GDL90OwnshipGeometricAltitude(data));
+                            console.log(new GDL90OwnshipGeometricAltitude(view, data));
                             break;
                     }
                 },
@@ -59,14 +72,157 @@ class GDL90 {
 
     init() {
         this.native.GDL90_init();
+        this.trafficReportLayout = new GDL90Layout(this.memory,
+            this.native.gdl90TrafficReportLayout.value, GDL90TrafficReport.FIELDS);
+        this.ownshipGeometricAltitudeLayout = new GDL90Layout(this.memory,
+            this.native.gdl90OwnshipGeometricAltitudeLayout.value, GDL90OwnshipGeometricAltitude.FIELDS);
+        this.heartbeatLayout = new GDL90Layout(this.memory,
+            this.native.gdl90HeartbeatLayout.value, GDL90Heartbeat.FIELDS);
+        this.heightAboveTerrainLayout = new GDL90Layout(this.memory,
+            this.native.gdl90HeightAboveTerrainLayout.value, GDL90HeightAboveTerrain.FIELDS);
+        this.uplinkDataLayout = new GDL90Layout(this.memory,
+            this.native.gdl90UplinkDataLayout.value, GDL90UplinkData.FIELDS);
+        this.recordLayout = new GDL90Layout(this.memory,
+            this.native.gdl90RecordLayout.value, [["id", "u8"], ["message", "struct"]]);
+        this.streamBufferSize = this.native.GDL90_streamBufferSize();
+        this.inputRingSize = this.native.GDL90_inputRingSize();
+        this.outputRingCapacity = this.native.GDL90_outputRingCapacity();
+        this.uplinkRingCapacity = this.native.GDL90_uplinkRingCapacity();
     }
 
+    // processes data, returns its Ownship and Traffic Reports (the other messages go to
+    // EXT_handleGDL90Message). The reports are only returned once the whole packet was decoded,
+    // so they come after the callbacks of all the other messages of the packet, whatever their
+    // order in it : use writePacket / processRing / readRecords for every message in stream order
     processData(data) {
+        if (data.length > this.streamBufferSize) {
+            throw new RangeError(`packet of ${data.length} bytes, at most ${this.streamBufferSize}`);
+        }
+
         // set data in gdl90 instance's buffer
-        let gdl90StreamBuffer = new Uint8Array(this.memory.buffer, this.native.gdl90StreamBuffer, data.length);
+        let gdl90StreamBuffer = new Uint8Array(this.memory.buffer, this.native.gdl90StreamBuffer.value, data.length);
         gdl90StreamBuffer.set(data);
 
         this.native.GDL90_processData(data.length);
+
+        // read the packed reports through a single DataView
+        const count = this.native.GDL90_takeTrafficReports();
+        const view = new DataView(this.memory.buffer, this.native.gdl90TrafficReports.value,
+            count * this.trafficReportLayout.size);
+        const reports = new Array(count);
+        for (let i = 0; i < count; i++) {
+            reports[i] = new GDL90TrafficReport(view, i * this.trafficReportLayout.size);
+        }
+        return reports;
+    }
+
+    // batched processing : packets are queued with writePacket, decoded by a single processRing
+    // call, and readRecords returns the decoded messages (no calls from the module to JS)
+
+    u32(name) {
+        return new DataView(this.memory.buffer).getUint32(this.native[name].value, true);
+    }
+
+    setU32(name, value) {
+        new DataView(this.memory.buffer).setUint32(this.native[name].value, value >>> 0, true);
+    }
+
+    // queues a packet (array of bytes), false if the input ring is full (call processRing)
+    writePacket(data) {
+        const size = this.inputRingSize;
+        if (!data.length || data.length > 0xffff || data.length + 2 > size) {
+            throw new RangeError(`invalid packet length ${data.length}`);
+        }
+        let head = this.u32("gdl90InputRingHead");
+        const tail = this.u32("gdl90InputRingTail");
+        let offset = head % size;
+        const wrap = offset + 2 + data.length > size ? size - offset : 0;
+        if (((head - tail) >>> 0) + wrap + 2 + data.length > size) {
+            return false;
+        }
+        const ring = new Uint8Array(this.memory.buffer, this.native.gdl90InputRing.value, size);
+        if (wrap) {
+            if (wrap >= 2) {
+                ring[offset] = ring[offset + 1] = 0;
+            }
+            head += wrap;
+            offset = 0;
+        }
+        ring[offset] = data.length & 0xff;
+        ring[offset + 1] = data.length >> 8;
+        ring.set(data, offset + 2);
+        this.setU32("gdl90InputRingHead", head + 2 + data.length);
+        return true;
+    }
+
+    // decodes the queued packets, returns the number of records to read
+    processRing() {
+        return this.native.GDL90_processRing();
+    }
+
+    // reads (and releases) up to max records : GDL90TrafficReport, GDL90Heartbeat, GDL90UplinkData,
+    // etc. objects, { id } for the messages without a layout
+    readRecords(max = Infinity) {
+        const head = this.u32("gdl90OutputRingHead");
+        let tail = this.u32("gdl90OutputRingTail");
+        const count = Math.min((head - tail) >>> 0, max);
+        const size = this.recordLayout.size;
+        const messageOffset = this.recordLayout.fields[1].offset;
+        const view = new DataView(this.memory.buffer, this.native.gdl90OutputRing.value,
+            this.outputRingCapacity * size);
+        const uplinkView = new DataView(this.memory.buffer, this.native.gdl90UplinkRing.value,
+            this.uplinkRingCapacity * this.uplinkDataLayout.size);
+        let uplinkTail = -1;
+        const records = new Array(count);
+        for (let i = 0; i < count; i++, tail++) {
+            const offset = (tail % this.outputRingCapacity) * size;
+            const at = offset + messageOffset;
+            switch (view.getUint8(offset)) {
+                case 0x00:
+                    records[i] = new GDL90Heartbeat(view, at);
+                    break;
+                case 0x07:
+                    uplinkTail = view.getUint32(at, true);
+                    records[i] = new GDL90UplinkData(uplinkView,
+                        (uplinkTail % this.uplinkRingCapacity) * this.uplinkDataLayout.size);
+                    uplinkTail++;
+                    break;
+                case 0x09:
+                    records[i] = new GDL90HeightAboveTerrain(view, at);
+                    break;
+                case 0x0a:
+                case 0x14:
+                    records[i] = new GDL90TrafficReport(view, at);
+                    break;
+                case 0x0b:
+                    records[i] = new GDL90OwnshipGeometricAltitude(view, at);
+                    break;
+                default:
+                    records[i] = { id: view.getUint8(offset) };
+            }
+        }
+        if (uplinkTail >= 0) {
+            this.setU32("gdl90UplinkRingTail", uplinkTail);
+        }
+        this.setU32("gdl90OutputRingTail", tail);
+        return records;
+    }
+
+    // messages left out of the output ring, and whether processRing stopped at a corrupted
+    // length of the input ring (call resetInputRing)
+    get ringStats() {
+        return {
+            skipped: this.u32("gdl90RingSkippedCount"),
+            errors: this.u32("gdl90RingErrorCount"),
+            overflows: this.u32("gdl90RingOverflowCount"),
+            corrupted: this.u32("gdl90InputRingCorrupted") !== 0
+        };
+    }
+
+    // drops the packets queued in the input ring
+    resetInputRing() {
+        this.setU32("gdl90InputRingTail", this.u32("gdl90InputRingHead"));
+        this.setU32("gdl90InputRingCorrupted", 0);
     }
 
     // gdl90 tests
@@ -86,7 +242,9 @@ class GDL90 {
             // GDL90 Flag
             0x7e
         ];
-        this.processData(data);
+        for (const report of this.processData(data)) {
+            console.log(report);
+        }
     }
 
     testGDL90OwnshipGeometricAltitude() {
@@ -106,48 +264,273 @@ class GDL90 {
     }
 }
 
+// Layout of a struct of the wasm module, read from its layout table (see gdl90-wasm.cpp) : the
+// offsets and sizes come from the C headers, and the sizes are checked against the field types
+
+class GDL90Layout {
+    static GETTERS = {
+        u8: [1, (view, at) => view.getUint8(at)],
+        i8: [1, (view, at) => view.getInt8(at)],
+        u16: [2, (view, at) => view.getUint16(at, true)],
+        i16: [2, (view, at) => view.getInt16(at, true)],
+        u32: [4, (view, at) => view.getUint32(at, true)],
+        i32: [4, (view, at) => view.getInt32(at, true)],
+        f64: [8, (view, at) => view.getFloat64(at, true)],
+        bool: [1, (view, at) => view.getUint8(at) !== 0],
+        bytes: [0, (view, at, size) => new Uint8Array(view.buffer.slice(view.byteOffset + at, view.byteOffset + at + size))],
+        struct: [0, (view, at) => at],
+        str: [0, (view, at, size) => {
+            let text = "";
+            for (let i = 0; i < size; i++) {
+                const c = view.getUint8(at + i);
+                if (!c) {
+                    break;
+                }
+                text += String.fromCharCode(c);
+            }
+            return text;
+        }]
+    };
+
+    // fields : [name, type] in the order of the layout table at address
+    constructor(memory, address, fields) {
+        const table = new DataView(memory.buffer, address);
+        this.size = table.getUint32(0, true);
+        if (table.getUint32(4, true) !== fields.length) {
+            throw new Error(`layout has ${table.getUint32(4, true)} fields, ${fields.length} expected`);
+        }
+        this.fields = fields.map(([name, type], i) => {
+            const offset = table.getUint32(8 + i * 8, true);
+            const size = table.getUint32(12 + i * 8, true);
+            const [expectedSize, get] = GDL90Layout.GETTERS[type];
+            if (expectedSize && size !== expectedSize) {
+                throw new Error(`${name} is ${size} bytes, ${type} expected`);
+            }
+            return { name, offset, size, get };
+        });
+    }
+
+    // reads the struct at offset of view into target
+    read(view, offset, target) {
+        for (const field of this.fields) {
+            target[field.name] = field.get(view, offset + field.offset, field.size);
+        }
+        return target;
+    }
+}
+
 class GDL90TrafficReport {
-    constructor(data) {
-        this.id = gdl90.native[`${this.constructor.name}_id`](data);
-        this.alertStatus = gdl90.native[`${this.constructor.name}_alertStatus`](data);
-        this.addressType = gdl90.native[`${this.constructor.name}_addressType`](data);
-        this.participantAddress = gdl90.native[`${this.constructor.name}_participantAddress`](data);
-        this.latitude = gdl90.native[`${this.constructor.name}_latitude`](data);
-        this.longitude = gdl90.native[`${this.constructor.name}_longitude`](data);
-        this.altitude = gdl90.native[`${this.constructor.name}_altitude`](data);
-        this.trackHeadingType = gdl90.native[`${this.constructor.name}_trackHeadingType`](data);
-        this.reportStatus = gdl90.native[`${this.constructor.name}_reportStatus`](data);
-        this.airGroundState = gdl90.native[`${this.constructor.name}_airGroundState`](data);
-        this.navigationIntegrityCategory = gdl90.native[`${this.constructor.name}_navigationIntegrityCategory`](data);
-        this.navigationAccuracyCategoryForPosition = gdl90.native[`${this.constructor.name}_navigationAccuracyCategoryForPosition`](data);
-        this.horizontalVelocity = gdl90.native[`${this.constructor.name}_horizontalVelocity`](data);
-        this.verticalVelocity = gdl90.native[`${this.constructor.name}_verticalVelocity`](data);
-        this.trackHeading = gdl90.native[`${this.constructor.name}_trackHeading`](data);
-        this.emitterCategory = gdl90.native[`${this.constructor.name}_emitterCategory`](data);
-        const callsign = gdl90.native[`${this.constructor.name}_callsign`](data);
-        this.callsign = new TextDecoder().decode(new Uint8Array(gdl90.memory.buffer, callsign, 8)).replace(/\0/g, '');
-        this.emergencyPriorityCode = gdl90.native[`${this.constructor.name}_emergencyPriorityCode`](data);
-        this.spare = gdl90.native[`${this.constructor.name}_spare`](data);
-        this.hasValidAltitude = gdl90.native[`${this.constructor.name}_hasValidAltitude`](data);
-        this.hasValidHorizontalVelocity = gdl90.native[`${this.constructor.name}_hasValidHorizontalVelocity`](data);
-        this.hasValidVerticalVelocity = gdl90.native[`${this.constructor.name}_hasValidVerticalVelocity`](data);
-        this.hasValidPosition = gdl90.native[`${this.constructor.name}_hasValidPosition`](data);
+    static FIELDS = [
+        ["id", "u8"], ["alertStatus", "u8"], ["addressType", "u8"], ["participantAddress", "u32"],
+        ["latitude", "f64"], ["longitude", "f64"], ["altitude", "i32"], ["trackHeadingType", "u32"],
+        ["reportStatus", "u8"], ["airGroundState", "u8"], ["navigationIntegrityCategory", "u8"],
+        ["navigationAccuracyCategoryForPosition", "u8"], ["horizontalVelocity", "u32"],
+        ["verticalVelocity", "i32"], ["trackHeading", "f64"], ["emitterCategory", "u8"], ["callsign", "str"],
+        ["emergencyPriorityCode", "i8"], ["spare", "i8"], ["hasValidAltitude", "bool"],
+        ["hasValidHorizontalVelocity", "bool"], ["hasValidVerticalVelocity", "bool"], ["hasValidPosition", "bool"]
+    ];
+
+    constructor(view, offset) {
+        gdl90.trafficReportLayout.read(view, offset, this);
+    }
+}
+
+class GDL90Heartbeat {
+    static FIELDS = [
+        ["id", "u8"], ["status1", "u8"], ["status2", "u8"], ["timestamp", "u32"],
+        ["uplinkMessageCount", "u8"], ["basicLongMessageCount", "u16"]
+    ];
+
+    constructor(view, offset) {
+        gdl90.heartbeatLayout.read(view, offset, this);
+    }
+}
+
+class GDL90HeightAboveTerrain {
+    static FIELDS = [["id", "u8"], ["heightAboveTerrain", "i16"]];
+
+    constructor(view, offset) {
+        gdl90.heightAboveTerrainLayout.read(view, offset, this);
+    }
+}
+
+class GDL90UplinkData {
+    static FIELDS = [["id", "u8"], ["timeOfReception", "u32"], ["payload", "bytes"], ["hasValidTor", "bool"]];
+
+    constructor(view, offset) {
+        gdl90.uplinkDataLayout.read(view, offset, this);
     }
 }
 
 class GDL90OwnshipGeometricAltitude {
-    constructor(data) {
-        this.id = gdl90.native[`${this.constructor.name}_id`](data)
-        this.verticalWarning = gdl90.native[`${this.constructor.name}_verticalWarning`](data)
-        this.hasValidVFOM = gdl90.native[`${this.constructor.name}_hasValidVFOM`](data)
-        this.verticalFigureOfMerit = gdl90.native[`${this.constructor.name}_verticalFigureOfMerit`](data)
-        this.geoAltitude = gdl90.native[`${this.constructor.name}_geoAltitude`](data)
+    static FIELDS = [
+        ["id", "u8"], ["verticalWarning", "bool"], ["hasValidVFOM", "bool"],
+        ["verticalFigureOfMerit", "u16"], ["geoAltitude", "i32"]
+    ];
+
+    constructor(view, offset) {
+        gdl90.ownshipGeometricAltitudeLayout.read(view, offset, this);
+    }
+}
+
+// Decoder of the delta encoded traffic snapshots of gdl90-ws (see gdl90-delta.h for the format)
+
+class GDL90DeltaDecoder {
+    static SNAPSHOT_COUNT = 8;
+    static LATLON_RES = 180 / (1 << 23);
+
+    constructor() {
+        // last GDL90DeltaDecoder.SNAPSHOT_COUNT snapshots : { sequence, timeMs, targets (Map of id to target) }
+        this.snapshots = new Array(GDL90DeltaDecoder.SNAPSHOT_COUNT).fill(null);
+        this.sequence = 0;
+    }
+
+    // targets of the last snapshot decoded
+    get targets() {
+        const snapshot = this.snapshots[this.sequence % GDL90DeltaDecoder.SNAPSHOT_COUNT];
+        return snapshot ? snapshot.targets : new Map();
+    }
+
+    // decodes a message (ArrayBuffer or Uint8Array), returns its sequence to acknowledge, 0 if it
+    // can't be decoded (a delta of an unknown base : request a keyframe)
+    decode(message) {
+        const data = message instanceof Uint8Array ? message : new Uint8Array(message);
+        let at = 0;
+        const varint = () => {
+            let value = 0;
+            for (let scale = 1; at < data.length; scale *= 128) {
+                const byte = data[at++];
+                value += (byte & 0x7f) * scale;
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+            throw new RangeError("truncated varint");
+        };
+        const signed = () => {
+            const zigzag = varint();
+            return zigzag % 2 ? -(zigzag + 1) / 2 : zigzag / 2;
+        };
+        const byte = () => {
+            if (at >= data.length) {
+                throw new RangeError("truncated record");
+            }
+            return data[at++];
+        };
+
+        try {
+            const type = byte();
+            if (type !== 0x4b && type !== 0x44) {
+                return 0;
+            }
+            const sequence = varint();
+            let targets = new Map();
+            if (type === 0x44) {
+                const baseSequence = varint();
+                const base = this.snapshots[baseSequence % GDL90DeltaDecoder.SNAPSHOT_COUNT];
+                if (!base || base.sequence !== baseSequence || baseSequence % GDL90DeltaDecoder.SNAPSHOT_COUNT === sequence % GDL90DeltaDecoder.SNAPSHOT_COUNT) {
+                    return 0;
+                }
+                targets = new Map(base.targets);
+            }
+            const timeMs = varint();
+            const count = varint();
+
+            for (let n = 0; n < count; n++) {
+                const id = varint();
+                const fields = byte();
+                if (fields & 0x80) {
+                    targets.delete(id);
+                    continue;
+                }
+
+                const previous = targets.get(id);
+                const target = previous ? { ...previous } : GDL90DeltaDecoder.emptyTarget(id);
+                if (fields & 0x01) {
+                    target.latitude = (Math.round(target.latitude / GDL90DeltaDecoder.LATLON_RES) + signed()) * GDL90DeltaDecoder.LATLON_RES;
+                    target.longitude = (Math.round(target.longitude / GDL90DeltaDecoder.LATLON_RES) + signed()) * GDL90DeltaDecoder.LATLON_RES;
+                }
+                if (fields & 0x02) {
+                    target.altitude += signed();
+                }
+                if (fields & 0x04) {
+                    target.horizontalVelocity = varint();
+                }
+                if (fields & 0x08) {
+                    target.verticalVelocity = signed() * 64;
+                }
+                if (fields & 0x10) {
+                    target.trackHeading = byte() * 360 / 256;
+                }
+                if (fields & 0x20) {
+                    const status = [byte(), byte(), byte(), byte(), byte()];
+                    target.alertStatus = status[0] & 0x0f;
+                    target.addressType = status[0] >> 4;
+                    target.trackHeadingType = status[1] & 0x03;
+                    target.reportStatus = (status[1] >> 2) & 1;
+                    target.airGroundState = (status[1] >> 3) & 1;
+                    target.hasValidPosition = (status[1] >> 4) & 1;
+                    target.hasValidAltitude = (status[1] >> 5) & 1;
+                    target.hasValidHorizontalVelocity = (status[1] >> 6) & 1;
+                    target.hasValidVerticalVelocity = (status[1] >> 7) & 1;
+                    target.navigationIntegrityCategory = status[2] & 0x0f;
+                    target.navigationAccuracyCategoryForPosition = status[2] >> 4;
+                    target.emitterCategory = status[3];
+                    target.emergencyPriorityCode = status[4] << 24 >> 24;
+                }
+                if (fields & 0x40) {
+                    target.participantAddress = byte() << 16 | byte() << 8 | byte();
+                    const callsign = new Uint8Array(8).map(byte);
+                    target.callsign = new TextDecoder().decode(callsign).replace(/\0/g, '');
+                }
+                targets.set(id, target);
+            }
+            if (at !== data.length) {
+                return 0;
+            }
+
+            this.snapshots[sequence % GDL90DeltaDecoder.SNAPSHOT_COUNT] = { sequence, timeMs, targets };
+            this.sequence = sequence;
+            return sequence;
+        }
+        catch (e) {
+            return 0;
+        }
+    }
+
+    static emptyTarget(id) {
+        return {
+            id, alertStatus: 0, addressType: 0, participantAddress: 0, latitude: 0, longitude: 0, altitude: 0,
+            trackHeadingType: 0, reportStatus: 0, airGroundState: 0, navigationIntegrityCategory: 0,
+            navigationAccuracyCategoryForPosition: 0, horizontalVelocity: 0, verticalVelocity: 0, trackHeading: 0,
+            emitterCategory: 0, callsign: "", emergencyPriorityCode: 0, hasValidAltitude: 0,
+            hasValidHorizontalVelocity: 0, hasValidVerticalVelocity: 0, hasValidPosition: 0
+        };
+    }
+
+    // connects to a gdl90-ws server, handler(targets, timeMs) is called with every snapshot
+    static connect(url, handler) {
+        const decoder = new GDL90DeltaDecoder();
+        const socket = new WebSocket(url);
+        socket.binaryType = "arraybuffer";
+        socket.onmessage = event => {
+            const sequence = decoder.decode(event.data);
+            if (!sequence) {
+                socket.send(new Uint8Array([0x4b]));
+                return;
+            }
+            const ack = new DataView(new ArrayBuffer(4));
+            ack.setUint32(0, sequence, true);
+            socket.send(ack.buffer);
+            handler(decoder.targets, decoder.snapshots[sequence % GDL90DeltaDecoder.SNAPSHOT_COUNT].timeMs);
+        };
+        return socket;
     }
 }
 
 async function main() {
     WebAssembly.instantiateStreaming(
-        fetch("gdl90.wasm"),
+        fetch(GDL90.moduleName()),
         GDL90.imports()
     ).then(result => {
         gdl90 = new GDL90(result.instance);
@@ -157,6 +540,12 @@ async function main() {
     });
 }
 
-main().catch(e => {
-    console.error(`${e}\n\nStack:\n${e.stack}`);
-});
+if (typeof window !== "undefined") {
+    main().catch(e => {
+        console.error(`${e}\n\nStack:\n${e.stack}`);
+    });
+}
+
+if (typeof module !== "undefined") {
+    module.exports = { GDL90, GDL90DeltaDecoder };
+}
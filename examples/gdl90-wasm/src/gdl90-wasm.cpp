@@ -46,44 +46,291 @@ void GDL90_write_stdout(const char * str)
     EXT_write_stdout(str, strlen(str));
 }
 
-#define GDL90_SYNTHESIZE(CLASS,MEMBER) \
-__attribute__((used)) auto CLASS ## _ ## MEMBER(CLASS * cl) -> decltype(+cl->MEMBER) { return cl->MEMBER; }
-
-GDL90_SYNTHESIZE(GDL90TrafficReport, id)
-GDL90_SYNTHESIZE(GDL90TrafficReport, alertStatus)
-GDL90_SYNTHESIZE(GDL90TrafficReport, addressType)
-GDL90_SYNTHESIZE(GDL90TrafficReport, participantAddress)
-GDL90_SYNTHESIZE(GDL90TrafficReport, latitude)
-GDL90_SYNTHESIZE(GDL90TrafficReport, longitude)
-GDL90_SYNTHESIZE(GDL90TrafficReport, altitude)
-GDL90_SYNTHESIZE(GDL90TrafficReport, trackHeadingType)
-GDL90_SYNTHESIZE(GDL90TrafficReport, reportStatus)
-GDL90_SYNTHESIZE(GDL90TrafficReport, airGroundState)
-GDL90_SYNTHESIZE(GDL90TrafficReport, navigationIntegrityCategory)
-GDL90_SYNTHESIZE(GDL90TrafficReport, navigationAccuracyCategoryForPosition)
-GDL90_SYNTHESIZE(GDL90TrafficReport, horizontalVelocity)
-GDL90_SYNTHESIZE(GDL90TrafficReport, verticalVelocity)
-GDL90_SYNTHESIZE(GDL90TrafficReport, trackHeading)
-GDL90_SYNTHESIZE(GDL90TrafficReport, emitterCategory)
-GDL90_SYNTHESIZE(GDL90TrafficReport, callsign)
-GDL90_SYNTHESIZE(GDL90TrafficReport, emergencyPriorityCode)
-GDL90_SYNTHESIZE(GDL90TrafficReport, spare)
-GDL90_SYNTHESIZE(GDL90TrafficReport, hasValidAltitude)
-GDL90_SYNTHESIZE(GDL90TrafficReport, hasValidHorizontalVelocity)
-GDL90_SYNTHESIZE(GDL90TrafficReport, hasValidVerticalVelocity)
-GDL90_SYNTHESIZE(GDL90TrafficReport, hasValidPosition)
-
-GDL90_SYNTHESIZE(GDL90OwnshipGeometricAltitude, id)
-GDL90_SYNTHESIZE(GDL90OwnshipGeometricAltitude, verticalWarning)
-GDL90_SYNTHESIZE(GDL90OwnshipGeometricAltitude, hasValidVFOM)
-GDL90_SYNTHESIZE(GDL90OwnshipGeometricAltitude, verticalFigureOfMerit)
-GDL90_SYNTHESIZE(GDL90OwnshipGeometricAltitude, geoAltitude)
+// Struct layouts for gdl90.js (GDL90Layout) : size, field count, then the offset and size of
+// each field in declaration order, so the JS reads the structs in linear memory with a DataView
+#define GDL90_LAYOUT_FIELD(CLASS,MEMBER) offsetof(CLASS, MEMBER), sizeof(((CLASS *)0)->MEMBER)
+
+__attribute__((used))
+uint32_t gdl90TrafficReportLayout[] = {
+    sizeof(GDL90TrafficReport), 23,
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, id),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, alertStatus),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, addressType),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, participantAddress),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, latitude),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, longitude),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, altitude),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, trackHeadingType),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, reportStatus),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, airGroundState),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, navigationIntegrityCategory),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, navigationAccuracyCategoryForPosition),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, horizontalVelocity),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, verticalVelocity),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, trackHeading),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, emitterCategory),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, callsign),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, emergencyPriorityCode),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, spare),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, hasValidAltitude),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, hasValidHorizontalVelocity),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, hasValidVerticalVelocity),
+    GDL90_LAYOUT_FIELD(GDL90TrafficReport, hasValidPosition)
+};
+
+__attribute__((used))
+uint32_t gdl90OwnshipGeometricAltitudeLayout[] = {
+    sizeof(GDL90OwnshipGeometricAltitude), 5,
+    GDL90_LAYOUT_FIELD(GDL90OwnshipGeometricAltitude, id),
+    GDL90_LAYOUT_FIELD(GDL90OwnshipGeometricAltitude, verticalWarning),
+    GDL90_LAYOUT_FIELD(GDL90OwnshipGeometricAltitude, hasValidVFOM),
+    GDL90_LAYOUT_FIELD(GDL90OwnshipGeometricAltitude, verticalFigureOfMerit),
+    GDL90_LAYOUT_FIELD(GDL90OwnshipGeometricAltitude, geoAltitude)
+};
+
+__attribute__((used))
+uint32_t gdl90HeartbeatLayout[] = {
+    sizeof(GDL90Heartbeat), 6,
+    GDL90_LAYOUT_FIELD(GDL90Heartbeat, id),
+    GDL90_LAYOUT_FIELD(GDL90Heartbeat, status1),
+    GDL90_LAYOUT_FIELD(GDL90Heartbeat, status2),
+    GDL90_LAYOUT_FIELD(GDL90Heartbeat, timestamp),
+    GDL90_LAYOUT_FIELD(GDL90Heartbeat, uplinkMessageCount),
+    GDL90_LAYOUT_FIELD(GDL90Heartbeat, basicLongMessageCount)
+};
+
+__attribute__((used))
+uint32_t gdl90HeightAboveTerrainLayout[] = {
+    sizeof(GDL90HeightAboveTerrain), 2,
+    GDL90_LAYOUT_FIELD(GDL90HeightAboveTerrain, id),
+    GDL90_LAYOUT_FIELD(GDL90HeightAboveTerrain, heightAboveTerrain)
+};
+
+__attribute__((used))
+uint32_t gdl90UplinkDataLayout[] = {
+    sizeof(GDL90UplinkData), 4,
+    GDL90_LAYOUT_FIELD(GDL90UplinkData, id),
+    GDL90_LAYOUT_FIELD(GDL90UplinkData, timeOfReception),
+    GDL90_LAYOUT_FIELD(GDL90UplinkData, payload),
+    GDL90_LAYOUT_FIELD(GDL90UplinkData, hasValidTor)
+};
+
+// Ownship and Traffic Reports of a GDL90_processData call, packed for gdl90.js to read them in
+// bulk rather than through EXT_handleGDL90Message. Sized for a full buffer of the smallest frames
+// GDL90TrafficReport_init accepts : 28 unescaped bytes (CRC included) between a flag and the
+// byte before them, so no report of a packet can miss it.
+#define GDL90_WASM_MIN_TRAFFIC_REPORT_FRAME_SIZE (28 + 2)
+#define GDL90_WASM_TRAFFIC_REPORT_CAPACITY (sizeof(gdl90StreamBuffer) / GDL90_WASM_MIN_TRAFFIC_REPORT_FRAME_SIZE)
+
+__attribute__((used))
+GDL90TrafficReport gdl90TrafficReports[GDL90_WASM_TRAFFIC_REPORT_CAPACITY] = {};
+static uint32_t gdl90TrafficReportCount = 0;
+
+static void handleGDL90Message(GDL90Message *gdl90Message, void *message)
+{
+    if ((gdl90Message->id == GDL90MessageType_TrafficReport || gdl90Message->id == GDL90MessageType_OwnshipReport)
+        && gdl90TrafficReportCount < GDL90_WASM_TRAFFIC_REPORT_CAPACITY)
+    {
+        memcpy(&gdl90TrafficReports[gdl90TrafficReportCount++], message, sizeof(GDL90TrafficReport));
+        return;
+    }
+    EXT_handleGDL90Message(gdl90Message, message);
+}
+
+/** Number of gdl90TrafficReports of the last GDL90_processData call, and resets it */
+__attribute__((used))
+uint32_t GDL90_takeTrafficReports()
+{
+    uint32_t count = gdl90TrafficReportCount;
+    gdl90TrafficReportCount = 0;
+    return count;
+}
+
+// Batched processing, without any call to JS : JS appends packets to gdl90InputRing (a uint16_t
+// length then the data, a zero length or less than 2 bytes left wrapping to the start) and
+// advances gdl90InputRingHead, GDL90_processRing() decodes them into gdl90OutputRing records,
+// and JS advances gdl90OutputRingTail as it reads them. Indices are free running (mod the size).
+// Uplink Data, ten times larger than the other messages, goes to gdl90UplinkRing : its record
+// only holds its index there, and JS advances gdl90UplinkRingTail past it as it reads it.
+#define GDL90_WASM_INPUT_RING_SIZE (1 << 16)
+#define GDL90_WASM_OUTPUT_RING_CAPACITY (1 << 10)
+#define GDL90_WASM_UPLINK_RING_CAPACITY (1 << 6)
+// Smallest Uplink Data frame : 436 unescaped bytes, the CRC and the flag after them (a packet
+// also starts with a flag or a byte GDL90Message_init skips)
+#define GDL90_WASM_MIN_UPLINK_DATA_FRAME_SIZE (436 + 2 + 1)
+
+/** Output record : the decoded message of id, or the gdl90UplinkRing index of Uplink Data */
+typedef struct GDL90WasmRecord
+{
+    uint8_t id;
+    union
+    {
+        GDL90Heartbeat heartbeat;
+        GDL90Initialization initialization;
+        GDL90HeightAboveTerrain heightAboveTerrain;
+        GDL90OwnshipGeometricAltitude ownshipGeometricAltitude;
+        GDL90TrafficReport trafficReport;
+        GDL90BasicReport basicReport;
+        GDL90LongReport longReport;
+        uint32_t uplink;
+    } message;
+} GDL90WasmRecord;
+
+__attribute__((used))
+uint32_t gdl90RecordLayout[] = {
+    sizeof(GDL90WasmRecord), 2,
+    GDL90_LAYOUT_FIELD(GDL90WasmRecord, id),
+    GDL90_LAYOUT_FIELD(GDL90WasmRecord, message)
+};
+
+static GDL90Stream gdl90RingStream = {};
+
+__attribute__((used))
+uint8_t gdl90InputRing[GDL90_WASM_INPUT_RING_SIZE] = {};
+/** Written by JS */
+__attribute__((used))
+uint32_t gdl90InputRingHead = 0;
+__attribute__((used))
+uint32_t gdl90InputRingTail = 0;
+
+__attribute__((used))
+GDL90WasmRecord gdl90OutputRing[GDL90_WASM_OUTPUT_RING_CAPACITY] = {};
+__attribute__((used))
+uint32_t gdl90OutputRingHead = 0;
+/** Written by JS */
+__attribute__((used))
+uint32_t gdl90OutputRingTail = 0;
+
+__attribute__((used))
+GDL90UplinkData gdl90UplinkRing[GDL90_WASM_UPLINK_RING_CAPACITY] = {};
+__attribute__((used))
+uint32_t gdl90UplinkRingHead = 0;
+/** Written by JS */
+__attribute__((used))
+uint32_t gdl90UplinkRingTail = 0;
+
+/** Messages not in the output ring : unknown ids (skipped), invalid or CRC errors, full rings */
+__attribute__((used))
+uint32_t gdl90RingSkippedCount = 0;
+__attribute__((used))
+uint32_t gdl90RingErrorCount = 0;
+__attribute__((used))
+uint32_t gdl90RingOverflowCount = 0;
+/** Set when a length of gdl90InputRing runs past its head : GDL90_processRing stops there */
+__attribute__((used))
+uint32_t gdl90InputRingCorrupted = 0;
+
+__attribute__((used))
+uint32_t GDL90_inputRingSize()
+{
+    return GDL90_WASM_INPUT_RING_SIZE;
+}
+
+__attribute__((used))
+uint32_t GDL90_outputRingCapacity()
+{
+    return GDL90_WASM_OUTPUT_RING_CAPACITY;
+}
+
+__attribute__((used))
+uint32_t GDL90_uplinkRingCapacity()
+{
+    return GDL90_WASM_UPLINK_RING_CAPACITY;
+}
+
+static void handleGDL90RingMessage(GDL90Message *gdl90Message, void *message)
+{
+    size_t size = 0;
+    switch (gdl90Message->id)
+    {
+        case GDL90MessageType_Heartbeat: size = sizeof(GDL90Heartbeat); break;
+        case GDL90MessageType_Initialization: size = sizeof(GDL90Initialization); break;
+        case GDL90MessageType_HeightAboveTerrain: size = sizeof(GDL90HeightAboveTerrain); break;
+        case GDL90MessageType_OwnshipGeometricAltitude: size = sizeof(GDL90OwnshipGeometricAltitude); break;
+        case GDL90MessageType_OwnshipReport:
+        case GDL90MessageType_TrafficReport: size = sizeof(GDL90TrafficReport); break;
+        case GDL90MessageType_BasicReport: size = sizeof(GDL90BasicReport); break;
+        case GDL90MessageType_LongReport: size = sizeof(GDL90LongReport); break;
+        case GDL90MessageType_UplinkData: break;
+        default: gdl90RingSkippedCount++; return;
+    }
+    if (gdl90OutputRingHead - gdl90OutputRingTail >= GDL90_WASM_OUTPUT_RING_CAPACITY
+        || (!size && gdl90UplinkRingHead - gdl90UplinkRingTail >= GDL90_WASM_UPLINK_RING_CAPACITY))
+    {
+        gdl90RingOverflowCount++;
+        return;
+    }
+    GDL90WasmRecord *record = &gdl90OutputRing[gdl90OutputRingHead++ % GDL90_WASM_OUTPUT_RING_CAPACITY];
+    record->id = gdl90Message->id;
+    if (!size)
+    {
+        record->message.uplink = gdl90UplinkRingHead;
+        memcpy(&gdl90UplinkRing[gdl90UplinkRingHead++ % GDL90_WASM_UPLINK_RING_CAPACITY], message, sizeof(GDL90UplinkData));
+        return;
+    }
+    memcpy(&record->message, message, size);
+}
+
+static void handleGDL90RingError(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    (void)error;
+    gdl90RingErrorCount++;
+}
+
+/**
+ * Decodes the packets of gdl90InputRing into gdl90OutputRing, returns the number of records to
+ * read. A packet is only started if its records (a frame takes at least 4 bytes) fit in the
+ * output ring and its Uplink Data in the uplink ring, or if the output ring is empty. Stops at
+ * a length running past gdl90InputRingHead, setting gdl90InputRingCorrupted.
+ */
+__attribute__((used))
+uint32_t GDL90_processRing()
+{
+    while (gdl90InputRingTail != gdl90InputRingHead)
+    {
+        uint32_t available = gdl90InputRingHead - gdl90InputRingTail;
+        uint32_t offset = gdl90InputRingTail % GDL90_WASM_INPUT_RING_SIZE;
+        uint16_t length = 0;
+        if (offset + 2 <= GDL90_WASM_INPUT_RING_SIZE)
+        {
+            length = (uint16_t)(gdl90InputRing[offset] | (gdl90InputRing[offset + 1] << 8));
+        }
+        if (!length || offset + 2 + length > GDL90_WASM_INPUT_RING_SIZE)
+        {
+            // wrap
+            if (GDL90_WASM_INPUT_RING_SIZE - offset > available)
+            {
+                gdl90InputRingCorrupted = 1;
+                break;
+            }
+            gdl90InputRingTail += GDL90_WASM_INPUT_RING_SIZE - offset;
+            continue;
+        }
+        if (2u + length > available)
+        {
+            gdl90InputRingCorrupted = 1;
+            break;
+        }
+
+        uint32_t used = gdl90OutputRingHead - gdl90OutputRingTail;
+        uint32_t uplinksUsed = gdl90UplinkRingHead - gdl90UplinkRingTail;
+        if (used && (GDL90_WASM_OUTPUT_RING_CAPACITY - used < (uint32_t)length / 4 + 1
+            || GDL90_WASM_UPLINK_RING_CAPACITY - uplinksUsed < (uint32_t)(length - 1) / GDL90_WASM_MIN_UPLINK_DATA_FRAME_SIZE))
+        {
+            break;
+        }
+        GDL90Stream_process(&gdl90RingStream, &gdl90InputRing[offset + 2], length);
+        gdl90InputRingTail += 2 + length;
+    }
+    return gdl90OutputRingHead - gdl90OutputRingTail;
+}
 
 __attribute__((used))
 void GDL90_init()
 {
     GDL90StreamConfig gdl90StreamConfig = {};
-    if (GDL90StreamConfig_init(&gdl90StreamConfig, EXT_handleGDL90Message, EXT_handleGDL90Error) != 0)
+    if (GDL90StreamConfig_init(&gdl90StreamConfig, handleGDL90Message, EXT_handleGDL90Error) != 0)
     {
         GDL90_write_stdout("failed to initialize GDL90Stream");
         return;
@@ -94,11 +341,30 @@ void GDL90_init()
         GDL90_write_stdout("failed to initialize GDL90Stream");
         return;
     }
+
+    GDL90StreamConfig gdl90RingStreamConfig = {};
+    if (GDL90StreamConfig_init(&gdl90RingStreamConfig, handleGDL90RingMessage, handleGDL90RingError) != 0
+        || GDL90Stream_init(&gdl90RingStream, &gdl90RingStreamConfig) != 0)
+    {
+        GDL90_write_stdout("failed to initialize GDL90Stream");
+        return;
+    }
+}
+
+__attribute__((used))
+uint32_t GDL90_streamBufferSize()
+{
+    return sizeof(gdl90StreamBuffer);
 }
 
 __attribute__((used))
 void GDL90_processData(uint16_t packetLength)
 {
+    if (packetLength > sizeof(gdl90StreamBuffer))
+    {
+        GDL90_write_stdout("GDL90 packet larger than gdl90StreamBuffer");
+        return;
+    }
     if (GDL90Stream_process(&gdl90Stream, gdl90StreamBuffer, packetLength) != 0)
     {
         GDL90_write_stdout("GDL90Stream processing failed");
@@ -0,0 +1,1042 @@
+//
+//  main.c
+//  gdl90-ws
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Serves the traffic picture of a GDL90 feed (UDP) to WebSocket display clients as delta
+// encoded snapshots (gdl90-delta), see GDL90DeltaDecoder in gdl90-wasm's gdl90.js.
+// Clients acknowledge each snapshot with its sequence (4 bytes, little endian, binary message)
+// and can ask for a keyframe with a single 'K'. A client whose previous snapshot isn't sent yet
+// skips the tick, its next delta is still relative to the last snapshot it acknowledged.
+
+#include <gdl90.h>
+#include <gdl90-traffic.h>
+#include <gdl90-delta.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 16
+#define CLIENT_IN_SIZE 4096
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+/** Frame header : 2 bytes, 8 of extended length */
+#define WS_HEADER_MAX_SIZE (2 + 8)
+
+// macOS and the BSDs have SO_NOSIGPIPE on the socket instead of MSG_NOSIGNAL on send
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+/** Make send to a closed peer fail with EPIPE instead of raising SIGPIPE */
+static void Socket_setNoSigPipe(int socket)
+{
+#if defined(SO_NOSIGPIPE)
+    int yes = 1;
+    (void)setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#else
+    (void)socket;
+#endif
+}
+
+typedef struct Client
+{
+    int socket;
+    uint8_t isOpen;
+    uint8_t in[CLIENT_IN_SIZE];
+    size_t inLength;
+    /** Frame being sent */
+    uint8_t *out;
+    size_t outLength;
+    size_t outSent;
+
+    GDL90DeltaState *states;
+    GDL90DeltaEncoder encoder;
+    uint64_t skippedCount;
+} Client;
+
+typedef struct Server
+{
+    // options
+    uint32_t capacity;
+    uint64_t intervalMs;
+    uint64_t keyframeIntervalMs;
+    uint64_t staleMs;
+
+    int listener;
+    int udp;
+    Client clients[MAX_CLIENTS];
+
+    GDL90StreamConfig streamConfig;
+    GDL90Stream stream;
+    GDL90TargetTableSlot *slots;
+    GDL90Target *targets;
+    GDL90TargetTable table;
+    uint64_t timeMs;
+
+    uint8_t *message;
+    size_t messageSize;
+
+    // stats
+    uint64_t reportCount;
+    uint64_t messageCount;
+} Server;
+
+/** The stream's message handler has no context */
+static Server *currentServer = NULL;
+
+static uint64_t monotonicMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline uint32_t rol32(uint32_t v, int n)
+{
+    return v << n | v >> (32 - n);
+}
+
+/** FIPS 180-4, only for the handshake */
+static void sha1(const uint8_t *data, size_t len, uint8_t out[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    uint64_t bits = (uint64_t)len * 8;
+    size_t blocks = (len + 8) / 64 + 1;
+
+    for (size_t block = 0; block < blocks; block++)
+    {
+        uint8_t chunk[64];
+        for (size_t i = 0; i < 64; i++)
+        {
+            size_t at = block * 64 + i;
+            chunk[i] = at < len ? data[at] : at == len ? 0x80 : 0;
+        }
+        if (block == blocks - 1)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                chunk[63 - i] = (uint8_t)(bits >> (8 * i));
+            }
+        }
+
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (uint32_t)chunk[4 * i] << 24 | (uint32_t)chunk[4 * i + 1] << 16 | (uint32_t)chunk[4 * i + 2] << 8 | chunk[4 * i + 3];
+        }
+        for (int i = 16; i < 80; i++)
+        {
+            w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++)
+        {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5a827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ed9eba1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+            else { f = b ^ c ^ d; k = 0xca62c1d6; }
+            uint32_t t = rol32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol32(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        out[4 * i] = (uint8_t)(h[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        out[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+/** out must fit 4 * ((len + 2) / 3) + 1 */
+static void base64(const uint8_t *data, size_t len, char *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t at = 0;
+    for (size_t i = 0; i < len; i += 3)
+    {
+        uint32_t v = (uint32_t)data[i] << 16 | (i + 1 < len ? (uint32_t)data[i + 1] << 8 : 0) | (i + 2 < len ? data[i + 2] : 0);
+        out[at++] = alphabet[(v >> 18) & 0x3f];
+        out[at++] = alphabet[(v >> 12) & 0x3f];
+        out[at++] = i + 1 < len ? alphabet[(v >> 6) & 0x3f] : '=';
+        out[at++] = i + 2 < len ? alphabet[v & 0x3f] : '=';
+    }
+    out[at] = '\0';
+}
+
+/** Sec-WebSocket-Accept of a Sec-WebSocket-Key */
+static void webSocketAccept(const char *key, size_t keyLength, char out[29])
+{
+    uint8_t input[128];
+    uint8_t digest[20];
+    size_t guidLength = strlen(WS_GUID);
+    keyLength = keyLength > sizeof(input) - guidLength ? sizeof(input) - guidLength : keyLength;
+    memcpy(input, key, keyLength);
+    memcpy(input + keyLength, WS_GUID, guidLength);
+    sha1(input, keyLength + guidLength, digest);
+    base64(digest, sizeof(digest), out);
+}
+
+/** Frame header of a payload of len, returns its size */
+static size_t webSocketHeader(uint8_t opcode, uint64_t len, uint8_t *out)
+{
+    out[0] = 0x80 | opcode;
+    if (len < 126)
+    {
+        out[1] = (uint8_t)len;
+        return 2;
+    }
+    if (len <= 0xffff)
+    {
+        out[1] = 126;
+        out[2] = (uint8_t)(len >> 8);
+        out[3] = (uint8_t)len;
+        return 4;
+    }
+    out[1] = 127;
+    for (int i = 0; i < 8; i++)
+    {
+        out[2 + i] = (uint8_t)(len >> (56 - 8 * i));
+    }
+    return 10;
+}
+
+/**
+ * Parses a frame at the start of data, 0 if incomplete, else its size with the (unmasked in
+ * place) payload
+ */
+static size_t webSocketParse(uint8_t *data, size_t len, uint8_t *opcode, uint8_t **payload, uint64_t *payloadLength)
+{
+    if (len < 2) { return 0; }
+
+    size_t at = 2;
+    uint64_t length = data[1] & 0x7f;
+    if (length == 126)
+    {
+        if (len < 4) { return 0; }
+        length = (uint64_t)data[2] << 8 | data[3];
+        at = 4;
+    }
+    else if (length == 127)
+    {
+        if (len < 10) { return 0; }
+        length = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            length = length << 8 | data[2 + i];
+        }
+        at = 10;
+    }
+
+    uint8_t mask[4] = {0};
+    uint8_t isMasked = data[1] & 0x80;
+    if (isMasked)
+    {
+        if (len < at + 4) { return 0; }
+        memcpy(mask, data + at, 4);
+        at += 4;
+    }
+    if (length > len - at) { return 0; }
+
+    for (uint64_t i = 0; isMasked && i < length; i++)
+    {
+        data[at + i] ^= mask[i & 3];
+    }
+    *opcode = data[0] & 0x0f;
+    *payload = data + at;
+    *payloadLength = length;
+
+    return at + (size_t)length;
+}
+
+static void Client_close(Client *self)
+{
+    if (self->socket >= 0)
+    {
+        close(self->socket);
+    }
+    self->socket = -1;
+    self->isOpen = 0;
+    self->inLength = 0;
+    self->outLength = 0;
+    self->outSent = 0;
+}
+
+/** Sends what it can of the pending frame, 0 if the connection failed */
+static int Client_flush(Client *self)
+{
+    while (self->outSent < self->outLength)
+    {
+        ssize_t n = send(self->socket, self->out + self->outSent, self->outLength - self->outSent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        self->outSent += (size_t)n;
+    }
+    self->outLength = 0;
+    self->outSent = 0;
+    return 1;
+}
+
+/** Queues a frame (fails if one is still being sent) */
+static int Client_sendFrame(Client *self, uint8_t opcode, const uint8_t *payload, size_t len)
+{
+    if (self->outLength) { return 0; }
+
+    self->outLength = webSocketHeader(opcode, len, self->out);
+    memcpy(self->out + self->outLength, payload, len);
+    self->outLength += len;
+    self->outSent = 0;
+    return Client_flush(self);
+}
+
+/** HTTP upgrade request, 0 if it failed */
+static int Client_handshake(Client *self)
+{
+    self->in[self->inLength < CLIENT_IN_SIZE ? self->inLength : CLIENT_IN_SIZE - 1] = '\0';
+    char *end = strstr((char *)self->in, "\r\n\r\n");
+    if (!end) { return self->inLength < CLIENT_IN_SIZE - 1; }
+
+    const char *key = NULL;
+    size_t keyLength = 0;
+    for (char *line = strstr((char *)self->in, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n"))
+    {
+        const char *header = line + 2;
+        if (strncasecmp(header, "Sec-WebSocket-Key:", 18) == 0)
+        {
+            key = header + 18;
+            while (*key == ' ') { key++; }
+            keyLength = strcspn(key, " \r\n");
+        }
+    }
+    if (!key) { return 0; }
+
+    char accept[29];
+    char response[256];
+    webSocketAccept(key, keyLength, accept);
+    int length = snprintf(response, sizeof(response),
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: %s\r\n"
+        "\r\n", accept);
+    memcpy(self->out, response, (size_t)length);
+    self->outLength = (size_t)length;
+    self->outSent = 0;
+
+    // frames may follow the request
+    size_t consumed = (size_t)(end + 4 - (char *)self->in);
+    memmove(self->in, self->in + consumed, self->inLength - consumed);
+    self->inLength -= consumed;
+    self->isOpen = 1;
+    GDL90DeltaEncoder_requestKeyframe(&self->encoder);
+
+    return Client_flush(self);
+}
+
+/** Handles the frames received, 0 if the connection should be closed */
+static int Client_handleFrames(Client *self)
+{
+    size_t at = 0;
+    for (;;)
+    {
+        uint8_t opcode = 0;
+        uint8_t *payload = NULL;
+        uint64_t length = 0;
+        const uint8_t *header = self->in + at;
+        size_t size = webSocketParse(self->in + at, self->inLength - at, &opcode, &payload, &length);
+        if (!size) { break; }
+        at += size;
+
+        // RFC 6455 5.1 client frames must be masked, 5.2 no extension was negotiated (RSV bits 0)
+        // and the client only sends short messages : fragments (5.4) are protocol errors here
+        if (!(header[1] & 0x80) || (header[0] & 0x70) || !(header[0] & 0x80) || opcode == 0x0)
+        {
+            const uint8_t status[2] = { 1002 >> 8, 1002 & 0xff };
+            (void)Client_sendFrame(self, 0x8, status, sizeof(status));
+            return 0;
+        }
+
+        switch (opcode)
+        {
+            case 0x2:
+                if (length == 4)
+                {
+                    uint32_t sequence = (uint32_t)payload[0] | (uint32_t)payload[1] << 8 | (uint32_t)payload[2] << 16 | (uint32_t)payload[3] << 24;
+                    GDL90DeltaEncoder_ack(&self->encoder, sequence);
+                }
+                else if (length == 1 && payload[0] == 'K')
+                {
+                    GDL90DeltaEncoder_requestKeyframe(&self->encoder);
+                }
+                break;
+            case 0x8:
+                return 0;
+            case 0x9:
+                (void)Client_sendFrame(self, 0xa, payload, (size_t)length);
+                break;
+            default:
+                break;
+        }
+    }
+    memmove(self->in, self->in + at, self->inLength - at);
+    self->inLength -= at;
+
+    // a frame larger than the buffer
+    return self->inLength < CLIENT_IN_SIZE;
+}
+
+static void Client_receive(Client *self)
+{
+    ssize_t n = recv(self->socket, self->in + self->inLength, CLIENT_IN_SIZE - self->inLength, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        Client_close(self);
+        return;
+    }
+    if (n < 0) { return; }
+    self->inLength += (size_t)n;
+
+    int isOK = self->isOpen ? 1 : Client_handshake(self);
+    if (isOK && self->isOpen)
+    {
+        isOK = Client_handleFrames(self);
+    }
+    if (!isOK)
+    {
+        Client_close(self);
+    }
+}
+
+static void handleGDL90Message(GDL90Message *gdl90Message, void *message)
+{
+    if (gdl90Message->id != GDL90MessageType_TrafficReport) { return; }
+
+    GDL90Target *target = NULL;
+    if (GDL90TargetTable_update(&currentServer->table, currentServer->timeMs, (GDL90TrafficReport *)message, &target) == GDL90ResultOK)
+    {
+        currentServer->reportCount++;
+    }
+}
+
+static void handleGDL90Error(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    (void)error;
+}
+
+static int Server_init(Server *self, uint16_t port, uint16_t udpPort, uint8_t loopbackOnly)
+{
+    currentServer = self;
+    self->udp = -1;
+    self->listener = -1;
+    self->messageSize = GDL90_DELTA_MAX_SIZE(self->capacity);
+    self->slots = calloc(self->capacity, sizeof(GDL90TargetTableSlot));
+    self->targets = calloc(self->capacity, sizeof(GDL90Target));
+    self->message = malloc(self->messageSize);
+    if (!self->slots || !self->targets || !self->message) { return 0; }
+    if (GDL90TargetTable_init(&self->table, self->slots, self->targets, self->capacity) != GDL90ResultOK) { return 0; }
+    if (GDL90StreamConfig_init(&self->streamConfig, handleGDL90Message, handleGDL90Error) != GDL90ResultOK) { return 0; }
+    if (GDL90Stream_init(&self->stream, &self->streamConfig) != GDL90ResultOK) { return 0; }
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        Client *client = &self->clients[i];
+        client->socket = -1;
+        client->states = calloc((size_t)GDL90_DELTA_SNAPSHOT_COUNT * self->capacity, sizeof(GDL90DeltaState));
+        client->out = malloc(WS_HEADER_MAX_SIZE + self->messageSize);
+        if (!client->states || !client->out) { return 0; }
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+
+    int yes = 1;
+    self->listener = socket(AF_INET, SOCK_STREAM, 0);
+    address.sin_port = htons(port);
+    if (self->listener < 0
+        || setsockopt(self->listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0
+        || bind(self->listener, (struct sockaddr *)&address, sizeof(address)) < 0
+        || listen(self->listener, MAX_CLIENTS) < 0)
+    {
+        perror("listen");
+        return 0;
+    }
+    fcntl(self->listener, F_SETFL, O_NONBLOCK);
+
+    if (udpPort)
+    {
+        self->udp = socket(AF_INET, SOCK_DGRAM, 0);
+        address.sin_port = htons(udpPort);
+        if (self->udp < 0 || bind(self->udp, (struct sockaddr *)&address, sizeof(address)) < 0)
+        {
+            perror("udp");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static uint16_t Server_port(Server *self)
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (getsockname(self->listener, (struct sockaddr *)&address, &length) < 0) { return 0; }
+    return ntohs(address.sin_port);
+}
+
+static void Server_accept(Server *self)
+{
+    int socket = accept(self->listener, NULL, NULL);
+    if (socket < 0) { return; }
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        Client *client = &self->clients[i];
+        if (client->socket >= 0) { continue; }
+
+        fcntl(socket, F_SETFL, O_NONBLOCK);
+        Socket_setNoSigPipe(socket);
+        client->socket = socket;
+        client->isOpen = 0;
+        client->inLength = 0;
+        client->outLength = 0;
+        client->outSent = 0;
+        client->skippedCount = 0;
+        GDL90DeltaEncoder_init(&client->encoder, client->states, self->capacity, self->keyframeIntervalMs);
+        return;
+    }
+    close(socket);
+}
+
+/** Sends the next snapshot to the clients */
+static void Server_tick(Server *self)
+{
+    GDL90TargetTable_evict(&self->table, self->timeMs > self->staleMs ? self->timeMs - self->staleMs : 0);
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        Client *client = &self->clients[i];
+        if (client->socket < 0 || !client->isOpen) { continue; }
+        if (client->outLength)
+        {
+            client->skippedCount++;
+            continue;
+        }
+
+        size_t length = 0;
+        if (GDL90DeltaEncoder_encode(&client->encoder, &self->table, self->timeMs, self->message, self->messageSize, &length) != GDL90ResultOK) { continue; }
+        if (!Client_sendFrame(client, 0x2, self->message, length))
+        {
+            Client_close(client);
+            continue;
+        }
+        self->messageCount++;
+    }
+}
+
+/** One round of I/O, waiting up to timeoutMs */
+static void Server_poll(Server *self, int timeoutMs)
+{
+    struct pollfd fds[2 + MAX_CLIENTS];
+    int clientFds[MAX_CLIENTS];
+    nfds_t count = 0;
+
+    fds[count].fd = self->listener;
+    fds[count++].events = POLLIN;
+    if (self->udp >= 0)
+    {
+        fds[count].fd = self->udp;
+        fds[count++].events = POLLIN;
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        Client *client = &self->clients[i];
+        clientFds[i] = -1;
+        if (client->socket < 0) { continue; }
+        clientFds[i] = (int)count;
+        fds[count].fd = client->socket;
+        fds[count++].events = (short)(POLLIN | (client->outLength ? POLLOUT : 0));
+    }
+
+    if (poll(fds, count, timeoutMs) <= 0) { return; }
+
+    if (fds[0].revents & POLLIN)
+    {
+        Server_accept(self);
+    }
+    if (self->udp >= 0 && (fds[1].revents & POLLIN))
+    {
+        uint8_t datagram[65536];
+        ssize_t n = recv(self->udp, datagram, sizeof(datagram), MSG_DONTWAIT);
+        if (n > 0 && n <= UINT16_MAX)
+        {
+            GDL90Stream_process(&self->stream, datagram, (uint16_t)n);
+        }
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        Client *client = &self->clients[i];
+        if (clientFds[i] < 0 || client->socket < 0) { continue; }
+
+        short revents = fds[clientFds[i]].revents;
+        if (revents & (POLLERR | POLLHUP))
+        {
+            Client_close(client);
+            continue;
+        }
+        if ((revents & POLLOUT) && !Client_flush(client))
+        {
+            Client_close(client);
+            continue;
+        }
+        if (revents & POLLIN)
+        {
+            Client_receive(client);
+        }
+    }
+}
+
+static void Server_free(Server *self)
+{
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        Client_close(&self->clients[i]);
+        free(self->clients[i].states);
+        free(self->clients[i].out);
+    }
+    if (self->listener >= 0) { close(self->listener); }
+    if (self->udp >= 0) { close(self->udp); }
+    free(self->message);
+    free(self->targets);
+    free(self->slots);
+}
+
+// Self test : simulated traffic fed through the stream, one client over the loopback
+
+typedef struct TestClient
+{
+    int socket;
+    uint8_t in[1<<20];
+    size_t inLength;
+    GDL90DeltaState *states;
+    GDL90DeltaDecoder decoder;
+    uint64_t byteCount;
+    FILE *dump;
+} TestClient;
+
+/** Masked client frame */
+static int TestClient_send(TestClient *self, const uint8_t *payload, size_t len)
+{
+    uint8_t frame[64];
+    const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    size_t at = webSocketHeader(0x2, len, frame);
+    frame[1] |= 0x80;
+    memcpy(frame + at, mask, 4);
+    at += 4;
+    for (size_t i = 0; i < len; i++)
+    {
+        frame[at + i] = payload[i] ^ mask[i & 3];
+    }
+    return send(self->socket, frame, at + len, MSG_NOSIGNAL) == (ssize_t)(at + len);
+}
+
+/** Waits for the next snapshot (serving the server meanwhile), 0 if none came */
+static int TestClient_receive(TestClient *self, Server *server, uint8_t ack)
+{
+    for (int attempt = 0; attempt < 1000; attempt++)
+    {
+        uint8_t opcode = 0;
+        uint8_t *payload = NULL;
+        uint64_t length = 0;
+        size_t size = webSocketParse(self->in, self->inLength, &opcode, &payload, &length);
+        if (size)
+        {
+            if (opcode != 0x2) { return 0; }
+            if (self->dump)
+            {
+                uint8_t header[4] = { (uint8_t)length, (uint8_t)(length >> 8), (uint8_t)(length >> 16), (uint8_t)(length >> 24) };
+                fwrite(header, 1, sizeof(header), self->dump);
+                fwrite(payload, 1, (size_t)length, self->dump);
+            }
+            self->byteCount += size;
+            int isOK = GDL90DeltaDecoder_decode(&self->decoder, payload, (size_t)length) == GDL90ResultOK;
+            memmove(self->in, self->in + size, self->inLength - size);
+            self->inLength -= size;
+            if (!isOK) { return 0; }
+            if (ack)
+            {
+                uint8_t sequence[4] = { (uint8_t)self->decoder.sequence, (uint8_t)(self->decoder.sequence >> 8), (uint8_t)(self->decoder.sequence >> 16), (uint8_t)(self->decoder.sequence >> 24) };
+                if (!TestClient_send(self, sequence, sizeof(sequence))) { return 0; }
+            }
+            return 1;
+        }
+
+        Server_poll(server, 0);
+        struct pollfd fd = { self->socket, POLLIN, 0 };
+        if (poll(&fd, 1, 10) > 0)
+        {
+            ssize_t n = recv(self->socket, self->in + self->inLength, sizeof(self->in) - self->inLength, 0);
+            if (n <= 0) { return 0; }
+            self->inLength += (size_t)n;
+        }
+    }
+    return 0;
+}
+
+static int TestClient_connect(TestClient *self, Server *server)
+{
+    self->inLength = 0;
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(Server_port(server));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    self->socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (self->socket < 0 || connect(self->socket, (struct sockaddr *)&address, sizeof(address)) < 0) { return 0; }
+    Socket_setNoSigPipe(self->socket);
+
+    // RFC 6455 1.3 example key
+    const char *request =
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+    if (send(self->socket, request, strlen(request), MSG_NOSIGNAL) != (ssize_t)strlen(request)) { return 0; }
+
+    for (int attempt = 0; attempt < 1000; attempt++)
+    {
+        Server_poll(server, 0);
+        struct pollfd fd = { self->socket, POLLIN, 0 };
+        if (poll(&fd, 1, 10) <= 0) { continue; }
+
+        ssize_t n = recv(self->socket, self->in + self->inLength, sizeof(self->in) - 1 - self->inLength, 0);
+        if (n <= 0) { return 0; }
+        self->inLength += (size_t)n;
+        self->in[self->inLength] = '\0';
+
+        char *end = strstr((char *)self->in, "\r\n\r\n");
+        if (!end) { continue; }
+        if (!strstr((char *)self->in, "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n")) { return 0; }
+
+        size_t consumed = (size_t)(end + 4 - (char *)self->in);
+        memmove(self->in, self->in + consumed, self->inLength - consumed);
+        self->inLength -= consumed;
+        return 1;
+    }
+    return 0;
+}
+
+/** Sends a frame the server must close the connection on, 1 if it did */
+static int TestClient_expectClose(TestClient *self, Server *server, const uint8_t *frame, size_t len)
+{
+    if (!TestClient_connect(self, server)) { return 0; }
+    if (send(self->socket, frame, len, MSG_NOSIGNAL) != (ssize_t)len) { return 0; }
+
+    int isClosed = 0;
+    for (int attempt = 0; attempt < 1000 && !isClosed; attempt++)
+    {
+        Server_poll(server, 0);
+        struct pollfd fd = { self->socket, POLLIN, 0 };
+        if (poll(&fd, 1, 10) <= 0) { continue; }
+
+        // the close frame, then the end of the connection
+        uint8_t in[64];
+        isClosed = recv(self->socket, in, sizeof(in), 0) <= 0;
+    }
+    close(self->socket);
+    return isClosed;
+}
+
+static void testTrafficReport(GDL90TrafficReport *report, uint32_t i, double timeS)
+{
+    memset(report, 0, sizeof(*report));
+    report->id = GDL90MessageType_TrafficReport;
+    report->addressType = GDL90TrafficReportAddressTypeADSBWithICAO;
+    report->participantAddress = 0xa00000 + i;
+    report->latitude = 45.0 + (i % 50) * 0.02 + timeS * 0.0004 * ((i & 1) ? 1.0 : -1.0);
+    report->longitude = -122.0 - (i / 50) * 0.02 + timeS * 0.0003;
+    report->altitude = 3000 + (int32_t)(i * 100) + (int32_t)timeS / 10 * 100;
+    report->hasValidAltitude = 1;
+    report->hasValidPosition = 1;
+    report->hasValidHorizontalVelocity = 1;
+    report->horizontalVelocity = 100 + i % 200;
+    report->hasValidVerticalVelocity = 1;
+    report->trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report->trackHeading = (double)((i * 37) % 360);
+    report->airGroundState = 1;
+    report->navigationIntegrityCategory = 8;
+    report->navigationAccuracyCategoryForPosition = 9;
+    report->emitterCategory = 1;
+    snprintf(report->callsign, sizeof(report->callsign), "T%05u", (unsigned)i);
+}
+
+static int selfTest(Server *server, uint32_t targetCount, uint64_t durationMs, const char *dumpPrefix)
+{
+    static TestClient client;
+    char path[512];
+
+    client.states = calloc((size_t)GDL90_DELTA_SNAPSHOT_COUNT * server->capacity, sizeof(GDL90DeltaState));
+    if (!client.states || GDL90DeltaDecoder_init(&client.decoder, client.states, server->capacity) != GDL90ResultOK) { return 0; }
+    if (dumpPrefix)
+    {
+        snprintf(path, sizeof(path), "%s.bin", dumpPrefix);
+        client.dump = fopen(path, "wb");
+        if (!client.dump) { return 0; }
+    }
+
+    if (!TestClient_connect(&client, server))
+    {
+        fprintf(stderr, "Handshake failed\n");
+        return 0;
+    }
+
+    uint8_t datagram[1400];
+    uint8_t bytes[28];
+    GDL90FrameBuilder builder;
+    GDL90TrafficReport report;
+    uint64_t fullByteCount = 0;
+    uint64_t tick = 0;
+
+    for (server->timeMs = 0; server->timeMs < durationMs; server->timeMs += server->intervalMs, tick++)
+    {
+        // every target reports once a second, spread over the ticks
+        GDL90FrameBuilder_init(&builder, datagram, sizeof(datagram));
+        for (uint32_t i = 0; i < targetCount; i++)
+        {
+            if ((i + tick) % (1000 / server->intervalMs) != 0 && server->timeMs != 0) { continue; }
+
+            testTrafficReport(&report, i, (double)server->timeMs / 1000.0);
+            GDL90TrafficReport_toBytes(&report, bytes);
+            if (GDL90FrameBuilder_append(&builder, bytes, sizeof(bytes)) != GDL90ResultOK)
+            {
+                GDL90Stream_process(&server->stream, datagram, (uint16_t)builder.length);
+                GDL90FrameBuilder_reset(&builder);
+                GDL90FrameBuilder_append(&builder, bytes, sizeof(bytes));
+            }
+        }
+        GDL90Stream_process(&server->stream, datagram, (uint16_t)builder.length);
+
+        // the display is briefly slow every now and then : acknowledgements lost
+        Server_tick(server);
+        if (!TestClient_receive(&client, server, tick % 7 != 3))
+        {
+            fprintf(stderr, "No snapshot at %llu ms\n", (unsigned long long)server->timeMs);
+            return 0;
+        }
+        // the acknowledgement gets to the server before the next tick
+        Server_poll(server, 1);
+        // what sending the Traffic Reports of every target would take
+        fullByteCount += (uint64_t)server->table.count * GDL90_TRAFFIC_REPORT_FRAME_SIZE;
+    }
+
+    // same picture on both sides
+    const GDL90DeltaState *states = GDL90DeltaDecoder_states(&client.decoder);
+    uint32_t mismatchCount = 0;
+    for (uint32_t i = 0; i < server->capacity; i++)
+    {
+        GDL90DeltaState expected;
+        memset(&expected, 0, sizeof(expected));
+        if (server->targets[i].key)
+        {
+            GDL90DeltaState_initWithTrafficReport(&expected, &server->targets[i].report);
+        }
+        mismatchCount += memcmp(&expected, &states[i], sizeof(expected)) != 0;
+    }
+
+    if (dumpPrefix)
+    {
+        fclose(client.dump);
+        snprintf(path, sizeof(path), "%s.json", dumpPrefix);
+        FILE *json = fopen(path, "w");
+        if (!json) { return 0; }
+        fprintf(json, "[");
+        int isFirst = 1;
+        for (uint32_t i = 0; i < server->capacity; i++)
+        {
+            if (!states[i].present) { continue; }
+            GDL90DeltaState_toTrafficReport(&states[i], &report);
+            fprintf(json, "%s\n{\"id\":%u,\"participantAddress\":%u,\"latitude\":%.17g,\"longitude\":%.17g,\"altitude\":%d,\"horizontalVelocity\":%u,\"verticalVelocity\":%d,\"trackHeading\":%.17g,\"callsign\":\"%.8s\"}",
+                isFirst ? "" : ",", (unsigned)i, (unsigned)report.participantAddress, report.latitude, report.longitude, (int)report.altitude,
+                (unsigned)report.horizontalVelocity, (int)report.verticalVelocity, report.trackHeading, report.callsign);
+            isFirst = 0;
+        }
+        fprintf(json, "\n]\n");
+        fclose(json);
+    }
+
+    const GDL90DeltaEncoder *encoder = &server->clients[0].encoder;
+    double ratio = client.byteCount ? (double)fullByteCount / (double)client.byteCount : 0.0;
+    fprintf(stderr,
+        "%u targets, %llu snapshots (%llu keyframes, %llu deltas), %llu bytes received\n"
+        "%llu bytes as Traffic Reports (%.1fx), %llu bytes as keyframes (%.1fx), %u mismatches\n"
+        , (unsigned)server->table.count
+        , (unsigned long long)tick
+        , (unsigned long long)encoder->keyframeCount
+        , (unsigned long long)encoder->deltaCount
+        , (unsigned long long)client.byteCount
+        , (unsigned long long)fullByteCount
+        , ratio
+        , (unsigned long long)encoder->keyframeByteCount
+        , client.byteCount ? (double)encoder->keyframeByteCount / (double)client.byteCount : 0.0
+        , (unsigned)mismatchCount
+    );
+
+    close(client.socket);
+    free(client.states);
+
+    // protocol errors : an unmasked frame, a fragment
+    const uint8_t unmasked[] = { 0x82, 0x01, 'K' };
+    const uint8_t fragment[] = { 0x02, 0x81, 0x12, 0x34, 0x56, 0x78, 'K' ^ 0x12 };
+    int isRejected = TestClient_expectClose(&client, server, unmasked, sizeof(unmasked)) && TestClient_expectClose(&client, server, fragment, sizeof(fragment));
+    if (!isRejected)
+    {
+        fprintf(stderr, "Invalid client frames accepted\n");
+    }
+
+    return mismatchCount == 0 && ratio >= 10.0 && isRejected;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "gdl90-ws [options]\n"
+        "  -p port         GDL90 UDP port (default 4000)\n"
+        "  -l port         WebSocket port (default 8090)\n"
+        "  -r hz           snapshots per second (default 5)\n"
+        "  -k seconds      keyframe interval (default 10)\n"
+        "  -n capacity     targets (power of 2, default 4096)\n"
+        "  -T              self test over the loopback\n"
+        "  -w prefix       with -T, write the snapshots (prefix.bin) and the decoded targets (prefix.json)\n"
+    );
+}
+
+int main(int argc, char *argv[])
+{
+    static Server server;
+    Server *self = &server;
+    long port = 8090;
+    long udpPort = 4000;
+    double rate = 5.0;
+    double keyframeInterval = 10.0;
+    int isSelfTest = 0;
+    const char *dumpPrefix = NULL;
+
+    self->capacity = 4096;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0') { usage(); return EXIT_FAILURE; }
+
+        switch (arg[1])
+        {
+            case 'T': isSelfTest = 1; continue;
+            case 'h': usage(); return EXIT_SUCCESS;
+            default: break;
+        }
+
+        if (!value) { usage(); return EXIT_FAILURE; }
+        i++;
+        switch (arg[1])
+        {
+            case 'p': udpPort = strtol(value, NULL, 10); break;
+            case 'l': port = strtol(value, NULL, 10); break;
+            case 'r': rate = strtod(value, NULL); break;
+            case 'k': keyframeInterval = strtod(value, NULL); break;
+            case 'n': self->capacity = (uint32_t)strtoul(value, NULL, 10); break;
+            case 'w': dumpPrefix = value; break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    if (rate <= 0.0 || rate > 100.0 || keyframeInterval < 0.0 || port < 0 || port > 65535 || udpPort < 0 || udpPort > 65535
+        || self->capacity < 8 || (self->capacity & (self->capacity - 1)))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+    self->intervalMs = (uint64_t)(1000.0 / rate);
+    self->keyframeIntervalMs = (uint64_t)(keyframeInterval * 1000.0);
+    self->staleMs = 20000;
+
+    if (isSelfTest)
+    {
+        self->intervalMs = 200;
+        int isOK = Server_init(self, 0, 0, 1) && selfTest(self, 1000, 60000, dumpPrefix);
+        Server_free(self);
+        return isOK ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (!Server_init(self, (uint16_t)port, (uint16_t)udpPort, 0))
+    {
+        Server_free(self);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "GDL90 on udp/%ld, WebSocket on tcp/%u\n", udpPort, (unsigned)Server_port(self));
+
+    uint64_t nextTickMs = monotonicMs();
+    for (;;)
+    {
+        uint64_t nowMs = monotonicMs();
+        if (nowMs >= nextTickMs)
+        {
+            self->timeMs = nowMs;
+            Server_tick(self);
+            nextTickMs += self->intervalMs;
+            nextTickMs = nextTickMs < nowMs ? nowMs + self->intervalMs : nextTickMs;
+        }
+        self->timeMs = monotonicMs();
+        Server_poll(self, (int)(nextTickMs > self->timeMs ? nextTickMs - self->timeMs : 0));
+    }
+
+    return EXIT_SUCCESS;
+}
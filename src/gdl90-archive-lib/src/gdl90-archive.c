@@ -0,0 +1,488 @@
+//
+//  gdl90-archive.c
+//  gdl90-archive-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "gdl90-archive.h"
+
+#include <string.h>
+
+static const uint8_t GDL90_ARCHIVE_FILEMAGIC[8] = { 'G', 'D', 'L', '9', '0', 'A', 'R', 'C' };
+static const uint8_t GDL90_ARCHIVE_BLOCKMAGIC[4] = { 'G', 'A', 'R', 'B' };
+static const uint16_t GDL90_ARCHIVE_VERSION = 1;
+
+#define GDL90_ARCHIVE_FILEHEADER_SIZE 12
+#define GDL90_ARCHIVE_COLUMNHEADER_SIZE 26
+#define GDL90_ARCHIVE_BLOCKHEADER_SIZE (12 + GDL90ArchiveColumnCount * GDL90_ARCHIVE_COLUMNHEADER_SIZE)
+
+static const double GDL90_ARCHIVE_LATLONRES = 180.0 / (double)(1<<23);
+
+static inline void lsbu16(uint8_t *out, uint16_t v)
+{
+    out[0] = (uint8_t)v;
+    out[1] = (uint8_t)(v >> 8);
+}
+
+static inline void lsbu32(uint8_t *out, uint32_t v)
+{
+    for (size_t i = 0; i < 4; i++) { out[i] = (uint8_t)(v >> (8*i)); }
+}
+
+static inline void lsbu64(uint8_t *out, uint64_t v)
+{
+    for (size_t i = 0; i < 8; i++) { out[i] = (uint8_t)(v >> (8*i)); }
+}
+
+static inline uint32_t u32lsb(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static inline uint64_t u64lsb(const uint8_t *in)
+{
+    return (uint64_t)u32lsb(in) | ((uint64_t)u32lsb(in+4) << 32);
+}
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline size_t varintSize(uint64_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+static inline int32_t rawAngle(double degrees, double res)
+{
+    double raw = degrees / res;
+    return (int32_t)(raw < 0 ? raw - 0.5 : raw + 0.5);
+}
+
+/** Buffered sequential writer for column data */
+typedef struct GDL90ArchiveOutput
+{
+    FILE *file;
+    uint8_t buffer[256];
+    size_t length;
+    uint8_t bits;
+    uint8_t bitCount;
+    uint8_t failed;
+} GDL90ArchiveOutput;
+
+static inline void GDL90ArchiveOutput_byte(GDL90ArchiveOutput *self, uint8_t b)
+{
+    self->buffer[self->length++] = b;
+    if (self->length == sizeof(self->buffer))
+    {
+        if (fwrite(self->buffer, 1, self->length, self->file) != self->length) { self->failed = 1; }
+        self->length = 0;
+    }
+}
+
+static inline void GDL90ArchiveOutput_varint(GDL90ArchiveOutput *self, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        GDL90ArchiveOutput_byte(self, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    GDL90ArchiveOutput_byte(self, (uint8_t)v);
+}
+
+static inline void GDL90ArchiveOutput_bits(GDL90ArchiveOutput *self, uint64_t v, uint8_t width)
+{
+    while (width > 0)
+    {
+        uint8_t take = (uint8_t)(8 - self->bitCount);
+        if (take > width) { take = width; }
+        self->bits |= (uint8_t)((v & ((1u << take) - 1)) << self->bitCount);
+        self->bitCount = (uint8_t)(self->bitCount + take);
+        v >>= take;
+        width = (uint8_t)(width - take);
+        if (self->bitCount == 8)
+        {
+            GDL90ArchiveOutput_byte(self, self->bits);
+            self->bits = 0;
+            self->bitCount = 0;
+        }
+    }
+}
+
+static inline GDL90Result GDL90ArchiveOutput_finish(GDL90ArchiveOutput *self)
+{
+    if (self->bitCount)
+    {
+        GDL90ArchiveOutput_byte(self, self->bits);
+        self->bits = 0;
+        self->bitCount = 0;
+    }
+    if (self->length && fwrite(self->buffer, 1, self->length, self->file) != self->length) { self->failed = 1; }
+    self->length = 0;
+    return self->failed ? GDL90ResultFailure : GDL90ResultOK;
+}
+
+GDL90Result GDL90ArchiveWriter_init(GDL90ArchiveWriter *self, FILE *file)
+{
+    if (!self || !file) { return GDL90ResultFailure; }
+
+    self->file = file;
+    self->recordCount = 0;
+
+    uint8_t header[GDL90_ARCHIVE_FILEHEADER_SIZE];
+    memcpy(header, GDL90_ARCHIVE_FILEMAGIC, sizeof(GDL90_ARCHIVE_FILEMAGIC));
+    lsbu16(header+8, GDL90_ARCHIVE_VERSION);
+    lsbu16(header+10, GDL90ArchiveColumnCount);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) { return GDL90ResultFailure; }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ArchiveWriter_append(GDL90ArchiveWriter *self, uint64_t timeMs, const GDL90TrafficReport *report)
+{
+    if (!self || !report) { return GDL90ResultFailure; }
+    // full block left by a failed write : write it again first
+    if (self->recordCount >= GDL90_ARCHIVE_BLOCK_RECORDS && GDL90ArchiveWriter_flush(self) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+    uint32_t i = self->recordCount;
+    self->columns[GDL90ArchiveColumnTime][i] = (int64_t)timeMs;
+    self->columns[GDL90ArchiveColumnAddress][i] = ((int64_t)report->addressType << 24) | (int64_t)(report->participantAddress & 0xffffff);
+    self->columns[GDL90ArchiveColumnLatitude][i] = rawAngle(report->latitude, GDL90_ARCHIVE_LATLONRES);
+    self->columns[GDL90ArchiveColumnLongitude][i] = rawAngle(report->longitude, GDL90_ARCHIVE_LATLONRES);
+    self->columns[GDL90ArchiveColumnAltitude][i] = report->altitude;
+    self->columns[GDL90ArchiveColumnHorizontalVelocity][i] = report->horizontalVelocity;
+    self->columns[GDL90ArchiveColumnVerticalVelocity][i] = report->verticalVelocity;
+    self->columns[GDL90ArchiveColumnTrackHeading][i] = rawAngle(report->trackHeading, 360.0/256.0) & 0xff;
+    self->columns[GDL90ArchiveColumnFlags][i] =
+        ((int64_t)(report->alertStatus & 0x0f) << GDL90ArchiveFlagsShiftAlertStatus)
+        | ((int64_t)(report->trackHeadingType & 0x03) << GDL90ArchiveFlagsShiftTrackHeadingType)
+        | ((int64_t)(report->reportStatus & 0x01) << GDL90ArchiveFlagsShiftReportStatus)
+        | ((int64_t)(report->airGroundState & 0x01) << GDL90ArchiveFlagsShiftAirGroundState)
+        | ((int64_t)(report->navigationIntegrityCategory & 0x0f) << GDL90ArchiveFlagsShiftNIC)
+        | ((int64_t)(report->navigationAccuracyCategoryForPosition & 0x0f) << GDL90ArchiveFlagsShiftNACP)
+        | ((int64_t)report->emitterCategory << GDL90ArchiveFlagsShiftEmitterCategory)
+        | ((int64_t)(report->emergencyPriorityCode & 0x0f) << GDL90ArchiveFlagsShiftEmergencyPriorityCode)
+        | ((int64_t)(report->hasValidAltitude != 0) << (GDL90ArchiveFlagsShiftValidity + 0))
+        | ((int64_t)(report->hasValidHorizontalVelocity != 0) << (GDL90ArchiveFlagsShiftValidity + 1))
+        | ((int64_t)(report->hasValidVerticalVelocity != 0) << (GDL90ArchiveFlagsShiftValidity + 2))
+        | ((int64_t)(report->hasValidPosition != 0) << (GDL90ArchiveFlagsShiftValidity + 3))
+        | ((int64_t)(report->id == GDL90MessageType_OwnshipReport) << GDL90ArchiveFlagsShiftOwnship);
+    self->recordCount++;
+
+    if (self->recordCount == GDL90_ARCHIVE_BLOCK_RECORDS)
+    {
+        return GDL90ArchiveWriter_flush(self);
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ArchiveWriter_flush(GDL90ArchiveWriter *self)
+{
+    if (!self || !self->file) { return GDL90ResultFailure; }
+    if (self->recordCount == 0) { return GDL90ResultOK; }
+
+    uint32_t n = self->recordCount;
+    GDL90ArchiveColumnInfo infos[GDL90ArchiveColumnCount];
+    uint32_t offset = 0;
+
+    // pick the smaller encoding per column and precompute its size, so the header can go first
+    for (size_t c = 0; c < GDL90ArchiveColumnCount; c++)
+    {
+        const int64_t *values = self->columns[c];
+        GDL90ArchiveColumnInfo *info = &infos[c];
+        uint64_t deltaBits = 0;
+        size_t varintLength = 0;
+
+        info->min = values[0];
+        info->max = values[0];
+        for (uint32_t i = 1; i < n; i++)
+        {
+            uint64_t delta = zigzag((int64_t)((uint64_t)values[i] - (uint64_t)values[i-1]));
+            deltaBits |= delta;
+            varintLength += varintSize(delta);
+            if (values[i] < info->min) { info->min = values[i]; }
+            if (values[i] > info->max) { info->max = values[i]; }
+        }
+
+        uint8_t width = 0;
+        while (width < 64 && (deltaBits >> width) != 0) { width++; }
+        size_t bitpackedLength = ((size_t)(n-1) * width + 7) / 8;
+
+        info->offset = offset;
+        info->bitWidth = width;
+        if (bitpackedLength < varintLength)
+        {
+            info->encoding = GDL90ArchiveEncodingDeltaBitpacked;
+            info->length = (uint32_t)(varintSize(zigzag(values[0])) + bitpackedLength);
+        }
+        else
+        {
+            info->encoding = GDL90ArchiveEncodingDeltaVarint;
+            info->length = (uint32_t)(varintSize(zigzag(values[0])) + varintLength);
+        }
+        offset += info->length;
+    }
+
+    uint8_t header[GDL90_ARCHIVE_BLOCKHEADER_SIZE];
+    memcpy(header, GDL90_ARCHIVE_BLOCKMAGIC, sizeof(GDL90_ARCHIVE_BLOCKMAGIC));
+    lsbu32(header+4, n);
+    lsbu32(header+8, offset);
+    for (size_t c = 0; c < GDL90ArchiveColumnCount; c++)
+    {
+        uint8_t *h = header + 12 + c * GDL90_ARCHIVE_COLUMNHEADER_SIZE;
+        lsbu32(h+0, infos[c].offset);
+        lsbu32(h+4, infos[c].length);
+        lsbu64(h+8, (uint64_t)infos[c].min);
+        lsbu64(h+16, (uint64_t)infos[c].max);
+        h[24] = infos[c].encoding;
+        h[25] = infos[c].bitWidth;
+    }
+    if (fwrite(header, 1, sizeof(header), self->file) != sizeof(header)) { return GDL90ResultFailure; }
+
+    GDL90ArchiveOutput output = {0};
+    output.file = self->file;
+    for (size_t c = 0; c < GDL90ArchiveColumnCount; c++)
+    {
+        const int64_t *values = self->columns[c];
+        GDL90ArchiveOutput_varint(&output, zigzag(values[0]));
+        for (uint32_t i = 1; i < n; i++)
+        {
+            uint64_t delta = zigzag((int64_t)((uint64_t)values[i] - (uint64_t)values[i-1]));
+            if (infos[c].encoding == GDL90ArchiveEncodingDeltaBitpacked)
+            {
+                GDL90ArchiveOutput_bits(&output, delta, infos[c].bitWidth);
+            }
+            else
+            {
+                GDL90ArchiveOutput_varint(&output, delta);
+            }
+        }
+        // columns start byte aligned
+        if (GDL90ArchiveOutput_finish(&output) != GDL90ResultOK) { return GDL90ResultFailure; }
+    }
+
+    self->recordCount = 0;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ArchiveReader_init(GDL90ArchiveReader *self, FILE *file)
+{
+    if (!self || !file) { return GDL90ResultFailure; }
+
+    uint8_t header[GDL90_ARCHIVE_FILEHEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)
+        || memcmp(header, GDL90_ARCHIVE_FILEMAGIC, sizeof(GDL90_ARCHIVE_FILEMAGIC)) != 0
+        || (uint16_t)(header[8] | (header[9] << 8)) != GDL90_ARCHIVE_VERSION
+        || (uint16_t)(header[10] | (header[11] << 8)) != GDL90ArchiveColumnCount)
+    {
+        return GDL90ResultFailure;
+    }
+
+    self->file = file;
+    self->hasBlock = 0;
+    self->dataOffset = GDL90_ARCHIVE_FILEHEADER_SIZE;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ArchiveReader_nextBlock(GDL90ArchiveReader *self, const GDL90ArchiveBlockInfo **outInfo)
+{
+    if (!self || !self->file) { return GDL90ResultFailure; }
+
+    long blockOffset = self->hasBlock ? self->dataOffset + (long)self->block.dataLength : self->dataOffset;
+    self->hasBlock = 0;
+    if (fseek(self->file, blockOffset, SEEK_SET) != 0) { return GDL90ResultFailure; }
+
+    uint8_t header[GDL90_ARCHIVE_BLOCKHEADER_SIZE];
+    if (fread(header, 1, sizeof(header), self->file) != sizeof(header)
+        || memcmp(header, GDL90_ARCHIVE_BLOCKMAGIC, sizeof(GDL90_ARCHIVE_BLOCKMAGIC)) != 0)
+    {
+        return GDL90ResultFailure;
+    }
+
+    GDL90ArchiveBlockInfo *block = &self->block;
+    block->recordCount = u32lsb(header+4);
+    block->dataLength = u32lsb(header+8);
+    if (block->recordCount == 0 || block->recordCount > GDL90_ARCHIVE_BLOCK_RECORDS) { return GDL90ResultFailure; }
+    for (size_t c = 0; c < GDL90ArchiveColumnCount; c++)
+    {
+        const uint8_t *h = header + 12 + c * GDL90_ARCHIVE_COLUMNHEADER_SIZE;
+        GDL90ArchiveColumnInfo *info = &block->columns[c];
+        info->offset = u32lsb(h+0);
+        info->length = u32lsb(h+4);
+        info->min = (int64_t)u64lsb(h+8);
+        info->max = (int64_t)u64lsb(h+16);
+        info->encoding = h[24];
+        info->bitWidth = h[25];
+        if (info->length > sizeof(self->buffer)
+            || (uint64_t)info->offset + info->length > block->dataLength
+            || info->bitWidth > 64)
+        {
+            return GDL90ResultFailure;
+        }
+    }
+
+    self->dataOffset = blockOffset + GDL90_ARCHIVE_BLOCKHEADER_SIZE;
+    self->hasBlock = 1;
+    if (outInfo) { *outInfo = block; }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ArchiveReader_readColumn(GDL90ArchiveReader *self, GDL90ArchiveColumn column, int64_t *out)
+{
+    if (!self || !self->hasBlock || !out || column >= GDL90ArchiveColumnCount) { return GDL90ResultFailure; }
+
+    const GDL90ArchiveColumnInfo *info = &self->block.columns[column];
+    if (fseek(self->file, self->dataOffset + (long)info->offset, SEEK_SET) != 0
+        || fread(self->buffer, 1, info->length, self->file) != info->length)
+    {
+        return GDL90ResultFailure;
+    }
+
+    const uint8_t *p = self->buffer;
+    const uint8_t *end = self->buffer + info->length;
+    uint64_t v = 0;
+    uint32_t shift = 0;
+
+    // first value
+    for (;;)
+    {
+        if (p == end || shift > 63) { return GDL90ResultFailure; }
+        v |= (uint64_t)(*p & 0x7f) << shift;
+        shift += 7;
+        if ((*p++ & 0x80) == 0) { break; }
+    }
+    out[0] = unzigzag(v);
+
+    uint8_t bitCount = 0;
+    for (uint32_t i = 1; i < self->block.recordCount; i++)
+    {
+        uint64_t delta = 0;
+        if (info->encoding == GDL90ArchiveEncodingDeltaBitpacked)
+        {
+            uint8_t width = info->bitWidth;
+            uint8_t got = 0;
+            while (got < width)
+            {
+                if (p == end) { return GDL90ResultFailure; }
+                uint8_t take = (uint8_t)(8 - bitCount);
+                if (take > width - got) { take = (uint8_t)(width - got); }
+                delta |= (uint64_t)((*p >> bitCount) & ((1u << take) - 1)) << got;
+                got = (uint8_t)(got + take);
+                bitCount = (uint8_t)(bitCount + take);
+                if (bitCount == 8) { p++; bitCount = 0; }
+            }
+        }
+        else
+        {
+            shift = 0;
+            for (;;)
+            {
+                if (p == end || shift > 63) { return GDL90ResultFailure; }
+                delta |= (uint64_t)(*p & 0x7f) << shift;
+                shift += 7;
+                if ((*p++ & 0x80) == 0) { break; }
+            }
+        }
+        out[i] = (int64_t)((uint64_t)out[i-1] + (uint64_t)unzigzag(delta));
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ArchiveReader_readRecords(GDL90ArchiveReader *self, uint64_t *timesMs, GDL90TrafficReport *reports)
+{
+    if (!self || !self->hasBlock || !reports) { return GDL90ResultFailure; }
+
+    uint32_t n = self->block.recordCount;
+    int64_t *values = self->values;
+
+    memset(reports, 0, sizeof(GDL90TrafficReport) * n);
+
+    for (size_t c = 0; c < GDL90ArchiveColumnCount; c++)
+    {
+        if (c == GDL90ArchiveColumnTime && !timesMs) { continue; }
+        if (GDL90ArchiveReader_readColumn(self, (GDL90ArchiveColumn)c, values) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            GDL90TrafficReport *report = &reports[i];
+            int64_t v = values[i];
+            switch (c)
+            {
+                case GDL90ArchiveColumnTime:
+                    timesMs[i] = (uint64_t)v;
+                    break;
+                case GDL90ArchiveColumnAddress:
+                    report->addressType = (uint8_t)(v >> 24);
+                    report->participantAddress = (uint32_t)(v & 0xffffff);
+                    break;
+                case GDL90ArchiveColumnLatitude:
+                    report->latitude = (double)v * GDL90_ARCHIVE_LATLONRES;
+                    break;
+                case GDL90ArchiveColumnLongitude:
+                    report->longitude = (double)v * GDL90_ARCHIVE_LATLONRES;
+                    break;
+                case GDL90ArchiveColumnAltitude:
+                    report->altitude = (int32_t)v;
+                    break;
+                case GDL90ArchiveColumnHorizontalVelocity:
+                    report->horizontalVelocity = (uint32_t)v;
+                    break;
+                case GDL90ArchiveColumnVerticalVelocity:
+                    report->verticalVelocity = (int32_t)v;
+                    break;
+                case GDL90ArchiveColumnTrackHeading:
+                    report->trackHeading = (double)v * (360.0/256.0);
+                    break;
+                case GDL90ArchiveColumnFlags:
+                    report->id = ((v >> GDL90ArchiveFlagsShiftOwnship) & 0x01) ? GDL90MessageType_OwnshipReport : GDL90MessageType_TrafficReport;
+                    report->alertStatus = (uint8_t)((v >> GDL90ArchiveFlagsShiftAlertStatus) & 0x0f);
+                    report->trackHeadingType = (GDL90TrafficReportTrackHeadingType)((v >> GDL90ArchiveFlagsShiftTrackHeadingType) & 0x03);
+                    report->reportStatus = (uint8_t)((v >> GDL90ArchiveFlagsShiftReportStatus) & 0x01);
+                    report->airGroundState = (uint8_t)((v >> GDL90ArchiveFlagsShiftAirGroundState) & 0x01);
+                    report->navigationIntegrityCategory = (uint8_t)((v >> GDL90ArchiveFlagsShiftNIC) & 0x0f);
+                    report->navigationAccuracyCategoryForPosition = (uint8_t)((v >> GDL90ArchiveFlagsShiftNACP) & 0x0f);
+                    report->emitterCategory = (uint8_t)((v >> GDL90ArchiveFlagsShiftEmitterCategory) & 0xff);
+                    report->emergencyPriorityCode = (int8_t)((v >> GDL90ArchiveFlagsShiftEmergencyPriorityCode) & 0x0f);
+                    report->hasValidAltitude = (uint8_t)((v >> (GDL90ArchiveFlagsShiftValidity + 0)) & 0x01);
+                    report->hasValidHorizontalVelocity = (uint8_t)((v >> (GDL90ArchiveFlagsShiftValidity + 1)) & 0x01);
+                    report->hasValidVerticalVelocity = (uint8_t)((v >> (GDL90ArchiveFlagsShiftValidity + 2)) & 0x01);
+                    report->hasValidPosition = (uint8_t)((v >> (GDL90ArchiveFlagsShiftValidity + 3)) & 0x01);
+                    break;
+            }
+        }
+    }
+
+    return GDL90ResultOK;
+}
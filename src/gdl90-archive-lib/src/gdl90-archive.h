@@ -0,0 +1,175 @@
+//
+//  gdl90-archive.h
+//  gdl90-archive-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Columnar block archive of decoded GDL90TrafficReports.
+//
+// File layout (little endian) :
+//   File header  : "GDL90ARC", u16 version, u16 column count
+//   Block        : block header + column data, repeated
+//   Block header : "GARB", u32 record count, u32 data length,
+//                  per column: u32 offset, u32 length, i64 min, i64 max, u8 encoding, u8 bit width
+//   Column data  : zigzag varint first value, then the zigzag encoded deltas
+//                  either as varints or bitpacked at the block's bit width
+//
+// Blocks are self describing so readers can skip blocks (by min/max) and
+// columns (by offset/length) they don't need without decoding them.
+
+#ifndef __gdl90__gdl90_archive_h__
+#define __gdl90__gdl90_archive_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/** Max records per block */
+#define GDL90_ARCHIVE_BLOCK_RECORDS 1024
+
+typedef enum GDL90ArchiveColumn
+{
+    /** Receive time (ms) */
+    GDL90ArchiveColumnTime,
+    /** addressType << 24 | participantAddress */
+    GDL90ArchiveColumnAddress,
+    /** Latitude (raw 24 bit, 180/2^23 degrees) */
+    GDL90ArchiveColumnLatitude,
+    /** Longitude (raw 24 bit, 180/2^23 degrees) */
+    GDL90ArchiveColumnLongitude,
+    /** Altitude (ft) */
+    GDL90ArchiveColumnAltitude,
+    /** Horizontal velocity (kt) */
+    GDL90ArchiveColumnHorizontalVelocity,
+    /** Vertical velocity (ft/min) */
+    GDL90ArchiveColumnVerticalVelocity,
+    /** Track/Heading (raw 8 bit, 360/256 degrees) */
+    GDL90ArchiveColumnTrackHeading,
+    /** Packed indicators (GDL90ArchiveFlagsShift) */
+    GDL90ArchiveColumnFlags,
+    GDL90ArchiveColumnCount
+} GDL90ArchiveColumn;
+
+/** Bit offsets of the GDL90ArchiveColumnFlags fields */
+typedef enum GDL90ArchiveFlagsShift
+{
+    /** 4 bits : alertStatus */
+    GDL90ArchiveFlagsShiftAlertStatus = 0,
+    /** 2 bits : trackHeadingType */
+    GDL90ArchiveFlagsShiftTrackHeadingType = 4,
+    /** 1 bit : reportStatus */
+    GDL90ArchiveFlagsShiftReportStatus = 6,
+    /** 1 bit : airGroundState */
+    GDL90ArchiveFlagsShiftAirGroundState = 7,
+    /** 4 bits : navigationIntegrityCategory */
+    GDL90ArchiveFlagsShiftNIC = 8,
+    /** 4 bits : navigationAccuracyCategoryForPosition */
+    GDL90ArchiveFlagsShiftNACP = 12,
+    /** 8 bits : emitterCategory */
+    GDL90ArchiveFlagsShiftEmitterCategory = 16,
+    /** 4 bits : emergencyPriorityCode */
+    GDL90ArchiveFlagsShiftEmergencyPriorityCode = 24,
+    /** 4 bits : hasValidAltitude, hasValidHorizontalVelocity, hasValidVerticalVelocity, hasValidPosition */
+    GDL90ArchiveFlagsShiftValidity = 28,
+    /** 1 bit : set for GDL90MessageType_OwnshipReport */
+    GDL90ArchiveFlagsShiftOwnship = 32
+} GDL90ArchiveFlagsShift;
+
+typedef enum GDL90ArchiveEncoding
+{
+    /** Zigzag deltas as LEB128 varints */
+    GDL90ArchiveEncodingDeltaVarint,
+    /** Zigzag deltas bitpacked at a fixed width per block */
+    GDL90ArchiveEncodingDeltaBitpacked
+} GDL90ArchiveEncoding;
+
+typedef struct GDL90ArchiveColumnInfo
+{
+    /** Offset of the column from the start of the block data */
+    uint32_t offset;
+    /** Length of the column data */
+    uint32_t length;
+    /** Smallest value in the block */
+    int64_t min;
+    /** Largest value in the block */
+    int64_t max;
+    /** GDL90ArchiveEncoding */
+    uint8_t encoding;
+    /** Bits per delta if GDL90ArchiveEncodingDeltaBitpacked */
+    uint8_t bitWidth;
+} GDL90ArchiveColumnInfo;
+
+typedef struct GDL90ArchiveBlockInfo
+{
+    uint32_t recordCount;
+    /** Length of all the column data following the block header */
+    uint32_t dataLength;
+    GDL90ArchiveColumnInfo columns[GDL90ArchiveColumnCount];
+} GDL90ArchiveBlockInfo;
+
+/** Buffers up to GDL90_ARCHIVE_BLOCK_RECORDS reports and writes them as a block */
+typedef struct GDL90ArchiveWriter
+{
+    FILE *file;
+    uint32_t recordCount;
+    int64_t columns[GDL90ArchiveColumnCount][GDL90_ARCHIVE_BLOCK_RECORDS];
+} GDL90ArchiveWriter;
+
+/** Writes the file header, file must be opened for binary writing */
+GDL90Result GDL90ArchiveWriter_init(GDL90ArchiveWriter *, FILE *file);
+/** Appends a report, writing a block when the current one gets full (the report is refused while a full block can't be written) */
+GDL90Result GDL90ArchiveWriter_append(GDL90ArchiveWriter *, uint64_t timeMs, const GDL90TrafficReport *report);
+/** Writes the pending (partial) block if any */
+GDL90Result GDL90ArchiveWriter_flush(GDL90ArchiveWriter *);
+
+/** Reads blocks sequentially, seeking over column data that isn't requested */
+typedef struct GDL90ArchiveReader
+{
+    FILE *file;
+    /** File offset of the current block's column data */
+    long dataOffset;
+    uint8_t hasBlock;
+    GDL90ArchiveBlockInfo block;
+    uint8_t buffer[GDL90_ARCHIVE_BLOCK_RECORDS * 10];
+    int64_t values[GDL90_ARCHIVE_BLOCK_RECORDS];
+} GDL90ArchiveReader;
+
+/** Validates the file header, file must be opened for binary reading */
+GDL90Result GDL90ArchiveReader_init(GDL90ArchiveReader *, FILE *file);
+/** Reads the next block header, GDL90ResultFailure at the end of the archive */
+GDL90Result GDL90ArchiveReader_nextBlock(GDL90ArchiveReader *, const GDL90ArchiveBlockInfo **outInfo);
+/** Decodes one column of the current block into out[recordCount] */
+GDL90Result GDL90ArchiveReader_readColumn(GDL90ArchiveReader *, GDL90ArchiveColumn column, int64_t *out);
+/** Decodes all columns of the current block into timesMs[recordCount] and reports[recordCount] */
+GDL90Result GDL90ArchiveReader_readRecords(GDL90ArchiveReader *, uint64_t *timesMs, GDL90TrafficReport *reports);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_archive_h__) */
@@ -0,0 +1,285 @@
+//
+//  gdl90-capture.c
+//  gdl90-capture-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "gdl90-capture.h"
+
+#include <string.h>
+
+static const uint8_t GDL90_CAPTURE_FILEMAGIC[8] = { 'G', 'D', 'L', '9', '0', 'C', 'A', 'P' };
+static const uint8_t GDL90_CAPTURE_INDEXMAGIC[8] = { 'G', 'D', 'L', '9', '0', 'I', 'D', 'X' };
+static const uint16_t GDL90_CAPTURE_VERSION = 1;
+
+#define GDL90_CAPTURE_FILEHEADER_SIZE 12
+#define GDL90_CAPTURE_RECORDHEADER_SIZE 12
+#define GDL90_CAPTURE_INDEXENTRY_SIZE 16
+#define GDL90_CAPTURE_TRAILER_SIZE 24
+
+static inline void lsbu16(uint8_t *out, uint16_t v)
+{
+    out[0] = (uint8_t)v;
+    out[1] = (uint8_t)(v >> 8);
+}
+
+static inline void lsbu32(uint8_t *out, uint32_t v)
+{
+    for (size_t i = 0; i < 4; i++) { out[i] = (uint8_t)(v >> (8*i)); }
+}
+
+static inline void lsbu64(uint8_t *out, uint64_t v)
+{
+    for (size_t i = 0; i < 8; i++) { out[i] = (uint8_t)(v >> (8*i)); }
+}
+
+static inline uint16_t u16lsb(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static inline uint32_t u32lsb(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static inline uint64_t u64lsb(const uint8_t *in)
+{
+    return (uint64_t)u32lsb(in) | ((uint64_t)u32lsb(in+4) << 32);
+}
+
+static GDL90Result readAt(FILE *file, uint64_t offset, uint8_t *out, size_t len)
+{
+    if (fseek(file, (long)offset, SEEK_SET) != 0 || fread(out, 1, len, file) != len)
+    {
+        return GDL90ResultFailure;
+    }
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90CaptureWriter_init(GDL90CaptureWriter *self, FILE *file, GDL90CaptureIndexEntry *index, uint32_t indexCapacity)
+{
+    if (!self || !file || !index || indexCapacity < 2) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->file = file;
+    self->index = index;
+    self->indexCapacity = indexCapacity;
+    self->indexInterval = 1;
+
+    uint8_t header[GDL90_CAPTURE_FILEHEADER_SIZE] = {0};
+    memcpy(header, GDL90_CAPTURE_FILEMAGIC, sizeof(GDL90_CAPTURE_FILEMAGIC));
+    lsbu16(header+8, GDL90_CAPTURE_VERSION);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) { return GDL90ResultFailure; }
+    self->offset = sizeof(header);
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90CaptureWriter_write(GDL90CaptureWriter *self, uint64_t timeMs, uint16_t sourceId, const GDL90Message *gdl90Message)
+{
+    if (!self || !self->file || !gdl90Message) { return GDL90ResultFailure; }
+
+    if (timeMs > self->maxTimeMs) { self->maxTimeMs = timeMs; }
+
+    if (self->recordCount % self->indexInterval == 0)
+    {
+        if (self->indexCount == self->indexCapacity)
+        {
+            // keep every other entry
+            for (uint32_t i = 0; i < self->indexCapacity; i += 2)
+            {
+                self->index[i/2] = self->index[i];
+            }
+            self->indexCount = (self->indexCapacity + 1) / 2;
+            self->indexInterval *= 2;
+        }
+        if (self->recordCount % self->indexInterval == 0)
+        {
+            GDL90CaptureIndexEntry *entry = &self->index[self->indexCount++];
+            entry->timeMs = self->maxTimeMs;
+            entry->offset = self->offset;
+        }
+    }
+
+    uint8_t header[GDL90_CAPTURE_RECORDHEADER_SIZE];
+    lsbu64(header, timeMs);
+    lsbu16(header+8, sourceId);
+    lsbu16(header+10, gdl90Message->dataLength);
+    if (fwrite(header, 1, sizeof(header), self->file) != sizeof(header)
+        || fwrite(gdl90Message->data, 1, gdl90Message->dataLength, self->file) != gdl90Message->dataLength)
+    {
+        return GDL90ResultFailure;
+    }
+
+    self->offset += sizeof(header) + gdl90Message->dataLength;
+    self->recordCount++;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90CaptureWriter_setReceiveInfo(GDL90CaptureWriter *self, uint64_t timeMs, uint16_t sourceId)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->currentTimeMs = timeMs;
+    self->currentSourceId = sourceId;
+
+    return GDL90ResultOK;
+}
+
+void GDL90CaptureWriter_handleFrame(GDL90Message *gdl90Message, void *context)
+{
+    GDL90CaptureWriter *self = (GDL90CaptureWriter *)context;
+    if (!self) { return; }
+
+    (void)GDL90CaptureWriter_write(self, self->currentTimeMs, self->currentSourceId, gdl90Message);
+}
+
+GDL90Result GDL90CaptureWriter_close(GDL90CaptureWriter *self)
+{
+    if (!self || !self->file) { return GDL90ResultFailure; }
+
+    uint64_t indexOffset = self->offset;
+    for (uint32_t i = 0; i < self->indexCount; i++)
+    {
+        uint8_t entry[GDL90_CAPTURE_INDEXENTRY_SIZE];
+        lsbu64(entry, self->index[i].timeMs);
+        lsbu64(entry+8, self->index[i].offset);
+        if (fwrite(entry, 1, sizeof(entry), self->file) != sizeof(entry)) { return GDL90ResultFailure; }
+    }
+
+    uint8_t trailer[GDL90_CAPTURE_TRAILER_SIZE] = {0};
+    lsbu64(trailer, indexOffset);
+    lsbu32(trailer+8, self->indexCount);
+    memcpy(trailer+16, GDL90_CAPTURE_INDEXMAGIC, sizeof(GDL90_CAPTURE_INDEXMAGIC));
+    if (fwrite(trailer, 1, sizeof(trailer), self->file) != sizeof(trailer)) { return GDL90ResultFailure; }
+
+    self->file = NULL;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90CaptureReader_init(GDL90CaptureReader *self, FILE *file)
+{
+    if (!self || !file) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->file = file;
+
+    uint8_t header[GDL90_CAPTURE_FILEHEADER_SIZE];
+    if (readAt(file, 0, header, sizeof(header)) != GDL90ResultOK
+        || memcmp(header, GDL90_CAPTURE_FILEMAGIC, sizeof(GDL90_CAPTURE_FILEMAGIC)) != 0
+        || u16lsb(header+8) != GDL90_CAPTURE_VERSION)
+    {
+        return GDL90ResultFailure;
+    }
+    self->offset = sizeof(header);
+
+    if (fseek(file, 0, SEEK_END) != 0) { return GDL90ResultFailure; }
+    long end = ftell(file);
+    if (end < 0) { return GDL90ResultFailure; }
+    self->recordsEnd = (uint64_t)end;
+
+    uint8_t trailer[GDL90_CAPTURE_TRAILER_SIZE];
+    if ((uint64_t)end >= sizeof(header) + sizeof(trailer)
+        && readAt(file, (uint64_t)end - sizeof(trailer), trailer, sizeof(trailer)) == GDL90ResultOK
+        && memcmp(trailer+16, GDL90_CAPTURE_INDEXMAGIC, sizeof(GDL90_CAPTURE_INDEXMAGIC)) == 0)
+    {
+        uint64_t indexOffset = u64lsb(trailer);
+        uint32_t indexCount = u32lsb(trailer+8);
+        if (indexOffset + (uint64_t)indexCount * GDL90_CAPTURE_INDEXENTRY_SIZE + sizeof(trailer) == (uint64_t)end)
+        {
+            self->indexOffset = indexOffset;
+            self->indexCount = indexCount;
+            self->recordsEnd = indexOffset;
+            self->hasIndex = 1;
+        }
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90CaptureReader_seek(GDL90CaptureReader *self, uint64_t timeMs)
+{
+    if (!self || !self->file || !self->hasIndex) { return GDL90ResultFailure; }
+
+    // last entry with time < timeMs, all records up to it are earlier than timeMs
+    uint64_t start = GDL90_CAPTURE_FILEHEADER_SIZE;
+    uint32_t lo = 0, hi = self->indexCount;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint8_t entry[GDL90_CAPTURE_INDEXENTRY_SIZE];
+        if (readAt(self->file, self->indexOffset + (uint64_t)mid * GDL90_CAPTURE_INDEXENTRY_SIZE, entry, sizeof(entry)) != GDL90ResultOK)
+        {
+            return GDL90ResultFailure;
+        }
+        if (u64lsb(entry) < timeMs)
+        {
+            start = u64lsb(entry+8);
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    // scan the record headers up to the next index entry at most
+    uint64_t offset = start;
+    while (offset + GDL90_CAPTURE_RECORDHEADER_SIZE <= self->recordsEnd)
+    {
+        uint8_t header[GDL90_CAPTURE_RECORDHEADER_SIZE];
+        if (readAt(self->file, offset, header, sizeof(header)) != GDL90ResultOK) { return GDL90ResultFailure; }
+        if (u64lsb(header) >= timeMs) { break; }
+        offset += GDL90_CAPTURE_RECORDHEADER_SIZE + u16lsb(header+10);
+    }
+    self->offset = offset;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90CaptureReader_next(GDL90CaptureReader *self, GDL90CaptureRecord *record)
+{
+    if (!self || !self->file || !record) { return GDL90ResultFailure; }
+    if (self->offset + GDL90_CAPTURE_RECORDHEADER_SIZE > self->recordsEnd) { return GDL90ResultFailure; }
+
+    uint8_t header[GDL90_CAPTURE_RECORDHEADER_SIZE];
+    if (readAt(self->file, self->offset, header, sizeof(header)) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+    uint16_t length = u16lsb(header+10);
+    if (length == 0 || length > sizeof(record->message.data)
+        || self->offset + sizeof(header) + length > self->recordsEnd
+        || fread(record->message.data, 1, length, self->file) != length)
+    {
+        return GDL90ResultFailure;
+    }
+
+    record->timeMs = u64lsb(header);
+    record->sourceId = u16lsb(header+8);
+    record->message.dataLength = length;
+    record->message.id = record->message.data[0];
+    self->offset += sizeof(header) + length;
+
+    return GDL90ResultOK;
+}
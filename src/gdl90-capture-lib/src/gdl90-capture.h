@@ -0,0 +1,120 @@
+//
+//  gdl90-capture.h
+//  gdl90-capture-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Raw capture of validated GDL90 frames with a sparse time index.
+//
+// File layout (little endian) :
+//   File header : "GDL90CAP", u16 version, u16 reserved
+//   Record      : u64 receive time (ms), u16 source id, u16 length, unescaped message (id ... FCS)
+//   Index       : u64 time (ms), u64 record offset, repeated (time is non decreasing)
+//   Trailer     : u64 index offset, u32 index entry count, u32 reserved, "GDL90IDX"
+//
+// The index is built while recording into a caller supplied fixed size array.
+// When it fills up every other entry is dropped and the interval between
+// entries doubles, so it stays bounded and sparse without a second pass.
+// A capture without a trailer (eg. the recorder was killed) can still be read
+// sequentially, it just can't seek.
+
+#ifndef __gdl90__gdl90_capture_h__
+#define __gdl90__gdl90_capture_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct GDL90CaptureIndexEntry
+{
+    /** Largest receive time recorded up to the record */
+    uint64_t timeMs;
+    /** File offset of the record */
+    uint64_t offset;
+} GDL90CaptureIndexEntry;
+
+typedef struct GDL90CaptureRecord
+{
+    /** Receive time (ms) */
+    uint64_t timeMs;
+    /** Id of the receiver/source the frame came from */
+    uint16_t sourceId;
+    /** The unescaped, CRC validated message */
+    GDL90Message message;
+} GDL90CaptureRecord;
+
+typedef struct GDL90CaptureWriter
+{
+    FILE *file;
+    uint64_t offset;
+    GDL90CaptureIndexEntry *index;
+    uint32_t indexCapacity;
+    uint32_t indexCount;
+    /** Records between index entries (doubles each time the index fills up) */
+    uint64_t indexInterval;
+    uint64_t recordCount;
+    uint64_t maxTimeMs;
+
+    /** Receive time and source used by GDL90CaptureWriter_handleFrame */
+    uint64_t currentTimeMs;
+    uint16_t currentSourceId;
+} GDL90CaptureWriter;
+
+/** Writes the file header, index[indexCapacity] (>= 2) holds the index until closing */
+GDL90Result GDL90CaptureWriter_init(GDL90CaptureWriter *, FILE *file, GDL90CaptureIndexEntry *index, uint32_t indexCapacity);
+GDL90Result GDL90CaptureWriter_write(GDL90CaptureWriter *, uint64_t timeMs, uint16_t sourceId, const GDL90Message *gdl90Message);
+/** Sets the receive time and source of the frames of the next GDL90Stream_process call */
+GDL90Result GDL90CaptureWriter_setReceiveInfo(GDL90CaptureWriter *, uint64_t timeMs, uint16_t sourceId);
+/** GDL90StreamFrameHandler, use with GDL90StreamConfig_setFrameHandler(&config, GDL90CaptureWriter_handleFrame, &writer), or GDL90FrameHandlers_add(&handlers, GDL90CaptureWriter_handleFrame, &writer) to share the stream */
+void GDL90CaptureWriter_handleFrame(GDL90Message *gdl90Message, void *context);
+/** Writes the index and trailer */
+GDL90Result GDL90CaptureWriter_close(GDL90CaptureWriter *);
+
+typedef struct GDL90CaptureReader
+{
+    FILE *file;
+    /** Offset of the next record */
+    uint64_t offset;
+    /** End of the records (start of the index, or end of file without one) */
+    uint64_t recordsEnd;
+    uint64_t indexOffset;
+    uint32_t indexCount;
+    uint8_t hasIndex;
+} GDL90CaptureReader;
+
+GDL90Result GDL90CaptureReader_init(GDL90CaptureReader *, FILE *file);
+/** Positions the reader on the first record with time >= timeMs in O(log n) index reads */
+GDL90Result GDL90CaptureReader_seek(GDL90CaptureReader *, uint64_t timeMs);
+/** Reads the next record, GDL90ResultFailure at the end of the capture */
+GDL90Result GDL90CaptureReader_next(GDL90CaptureReader *, GDL90CaptureRecord *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_capture_h__) */
@@ -0,0 +1,433 @@
+//
+//  gdl90-delta.c
+//  gdl90-delta-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "gdl90-delta.h"
+
+#include <string.h>
+
+#define GDL90_DELTA_LATLON_RES (180.0 / (double)(1<<23))
+
+static inline int32_t GDL90Delta_round(double v)
+{
+    return (int32_t)(v < 0.0 ? v - 0.5 : v + 0.5);
+}
+
+static inline size_t GDL90Delta_putVarint(uint8_t *out, size_t at, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        if (out) { out[at] = (uint8_t)(v | 0x80); }
+        at++;
+        v >>= 7;
+    }
+    if (out) { out[at] = (uint8_t)v; }
+    return at + 1;
+}
+
+static inline size_t GDL90Delta_putSigned(uint8_t *out, size_t at, int64_t v)
+{
+    return GDL90Delta_putVarint(out, at, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static inline size_t GDL90Delta_putByte(uint8_t *out, size_t at, uint8_t v)
+{
+    if (out) { out[at] = v; }
+    return at + 1;
+}
+
+/** 0 if malformed */
+static inline size_t GDL90Delta_getVarint(const uint8_t *data, size_t len, size_t at, uint64_t *v)
+{
+    uint64_t value = 0;
+    for (uint32_t shift = 0; shift < 64 && at < len; shift += 7)
+    {
+        uint8_t byte = data[at++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            *v = value;
+            return at;
+        }
+    }
+    return 0;
+}
+
+static inline size_t GDL90Delta_getSigned(const uint8_t *data, size_t len, size_t at, int64_t *v)
+{
+    uint64_t zigzag = 0;
+    at = GDL90Delta_getVarint(data, len, at, &zigzag);
+    *v = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    return at;
+}
+
+GDL90Result GDL90DeltaState_initWithTrafficReport(GDL90DeltaState *self, const GDL90TrafficReport *report)
+{
+    if (!self || !report) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->latitude = report->hasValidPosition ? GDL90Delta_round(report->latitude / GDL90_DELTA_LATLON_RES) : 0;
+    self->longitude = report->hasValidPosition ? GDL90Delta_round(report->longitude / GDL90_DELTA_LATLON_RES) : 0;
+    self->altitude = report->hasValidAltitude ? report->altitude : 0;
+    self->participantAddress = report->participantAddress & 0xffffff;
+    self->horizontalVelocity = report->hasValidHorizontalVelocity ? (uint16_t)report->horizontalVelocity : 0;
+    self->verticalVelocity = report->hasValidVerticalVelocity ? (int16_t)(report->verticalVelocity / 64) : 0;
+    self->track = report->trackHeadingType != GDL90TrafficReportTrackHeadingTypeInvalid ? (uint8_t)(GDL90Delta_round(report->trackHeading * (256.0 / 360.0)) & 0xff) : 0;
+    self->status[0] = (uint8_t)((report->alertStatus & 0x0f) | (report->addressType & 0x0f) << 4);
+    self->status[1] = (uint8_t)((report->trackHeadingType & 0x03)
+        | (report->reportStatus & 1) << 2
+        | (report->airGroundState & 1) << 3
+        | (report->hasValidPosition ? 1 : 0) << 4
+        | (report->hasValidAltitude ? 1 : 0) << 5
+        | (report->hasValidHorizontalVelocity ? 1 : 0) << 6
+        | (report->hasValidVerticalVelocity ? 1 : 0) << 7);
+    self->status[2] = (uint8_t)((report->navigationIntegrityCategory & 0x0f) | (report->navigationAccuracyCategoryForPosition & 0x0f) << 4);
+    self->status[3] = report->emitterCategory;
+    self->status[4] = (uint8_t)report->emergencyPriorityCode;
+    memcpy(self->callsign, report->callsign, sizeof(self->callsign));
+    self->present = 1;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90DeltaState_toTrafficReport(const GDL90DeltaState *self, GDL90TrafficReport *report)
+{
+    if (!self || !report) { return GDL90ResultFailure; }
+
+    memset(report, 0, sizeof(*report));
+    report->id = GDL90MessageType_TrafficReport;
+    report->alertStatus = self->status[0] & 0x0f;
+    report->addressType = self->status[0] >> 4;
+    report->participantAddress = self->participantAddress;
+    report->latitude = self->latitude * GDL90_DELTA_LATLON_RES;
+    report->longitude = self->longitude * GDL90_DELTA_LATLON_RES;
+    report->altitude = self->altitude;
+    report->trackHeadingType = (GDL90TrafficReportTrackHeadingType)(self->status[1] & 0x03);
+    report->reportStatus = (self->status[1] >> 2) & 1;
+    report->airGroundState = (self->status[1] >> 3) & 1;
+    report->hasValidPosition = (self->status[1] >> 4) & 1;
+    report->hasValidAltitude = (self->status[1] >> 5) & 1;
+    report->hasValidHorizontalVelocity = (self->status[1] >> 6) & 1;
+    report->hasValidVerticalVelocity = (self->status[1] >> 7) & 1;
+    report->navigationIntegrityCategory = self->status[2] & 0x0f;
+    report->navigationAccuracyCategoryForPosition = self->status[2] >> 4;
+    report->horizontalVelocity = self->horizontalVelocity;
+    report->verticalVelocity = self->verticalVelocity * 64;
+    report->trackHeading = self->track * (360.0 / 256.0);
+    report->emitterCategory = self->status[3];
+    memcpy(report->callsign, self->callsign, sizeof(report->callsign));
+    report->emergencyPriorityCode = (int8_t)self->status[4];
+
+    return GDL90ResultOK;
+}
+
+/** Fields of state that differ from base */
+static uint8_t GDL90DeltaState_diff(const GDL90DeltaState *state, const GDL90DeltaState *base)
+{
+    if (!state->present) { return base->present ? GDL90DeltaFieldRemoved : 0; }
+    if (!base->present) { return GDL90DeltaFieldAll; }
+
+    uint8_t fields = 0;
+    fields |= (state->latitude != base->latitude || state->longitude != base->longitude) ? GDL90DeltaFieldPosition : 0;
+    fields |= state->altitude != base->altitude ? GDL90DeltaFieldAltitude : 0;
+    fields |= state->horizontalVelocity != base->horizontalVelocity ? GDL90DeltaFieldHorizontalVelocity : 0;
+    fields |= state->verticalVelocity != base->verticalVelocity ? GDL90DeltaFieldVerticalVelocity : 0;
+    fields |= state->track != base->track ? GDL90DeltaFieldTrack : 0;
+    fields |= memcmp(state->status, base->status, sizeof(state->status)) ? GDL90DeltaFieldStatus : 0;
+    fields |= (state->participantAddress != base->participantAddress || memcmp(state->callsign, base->callsign, sizeof(state->callsign))) ? GDL90DeltaFieldIdentity : 0;
+    return fields;
+}
+
+/** Writes the record at out + at (only counts the bytes if out is NULL), base fields are 0 for targets that weren't in the base */
+static size_t GDL90DeltaState_write(const GDL90DeltaState *state, const GDL90DeltaState *base, uint32_t id, uint8_t fields, uint8_t *out, size_t at)
+{
+    static const GDL90DeltaState empty = {0};
+    base = base->present ? base : &empty;
+
+    at = GDL90Delta_putVarint(out, at, id);
+    at = GDL90Delta_putByte(out, at, fields);
+    if (fields & GDL90DeltaFieldPosition)
+    {
+        at = GDL90Delta_putSigned(out, at, (int64_t)state->latitude - base->latitude);
+        at = GDL90Delta_putSigned(out, at, (int64_t)state->longitude - base->longitude);
+    }
+    if (fields & GDL90DeltaFieldAltitude) { at = GDL90Delta_putSigned(out, at, (int64_t)state->altitude - base->altitude); }
+    if (fields & GDL90DeltaFieldHorizontalVelocity) { at = GDL90Delta_putVarint(out, at, state->horizontalVelocity); }
+    if (fields & GDL90DeltaFieldVerticalVelocity) { at = GDL90Delta_putSigned(out, at, state->verticalVelocity); }
+    if (fields & GDL90DeltaFieldTrack) { at = GDL90Delta_putByte(out, at, state->track); }
+    if (fields & GDL90DeltaFieldStatus)
+    {
+        for (size_t i = 0; i < sizeof(state->status); i++)
+        {
+            at = GDL90Delta_putByte(out, at, state->status[i]);
+        }
+    }
+    if (fields & GDL90DeltaFieldIdentity)
+    {
+        at = GDL90Delta_putByte(out, at, (uint8_t)(state->participantAddress >> 16));
+        at = GDL90Delta_putByte(out, at, (uint8_t)(state->participantAddress >> 8));
+        at = GDL90Delta_putByte(out, at, (uint8_t)state->participantAddress);
+        for (size_t i = 0; i < sizeof(state->callsign); i++)
+        {
+            at = GDL90Delta_putByte(out, at, (uint8_t)state->callsign[i]);
+        }
+    }
+    return at;
+}
+
+GDL90Result GDL90DeltaEncoder_init(GDL90DeltaEncoder *self, GDL90DeltaState *states, uint32_t capacity, uint64_t keyframeIntervalMs)
+{
+    if (!self || !states || capacity == 0) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->states = states;
+    self->capacity = capacity;
+    self->keyframeIntervalMs = keyframeIntervalMs;
+    self->keyframeRequested = 1;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90DeltaEncoder_ack(GDL90DeltaEncoder *self, uint32_t sequence)
+{
+    if (!self || sequence == 0 || self->slotSequences[sequence % GDL90_DELTA_SNAPSHOT_COUNT] != sequence) { return GDL90ResultFailure; }
+
+    // acks can arrive out of order, keep the newest
+    if (self->ackSequence == 0 || (int32_t)(sequence - self->ackSequence) > 0)
+    {
+        self->ackSequence = sequence;
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90DeltaEncoder_requestKeyframe(GDL90DeltaEncoder *self)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->keyframeRequested = 1;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90DeltaEncoder_encode(GDL90DeltaEncoder *self, const GDL90TargetTable *table, uint64_t timeMs, uint8_t *out, size_t outSize, size_t *outLength)
+{
+    if (!self || !table || table->capacity != self->capacity || !out || outSize < GDL90_DELTA_MAX_SIZE(self->capacity) || !outLength) { return GDL90ResultFailure; }
+
+    uint32_t sequence = self->sequence + 1;
+    sequence += sequence == 0;
+    uint32_t slot = sequence % GDL90_DELTA_SNAPSHOT_COUNT;
+
+    // the acknowledged snapshot must still be there (and not in the slot about to be reused)
+    uint8_t isKeyframe = self->keyframeRequested
+        || timeMs >= self->keyframeTimeMs + self->keyframeIntervalMs
+        || self->ackSequence == 0
+        || self->slotSequences[self->ackSequence % GDL90_DELTA_SNAPSHOT_COUNT] != self->ackSequence
+        || self->ackSequence % GDL90_DELTA_SNAPSHOT_COUNT == slot;
+
+    static const GDL90DeltaState empty = {0};
+    GDL90DeltaState *states = &self->states[(size_t)slot * self->capacity];
+    const GDL90DeltaState *bases = isKeyframe ? NULL : &self->states[(size_t)(self->ackSequence % GDL90_DELTA_SNAPSHOT_COUNT) * self->capacity];
+
+    size_t at = 0;
+    at = GDL90Delta_putByte(out, at, isKeyframe ? GDL90DeltaMessageTypeKeyframe : GDL90DeltaMessageTypeDelta);
+    at = GDL90Delta_putVarint(out, at, sequence);
+    if (!isKeyframe) { at = GDL90Delta_putVarint(out, at, self->ackSequence); }
+    at = GDL90Delta_putVarint(out, at, timeMs);
+    // the count is only known at the end, keep the room of the largest varint and move the records after
+    size_t countAt = at;
+    at += 5;
+    size_t recordsAt = at;
+
+    uint32_t count = 0;
+    uint32_t presentCount = 0;
+    size_t keyframeSize = 0;
+    for (uint32_t i = 0; i < self->capacity; i++)
+    {
+        const GDL90Target *target = &table->targets[i];
+        GDL90DeltaState *state = &states[i];
+        if (target->key)
+        {
+            GDL90DeltaState_initWithTrafficReport(state, &target->report);
+            keyframeSize += GDL90DeltaState_write(state, &empty, i, GDL90DeltaFieldAll, NULL, 0);
+            presentCount++;
+        }
+        else
+        {
+            state->present = 0;
+        }
+
+        const GDL90DeltaState *base = bases ? &bases[i] : &empty;
+        uint8_t fields = GDL90DeltaState_diff(state, base);
+        if (fields)
+        {
+            at = GDL90DeltaState_write(state, base, i, fields, out, at);
+            count++;
+        }
+    }
+
+    size_t countEnd = GDL90Delta_putVarint(out, countAt, count);
+    memmove(out + countEnd, out + recordsAt, at - recordsAt);
+    at -= recordsAt - countEnd;
+
+    self->sequence = sequence;
+    self->slotSequences[slot] = sequence;
+    if (isKeyframe)
+    {
+        self->keyframeRequested = 0;
+        self->keyframeTimeMs = timeMs;
+        self->keyframeCount++;
+    }
+    else
+    {
+        self->deltaCount++;
+    }
+    self->byteCount += at;
+    self->keyframeByteCount += GDL90Delta_putVarint(NULL, GDL90Delta_putVarint(NULL, GDL90Delta_putVarint(NULL, 1, sequence), timeMs), presentCount) + keyframeSize;
+    *outLength = at;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90DeltaDecoder_init(GDL90DeltaDecoder *self, GDL90DeltaState *states, uint32_t capacity)
+{
+    if (!self || !states || capacity == 0) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->states = states;
+    self->capacity = capacity;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90DeltaDecoder_decode(GDL90DeltaDecoder *self, const uint8_t *data, size_t len)
+{
+    if (!self || !data || len < 1) { return GDL90ResultFailure; }
+
+    uint8_t type = data[0];
+    if (type != GDL90DeltaMessageTypeKeyframe && type != GDL90DeltaMessageTypeDelta) { return GDL90ResultFailure; }
+
+    size_t at = 1;
+    uint64_t sequence = 0;
+    uint64_t baseSequence = 0;
+    uint64_t timeMs = 0;
+    uint64_t count = 0;
+    if (!(at = GDL90Delta_getVarint(data, len, at, &sequence)) || sequence == 0 || sequence > UINT32_MAX) { return GDL90ResultFailure; }
+    if (type == GDL90DeltaMessageTypeDelta)
+    {
+        if (!(at = GDL90Delta_getVarint(data, len, at, &baseSequence))) { return GDL90ResultFailure; }
+        if (baseSequence == 0 || baseSequence > UINT32_MAX || self->slotSequences[baseSequence % GDL90_DELTA_SNAPSHOT_COUNT] != baseSequence) { return GDL90ResultFailure; }
+        if (baseSequence % GDL90_DELTA_SNAPSHOT_COUNT == sequence % GDL90_DELTA_SNAPSHOT_COUNT) { return GDL90ResultFailure; }
+    }
+    if (!(at = GDL90Delta_getVarint(data, len, at, &timeMs))) { return GDL90ResultFailure; }
+    if (!(at = GDL90Delta_getVarint(data, len, at, &count))) { return GDL90ResultFailure; }
+
+    uint32_t slot = (uint32_t)(sequence % GDL90_DELTA_SNAPSHOT_COUNT);
+    GDL90DeltaState *states = &self->states[(size_t)slot * self->capacity];
+    // invalid until fully decoded
+    self->slotSequences[slot] = 0;
+    self->sequence = self->sequence % GDL90_DELTA_SNAPSHOT_COUNT == slot ? 0 : self->sequence;
+    if (type == GDL90DeltaMessageTypeDelta)
+    {
+        memcpy(states, &self->states[(size_t)(baseSequence % GDL90_DELTA_SNAPSHOT_COUNT) * self->capacity], sizeof(*states) * self->capacity);
+    }
+    else
+    {
+        memset(states, 0, sizeof(*states) * self->capacity);
+    }
+
+    for (uint64_t n = 0; n < count; n++)
+    {
+        uint64_t id = 0;
+        int64_t v = 0;
+        if (!(at = GDL90Delta_getVarint(data, len, at, &id)) || id >= self->capacity || at >= len) { return GDL90ResultFailure; }
+        uint8_t fields = data[at++];
+        GDL90DeltaState *state = &states[id];
+
+        if (fields & GDL90DeltaFieldRemoved)
+        {
+            memset(state, 0, sizeof(*state));
+            continue;
+        }
+        if (!state->present)
+        {
+            memset(state, 0, sizeof(*state));
+            state->present = 1;
+        }
+        if (fields & GDL90DeltaFieldPosition)
+        {
+            if (!(at = GDL90Delta_getSigned(data, len, at, &v))) { return GDL90ResultFailure; }
+            state->latitude += (int32_t)v;
+            if (!(at = GDL90Delta_getSigned(data, len, at, &v))) { return GDL90ResultFailure; }
+            state->longitude += (int32_t)v;
+        }
+        if (fields & GDL90DeltaFieldAltitude)
+        {
+            if (!(at = GDL90Delta_getSigned(data, len, at, &v))) { return GDL90ResultFailure; }
+            state->altitude += (int32_t)v;
+        }
+        if (fields & GDL90DeltaFieldHorizontalVelocity)
+        {
+            uint64_t u = 0;
+            if (!(at = GDL90Delta_getVarint(data, len, at, &u))) { return GDL90ResultFailure; }
+            state->horizontalVelocity = (uint16_t)u;
+        }
+        if (fields & GDL90DeltaFieldVerticalVelocity)
+        {
+            if (!(at = GDL90Delta_getSigned(data, len, at, &v))) { return GDL90ResultFailure; }
+            state->verticalVelocity = (int16_t)v;
+        }
+        if (fields & GDL90DeltaFieldTrack)
+        {
+            if (at + 1 > len) { return GDL90ResultFailure; }
+            state->track = data[at++];
+        }
+        if (fields & GDL90DeltaFieldStatus)
+        {
+            if (at + sizeof(state->status) > len) { return GDL90ResultFailure; }
+            memcpy(state->status, data + at, sizeof(state->status));
+            at += sizeof(state->status);
+        }
+        if (fields & GDL90DeltaFieldIdentity)
+        {
+            if (at + 3 + sizeof(state->callsign) > len) { return GDL90ResultFailure; }
+            state->participantAddress = (uint32_t)data[at] << 16 | (uint32_t)data[at + 1] << 8 | data[at + 2];
+            memcpy(state->callsign, data + at + 3, sizeof(state->callsign));
+            at += 3 + sizeof(state->callsign);
+        }
+    }
+    if (at != len) { return GDL90ResultFailure; }
+
+    self->slotSequences[slot] = (uint32_t)sequence;
+    self->sequence = (uint32_t)sequence;
+    self->timeMs = timeMs;
+
+    return GDL90ResultOK;
+}
+
+const GDL90DeltaState* GDL90DeltaDecoder_states(const GDL90DeltaDecoder *self)
+{
+    if (!self || self->sequence == 0) { return NULL; }
+
+    return &self->states[(size_t)(self->sequence % GDL90_DELTA_SNAPSHOT_COUNT) * self->capacity];
+}
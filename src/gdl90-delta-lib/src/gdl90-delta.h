@@ -0,0 +1,174 @@
+//
+//  gdl90-delta.h
+//  gdl90-delta-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Delta encoding of the traffic picture of a GDL90TargetTable for remote displays.
+//
+// Each client gets numbered snapshots of the table : a keyframe with every target, then deltas
+// with only the fields that changed since the last snapshot the client acknowledged (so lost or
+// skipped messages don't break the chain), and a keyframe again periodically or when the
+// acknowledged snapshot is older than the last GDL90_DELTA_SNAPSHOT_COUNT ones.
+//
+// Message (varints are LEB128, signed ones zigzag encoded) :
+//   u8 type (GDL90DeltaMessageTypeKeyframe/Delta), varint sequence, varint base sequence
+//   (delta only), varint time (ms), varint record count, records
+// Record :
+//   varint id (target index in the table), u8 fields (GDL90DeltaField), then in bit order :
+//   Position : signed latitude and longitude deltas (180/2^23 degrees)
+//   Altitude : signed delta (ft)
+//   HorizontalVelocity : kt
+//   VerticalVelocity : signed (64 ft/min)
+//   Track : u8 (360/256 degrees)
+//   Status : 5 bytes, see GDL90DeltaState.status
+//   Identity : u24 participant address (big endian) and 8 bytes of callsign
+// Deltas are relative to the base snapshot, or to 0 for targets that weren't in it.
+
+#ifndef __gdl90__gdl90_delta_h__
+#define __gdl90__gdl90_delta_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90.h>
+#include <gdl90-traffic.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Snapshots kept per client (and decoder) to be used as bases */
+#define GDL90_DELTA_SNAPSHOT_COUNT 8
+#define GDL90_DELTA_HEADER_MAX_SIZE (1 + 5 + 5 + 10 + 5)
+#define GDL90_DELTA_RECORD_MAX_SIZE (5 + 1 + 5 + 5 + 5 + 5 + 3 + 1 + 5 + 11)
+/** Largest message for a table of capacity targets */
+#define GDL90_DELTA_MAX_SIZE(capacity) (GDL90_DELTA_HEADER_MAX_SIZE + (size_t)(capacity) * GDL90_DELTA_RECORD_MAX_SIZE)
+
+typedef enum GDL90DeltaMessageType
+{
+    GDL90DeltaMessageTypeKeyframe = 0x4b,
+    GDL90DeltaMessageTypeDelta = 0x44
+} GDL90DeltaMessageType;
+
+typedef enum GDL90DeltaField
+{
+    GDL90DeltaFieldPosition = 1<<0,
+    GDL90DeltaFieldAltitude = 1<<1,
+    GDL90DeltaFieldHorizontalVelocity = 1<<2,
+    GDL90DeltaFieldVerticalVelocity = 1<<3,
+    GDL90DeltaFieldTrack = 1<<4,
+    GDL90DeltaFieldStatus = 1<<5,
+    GDL90DeltaFieldIdentity = 1<<6,
+    /** The target left the table, no other field */
+    GDL90DeltaFieldRemoved = 1<<7,
+    GDL90DeltaFieldAll = 0x7f
+} GDL90DeltaField;
+
+/** A target at the resolution of the Traffic Report */
+typedef struct GDL90DeltaState
+{
+    /** 180/2^23 degrees */
+    int32_t latitude;
+    int32_t longitude;
+    /** ft */
+    int32_t altitude;
+    uint32_t participantAddress;
+    /** kt */
+    uint16_t horizontalVelocity;
+    /** 64 ft/min */
+    int16_t verticalVelocity;
+    /** 360/256 degrees */
+    uint8_t track;
+    /**
+     * alertStatus | addressType << 4,
+     * trackHeadingType | reportStatus << 2 | airGroundState << 3 | hasValidPosition << 4 | hasValidAltitude << 5 | hasValidHorizontalVelocity << 6 | hasValidVerticalVelocity << 7,
+     * navigationIntegrityCategory | navigationAccuracyCategoryForPosition << 4,
+     * emitterCategory,
+     * emergencyPriorityCode
+     */
+    uint8_t status[5];
+    char callsign[8];
+    uint8_t present;
+} GDL90DeltaState;
+
+GDL90Result GDL90DeltaState_initWithTrafficReport(GDL90DeltaState *, const GDL90TrafficReport *report);
+GDL90Result GDL90DeltaState_toTrafficReport(const GDL90DeltaState *, GDL90TrafficReport *report);
+
+/** Encoder of the snapshots of one client */
+typedef struct GDL90DeltaEncoder
+{
+    /** states[GDL90_DELTA_SNAPSHOT_COUNT * capacity] */
+    GDL90DeltaState *states;
+    uint32_t capacity;
+    /** Sequence of the snapshot in each slot (sequence % GDL90_DELTA_SNAPSHOT_COUNT), 0 if none */
+    uint32_t slotSequences[GDL90_DELTA_SNAPSHOT_COUNT];
+    /** Last snapshot encoded (sequences start at 1) */
+    uint32_t sequence;
+    /** Last snapshot acknowledged by the client, 0 if none */
+    uint32_t ackSequence;
+
+    uint64_t keyframeIntervalMs;
+    uint64_t keyframeTimeMs;
+    uint8_t keyframeRequested;
+
+    /** Statistics */
+    uint64_t keyframeCount;
+    uint64_t deltaCount;
+    uint64_t byteCount;
+    /** Bytes keyframes of the same snapshots would have been */
+    uint64_t keyframeByteCount;
+} GDL90DeltaEncoder;
+
+/** capacity is the capacity of the tables encoded, states must have GDL90_DELTA_SNAPSHOT_COUNT * capacity elements */
+GDL90Result GDL90DeltaEncoder_init(GDL90DeltaEncoder *, GDL90DeltaState *states, uint32_t capacity, uint64_t keyframeIntervalMs);
+/** The client has decoded sequence, fails if it's not one of the kept snapshots */
+GDL90Result GDL90DeltaEncoder_ack(GDL90DeltaEncoder *, uint32_t sequence);
+/** The next snapshot will be a keyframe (eg. the client lost its state) */
+GDL90Result GDL90DeltaEncoder_requestKeyframe(GDL90DeltaEncoder *);
+/** Encodes the next snapshot of table, out must fit GDL90_DELTA_MAX_SIZE(capacity) */
+GDL90Result GDL90DeltaEncoder_encode(GDL90DeltaEncoder *, const GDL90TargetTable *table, uint64_t timeMs, uint8_t *out, size_t outSize, size_t *outLength);
+
+typedef struct GDL90DeltaDecoder
+{
+    /** states[GDL90_DELTA_SNAPSHOT_COUNT * capacity] */
+    GDL90DeltaState *states;
+    uint32_t capacity;
+    uint32_t slotSequences[GDL90_DELTA_SNAPSHOT_COUNT];
+    /** Last snapshot decoded, 0 if none */
+    uint32_t sequence;
+    uint64_t timeMs;
+} GDL90DeltaDecoder;
+
+GDL90Result GDL90DeltaDecoder_init(GDL90DeltaDecoder *, GDL90DeltaState *states, uint32_t capacity);
+/**
+ * Decodes a message into a new snapshot, to acknowledge with its sequence. Fails for malformed
+ * messages and deltas of an unknown base (request a keyframe then)
+ */
+GDL90Result GDL90DeltaDecoder_decode(GDL90DeltaDecoder *, const uint8_t *data, size_t len);
+/** States[capacity] of the last snapshot decoded (present if the target is in it), NULL if none */
+const GDL90DeltaState* GDL90DeltaDecoder_states(const GDL90DeltaDecoder *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_delta_h__) */
@@ -0,0 +1,861 @@
+//
+//  gdl90-fisb.c
+//  gdl90-fisb-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "gdl90-fisb.h"
+
+#include <string.h>
+
+// NEXRAD blocks : 450 blocks of 48' of longitude per 4' ring of latitude, above 60 degrees only the even ones are sent, 96' wide
+#define GDL90_FISB_NEXRAD_BLOCKS_PER_RING 450
+#define GDL90_FISB_NEXRAD_WIDE_BLOCK_THRESHOLD 405000
+#define GDL90_FISB_NEXRAD_BLOCK_LATITUDE_SIZE (4.0 / 60.0)
+#define GDL90_FISB_NEXRAD_BLOCK_LONGITUDE_SIZE (48.0 / 60.0)
+
+static inline uint32_t GDL90NEXRADCache_key(uint16_t productId, uint8_t scale, uint8_t southern, uint32_t blockNumber)
+{
+    return 1u << 31 | (uint32_t)(productId == GDL90FISBProductIdNEXRADCONUS) << 24 | (uint32_t)(southern & 1) << 23 | (uint32_t)(scale & 3) << 20 | (blockNumber & 0xfffff);
+}
+
+void GDL90NEXRADTile_location(const GDL90NEXRADTile *self, double *northLatitude, double *westLongitude, double *latitudeSize, double *longitudeSize)
+{
+    static const double scales[4] = { 1.0, 5.0, 9.0, 1.0 };
+
+    uint32_t ring = self->blockNumber / GDL90_FISB_NEXRAD_BLOCKS_PER_RING;
+    uint32_t column = self->blockNumber % GDL90_FISB_NEXRAD_BLOCKS_PER_RING;
+    double width = GDL90_FISB_NEXRAD_BLOCK_LONGITUDE_SIZE;
+    if (self->blockNumber >= GDL90_FISB_NEXRAD_WIDE_BLOCK_THRESHOLD)
+    {
+        // wide blocks keep the 48' numbering, an even column covers the odd one east of it
+        column = (self->blockNumber & ~1u) % GDL90_FISB_NEXRAD_BLOCKS_PER_RING;
+        width = 2.0 * GDL90_FISB_NEXRAD_BLOCK_LONGITUDE_SIZE;
+    }
+    double south = ring * GDL90_FISB_NEXRAD_BLOCK_LATITUDE_SIZE;
+    double west = column * GDL90_FISB_NEXRAD_BLOCK_LONGITUDE_SIZE;
+
+    *latitudeSize = GDL90_FISB_NEXRAD_BLOCK_LATITUDE_SIZE * scales[self->scale & 3];
+    *longitudeSize = width * scales[self->scale & 3];
+    // block numbers count away from the equator
+    *northLatitude = self->southern ? -south : south + GDL90_FISB_NEXRAD_BLOCK_LATITUDE_SIZE;
+    *westLongitude = west > 180.0 ? west - 360.0 : west;
+}
+
+static inline uint32_t GDL90NEXRADCache_slot(const GDL90NEXRADCache *self, uint32_t key)
+{
+    return (uint32_t)(key * 0x9e3779b1u) >> self->hashShift;
+}
+
+static inline uint32_t GDL90NEXRADCache_lookup(const GDL90NEXRADCache *self, uint32_t key)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t i = GDL90NEXRADCache_slot(self, key);
+    while (self->slots[i].key != 0 && self->slots[i].key != key)
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void GDL90NEXRADCache_removeSlot(GDL90NEXRADCache *self, uint32_t i)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t j = i;
+
+    self->tiles[self->slots[i].tile].key = 0;
+
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (self->slots[j].key == 0) { break; }
+
+        uint32_t home = GDL90NEXRADCache_slot(self, self->slots[j].key);
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            self->slots[i] = self->slots[j];
+            i = j;
+        }
+    }
+    self->slots[i].key = 0;
+    self->count--;
+}
+
+GDL90Result GDL90NEXRADCache_init(GDL90NEXRADCache *self, GDL90NEXRADCacheSlot *slots, GDL90NEXRADTile *tiles, uint32_t capacity)
+{
+    if (!self || !slots || !tiles || capacity < 8 || (capacity & (capacity - 1)) != 0) { return GDL90ResultFailure; }
+
+    self->slots = slots;
+    self->tiles = tiles;
+    self->capacity = capacity;
+    self->count = 0;
+    self->maxCount = capacity - capacity / 8;
+    self->allocCursor = 0;
+    self->hashShift = 32;
+    for (uint32_t c = capacity; c > 1; c >>= 1) { self->hashShift--; }
+    self->removalHandler = NULL;
+    self->removalHandlerContext = NULL;
+
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        slots[i].key = 0;
+        tiles[i].key = 0;
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90NEXRADCache_setRemovalHandler(GDL90NEXRADCache *self, GDL90NEXRADCacheRemovalHandler *removalHandler, void *context)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->removalHandler = removalHandler;
+    self->removalHandlerContext = context;
+
+    return GDL90ResultOK;
+}
+
+static GDL90NEXRADTile* GDL90NEXRADCache_upsert(GDL90NEXRADCache *self, uint16_t productId, uint8_t scale, uint8_t southern, uint32_t blockNumber)
+{
+    uint32_t key = GDL90NEXRADCache_key(productId, scale, southern, blockNumber);
+    uint32_t i = GDL90NEXRADCache_lookup(self, key);
+
+    if (self->slots[i].key != 0)
+    {
+        return &self->tiles[self->slots[i].tile];
+    }
+    if (self->count >= self->maxCount) { return NULL; }
+
+    // next fit, at most 1/8 of the tiles are free so this is O(1) on average
+    uint32_t t = self->allocCursor;
+    while (self->tiles[t].key != 0)
+    {
+        t = (t + 1) & (self->capacity - 1);
+    }
+    self->allocCursor = (t + 1) & (self->capacity - 1);
+
+    GDL90NEXRADTile *tile = &self->tiles[t];
+    tile->key = key;
+    tile->productId = productId;
+    tile->scale = scale;
+    tile->southern = southern;
+    tile->blockNumber = blockNumber;
+    tile->empty = 1;
+    // a new tile is rendered even if it's empty
+    tile->dirty = 1;
+    memset(tile->bins, 0, sizeof(tile->bins));
+
+    self->slots[i].key = key;
+    self->slots[i].tile = t;
+    self->count++;
+
+    return tile;
+}
+
+static GDL90Result GDL90NEXRADCache_setEmpty(GDL90NEXRADCache *self, uint64_t timeMs, uint16_t productId, uint8_t scale, uint8_t southern, uint32_t blockNumber)
+{
+    GDL90NEXRADTile *tile = GDL90NEXRADCache_upsert(self, productId, scale, southern, blockNumber);
+    if (!tile) { return GDL90ResultFailure; }
+
+    if (!tile->empty)
+    {
+        memset(tile->bins, 0, sizeof(tile->bins));
+        tile->empty = 1;
+        tile->dirty = 1;
+    }
+    tile->updateTimeMs = timeMs;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90NEXRADCache_decode(GDL90NEXRADCache *self, uint64_t timeMs, const GDL90UATAPDU *apdu)
+{
+    if (!self || !self->slots || !apdu || !apdu->data || apdu->length < 4) { return GDL90ResultFailure; }
+    if (apdu->productId != GDL90FISBProductIdNEXRADRegional && apdu->productId != GDL90FISBProductIdNEXRADCONUS) { return GDL90ResultFailure; }
+
+    const uint8_t *data = apdu->data;
+    uint8_t runLengthEncoded = (data[0] & 0x80) != 0;
+    uint8_t southern = (data[0] & 0x40) != 0;
+    uint8_t scale = (data[0] & 0x30) >> 4;
+    uint32_t blockNumber = ((uint32_t)data[0] & 0x0f) << 16 | (uint32_t)data[1] << 8 | data[2];
+
+    if (!runLengthEncoded)
+    {
+        // empty blocks : 4 flags for blockNumber to blockNumber + 3, then a bitmap of the next ones
+        uint32_t bitmapLength = data[3] & 0x0f;
+        if (4u + bitmapLength > apdu->length) { return GDL90ResultFailure; }
+
+        for (uint32_t b = 0; b < 4; b++)
+        {
+            if ((data[3] & (0x10 << b)) && GDL90NEXRADCache_setEmpty(self, timeMs, apdu->productId, scale, southern, blockNumber + b) != GDL90ResultOK) { return GDL90ResultFailure; }
+        }
+        for (uint32_t i = 0; i < bitmapLength; i++)
+        {
+            for (uint32_t b = 0; b < 8; b++)
+            {
+                if ((data[4 + i] & (1 << b)) && GDL90NEXRADCache_setEmpty(self, timeMs, apdu->productId, scale, southern, blockNumber + 4 + i * 8 + b) != GDL90ResultOK) { return GDL90ResultFailure; }
+            }
+        }
+        return GDL90ResultOK;
+    }
+
+    // runs of (length - 1) << 3 | intensity, validated before touching the tile
+    uint32_t total = 0;
+    for (uint16_t i = 3; i < apdu->length; i++)
+    {
+        total += (uint32_t)(data[i] >> 3) + 1;
+    }
+    if (total != GDL90_FISB_NEXRAD_BLOCK_BINS) { return GDL90ResultFailure; }
+
+    GDL90NEXRADTile *tile = GDL90NEXRADCache_upsert(self, apdu->productId, scale, southern, blockNumber);
+    if (!tile) { return GDL90ResultFailure; }
+
+    uint8_t changed = 0;
+    uint8_t nonZero = 0;
+    uint8_t *bin = tile->bins;
+    for (uint16_t i = 3; i < apdu->length; i++)
+    {
+        uint8_t intensity = data[i] & 0x07;
+        uint8_t *end = bin + (data[i] >> 3) + 1;
+        nonZero |= intensity;
+        for (; bin < end; bin++)
+        {
+            changed |= *bin ^ intensity;
+            *bin = intensity;
+        }
+    }
+
+    tile->dirty |= changed != 0;
+    tile->empty = nonZero == 0;
+    tile->updateTimeMs = timeMs;
+
+    return GDL90ResultOK;
+}
+
+GDL90NEXRADTile* GDL90NEXRADCache_find(GDL90NEXRADCache *self, uint16_t productId, uint8_t scale, uint8_t southern, uint32_t blockNumber)
+{
+    if (!self || !self->slots) { return NULL; }
+
+    uint32_t i = GDL90NEXRADCache_lookup(self, GDL90NEXRADCache_key(productId, scale, southern, blockNumber));
+    return self->slots[i].key != 0 ? &self->tiles[self->slots[i].tile] : NULL;
+}
+
+uint32_t GDL90NEXRADCache_evict(GDL90NEXRADCache *self, uint64_t staleTimeMs)
+{
+    if (!self || !self->slots) { return 0; }
+
+    uint32_t evicted = 0;
+    for (uint32_t t = 0; t < self->capacity; t++)
+    {
+        GDL90NEXRADTile *tile = &self->tiles[t];
+        if (tile->key == 0 || tile->updateTimeMs >= staleTimeMs) { continue; }
+
+        if (self->removalHandler)
+        {
+            self->removalHandler(tile, t, self->removalHandlerContext);
+        }
+        GDL90NEXRADCache_removeSlot(self, GDL90NEXRADCache_lookup(self, tile->key));
+        evicted++;
+    }
+
+    return evicted;
+}
+
+GDL90NEXRADTile* GDL90NEXRADCache_nextDirty(GDL90NEXRADCache *self, uint32_t *cursor)
+{
+    if (!self || !self->slots || !cursor) { return NULL; }
+
+    for (uint32_t t = *cursor; t < self->capacity; t++)
+    {
+        if (self->tiles[t].key != 0 && self->tiles[t].dirty)
+        {
+            self->tiles[t].dirty = 0;
+            *cursor = t + 1;
+            return &self->tiles[t];
+        }
+    }
+    *cursor = self->capacity;
+
+    return NULL;
+}
+
+// DLAC alphabet, 0 is ETX, 27 change cipher (dropped), 28 a tab (the next code is the number of spaces), 29 record separator
+static const char GDL90_FISB_DLAC[64] = {
+    '\x03', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O',
+    'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', '\x1a', '\t', '\x1e', '\n', '|',
+    ' ', '!', '"', '#', '$', '%', '&', '\'', '(', ')', '*', '+', ',', '-', '.', '/',
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', ':', ';', '<', '=', '>', '?'
+};
+
+#define GDL90_FISB_DLAC_ETX 0
+#define GDL90_FISB_DLAC_CHANGECIPHER 27
+#define GDL90_FISB_DLAC_TAB 28
+
+size_t GDL90FISB_decodeDLAC(const uint8_t *data, size_t len, char *out, size_t outLen)
+{
+    if (!data || !out || outLen == 0) { return 0; }
+
+    char *p = out;
+    char *end = out + outLen - 1;
+    uint8_t codes[4];
+    uint8_t tab = 0;
+
+    for (size_t i = 0; i + 3 <= len; i += 3)
+    {
+        uint32_t v = (uint32_t)data[i] << 16 | (uint32_t)data[i+1] << 8 | data[i+2];
+        codes[0] = (uint8_t)(v >> 18);
+        codes[1] = (uint8_t)(v >> 12) & 0x3f;
+        codes[2] = (uint8_t)(v >> 6) & 0x3f;
+        codes[3] = (uint8_t)v & 0x3f;
+
+        // common case : 4 plain characters
+        if (!tab && end - p >= 4 && codes[0] > GDL90_FISB_DLAC_TAB && codes[1] > GDL90_FISB_DLAC_TAB && codes[2] > GDL90_FISB_DLAC_TAB && codes[3] > GDL90_FISB_DLAC_TAB)
+        {
+            p[0] = GDL90_FISB_DLAC[codes[0]];
+            p[1] = GDL90_FISB_DLAC[codes[1]];
+            p[2] = GDL90_FISB_DLAC[codes[2]];
+            p[3] = GDL90_FISB_DLAC[codes[3]];
+            p += 4;
+            continue;
+        }
+
+        for (int c = 0; c < 4; c++)
+        {
+            uint8_t code = codes[c];
+            if (tab)
+            {
+                while (code-- > 0 && p < end) { *p++ = ' '; }
+                tab = 0;
+            }
+            else if (code == GDL90_FISB_DLAC_ETX)
+            {
+                *p = '\0';
+                return (size_t)(p - out);
+            }
+            else if (code == GDL90_FISB_DLAC_TAB)
+            {
+                tab = 1;
+            }
+            else if (code != GDL90_FISB_DLAC_CHANGECIPHER && p < end)
+            {
+                *p++ = GDL90_FISB_DLAC[code];
+            }
+        }
+    }
+    *p = '\0';
+
+    return (size_t)(p - out);
+}
+
+GDL90Result GDL90FISBText_init(GDL90FISBText *self, const GDL90UATAPDU *apdu, char *buffer, size_t bufferSize)
+{
+    if (!self || !apdu || !apdu->data || !buffer || bufferSize == 0) { return GDL90ResultFailure; }
+
+    self->apdu = apdu;
+    self->text = buffer;
+    self->length = GDL90FISB_decodeDLAC(apdu->data, apdu->length, buffer, bufferSize);
+    self->offset = 0;
+
+    return GDL90ResultOK;
+}
+
+/** Next space separated word in [*p, end), empty at the end */
+static const char* GDL90FISBText_word(const char **p, const char *end, uint16_t *length)
+{
+    const char *s = *p;
+    while (s < end && (*s == ' ' || *s == '\n' || *s == '\r')) { s++; }
+    const char *e = s;
+    while (e < end && *e != ' ' && *e != '\n' && *e != '\r') { e++; }
+    *p = e;
+    *length = (uint16_t)(e - s);
+    return s;
+}
+
+GDL90Result GDL90FISBText_next(GDL90FISBText *self, GDL90FISBTextRecord *record)
+{
+    if (!self || !self->text || !record) { return GDL90ResultFailure; }
+
+    const char *text = self->text;
+    for (;;)
+    {
+        if (self->offset >= self->length) { return GDL90ResultFailure; }
+
+        const char *start = text + self->offset;
+        const char *separator = memchr(start, '\x1e', self->length - self->offset);
+        const char *end = separator ? separator : text + self->length;
+        self->offset = (size_t)(end - text) + 1;
+
+        const char *p = start;
+        uint16_t length = 0;
+        const char *type = GDL90FISBText_word(&p, end, &length);
+        // skip empty records (eg. trailing separator)
+        if (length == 0) { continue; }
+
+        record->productId = self->apdu->productId;
+        record->hours = self->apdu->hours;
+        record->minutes = self->apdu->minutes;
+        record->type = type;
+        record->typeLength = length;
+        record->location = GDL90FISBText_word(&p, end, &record->locationLength);
+        record->time = GDL90FISBText_word(&p, end, &record->timeLength);
+        record->text = start;
+        record->textLength = (uint16_t)(end - start);
+
+        return GDL90ResultOK;
+    }
+}
+
+GDL90Result GDL90FISBTextStream_init(GDL90FISBTextStream *self, GDL90FISBTextHandler *handler, void *context)
+{
+    if (!self || !handler) { return GDL90ResultFailure; }
+
+    self->handler = handler;
+    self->handlerContext = context;
+    self->segmentedCount = 0;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FISBTextStream_handleUplink(GDL90FISBTextStream *self, const GDL90Message *gdl90Message)
+{
+    if (!self || !self->handler) { return GDL90ResultFailure; }
+
+    GDL90UATUplink uplink;
+    GDL90UATInfoFrame frame;
+    GDL90UATAPDU apdu;
+    GDL90FISBText text;
+    GDL90FISBTextRecord record;
+
+    if (GDL90UATUplink_initWithMessage(&uplink, gdl90Message) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+    while (GDL90UATUplink_nextFrame(&uplink, &frame) == GDL90ResultOK)
+    {
+        if (frame.type != GDL90UATInfoFrameTypeFISB || GDL90UATAPDU_init(&apdu, &frame) != GDL90ResultOK) { continue; }
+        if (apdu.productId != GDL90FISBProductIdGenericText) { continue; }
+        if (apdu.sFlag)
+        {
+            self->segmentedCount++;
+            continue;
+        }
+
+        (void)GDL90FISBText_init(&text, &apdu, self->buffer, sizeof(self->buffer));
+        while (GDL90FISBText_next(&text, &record) == GDL90ResultOK)
+        {
+            self->handler(&record, self->handlerContext);
+        }
+    }
+
+    return GDL90ResultOK;
+}
+
+void GDL90FISBTextStream_handleFrame(GDL90Message *gdl90Message, void *context)
+{
+    GDL90FISBTextStream *self = (GDL90FISBTextStream *)context;
+    if (!self || !gdl90Message || gdl90Message->id != GDL90MessageType_UplinkData) { return; }
+
+    (void)GDL90FISBTextStream_handleUplink(self, gdl90Message);
+}
+
+static inline uint32_t GDL90FISB_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/** Hash of APDU data, a word at a time */
+static uint32_t GDL90FISB_hash(const uint8_t *data, size_t len)
+{
+    uint32_t h = 0x811c9dc5u ^ (uint32_t)len;
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        uint32_t w = (uint32_t)data[i] | (uint32_t)data[i+1] << 8 | (uint32_t)data[i+2] << 16 | (uint32_t)data[i+3] << 24;
+        h = (h ^ w) * 0x01000193u;
+        h ^= h >> 15;
+    }
+    for (; i < len; i++)
+    {
+        h = (h ^ data[i]) * 0x01000193u;
+    }
+    return GDL90FISB_mix(h);
+}
+
+static inline uint32_t GDL90FISBProductCache_key(uint16_t productId, uint8_t segmented, uint16_t productFileId, uint32_t productTime, uint32_t contentHash)
+{
+    uint32_t h = segmented ? (uint32_t)productFileId << 16 | productId : GDL90FISB_mix(productTime ^ contentHash) ^ productId;
+    h = GDL90FISB_mix(h ^ ((uint32_t)segmented << 31));
+    return h ? h : 1;
+}
+
+static inline uint32_t GDL90FISBProductCache_slot(const GDL90FISBProductCache *self, uint32_t key)
+{
+    return (uint32_t)(key * 0x9e3779b1u) >> self->hashShift;
+}
+
+static inline uint8_t GDL90FISBProductCache_matches(const GDL90FISBProductCache *self, const GDL90FISBProduct *product, uint32_t key, uint16_t productId, uint8_t segmented, uint16_t productFileId, uint32_t productTime, uint32_t contentHash, const uint8_t *data, uint16_t length)
+{
+    if (product->key != key || product->productId != productId || product->segmented != segmented) { return 0; }
+    if (segmented) { return product->productFileId == productFileId; }
+    if (product->productTime != productTime || product->contentHash != contentHash || product->length != length) { return 0; }
+    // the hash only tells which products can match, the bytes decide
+    return product->firstSegment != GDL90_FISB_NONE && memcmp(self->segments[product->firstSegment].data, data, length) == 0;
+}
+
+static uint32_t GDL90FISBProductCache_lookup(const GDL90FISBProductCache *self, uint32_t key, uint16_t productId, uint8_t segmented, uint16_t productFileId, uint32_t productTime, uint32_t contentHash, const uint8_t *data, uint16_t length)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t i = GDL90FISBProductCache_slot(self, key);
+    while (self->slots[i].key != 0 && !GDL90FISBProductCache_matches(self, &self->products[self->slots[i].product], key, productId, segmented, productFileId, productTime, contentHash, data, length))
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * 1 when productTime is later than previousTime. Dates are compared when both have one (December
+ * is followed by January), times of day within 12 hours of each other so midnight wraps.
+ */
+static uint8_t GDL90FISBProductCache_isNewer(uint32_t productTime, uint32_t previousTime)
+{
+    uint32_t date = productTime >> 17;
+    uint32_t previousDate = previousTime >> 17;
+    if ((date & 31) != 0 && (previousDate & 31) != 0 && date != previousDate)
+    {
+        // month << 5 | day, one year of 13 * 32 days is more than enough to order them
+        uint32_t days = (date - previousDate + 13 * 32) % (13 * 32);
+        return days < 13 * 16;
+    }
+
+    uint32_t seconds = (productTime >> 12 & 31) * 3600 + (productTime >> 6 & 63) * 60 + (productTime & 63);
+    uint32_t previousSeconds = (previousTime >> 12 & 31) * 3600 + (previousTime >> 6 & 63) * 60 + (previousTime & 63);
+    uint32_t elapsed = (seconds - previousSeconds + 86400) % 86400;
+    return elapsed != 0 && elapsed < 43200;
+}
+
+static void GDL90FISBProductCache_freeSegments(GDL90FISBProductCache *self, GDL90FISBProduct *product)
+{
+    uint32_t s = product->firstSegment;
+    while (s != GDL90_FISB_NONE)
+    {
+        uint32_t next = self->segments[s].next;
+        self->segments[s].next = self->freeSegment;
+        self->freeSegment = s;
+        self->freeSegmentCount++;
+        s = next;
+    }
+    product->firstSegment = GDL90_FISB_NONE;
+    product->length = 0;
+    product->receivedCount = 0;
+    memset(product->receivedSegments, 0, sizeof(product->receivedSegments));
+}
+
+static void GDL90FISBProductCache_remove(GDL90FISBProductCache *self, uint32_t productIndex)
+{
+    GDL90FISBProduct *product = &self->products[productIndex];
+    uint32_t mask = self->capacity - 1;
+
+    // find the slot of the product, then backward shift deletion
+    uint32_t i = GDL90FISBProductCache_slot(self, product->key);
+    while (self->slots[i].product != productIndex || self->slots[i].key == 0)
+    {
+        i = (i + 1) & mask;
+    }
+
+    GDL90FISBProductCache_freeSegments(self, product);
+    product->key = 0;
+
+    uint32_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (self->slots[j].key == 0) { break; }
+
+        uint32_t home = GDL90FISBProductCache_slot(self, self->slots[j].key);
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            self->slots[i] = self->slots[j];
+            i = j;
+        }
+    }
+    self->slots[i].key = 0;
+    self->count--;
+}
+
+GDL90Result GDL90FISBProductCache_init(GDL90FISBProductCache *self, GDL90FISBProductCacheSlot *slots, GDL90FISBProduct *products, uint32_t capacity, void *arena, size_t arenaSize)
+{
+    if (!self || !slots || !products || capacity < 8 || (capacity & (capacity - 1)) != 0 || !arena || arenaSize < sizeof(GDL90FISBSegment)) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->slots = slots;
+    self->products = products;
+    self->capacity = capacity;
+    self->maxCount = capacity - capacity / 8;
+    self->hashShift = 32;
+    for (uint32_t c = capacity; c > 1; c >>= 1) { self->hashShift--; }
+    self->validityMs = 60 * 60 * 1000;
+
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        slots[i].key = 0;
+        products[i].key = 0;
+    }
+
+    self->segments = (GDL90FISBSegment *)arena;
+    self->segmentCapacity = (uint32_t)(arenaSize / sizeof(GDL90FISBSegment));
+    for (uint32_t i = 0; i < self->segmentCapacity; i++)
+    {
+        self->segments[i].next = i + 1 < self->segmentCapacity ? i + 1 : GDL90_FISB_NONE;
+    }
+    self->freeSegment = 0;
+    self->freeSegmentCount = self->segmentCapacity;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FISBProductCache_setHandler(GDL90FISBProductCache *self, GDL90FISBProductHandler *handler, void *context)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->handler = handler;
+    self->handlerContext = context;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FISBProductCache_setValidity(GDL90FISBProductCache *self, uint16_t productId, uint64_t validityMs)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    uint32_t i = 0;
+    while (i < self->validityOverrideCount && self->validityOverrideProductIds[i] != productId) { i++; }
+    if (i == GDL90_FISB_PRODUCT_VALIDITY_OVERRIDES) { return GDL90ResultFailure; }
+
+    self->validityOverrideProductIds[i] = productId;
+    self->validityOverrideMs[i] = validityMs;
+    self->validityOverrideCount += i == self->validityOverrideCount;
+
+    return GDL90ResultOK;
+}
+
+static uint64_t GDL90FISBProductCache_validity(const GDL90FISBProductCache *self, uint16_t productId)
+{
+    for (uint32_t i = 0; i < self->validityOverrideCount; i++)
+    {
+        if (self->validityOverrideProductIds[i] == productId) { return self->validityOverrideMs[i]; }
+    }
+    return self->validityMs;
+}
+
+GDL90Result GDL90FISBProductCache_add(GDL90FISBProductCache *self, uint64_t timeMs, const GDL90UATAPDU *apdu)
+{
+    if (!self || !self->slots || !apdu || !apdu->data || apdu->length > GDL90_FISB_SEGMENT_DATA_SIZE) { return GDL90ResultFailure; }
+
+    uint8_t segmented = apdu->sFlag;
+    if (segmented && (apdu->productFileLength == 0 || apdu->apduNumber == 0 || apdu->apduNumber > apdu->productFileLength)) { return GDL90ResultFailure; }
+
+    uint32_t productTime = (uint32_t)apdu->month << 22 | (uint32_t)apdu->day << 17 | (uint32_t)apdu->hours << 12 | (uint32_t)apdu->minutes << 6 | apdu->seconds;
+    uint32_t contentHash = segmented ? 0 : GDL90FISB_hash(apdu->data, apdu->length);
+    uint16_t productFileId = segmented ? apdu->productFileId : 0;
+    uint32_t key = GDL90FISBProductCache_key(apdu->productId, segmented, productFileId, productTime, contentHash);
+
+    uint32_t i = GDL90FISBProductCache_lookup(self, key, apdu->productId, segmented, productFileId, productTime, contentHash, apdu->data, apdu->length);
+    GDL90FISBProduct *product = self->slots[i].key != 0 ? &self->products[self->slots[i].product] : NULL;
+
+    if (product && (!segmented || (product->productTime == productTime && (product->receivedSegments[apdu->apduNumber >> 6] >> (apdu->apduNumber & 63) & 1))))
+    {
+        self->duplicateCount++;
+        return GDL90ResultOK;
+    }
+    // only a later time replaces a segmented product, APDUs of an older version are late repeats
+    if (product && product->productTime != productTime && !GDL90FISBProductCache_isNewer(productTime, product->productTime))
+    {
+        self->staleCount++;
+        return GDL90ResultOK;
+    }
+
+    // make room, evicting first might remove the product, so look it up again
+    if (self->freeSegmentCount == 0 || (!product && self->count >= self->maxCount))
+    {
+        (void)GDL90FISBProductCache_evict(self, timeMs);
+        i = GDL90FISBProductCache_lookup(self, key, apdu->productId, segmented, productFileId, productTime, contentHash, apdu->data, apdu->length);
+        product = self->slots[i].key != 0 ? &self->products[self->slots[i].product] : NULL;
+    }
+    if (self->freeSegmentCount == 0 || (!product && self->count >= self->maxCount))
+    {
+        self->droppedCount++;
+        return GDL90ResultFailure;
+    }
+
+    if (!product)
+    {
+        uint32_t p = self->allocCursor;
+        while (self->products[p].key != 0)
+        {
+            p = (p + 1) & (self->capacity - 1);
+        }
+        self->allocCursor = (p + 1) & (self->capacity - 1);
+
+        product = &self->products[p];
+        memset(product, 0, sizeof(*product));
+        product->key = key;
+        product->productId = apdu->productId;
+        product->segmented = segmented;
+        product->productFileId = productFileId;
+        product->productTime = productTime;
+        product->contentHash = contentHash;
+        product->firstSegment = GDL90_FISB_NONE;
+        product->segmentCount = segmented ? apdu->productFileLength : 1;
+        product->receiveTimeMs = timeMs;
+        product->expiryTimeMs = timeMs + GDL90FISBProductCache_validity(self, apdu->productId);
+
+        self->slots[i].key = key;
+        self->slots[i].product = p;
+        self->count++;
+    }
+    else if (product->productTime != productTime)
+    {
+        // a newer version of a segmented product starts over
+        GDL90FISBProductCache_freeSegments(self, product);
+        product->version++;
+        product->complete = 0;
+        product->productTime = productTime;
+        product->segmentCount = apdu->productFileLength;
+        product->receiveTimeMs = timeMs;
+        product->expiryTimeMs = timeMs + GDL90FISBProductCache_validity(self, apdu->productId);
+    }
+
+    uint32_t s = self->freeSegment;
+    GDL90FISBSegment *segment = &self->segments[s];
+    self->freeSegment = segment->next;
+    self->freeSegmentCount--;
+
+    segment->apduNumber = segmented ? apdu->apduNumber : 1;
+    segment->length = apdu->length;
+    memcpy(segment->data, apdu->data, apdu->length);
+
+    // keep the segments sorted
+    uint32_t *link = &product->firstSegment;
+    while (*link != GDL90_FISB_NONE && self->segments[*link].apduNumber < segment->apduNumber)
+    {
+        link = &self->segments[*link].next;
+    }
+    segment->next = *link;
+    *link = s;
+
+    product->receivedSegments[segment->apduNumber >> 6] |= (uint64_t)1 << (segment->apduNumber & 63);
+    product->receivedCount++;
+    product->length += apdu->length;
+
+    if (product->receivedCount == product->segmentCount)
+    {
+        product->complete = 1;
+        if (self->handler)
+        {
+            self->handler(product, product->version ? GDL90FISBProductEventChanged : GDL90FISBProductEventComplete, self->handlerContext);
+        }
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FISBProductCache_handleUplink(GDL90FISBProductCache *self, uint64_t timeMs, const GDL90Message *gdl90Message)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    GDL90UATUplink uplink;
+    GDL90UATInfoFrame frame;
+    GDL90UATAPDU apdu;
+
+    if (GDL90UATUplink_initWithMessage(&uplink, gdl90Message) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+    while (GDL90UATUplink_nextFrame(&uplink, &frame) == GDL90ResultOK)
+    {
+        if (frame.type == GDL90UATInfoFrameTypeFISB && GDL90UATAPDU_init(&apdu, &frame) == GDL90ResultOK)
+        {
+            (void)GDL90FISBProductCache_add(self, timeMs, &apdu);
+        }
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FISBProductCache_setTime(GDL90FISBProductCache *self, uint64_t timeMs)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->currentTimeMs = timeMs;
+
+    return GDL90ResultOK;
+}
+
+void GDL90FISBProductCache_handleFrame(GDL90Message *gdl90Message, void *context)
+{
+    GDL90FISBProductCache *self = (GDL90FISBProductCache *)context;
+    if (!self || !gdl90Message || gdl90Message->id != GDL90MessageType_UplinkData) { return; }
+
+    (void)GDL90FISBProductCache_handleUplink(self, self->currentTimeMs, gdl90Message);
+}
+
+uint32_t GDL90FISBProductCache_evict(GDL90FISBProductCache *self, uint64_t timeMs)
+{
+    if (!self || !self->slots) { return 0; }
+
+    uint32_t evicted = 0;
+    for (uint32_t p = 0; p < self->capacity; p++)
+    {
+        if (self->products[p].key == 0 || self->products[p].expiryTimeMs > timeMs) { continue; }
+
+        GDL90FISBProductCache_remove(self, p);
+        evicted++;
+    }
+
+    return evicted;
+}
+
+const GDL90FISBSegment* GDL90FISBProductCache_nextSegment(const GDL90FISBProductCache *self, uint32_t *cursor)
+{
+    if (!self || !cursor || *cursor >= self->segmentCapacity) { return NULL; }
+
+    const GDL90FISBSegment *segment = &self->segments[*cursor];
+    *cursor = segment->next;
+
+    return segment;
+}
+
+size_t GDL90FISBProductCache_copy(const GDL90FISBProductCache *self, const GDL90FISBProduct *product, uint8_t *out, size_t len)
+{
+    if (!self || !product || !out || product->length > len) { return 0; }
+
+    size_t n = 0;
+    for (uint32_t s = product->firstSegment; s != GDL90_FISB_NONE; s = self->segments[s].next)
+    {
+        memcpy(out + n, self->segments[s].data, self->segments[s].length);
+        n += self->segments[s].length;
+    }
+
+    return n;
+}
@@ -0,0 +1,316 @@
+//
+//  gdl90-fisb.h
+//  gdl90-fisb-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Decoding of FIS-B products (see RTCA/DO-358) from the APDUs of gdl90-uat.
+
+#ifndef __gdl90__gdl90_fisb_h__
+#define __gdl90__gdl90_fisb_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90-uat.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GDL90_FISB_NONE UINT32_MAX
+
+typedef enum GDL90FISBProductId
+{
+    GDL90FISBProductIdNEXRADRegional = 63,
+    GDL90FISBProductIdNEXRADCONUS = 64,
+    /** Generic Textual Data (DLAC) : METAR, TAF, PIREP, WINDS... */
+    GDL90FISBProductIdGenericText = 413
+} GDL90FISBProductId;
+
+/** Bins of a NEXRAD block */
+#define GDL90_FISB_NEXRAD_BLOCK_WIDTH 32
+#define GDL90_FISB_NEXRAD_BLOCK_HEIGHT 4
+#define GDL90_FISB_NEXRAD_BLOCK_BINS (GDL90_FISB_NEXRAD_BLOCK_WIDTH * GDL90_FISB_NEXRAD_BLOCK_HEIGHT)
+
+/** A NEXRAD block expanded into a raster tile */
+typedef struct GDL90NEXRADTile
+{
+    /** 0 if unused */
+    uint32_t key;
+    /** GDL90FISBProductId */
+    uint16_t productId;
+    /** Scale factor (0 : 1x, 1 : 5x, 2 : 9x) */
+    uint8_t scale;
+    /** Set for the southern hemisphere */
+    uint8_t southern;
+    uint32_t blockNumber;
+    /** Set when the bins changed since the tile was last returned by GDL90NEXRADCache_nextDirty */
+    uint8_t dirty;
+    /** Set when the block was sent as empty (all bins 0) */
+    uint8_t empty;
+    uint64_t updateTimeMs;
+    /** Intensities (0-7), GDL90_FISB_NEXRAD_BLOCK_HEIGHT rows north to south of GDL90_FISB_NEXRAD_BLOCK_WIDTH bins west to east */
+    uint8_t bins[GDL90_FISB_NEXRAD_BLOCK_BINS];
+} GDL90NEXRADTile;
+
+/** Extent of a tile (degrees), the bins are latitudeSize / GDL90_FISB_NEXRAD_BLOCK_HEIGHT by longitudeSize / GDL90_FISB_NEXRAD_BLOCK_WIDTH */
+void GDL90NEXRADTile_location(const GDL90NEXRADTile *, double *northLatitude, double *westLongitude, double *latitudeSize, double *longitudeSize);
+
+typedef struct GDL90NEXRADCacheSlot
+{
+    /** 0 if empty */
+    uint32_t key;
+    /** Index in tiles */
+    uint32_t tile;
+} GDL90NEXRADCacheSlot;
+
+/** Called before a tile is removed by GDL90NEXRADCache_evict */
+typedef void (GDL90NEXRADCacheRemovalHandler)(GDL90NEXRADTile *tile, uint32_t tileIndex, void *context);
+
+/**
+ * Tiles keyed by product, scale and block number, decoded straight from the APDUs.
+ * Tiles keep their index while cached, eg. to map them to textures, and only the ones whose
+ * bins changed are flagged dirty, so a map layer only re-renders those.
+ */
+typedef struct GDL90NEXRADCache
+{
+    GDL90NEXRADCacheSlot *slots;
+    GDL90NEXRADTile *tiles;
+    uint32_t capacity;
+    uint32_t count;
+    /** Fails inserts past this count (7/8 of capacity) */
+    uint32_t maxCount;
+    uint32_t allocCursor;
+    uint8_t hashShift;
+
+    GDL90NEXRADCacheRemovalHandler *removalHandler;
+    void *removalHandlerContext;
+} GDL90NEXRADCache;
+
+/** slots and tiles must have capacity (a power of 2, >= 8) elements */
+GDL90Result GDL90NEXRADCache_init(GDL90NEXRADCache *, GDL90NEXRADCacheSlot *slots, GDL90NEXRADTile *tiles, uint32_t capacity);
+GDL90Result GDL90NEXRADCache_setRemovalHandler(GDL90NEXRADCache *, GDL90NEXRADCacheRemovalHandler *removalHandler, void *context);
+/** Expands the run length encoded or empty blocks of a NEXRAD APDU into the tiles (fails for other products) */
+GDL90Result GDL90NEXRADCache_decode(GDL90NEXRADCache *, uint64_t timeMs, const GDL90UATAPDU *apdu);
+/** NULL if not cached */
+GDL90NEXRADTile* GDL90NEXRADCache_find(GDL90NEXRADCache *, uint16_t productId, uint8_t scale, uint8_t southern, uint32_t blockNumber);
+/** Removes the tiles not updated since staleTimeMs, returns the number removed */
+uint32_t GDL90NEXRADCache_evict(GDL90NEXRADCache *, uint64_t staleTimeMs);
+/** Iterates the dirty tiles clearing their flag, start with *cursor = 0, NULL at the end */
+GDL90NEXRADTile* GDL90NEXRADCache_nextDirty(GDL90NEXRADCache *, uint32_t *cursor);
+
+static inline uint32_t GDL90NEXRADCache_index(const GDL90NEXRADCache *self, const GDL90NEXRADTile *tile)
+{
+    return (uint32_t)(tile - self->tiles);
+}
+
+/**
+ * Unpacks DLAC (6 bit) text, 4 characters per 3 bytes, up to the end of data or an ETX.
+ * Tabs are expanded to the number of spaces they encode, records are separated by '\x1e'.
+ * Writes up to outLen - 1 characters and a NUL, returns the number of characters written.
+ */
+size_t GDL90FISB_decodeDLAC(const uint8_t *data, size_t len, char *out, size_t outLen);
+
+/** A record of a text product, all strings point into the decoded text and aren't NUL terminated */
+typedef struct GDL90FISBTextRecord
+{
+    /** Product ID of the APDU */
+    uint16_t productId;
+    /** Time of the APDU */
+    uint8_t hours;
+    uint8_t minutes;
+    /** First word of the record (eg. METAR, TAF, PIREP) */
+    const char *type;
+    uint16_t typeLength;
+    /** Second word (eg. KSEA) */
+    const char *location;
+    uint16_t locationLength;
+    /** Third word (eg. 191853Z) */
+    const char *time;
+    uint16_t timeLength;
+    /** Whole record */
+    const char *text;
+    uint16_t textLength;
+} GDL90FISBTextRecord;
+
+/** Iterator over the records of a text APDU */
+typedef struct GDL90FISBText
+{
+    const GDL90UATAPDU *apdu;
+    const char *text;
+    size_t length;
+    size_t offset;
+} GDL90FISBText;
+
+/** Decodes the DLAC text of apdu into buffer (a 424 bytes APDU fits in 566 characters plus tab expansions) */
+GDL90Result GDL90FISBText_init(GDL90FISBText *, const GDL90UATAPDU *apdu, char *buffer, size_t bufferSize);
+/** Next record, GDL90ResultFailure after the last one */
+GDL90Result GDL90FISBText_next(GDL90FISBText *, GDL90FISBTextRecord *record);
+
+typedef void (GDL90FISBTextHandler)(const GDL90FISBTextRecord *record, void *context);
+
+/** Calls a handler for each text record of the uplinks seen by a stream */
+typedef struct GDL90FISBTextStream
+{
+    GDL90FISBTextHandler *handler;
+    void *handlerContext;
+    char buffer[2048];
+    /** Segmented APDUs aren't decoded here (see GDL90FISBProductCache), they are counted */
+    uint64_t segmentedCount;
+} GDL90FISBTextStream;
+
+GDL90Result GDL90FISBTextStream_init(GDL90FISBTextStream *, GDL90FISBTextHandler *handler, void *context);
+/** Decodes the text records of a GDL90MessageType_UplinkData message */
+GDL90Result GDL90FISBTextStream_handleUplink(GDL90FISBTextStream *, const GDL90Message *gdl90Message);
+/** GDL90StreamFrameHandler, use with GDL90StreamConfig_setFrameHandler(&config, GDL90FISBTextStream_handleFrame, &textStream), or GDL90FrameHandlers_add(&handlers, GDL90FISBTextStream_handleFrame, &textStream) to share the stream */
+void GDL90FISBTextStream_handleFrame(GDL90Message *gdl90Message, void *context);
+
+/** APDU data bytes a segment holds (the largest an uplink can carry) */
+#define GDL90_FISB_SEGMENT_DATA_SIZE 424
+
+/** Arena unit of a GDL90FISBProductCache, holding one APDU */
+typedef struct GDL90FISBSegment
+{
+    /** Next segment of the product (by apduNumber) or of the free list, GDL90_FISB_NONE terminated */
+    uint32_t next;
+    uint16_t apduNumber;
+    uint16_t length;
+    uint8_t data[GDL90_FISB_SEGMENT_DATA_SIZE];
+} GDL90FISBSegment;
+
+typedef struct GDL90FISBProduct
+{
+    /** 0 if unused */
+    uint32_t key;
+    uint16_t productId;
+    /** Set for segmented products (productFileId is valid) */
+    uint8_t segmented;
+    /** Set once all segments were received */
+    uint8_t complete;
+    /** Incremented when a newer version replaces the product */
+    uint16_t version;
+    uint16_t productFileId;
+    /** Segments of the product, and how many were received */
+    uint16_t segmentCount;
+    uint16_t receivedCount;
+    /** APDU time, month << 22 | day << 17 | hours << 12 | minutes << 6 | seconds */
+    uint32_t productTime;
+    /** Hash of the data of unsegmented products */
+    uint32_t contentHash;
+    /** Total data length */
+    uint32_t length;
+    /** First segment in the arena (GDL90_FISB_NONE terminated list sorted by apduNumber) */
+    uint32_t firstSegment;
+    /** Received segments, by apduNumber */
+    uint64_t receivedSegments[8];
+    uint64_t receiveTimeMs;
+    uint64_t expiryTimeMs;
+} GDL90FISBProduct;
+
+typedef struct GDL90FISBProductCacheSlot
+{
+    /** 0 if empty */
+    uint32_t key;
+    /** Index in products */
+    uint32_t product;
+} GDL90FISBProductCacheSlot;
+
+typedef enum GDL90FISBProductEvent
+{
+    /** A product was completed for the first time */
+    GDL90FISBProductEventComplete,
+    /** A newer version (time) of a segmented product replaced a complete one */
+    GDL90FISBProductEventChanged
+} GDL90FISBProductEvent;
+
+typedef void (GDL90FISBProductHandler)(const GDL90FISBProduct *product, GDL90FISBProductEvent event, void *context);
+
+#define GDL90_FISB_PRODUCT_VALIDITY_OVERRIDES 16
+
+/**
+ * Products assembled from the APDUs of uplinks, possibly from several ground stations.
+ * Segmented products are keyed by product id and file id and reassembled, unsegmented ones are
+ * keyed by product id, time and a hash of their data, so repeated transmissions cost one hash,
+ * one lookup and one compare. A segmented product is only replaced by a later time (across
+ * midnight too). The data lives in an arena of GDL90FISBSegment (one per APDU) supplied by the
+ * caller : when it is exhausted expired products are evicted, then APDUs are dropped.
+ */
+typedef struct GDL90FISBProductCache
+{
+    GDL90FISBProductCacheSlot *slots;
+    GDL90FISBProduct *products;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t maxCount;
+    uint32_t allocCursor;
+    uint8_t hashShift;
+
+    GDL90FISBSegment *segments;
+    uint32_t segmentCapacity;
+    uint32_t freeSegment;
+    uint32_t freeSegmentCount;
+
+    /** Validity of products (ms after their first APDU was received, default 1 hour) */
+    uint64_t validityMs;
+    uint16_t validityOverrideProductIds[GDL90_FISB_PRODUCT_VALIDITY_OVERRIDES];
+    uint64_t validityOverrideMs[GDL90_FISB_PRODUCT_VALIDITY_OVERRIDES];
+    uint32_t validityOverrideCount;
+
+    GDL90FISBProductHandler *handler;
+    void *handlerContext;
+
+    /** Receive time used by GDL90FISBProductCache_handleFrame */
+    uint64_t currentTimeMs;
+
+    /** Statistics */
+    uint64_t duplicateCount;
+    /** APDUs of a segmented product older than the version held */
+    uint64_t staleCount;
+    uint64_t droppedCount;
+} GDL90FISBProductCache;
+
+/** slots and products must have capacity (a power of 2, >= 8) elements, arena (4 byte aligned) is split in GDL90FISBSegment */
+GDL90Result GDL90FISBProductCache_init(GDL90FISBProductCache *, GDL90FISBProductCacheSlot *slots, GDL90FISBProduct *products, uint32_t capacity, void *arena, size_t arenaSize);
+GDL90Result GDL90FISBProductCache_setHandler(GDL90FISBProductCache *, GDL90FISBProductHandler *handler, void *context);
+/** Validity of a product id, overriding validityMs */
+GDL90Result GDL90FISBProductCache_setValidity(GDL90FISBProductCache *, uint16_t productId, uint64_t validityMs);
+/** Adds the APDU, calling the handler if it completes or changes a product */
+GDL90Result GDL90FISBProductCache_add(GDL90FISBProductCache *, uint64_t timeMs, const GDL90UATAPDU *apdu);
+/** Adds the FIS-B APDUs of a GDL90MessageType_UplinkData message */
+GDL90Result GDL90FISBProductCache_handleUplink(GDL90FISBProductCache *, uint64_t timeMs, const GDL90Message *gdl90Message);
+/** Sets the receive time of the frames of the next GDL90Stream_process call */
+GDL90Result GDL90FISBProductCache_setTime(GDL90FISBProductCache *, uint64_t timeMs);
+/** GDL90StreamFrameHandler, use with GDL90StreamConfig_setFrameHandler(&config, GDL90FISBProductCache_handleFrame, &cache), or GDL90FrameHandlers_add(&handlers, GDL90FISBProductCache_handleFrame, &cache) to share the stream */
+void GDL90FISBProductCache_handleFrame(GDL90Message *gdl90Message, void *context);
+/** Removes the products expired at timeMs, returns the number removed */
+uint32_t GDL90FISBProductCache_evict(GDL90FISBProductCache *, uint64_t timeMs);
+/** Iterates the segments of a product in order, start with *cursor = product->firstSegment, NULL at the end */
+const GDL90FISBSegment* GDL90FISBProductCache_nextSegment(const GDL90FISBProductCache *, uint32_t *cursor);
+/** Copies the data of a product, returns its length (0 if it doesn't fit) */
+size_t GDL90FISBProductCache_copy(const GDL90FISBProductCache *, const GDL90FISBProduct *product, uint8_t *out, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_fisb_h__) */
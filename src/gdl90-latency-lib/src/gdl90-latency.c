@@ -0,0 +1,319 @@
+//
+//  gdl90-latency.c
+//  gdl90-latency-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "gdl90-latency.h"
+
+#include <string.h>
+
+#define GDL90_LATENCY_NS_PER_S 1000000000ull
+#define GDL90_LATENCY_NS_PER_DAY (86400ull * GDL90_LATENCY_NS_PER_S)
+#define GDL90_LATENCY_TOR_INVALID 0xffffff
+
+static inline uint32_t GDL90LatencyHistogram_index(uint64_t ns)
+{
+    const uint64_t subBuckets = 1u << GDL90_LATENCY_SUB_BUCKET_BITS;
+    if (ns < subBuckets) { return (uint32_t)ns; }
+    if (ns >> GDL90_LATENCY_MAX_BITS) { return GDL90_LATENCY_BUCKETS - 1; }
+
+    uint32_t exponent = GDL90_LATENCY_MAX_BITS - 1;
+    while (!(ns >> exponent)) { exponent--; }
+    uint32_t sub = (uint32_t)(ns >> (exponent - GDL90_LATENCY_SUB_BUCKET_BITS)) & (uint32_t)(subBuckets - 1);
+    return (exponent - GDL90_LATENCY_SUB_BUCKET_BITS + 1) << GDL90_LATENCY_SUB_BUCKET_BITS | sub;
+}
+
+/** Largest value of the bucket */
+static inline uint64_t GDL90LatencyHistogram_value(uint32_t index)
+{
+    const uint32_t subBuckets = 1u << GDL90_LATENCY_SUB_BUCKET_BITS;
+    if (index < subBuckets) { return index; }
+
+    uint32_t exponent = (index >> GDL90_LATENCY_SUB_BUCKET_BITS) + GDL90_LATENCY_SUB_BUCKET_BITS - 1;
+    uint64_t sub = index & (subBuckets - 1);
+    return ((subBuckets + sub + 1) << (exponent - GDL90_LATENCY_SUB_BUCKET_BITS)) - 1;
+}
+
+GDL90Result GDL90LatencyHistogram_reset(GDL90LatencyHistogram *self)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->min = UINT64_MAX;
+
+    return GDL90ResultOK;
+}
+
+void GDL90LatencyHistogram_record(GDL90LatencyHistogram *self, uint64_t ns)
+{
+    self->counts[GDL90LatencyHistogram_index(ns)]++;
+    self->count++;
+    self->sum += ns;
+    self->min = ns < self->min ? ns : self->min;
+    self->max = ns > self->max ? ns : self->max;
+}
+
+GDL90Result GDL90LatencyHistogram_merge(GDL90LatencyHistogram *self, const GDL90LatencyHistogram *other)
+{
+    if (!self || !other) { return GDL90ResultFailure; }
+
+    for (uint32_t i = 0; i < GDL90_LATENCY_BUCKETS; i++)
+    {
+        self->counts[i] += other->counts[i];
+    }
+    self->count += other->count;
+    self->sum += other->sum;
+    self->min = other->min < self->min ? other->min : self->min;
+    self->max = other->max > self->max ? other->max : self->max;
+
+    return GDL90ResultOK;
+}
+
+uint64_t GDL90LatencyHistogram_percentile(const GDL90LatencyHistogram *self, double percentile)
+{
+    if (!self || self->count == 0) { return 0; }
+
+    uint64_t rank = (uint64_t)((double)self->count * percentile / 100.0);
+    rank = rank >= self->count ? self->count - 1 : rank;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < GDL90_LATENCY_BUCKETS; i++)
+    {
+        seen += self->counts[i];
+        if (seen > rank)
+        {
+            // the bucket's bound, but never past the largest value seen
+            uint64_t value = GDL90LatencyHistogram_value(i);
+            return value > self->max ? self->max : value;
+        }
+    }
+
+    return self->max;
+}
+
+static size_t GDL90Latency_appendU64(char *out, size_t len, size_t at, const char *key, uint64_t v)
+{
+    char digits[20];
+    size_t n = 0;
+    do
+    {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+
+    size_t keyLength = strlen(key);
+    if (at + keyLength + n < len)
+    {
+        memcpy(out + at, key, keyLength);
+        for (size_t i = 0; i < n; i++)
+        {
+            out[at + keyLength + i] = digits[n - 1 - i];
+        }
+    }
+    return at + keyLength + n;
+}
+
+size_t GDL90LatencyHistogram_toJSON(const GDL90LatencyHistogram *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    size_t at = 0;
+    at = GDL90Latency_appendU64(out, len, at, "{\"count\":", self->count);
+    at = GDL90Latency_appendU64(out, len, at, ",\"min\":", self->count ? self->min : 0);
+    at = GDL90Latency_appendU64(out, len, at, ",\"max\":", self->max);
+    at = GDL90Latency_appendU64(out, len, at, ",\"mean\":", self->count ? self->sum / self->count : 0);
+    at = GDL90Latency_appendU64(out, len, at, ",\"p50\":", GDL90LatencyHistogram_percentile(self, 50.0));
+    at = GDL90Latency_appendU64(out, len, at, ",\"p90\":", GDL90LatencyHistogram_percentile(self, 90.0));
+    at = GDL90Latency_appendU64(out, len, at, ",\"p99\":", GDL90LatencyHistogram_percentile(self, 99.0));
+    at = GDL90Latency_appendU64(out, len, at, ",\"p999\":", GDL90LatencyHistogram_percentile(self, 99.9));
+    if (at + 2 > len)
+    {
+        if (len) { out[0] = '\0'; }
+        return 0;
+    }
+    out[at++] = '}';
+    out[at] = '\0';
+
+    return at;
+}
+
+GDL90LatencyType GDL90LatencyType_fromMessageId(uint8_t id)
+{
+    switch (id)
+    {
+        case GDL90MessageType_Heartbeat: return GDL90LatencyTypeHeartbeat;
+        case GDL90MessageType_UplinkData: return GDL90LatencyTypeUplinkData;
+        case GDL90MessageType_OwnshipReport: return GDL90LatencyTypeOwnshipReport;
+        case GDL90MessageType_OwnshipGeometricAltitude: return GDL90LatencyTypeOwnshipGeometricAltitude;
+        case GDL90MessageType_TrafficReport: return GDL90LatencyTypeTrafficReport;
+        case GDL90MessageType_BasicReport: return GDL90LatencyTypeBasicReport;
+        case GDL90MessageType_LongReport: return GDL90LatencyTypeLongReport;
+        default: return GDL90LatencyTypeOther;
+    }
+}
+
+char* GDL90LatencyType_toString(GDL90LatencyType type)
+{
+    switch (type)
+    {
+        case GDL90LatencyTypeHeartbeat: return "Heartbeat";
+        case GDL90LatencyTypeUplinkData: return "UplinkData";
+        case GDL90LatencyTypeOwnshipReport: return "OwnshipReport";
+        case GDL90LatencyTypeOwnshipGeometricAltitude: return "OwnshipGeometricAltitude";
+        case GDL90LatencyTypeTrafficReport: return "TrafficReport";
+        case GDL90LatencyTypeBasicReport: return "BasicReport";
+        case GDL90LatencyTypeLongReport: return "LongReport";
+        default: return "Other";
+    }
+}
+
+GDL90Result GDL90LatencyMonitor_init(GDL90LatencyMonitor *self, GDL90LatencySource *sources, uint16_t sourceCount)
+{
+    if (!self || !sources || sourceCount == 0) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->sources = sources;
+    self->sourceCount = sourceCount;
+
+    return GDL90LatencyMonitor_reset(self);
+}
+
+GDL90Result GDL90LatencyMonitor_reset(GDL90LatencyMonitor *self)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    for (uint16_t i = 0; i < self->sourceCount; i++)
+    {
+        GDL90LatencySource *source = &self->sources[i];
+        source->heartbeatTimeNs = 0;
+        for (int type = 0; type < GDL90LatencyTypeCount; type++)
+        {
+            GDL90LatencyHistogram_reset(&source->deviceToHost[type]);
+            GDL90LatencyHistogram_reset(&source->hostToCallback[type]);
+        }
+    }
+    self->unknownSourceCount = 0;
+    self->negativeCount = 0;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90LatencyMonitor_setReceiveInfo(GDL90LatencyMonitor *self, uint64_t timeNs, uint64_t utcNs, uint16_t sourceId)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->currentTimeNs = timeNs;
+    self->currentUTCNs = utcNs;
+    self->currentSourceId = sourceId;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90LatencyMonitor_recordFrame(GDL90LatencyMonitor *self, const GDL90Message *gdl90Message)
+{
+    if (!self || !gdl90Message || gdl90Message->dataLength < 5) { return GDL90ResultFailure; }
+    if (self->currentSourceId >= self->sourceCount)
+    {
+        self->unknownSourceCount++;
+        return GDL90ResultFailure;
+    }
+
+    GDL90LatencySource *source = &self->sources[self->currentSourceId];
+    const uint8_t *data = gdl90Message->data;
+    GDL90LatencyType type = GDL90LatencyType_fromMessageId(data[0]);
+    int64_t latency = 0;
+
+    if (type == GDL90LatencyTypeHeartbeat)
+    {
+        // 3.1.2 UTC OK, or the time stamp isn't UTC
+        if (!(data[2] & (1<<GDL90HeartbeatStatusByte2BitUTCOK))) { return GDL90ResultOK; }
+        source->heartbeatTimeNs = self->currentTimeNs;
+        if (!self->currentUTCNs) { return GDL90ResultOK; }
+
+        uint64_t timestamp = ((uint64_t)(data[2] >> 7) << 16) | ((uint64_t)data[4] << 8) | data[3];
+        latency = (int64_t)(self->currentUTCNs % GDL90_LATENCY_NS_PER_DAY) - (int64_t)(timestamp * GDL90_LATENCY_NS_PER_S);
+        // around midnight
+        if (latency < -(int64_t)(GDL90_LATENCY_NS_PER_DAY / 2)) { latency += (int64_t)GDL90_LATENCY_NS_PER_DAY; }
+        else if (latency > (int64_t)(GDL90_LATENCY_NS_PER_DAY / 2)) { latency -= (int64_t)GDL90_LATENCY_NS_PER_DAY; }
+    }
+    else if (type == GDL90LatencyTypeUplinkData || type == GDL90LatencyTypeBasicReport || type == GDL90LatencyTypeLongReport)
+    {
+        uint32_t tor = (uint32_t)data[3] << 16 | (uint32_t)data[2] << 8 | data[1];
+        if (tor == GDL90_LATENCY_TOR_INVALID) { return GDL90ResultOK; }
+
+        int64_t torNs = (int64_t)tor * 80;
+        if (self->currentUTCNs)
+        {
+            latency = (int64_t)(self->currentUTCNs % GDL90_LATENCY_NS_PER_S) - torNs;
+        }
+        else if (source->heartbeatTimeNs)
+        {
+            // relative to the Heartbeat of the second the frame was received in
+            latency = (int64_t)((self->currentTimeNs - source->heartbeatTimeNs) % GDL90_LATENCY_NS_PER_S) - torNs;
+        }
+        else
+        {
+            return GDL90ResultOK;
+        }
+        // received in the next second
+        latency += latency < 0 ? (int64_t)GDL90_LATENCY_NS_PER_S : 0;
+    }
+    else
+    {
+        return GDL90ResultOK;
+    }
+
+    if (latency < 0)
+    {
+        self->negativeCount++;
+        return GDL90ResultOK;
+    }
+    GDL90LatencyHistogram_record(&source->deviceToHost[type], (uint64_t)latency);
+
+    return GDL90ResultOK;
+}
+
+void GDL90LatencyMonitor_handleFrame(GDL90Message *gdl90Message, void *context)
+{
+    (void)GDL90LatencyMonitor_recordFrame((GDL90LatencyMonitor *)context, gdl90Message);
+}
+
+GDL90Result GDL90LatencyMonitor_recordCallback(GDL90LatencyMonitor *self, uint16_t sourceId, uint8_t messageId, uint64_t receiveTimeNs, uint64_t callbackTimeNs)
+{
+    if (!self) { return GDL90ResultFailure; }
+    if (sourceId >= self->sourceCount)
+    {
+        self->unknownSourceCount++;
+        return GDL90ResultFailure;
+    }
+
+    uint64_t latency = callbackTimeNs > receiveTimeNs ? callbackTimeNs - receiveTimeNs : 0;
+    GDL90LatencyHistogram_record(&self->sources[sourceId].hostToCallback[GDL90LatencyType_fromMessageId(messageId)], latency);
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90LatencyMonitor_recordCurrentCallback(GDL90LatencyMonitor *self, uint8_t messageId, uint64_t callbackTimeNs)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    return GDL90LatencyMonitor_recordCallback(self, self->currentSourceId, messageId, self->currentTimeNs, callbackTimeNs);
+}
@@ -0,0 +1,138 @@
+//
+//  gdl90-latency.h
+//  gdl90-latency-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Latency accounting of received frames.
+//
+// Device to host : host receive time minus the device time of the frame.
+//   Uplink, Basic and Long Reports carry a Time of Reception (80 ns units since the UTC second)
+//   and Heartbeats mark the UTC second (seconds since midnight). With the host UTC time (eg. NTP
+//   or GPS disciplined) both are absolute. Without it, TOR latencies are measured from the
+//   receive time of the source's last Heartbeat, ie. relative to the latency of the Heartbeat.
+// Host to callback : time from the receive time of a frame to its delivery to a consumer.
+//
+// Both are kept per source and message type in HDR style (log-linear) histograms : each power
+// of 2 of ns is split in 2^GDL90_LATENCY_SUB_BUCKET_BITS buckets, ie. a ~6% relative precision
+// from 16 ns to ~68 s in fixed storage, with no allocation when recording.
+
+#ifndef __gdl90__gdl90_latency_h__
+#define __gdl90__gdl90_latency_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GDL90_LATENCY_SUB_BUCKET_BITS 4
+/** Values from 2^GDL90_LATENCY_MAX_BITS ns up are counted in the last bucket */
+#define GDL90_LATENCY_MAX_BITS 36
+#define GDL90_LATENCY_BUCKETS ((GDL90_LATENCY_MAX_BITS - GDL90_LATENCY_SUB_BUCKET_BITS + 1) << GDL90_LATENCY_SUB_BUCKET_BITS)
+
+typedef struct GDL90LatencyHistogram
+{
+    uint64_t count;
+    /** ns */
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint32_t counts[GDL90_LATENCY_BUCKETS];
+} GDL90LatencyHistogram;
+
+GDL90Result GDL90LatencyHistogram_reset(GDL90LatencyHistogram *);
+void GDL90LatencyHistogram_record(GDL90LatencyHistogram *, uint64_t ns);
+/** Adds the counts of other */
+GDL90Result GDL90LatencyHistogram_merge(GDL90LatencyHistogram *, const GDL90LatencyHistogram *other);
+/** Upper bound (ns) of the bucket holding the percentile (0-100), 0 if empty */
+uint64_t GDL90LatencyHistogram_percentile(const GDL90LatencyHistogram *, double percentile);
+/** JSON object (count, min, max, mean, p50, p90, p99, p999), returns the length written (0 if it didn't fit in len incl. terminator) */
+size_t GDL90LatencyHistogram_toJSON(const GDL90LatencyHistogram *, char *out, size_t len);
+
+/** Message types histograms are kept for */
+typedef enum GDL90LatencyType
+{
+    GDL90LatencyTypeHeartbeat,
+    GDL90LatencyTypeUplinkData,
+    GDL90LatencyTypeOwnshipReport,
+    GDL90LatencyTypeOwnshipGeometricAltitude,
+    GDL90LatencyTypeTrafficReport,
+    GDL90LatencyTypeBasicReport,
+    GDL90LatencyTypeLongReport,
+    GDL90LatencyTypeOther,
+    GDL90LatencyTypeCount
+} GDL90LatencyType;
+
+GDL90LatencyType GDL90LatencyType_fromMessageId(uint8_t id);
+char* GDL90LatencyType_toString(GDL90LatencyType type);
+
+typedef struct GDL90LatencySource
+{
+    /** Monotonic receive time (ns) of the last Heartbeat with UTC OK, 0 if none */
+    uint64_t heartbeatTimeNs;
+    /** Only Heartbeat, UplinkData, BasicReport and LongReport are filled */
+    GDL90LatencyHistogram deviceToHost[GDL90LatencyTypeCount];
+    GDL90LatencyHistogram hostToCallback[GDL90LatencyTypeCount];
+} GDL90LatencySource;
+
+typedef struct GDL90LatencyMonitor
+{
+    /** sources[sourceCount], indexed by source id */
+    GDL90LatencySource *sources;
+    uint16_t sourceCount;
+
+    /** Receive info of the frames of the current GDL90Stream_process call */
+    uint64_t currentTimeNs;
+    uint64_t currentUTCNs;
+    uint16_t currentSourceId;
+
+    /** Frames of sources >= sourceCount */
+    uint64_t unknownSourceCount;
+    /** Frames whose device time is after the host UTC time (clock skew) */
+    uint64_t negativeCount;
+} GDL90LatencyMonitor;
+
+GDL90Result GDL90LatencyMonitor_init(GDL90LatencyMonitor *, GDL90LatencySource *sources, uint16_t sourceCount);
+/** Clears all the histograms */
+GDL90Result GDL90LatencyMonitor_reset(GDL90LatencyMonitor *);
+/**
+ * Sets the receive info of the frames of the next GDL90Stream_process call : host monotonic
+ * time (ns), host UTC time (ns since the epoch, 0 if the host clock isn't synchronized) and source
+ */
+GDL90Result GDL90LatencyMonitor_setReceiveInfo(GDL90LatencyMonitor *, uint64_t timeNs, uint64_t utcNs, uint16_t sourceId);
+/** Records the device to host latency of a frame received with the current receive info */
+GDL90Result GDL90LatencyMonitor_recordFrame(GDL90LatencyMonitor *, const GDL90Message *gdl90Message);
+/** GDL90StreamFrameHandler, use with GDL90StreamConfig_setFrameHandler(&config, GDL90LatencyMonitor_handleFrame, &monitor), or GDL90FrameHandlers_add(&handlers, GDL90LatencyMonitor_handleFrame, &monitor) to share the stream */
+void GDL90LatencyMonitor_handleFrame(GDL90Message *gdl90Message, void *context);
+/** Records the host to callback latency of a message delivered at callbackTimeNs (monotonic) */
+GDL90Result GDL90LatencyMonitor_recordCallback(GDL90LatencyMonitor *, uint16_t sourceId, uint8_t messageId, uint64_t receiveTimeNs, uint64_t callbackTimeNs);
+/** GDL90LatencyMonitor_recordCallback for the frame being processed (from a GDL90StreamMessageHandler) */
+GDL90Result GDL90LatencyMonitor_recordCurrentCallback(GDL90LatencyMonitor *, uint8_t messageId, uint64_t callbackTimeNs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_latency_h__) */
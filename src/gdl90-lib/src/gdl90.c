@@ -27,9 +27,31 @@
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
 static const uint8_t GDL90_FLAGBYTE = 0x7E;
 static const uint8_t GDL90_ESCAPEBYTE = 0x7D;
 
+/** Offset of the first flag byte of data[from, len), len if none */
+static inline size_t GDL90_nextFlag(const uint8_t *data, size_t from, size_t len)
+{
+#if defined(__wasm_simd128__)
+    const v128_t flag = wasm_i8x16_splat((int8_t)GDL90_FLAGBYTE);
+    for (; from + 16 <= len; from += 16)
+    {
+        uint32_t mask = wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_load(&data[from]), flag));
+        if (mask) { return from + (size_t)__builtin_ctz(mask); }
+    }
+#endif
+    for (; from < len; from++)
+    {
+        if (data[from] == GDL90_FLAGBYTE) { return from; }
+    }
+    return len;
+}
+
 static inline uint32_t msbu24u32(uint8_t b0, uint8_t b1, uint8_t b2)
 {
     return ((uint32_t)b0 << 16) | ((uint32_t)b1 << 8) | (uint32_t)b2;
@@ -77,12 +99,209 @@ static inline int32_t msbi16i32(uint8_t b0, uint8_t b1)
     return (int32_t)ret;
 }
 
+static inline void u32msb24(uint32_t v, uint8_t *out)
+{
+    out[0] = (uint8_t)(v >> 16);
+    out[1] = (uint8_t)(v >> 8);
+    out[2] = (uint8_t)v;
+}
+
+static inline int32_t roundi32(double v)
+{
+    return (int32_t)(v < 0.0 ? v - 0.5 : v + 0.5);
+}
+
+/** 3.3.1. TOR is LS byte first, in 80 ns units */
+static inline void torlsb24(uint32_t timeOfReception, uint8_t hasValidTor, uint8_t *out)
+{
+    uint32_t tor = hasValidTor ? (timeOfReception / 80) & 0xffffff : 0xffffff;
+    out[0] = (uint8_t)tor;
+    out[1] = (uint8_t)(tor >> 8);
+    out[2] = (uint8_t)(tor >> 16);
+}
+
+/** Minimal JSON writer (no stdio/locale), tracks the would-be length on overflow */
+typedef struct GDL90JSONWriter
+{
+    char *out;
+    size_t len;
+    size_t pos;
+} GDL90JSONWriter;
+
+static const char GDL90_DIGITPAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char GDL90_HEXDIGITS[] = "0123456789abcdef";
+
+#define GDL90JSONWriter_literal(W,S) GDL90JSONWriter_raw((W), (S), sizeof(S)-1)
+
+static inline void GDL90JSONWriter_raw(GDL90JSONWriter *w, const char *s, size_t n)
+{
+    if (w->pos + n < w->len)
+    {
+        memcpy(w->out + w->pos, s, n);
+    }
+    w->pos += n;
+}
+
+static inline void GDL90JSONWriter_u64(GDL90JSONWriter *w, uint64_t v)
+{
+    char buf[20];
+    char *p = buf + sizeof(buf);
+    while (v >= 100)
+    {
+        size_t i = (size_t)(v % 100) * 2;
+        v /= 100;
+        p -= 2;
+        p[0] = GDL90_DIGITPAIRS[i];
+        p[1] = GDL90_DIGITPAIRS[i+1];
+    }
+    if (v >= 10)
+    {
+        p -= 2;
+        p[0] = GDL90_DIGITPAIRS[v*2];
+        p[1] = GDL90_DIGITPAIRS[v*2+1];
+    }
+    else
+    {
+        *--p = (char)('0' + v);
+    }
+    GDL90JSONWriter_raw(w, p, (size_t)(buf + sizeof(buf) - p));
+}
+
+static inline void GDL90JSONWriter_i64(GDL90JSONWriter *w, int64_t v)
+{
+    if (v < 0)
+    {
+        GDL90JSONWriter_literal(w, "-");
+        GDL90JSONWriter_u64(w, 0 - (uint64_t)v);
+    }
+    else
+    {
+        GDL90JSONWriter_u64(w, (uint64_t)v);
+    }
+}
+
+/** Fixed precision (decimals <= 9), rounded half away from zero */
+static inline void GDL90JSONWriter_fixed(GDL90JSONWriter *w, double v, unsigned decimals)
+{
+    static const uint64_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+    if (v != v || v > 1e9 || v < -1e9)
+    {
+        GDL90JSONWriter_literal(w, "null");
+        return;
+    }
+
+    uint64_t scaled = (uint64_t)((v < 0 ? -v : v) * (double)pow10[decimals] + 0.5);
+    if (v < 0 && scaled != 0)
+    {
+        GDL90JSONWriter_literal(w, "-");
+    }
+    GDL90JSONWriter_u64(w, scaled / pow10[decimals]);
+    if (decimals == 0) { return; }
+
+    char buf[10];
+    uint64_t frac = scaled % pow10[decimals];
+    buf[0] = '.';
+    for (unsigned i = decimals; i > 0; i--)
+    {
+        buf[i] = (char)('0' + frac % 10);
+        frac /= 10;
+    }
+    GDL90JSONWriter_raw(w, buf, decimals + 1);
+}
+
+static inline void GDL90JSONWriter_bool(GDL90JSONWriter *w, uint8_t v)
+{
+    if (v) { GDL90JSONWriter_literal(w, "true"); } else { GDL90JSONWriter_literal(w, "false"); }
+}
+
+static inline void GDL90JSONWriter_string(GDL90JSONWriter *w, const char *s, size_t maxLen)
+{
+    GDL90JSONWriter_literal(w, "\"");
+    for (size_t i = 0; i < maxLen && s[i] != 0; i++)
+    {
+        uint8_t c = (uint8_t)s[i];
+        if (c == '"' || c == '\\')
+        {
+            char esc[2] = { '\\', (char)c };
+            GDL90JSONWriter_raw(w, esc, 2);
+        }
+        else if (c < 0x20 || c >= 0x7f)
+        {
+            char esc[6] = { '\\', 'u', '0', '0', GDL90_HEXDIGITS[c >> 4], GDL90_HEXDIGITS[c & 0x0f] };
+            GDL90JSONWriter_raw(w, esc, 6);
+        }
+        else
+        {
+            GDL90JSONWriter_raw(w, (const char *)&s[i], 1);
+        }
+    }
+    GDL90JSONWriter_literal(w, "\"");
+}
+
+static inline void GDL90JSONWriter_hex(GDL90JSONWriter *w, const uint8_t *data, size_t len)
+{
+    GDL90JSONWriter_literal(w, "\"");
+    for (size_t i = 0; i < len; i++)
+    {
+        char hex[2] = { GDL90_HEXDIGITS[data[i] >> 4], GDL90_HEXDIGITS[data[i] & 0x0f] };
+        GDL90JSONWriter_raw(w, hex, 2);
+    }
+    GDL90JSONWriter_literal(w, "\"");
+}
+
+/** Terminates the output, returns the length written or 0 if it didn't fit */
+static inline size_t GDL90JSONWriter_finish(GDL90JSONWriter *w)
+{
+    if (w->pos >= w->len)
+    {
+        if (w->len > 0) { w->out[0] = 0; }
+        return 0;
+    }
+    w->out[w->pos] = 0;
+    return w->pos;
+}
+
 GDL90Result GDL90Message_init(GDL90Message *self, const uint8_t *data, const uint16_t dataLength)
 {
     if (!self || !data || dataLength < 3) { return GDL90ResultFailure; }
 
+    uint16_t j = 1;
+#if defined(__wasm_simd128__)
+    // copy 16 bytes at a time up to the next escape byte
+    const v128_t escape = wasm_i8x16_splat((int8_t)GDL90_ESCAPEBYTE);
+    while (j + 16 <= dataLength - 1 && (size_t)self->dataLength + 16 <= sizeof(self->data))
+    {
+        v128_t v = wasm_v128_load(&data[j]);
+        uint32_t mask = wasm_i8x16_bitmask(wasm_i8x16_eq(v, escape));
+        wasm_v128_store(&self->data[self->dataLength], v);
+        if (!mask)
+        {
+            j += 16;
+            self->dataLength += 16;
+            continue;
+        }
+        uint16_t n = (uint16_t)__builtin_ctz(mask);
+        self->dataLength += n;
+        j += n;
+        self->data[self->dataLength++] = data[j + 1] ^ 0x20;
+        j += 2;
+    }
+#endif
+
     // unescape gdl90 message
-    for (uint16_t j = 1; j < dataLength-1; j++)
+    for (; j < dataLength-1; j++)
     {
         uint8_t b = data[j] == GDL90_ESCAPEBYTE ? data[++j] ^ 0x20 : data[j];
         self->data[self->dataLength++] = b;
@@ -109,6 +328,22 @@ GDL90Result GDL90Heartbeat_init(GDL90Heartbeat *self, GDL90Message *gdl90Message
     return GDL90ResultOK;
 }
 
+uint8_t* GDL90Heartbeat_toBytes(GDL90Heartbeat *self, uint8_t out[7])
+{
+    if (!self) { return out; }
+
+    out[0] = self->id;
+    out[1] = self->status1;
+    // bit 7 of Status Byte 2 is the MS bit of the time stamp
+    out[2] = (uint8_t)((self->status2 & 0x7f) | ((self->timestamp >> 16) & 0x01) << 7);
+    out[3] = (uint8_t)self->timestamp;
+    out[4] = (uint8_t)(self->timestamp >> 8);
+    out[5] = (uint8_t)((self->uplinkMessageCount & 0x1f) << 3 | ((self->basicLongMessageCount >> 8) & 0x03));
+    out[6] = (uint8_t)self->basicLongMessageCount;
+
+    return out;
+}
+
 char* GDL90Heartbeat_toString(GDL90Heartbeat *self, char *out, size_t len)
 {
     if (!self || !out) { return out; }
@@ -149,6 +384,28 @@ char* GDL90Heartbeat_toString(GDL90Heartbeat *self, char *out, size_t len)
     return out;
 }
 
+size_t GDL90Heartbeat_toJSON(GDL90Heartbeat *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"status1\":");
+    GDL90JSONWriter_u64(&w, self->status1);
+    GDL90JSONWriter_literal(&w, ",\"status2\":");
+    GDL90JSONWriter_u64(&w, self->status2);
+    GDL90JSONWriter_literal(&w, ",\"timestamp\":");
+    GDL90JSONWriter_u64(&w, self->timestamp);
+    GDL90JSONWriter_literal(&w, ",\"uplinkMessageCount\":");
+    GDL90JSONWriter_u64(&w, self->uplinkMessageCount);
+    GDL90JSONWriter_literal(&w, ",\"basicLongMessageCount\":");
+    GDL90JSONWriter_u64(&w, self->basicLongMessageCount);
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 GDL90Result GDL90Initialization_init(GDL90Initialization *self, GDL90Message *gdl90Message)
 {
     if (!self || !gdl90Message || gdl90Message->dataLength < 3) { return GDL90ResultFailure; }
@@ -197,6 +454,22 @@ char* GDL90Initialization_toString(GDL90Initialization *self, char *out, size_t
     return out;
 }
 
+size_t GDL90Initialization_toJSON(GDL90Initialization *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"configuration1\":");
+    GDL90JSONWriter_u64(&w, self->configuration1);
+    GDL90JSONWriter_literal(&w, ",\"configuration2\":");
+    GDL90JSONWriter_u64(&w, self->configuration2);
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 GDL90Result GDL90UplinkData_init(GDL90UplinkData *self, GDL90Message *gdl90Message)
 {
     if (!self || !gdl90Message || gdl90Message->dataLength < 436) { return GDL90ResultFailure; }
@@ -222,6 +495,17 @@ GDL90Result GDL90UplinkData_init(GDL90UplinkData *self, GDL90Message *gdl90Messa
     return GDL90ResultOK;
 }
 
+uint8_t* GDL90UplinkData_toBytes(GDL90UplinkData *self, uint8_t out[436])
+{
+    if (!self) { return out; }
+
+    out[0] = self->id;
+    torlsb24(self->timeOfReception, self->hasValidTor, out+1);
+    memcpy(out+4, self->payload, sizeof(self->payload));
+
+    return out;
+}
+
 char* GDL90UplinkData_toString(GDL90UplinkData *self, char *out, size_t len)
 {
     if (!self || !out) { return out; }
@@ -239,6 +523,24 @@ char* GDL90UplinkData_toString(GDL90UplinkData *self, char *out, size_t len)
     return out;
 }
 
+size_t GDL90UplinkData_toJSON(GDL90UplinkData *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"timeOfReception\":");
+    GDL90JSONWriter_u64(&w, self->timeOfReception);
+    GDL90JSONWriter_literal(&w, ",\"hasValidTor\":");
+    GDL90JSONWriter_bool(&w, self->hasValidTor);
+    GDL90JSONWriter_literal(&w, ",\"payload\":");
+    GDL90JSONWriter_hex(&w, self->payload, sizeof(self->payload));
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 GDL90Result GDL90HeightAboveTerrain_init(GDL90HeightAboveTerrain *self, GDL90Message *gdl90Message)
 {
     if (!self || !gdl90Message || gdl90Message->dataLength < 3) { return GDL90ResultFailure; }
@@ -278,6 +580,20 @@ char* GDL90HeightAboveTerrain_toString(GDL90HeightAboveTerrain *self, char *out,
     return out;
 }
 
+size_t GDL90HeightAboveTerrain_toJSON(GDL90HeightAboveTerrain *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"heightAboveTerrain\":");
+    GDL90JSONWriter_i64(&w, self->heightAboveTerrain);
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 GDL90Result GDL90OwnshipGeometricAltitude_init(GDL90OwnshipGeometricAltitude *self, GDL90Message *gdl90Message)
 {
     if (!self || !gdl90Message || gdl90Message->dataLength < 5) { return GDL90ResultFailure; }
@@ -301,6 +617,22 @@ GDL90Result GDL90OwnshipGeometricAltitude_init(GDL90OwnshipGeometricAltitude *se
     return GDL90ResultOK;
 }
 
+uint8_t* GDL90OwnshipGeometricAltitude_toBytes(GDL90OwnshipGeometricAltitude *self, uint8_t out[5])
+{
+    if (!self) { return out; }
+
+    int32_t geoAltitude = self->geoAltitude / 5;
+    uint16_t vfom = self->hasValidVFOM ? (self->verticalFigureOfMerit & 0x7fff) : 0x7fff;
+
+    out[0] = self->id;
+    out[1] = (uint8_t)((uint32_t)geoAltitude >> 8);
+    out[2] = (uint8_t)geoAltitude;
+    out[3] = (uint8_t)((self->verticalWarning ? 0x80 : 0x00) | (vfom >> 8));
+    out[4] = (uint8_t)vfom;
+
+    return out;
+}
+
 char* GDL90OwnshipGeometricAltitude_toString(GDL90OwnshipGeometricAltitude *self, char *out, size_t len)
 {
     if (!self || !out) { return out; }
@@ -323,6 +655,26 @@ char* GDL90OwnshipGeometricAltitude_toString(GDL90OwnshipGeometricAltitude *self
     return out;
 }
 
+size_t GDL90OwnshipGeometricAltitude_toJSON(GDL90OwnshipGeometricAltitude *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"geoAltitude\":");
+    GDL90JSONWriter_i64(&w, self->geoAltitude);
+    GDL90JSONWriter_literal(&w, ",\"verticalWarning\":");
+    GDL90JSONWriter_bool(&w, self->verticalWarning);
+    GDL90JSONWriter_literal(&w, ",\"verticalFigureOfMerit\":");
+    GDL90JSONWriter_u64(&w, self->verticalFigureOfMerit);
+    GDL90JSONWriter_literal(&w, ",\"hasValidVFOM\":");
+    GDL90JSONWriter_bool(&w, self->hasValidVFOM);
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 char* GDL90TrafficReportAlertStatusType_toString(GDL90TrafficReportAlertStatusType alertStatus)
 {
     switch (alertStatus)
@@ -566,15 +918,15 @@ GDL90Result GDL90TrafficReport_init(GDL90TrafficReport *self, GDL90Message *gdl9
 
     self->navigationIntegrityCategory = data[13] >> 4;
     self->navigationAccuracyCategoryForPosition = data[13] & 0x0f;
-    if (data[14] == 0xff && (data[15] & 0xf0) == 0x00)
+    if (data[14] == 0xff && (data[15] & 0xf0) == 0xf0)
     {
         self->horizontalVelocity = 0;
-        self->hasValidAltitude = 0;
+        self->hasValidHorizontalVelocity = 0;
     }
     else
     {
         self->horizontalVelocity = (uint32_t)msbu12u16(data[14], data[15], 1);
-        self->hasValidAltitude = 1;
+        self->hasValidHorizontalVelocity = 1;
     }
     if ((data[15] & 0x0f) == 0x08 && data[16] == 0x00)
     {
@@ -600,16 +952,53 @@ GDL90Result GDL90TrafficReport_init(GDL90TrafficReport *self, GDL90Message *gdl9
     self->emergencyPriorityCode = data[27] >> 4;
     self->spare = data[27] & 0x0f;
 
-    if (
+    // 3.5.1.3 : lat, lon and NIC all zero means no valid position
+    self->hasValidPosition = (
         msbi24i32(data[5], data[6], data[7]) != 0
-        || msbi24i32(data[8], data[9], data[10]) == 0
-        || self->navigationIntegrityCategory == GDL90TrafficReportEmitterCategoryNoAircraftTypeInformation
-    )
+        || msbi24i32(data[8], data[9], data[10]) != 0
+        || self->navigationIntegrityCategory != GDL90TrafficReportNICTypeUnknown
+    );
+
+    return GDL90ResultOK;
+}
+
+uint8_t* GDL90TrafficReport_toBytes(GDL90TrafficReport *self, uint8_t out[28])
+{
+    if (!self) { return out; }
+
+    static const double latlonRes = 180.0 / (double)(1<<23);
+
+    out[0] = self->id;
+    out[1] = (uint8_t)((self->alertStatus & 0x0f) << 4 | (self->addressType & 0x0f));
+    u32msb24(self->participantAddress, out+2);
+
+    // 3.5.1.3 : lat, lon and NIC all zero means no valid position
+    uint8_t nic = self->hasValidPosition ? self->navigationIntegrityCategory : GDL90TrafficReportNICTypeUnknown;
+    u32msb24(self->hasValidPosition ? (uint32_t)roundi32(self->latitude / latlonRes) : 0, out+5);
+    u32msb24(self->hasValidPosition ? (uint32_t)roundi32(self->longitude / latlonRes) : 0, out+8);
+
+    uint16_t altitude = self->hasValidAltitude ? (uint16_t)(((self->altitude + 1000) / 25) & 0xfff) : 0xfff;
+    uint8_t miBits = (uint8_t)((self->trackHeadingType & 0x03) | (self->reportStatus ? 1<<2 : 0) | (self->airGroundState ? 1<<3 : 0));
+    out[11] = (uint8_t)(altitude >> 4);
+    out[12] = (uint8_t)((altitude & 0x0f) << 4 | miBits);
+    out[13] = (uint8_t)((nic & 0x0f) << 4 | (self->navigationAccuracyCategoryForPosition & 0x0f));
+
+    uint16_t horizontalVelocity = self->hasValidHorizontalVelocity ? (uint16_t)(self->horizontalVelocity & 0xfff) : 0xfff;
+    uint16_t verticalVelocity = self->hasValidVerticalVelocity ? (uint16_t)((self->verticalVelocity / 64) & 0xfff) : 0x800;
+    out[14] = (uint8_t)(horizontalVelocity >> 4);
+    out[15] = (uint8_t)((horizontalVelocity & 0x0f) << 4 | (verticalVelocity >> 8));
+    out[16] = (uint8_t)verticalVelocity;
+    out[17] = (uint8_t)(roundi32(self->trackHeading * (256.0/360.0)) & 0xff);
+    out[18] = self->emitterCategory;
+    uint8_t padding = 0;
+    for (size_t i = 0; i < sizeof(self->callsign); i++)
     {
-        self->hasValidPosition = 1;
+        padding |= self->callsign[i] == 0;
+        out[i+19] = padding ? 0x20 : (uint8_t)self->callsign[i];
     }
+    out[27] = (uint8_t)((self->emergencyPriorityCode & 0x0f) << 4 | (self->spare & 0x0f));
 
-    return GDL90ResultOK;
+    return out;
 }
 
 char* GDL90TrafficReport_toString(GDL90TrafficReport *self, char *out, size_t len)
@@ -663,6 +1052,62 @@ char* GDL90TrafficReport_toString(GDL90TrafficReport *self, char *out, size_t le
     return out;
 }
 
+size_t GDL90TrafficReport_toJSON(GDL90TrafficReport *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"alertStatus\":");
+    GDL90JSONWriter_u64(&w, self->alertStatus);
+    GDL90JSONWriter_literal(&w, ",\"addressType\":");
+    GDL90JSONWriter_u64(&w, self->addressType);
+    GDL90JSONWriter_literal(&w, ",\"participantAddress\":");
+    GDL90JSONWriter_u64(&w, self->participantAddress);
+    GDL90JSONWriter_literal(&w, ",\"latitude\":");
+    GDL90JSONWriter_fixed(&w, self->latitude, 6);
+    GDL90JSONWriter_literal(&w, ",\"longitude\":");
+    GDL90JSONWriter_fixed(&w, self->longitude, 6);
+    GDL90JSONWriter_literal(&w, ",\"altitude\":");
+    GDL90JSONWriter_i64(&w, self->altitude);
+    GDL90JSONWriter_literal(&w, ",\"trackHeadingType\":");
+    GDL90JSONWriter_u64(&w, (uint64_t)self->trackHeadingType);
+    GDL90JSONWriter_literal(&w, ",\"reportStatus\":");
+    GDL90JSONWriter_u64(&w, self->reportStatus);
+    GDL90JSONWriter_literal(&w, ",\"airGroundState\":");
+    GDL90JSONWriter_u64(&w, self->airGroundState);
+    GDL90JSONWriter_literal(&w, ",\"navigationIntegrityCategory\":");
+    GDL90JSONWriter_u64(&w, self->navigationIntegrityCategory);
+    GDL90JSONWriter_literal(&w, ",\"navigationAccuracyCategoryForPosition\":");
+    GDL90JSONWriter_u64(&w, self->navigationAccuracyCategoryForPosition);
+    GDL90JSONWriter_literal(&w, ",\"horizontalVelocity\":");
+    GDL90JSONWriter_u64(&w, self->horizontalVelocity);
+    GDL90JSONWriter_literal(&w, ",\"verticalVelocity\":");
+    GDL90JSONWriter_i64(&w, self->verticalVelocity);
+    GDL90JSONWriter_literal(&w, ",\"trackHeading\":");
+    GDL90JSONWriter_fixed(&w, self->trackHeading, 2);
+    GDL90JSONWriter_literal(&w, ",\"emitterCategory\":");
+    GDL90JSONWriter_u64(&w, self->emitterCategory);
+    GDL90JSONWriter_literal(&w, ",\"callsign\":");
+    GDL90JSONWriter_string(&w, self->callsign, sizeof(self->callsign));
+    GDL90JSONWriter_literal(&w, ",\"emergencyPriorityCode\":");
+    GDL90JSONWriter_i64(&w, self->emergencyPriorityCode);
+    GDL90JSONWriter_literal(&w, ",\"spare\":");
+    GDL90JSONWriter_i64(&w, self->spare);
+    GDL90JSONWriter_literal(&w, ",\"hasValidAltitude\":");
+    GDL90JSONWriter_bool(&w, self->hasValidAltitude);
+    GDL90JSONWriter_literal(&w, ",\"hasValidHorizontalVelocity\":");
+    GDL90JSONWriter_bool(&w, self->hasValidHorizontalVelocity);
+    GDL90JSONWriter_literal(&w, ",\"hasValidVerticalVelocity\":");
+    GDL90JSONWriter_bool(&w, self->hasValidVerticalVelocity);
+    GDL90JSONWriter_literal(&w, ",\"hasValidPosition\":");
+    GDL90JSONWriter_bool(&w, self->hasValidPosition);
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 GDL90Result GDL90BasicReport_init(GDL90BasicReport *self, GDL90Message *gdl90Message)
 {
     if (!self || !gdl90Message || gdl90Message->dataLength < 22) { return GDL90ResultFailure; }
@@ -688,6 +1133,17 @@ GDL90Result GDL90BasicReport_init(GDL90BasicReport *self, GDL90Message *gdl90Mes
     return GDL90ResultOK;
 }
 
+uint8_t* GDL90BasicReport_toBytes(GDL90BasicReport *self, uint8_t out[22])
+{
+    if (!self) { return out; }
+
+    out[0] = self->id;
+    torlsb24(self->timeOfReception, self->hasValidTor, out+1);
+    memcpy(out+4, self->payload, sizeof(self->payload));
+
+    return out;
+}
+
 char* GDL90BasicReport_toString(GDL90BasicReport *self, char *out, size_t len)
 {
     if (!self || !out) { return out; }
@@ -706,6 +1162,24 @@ char* GDL90BasicReport_toString(GDL90BasicReport *self, char *out, size_t len)
     return out;
 }
 
+size_t GDL90BasicReport_toJSON(GDL90BasicReport *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"timeOfReception\":");
+    GDL90JSONWriter_u64(&w, self->timeOfReception);
+    GDL90JSONWriter_literal(&w, ",\"hasValidTor\":");
+    GDL90JSONWriter_bool(&w, self->hasValidTor);
+    GDL90JSONWriter_literal(&w, ",\"payload\":");
+    GDL90JSONWriter_hex(&w, self->payload, sizeof(self->payload));
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 GDL90Result GDL90LongReport_init(GDL90LongReport *self, GDL90Message *gdl90Message)
 {
     if (!self || !gdl90Message || gdl90Message->dataLength < 38) { return GDL90ResultFailure; }
@@ -731,6 +1205,17 @@ GDL90Result GDL90LongReport_init(GDL90LongReport *self, GDL90Message *gdl90Messa
     return GDL90ResultOK;
 }
 
+uint8_t* GDL90LongReport_toBytes(GDL90LongReport *self, uint8_t out[38])
+{
+    if (!self) { return out; }
+
+    out[0] = self->id;
+    torlsb24(self->timeOfReception, self->hasValidTor, out+1);
+    memcpy(out+4, self->payload, sizeof(self->payload));
+
+    return out;
+}
+
 char* GDL90LongReport_toString(GDL90LongReport *self, char *out, size_t len)
 {
     if (!self || !out) { return out; }
@@ -749,6 +1234,24 @@ char* GDL90LongReport_toString(GDL90LongReport *self, char *out, size_t len)
     return out;
 }
 
+size_t GDL90LongReport_toJSON(GDL90LongReport *self, char *out, size_t len)
+{
+    if (!self || !out) { return 0; }
+
+    GDL90JSONWriter w = { out, len, 0 };
+    GDL90JSONWriter_literal(&w, "{\"id\":");
+    GDL90JSONWriter_u64(&w, self->id);
+    GDL90JSONWriter_literal(&w, ",\"timeOfReception\":");
+    GDL90JSONWriter_u64(&w, self->timeOfReception);
+    GDL90JSONWriter_literal(&w, ",\"hasValidTor\":");
+    GDL90JSONWriter_bool(&w, self->hasValidTor);
+    GDL90JSONWriter_literal(&w, ",\"payload\":");
+    GDL90JSONWriter_hex(&w, self->payload, sizeof(self->payload));
+    GDL90JSONWriter_literal(&w, "}");
+
+    return GDL90JSONWriter_finish(&w);
+}
+
 GDL90Result GDL90CRC_init(GDL90CRC *self)
 {
     if (!self) { return GDL90ResultFailure; }
@@ -802,16 +1305,156 @@ GDL90CRCResult GDL90CRC_isValid(GDL90CRC *self, uint8_t *data, size_t len)
     return GDL90CRCResultOK;
 }
 
+GDL90Result GDL90FrameBuilder_init(GDL90FrameBuilder *self, uint8_t *buffer, size_t capacity)
+{
+    if (!self || !buffer) { return GDL90ResultFailure; }
+
+    GDL90CRC_init(&self->crc);
+    self->buffer = buffer;
+    self->capacity = capacity;
+    self->length = 0;
+    self->frameCount = 0;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FrameBuilder_reset(GDL90FrameBuilder *self)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->length = 0;
+    self->frameCount = 0;
+
+    return GDL90ResultOK;
+}
+
+static inline size_t GDL90FrameBuilder_put(uint8_t *out, size_t at, uint8_t b)
+{
+    if (b == GDL90_FLAGBYTE || b == GDL90_ESCAPEBYTE)
+    {
+        out[at++] = GDL90_ESCAPEBYTE;
+        b ^= 0x20;
+    }
+    out[at++] = b;
+    return at;
+}
+
+GDL90Result GDL90FrameBuilder_append(GDL90FrameBuilder *self, const uint8_t *message, size_t len)
+{
+    if (!self || !message || len == 0) { return GDL90ResultFailure; }
+
+    size_t available = self->capacity - self->length;
+    // flags and escaped FCS
+    if (available < 2 + 4 + len) { return GDL90ResultFailure; }
+
+    uint8_t *out = self->buffer + self->length;
+    size_t at = 0;
+    uint16_t crc = 0;
+
+    out[at++] = GDL90_FLAGBYTE;
+    if (available >= 2 + 2 * (len + 2))
+    {
+        // fits even if every byte needs escaping
+        for (size_t i = 0; i < len; i++)
+        {
+            crc = self->crc.crc16Table[crc >> 8] ^ (uint16_t)(crc << 8) ^ message[i];
+            at = GDL90FrameBuilder_put(out, at, message[i]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            // worst case of this byte, the FCS and the flag
+            if (at + 2 + 4 + 1 > available) { return GDL90ResultFailure; }
+            crc = self->crc.crc16Table[crc >> 8] ^ (uint16_t)(crc << 8) ^ message[i];
+            at = GDL90FrameBuilder_put(out, at, message[i]);
+        }
+    }
+    // 2.2.3. FCS, LS byte first
+    at = GDL90FrameBuilder_put(out, at, (uint8_t)crc);
+    at = GDL90FrameBuilder_put(out, at, (uint8_t)(crc >> 8));
+    out[at++] = GDL90_FLAGBYTE;
+
+    self->length += at;
+    self->frameCount++;
+
+    return GDL90ResultOK;
+}
+
+size_t GDL90FrameBuilder_appendBatch(GDL90FrameBuilder *self, const uint8_t *const *messages, const size_t *lens, size_t count)
+{
+    if (!self || !messages || !lens) { return 0; }
+
+    size_t i = 0;
+    for (; i < count; i++)
+    {
+        if (GDL90FrameBuilder_append(self, messages[i], lens[i]) != GDL90ResultOK) { break; }
+    }
+
+    return i;
+}
+
 GDL90Result GDL90StreamConfig_init(GDL90StreamConfig *self, GDL90StreamMessageHandler *messageHandler, GDL90StreamErrorHandler *errorHandler)
 {
     if (!self || !messageHandler || !errorHandler) { return GDL90ResultFailure; }
 
     self->messageHandler = messageHandler;
     self->errorHandler = errorHandler;
+    self->frameHandler = NULL;
+    self->frameHandlerContext = NULL;
 
     return GDL90ResultOK;
 }
 
+GDL90Result GDL90StreamConfig_setFrameHandler(GDL90StreamConfig *self, GDL90StreamFrameHandler *frameHandler, void *context)
+{
+    if (!self) { return GDL90ResultFailure; }
+    // only one slot : replacing a handler would silently cut off its consumer
+    if (frameHandler && self->frameHandler && (self->frameHandler != frameHandler || self->frameHandlerContext != context))
+    {
+        return GDL90ResultFailure;
+    }
+
+    self->frameHandler = frameHandler;
+    self->frameHandlerContext = context;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FrameHandlers_init(GDL90FrameHandlers *self, GDL90FrameHandlerEntry *entries, size_t capacity)
+{
+    if (!self || !entries || !capacity) { return GDL90ResultFailure; }
+
+    self->entries = entries;
+    self->capacity = capacity;
+    self->count = 0;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90FrameHandlers_add(GDL90FrameHandlers *self, GDL90StreamFrameHandler *handler, void *context)
+{
+    if (!self || !handler || self->count >= self->capacity) { return GDL90ResultFailure; }
+
+    self->entries[self->count].handler = handler;
+    self->entries[self->count].context = context;
+    self->count++;
+
+    return GDL90ResultOK;
+}
+
+void GDL90FrameHandlers_handleFrame(GDL90Message *gdl90Message, void *context)
+{
+    GDL90FrameHandlers *self = (GDL90FrameHandlers *)context;
+    if (!self || !gdl90Message) { return; }
+
+    for (size_t i = 0; i < self->count; i++)
+    {
+        self->entries[i].handler(gdl90Message, self->entries[i].context);
+    }
+}
+
 GDL90Result GDL90Stream_init(GDL90Stream *self, GDL90StreamConfig *config)
 {
     if (!self || !config) { return GDL90ResultFailure; }
@@ -828,11 +1471,11 @@ GDL90Result GDL90Stream_process(GDL90Stream *self, const uint8_t *data, const ui
     if (!self || !data || !self->config.errorHandler || !self->config.messageHandler) { return GDL90ResultFailure; }
 
     size_t curMessageOffset = 0;
-    uint16_t curMessageLength = 1;
-    for (size_t i = 0; i < dataLength; i++)
+    for (size_t i = GDL90_nextFlag(data, 0, dataLength); i < dataLength; i = GDL90_nextFlag(data, i + 1, dataLength))
     {
-        if (data[i] == GDL90_FLAGBYTE && i > 0 && curMessageLength > 1)
+        if (i > curMessageOffset)
         {
+            uint16_t curMessageLength = (uint16_t)(i - curMessageOffset + 1);
             GDL90Message gdl90Message = {0};
             if (GDL90Message_init(&gdl90Message, &data[curMessageOffset], curMessageLength) != GDL90ResultOK)
             {
@@ -845,16 +1488,21 @@ GDL90Result GDL90Stream_process(GDL90Stream *self, const uint8_t *data, const ui
                 {
                     self->config.errorHandler(&gdl90Message, GDL90StreamProcessingErrorCRCError);
                 }
-                else if (GDL90Stream_handleUnescapedMessage(self, &gdl90Message) != GDL90ResultOK)
+                else
                 {
-                    self->config.errorHandler(&gdl90Message, GDL90StreamProcessingErrorInvalidMessage);
+                    if (self->config.frameHandler)
+                    {
+                        self->config.frameHandler(&gdl90Message, self->config.frameHandlerContext);
+                    }
+                    if (GDL90Stream_handleUnescapedMessage(self, &gdl90Message) != GDL90ResultOK)
+                    {
+                        self->config.errorHandler(&gdl90Message, GDL90StreamProcessingErrorInvalidMessage);
+                    }
                 }
             }
             
             curMessageOffset = i+1;
-            curMessageLength = 0;
         }
-        curMessageLength++;
     }
 
     return GDL90ResultOK;
@@ -124,7 +124,10 @@ typedef struct GDL90Heartbeat
 } GDL90Heartbeat;
 
 GDL90Result GDL90Heartbeat_init(GDL90Heartbeat *, GDL90Message *gdl90Message);
+uint8_t* GDL90Heartbeat_toBytes(GDL90Heartbeat *, uint8_t out[7]);
 char* GDL90Heartbeat_toString(GDL90Heartbeat *, char *out, size_t len);
+/** JSON object of all fields, returns the length written (0 if it didn't fit in len incl. terminator) */
+size_t GDL90Heartbeat_toJSON(GDL90Heartbeat *, char *out, size_t len);
 
 typedef enum GDL90InitializationConfiguration1Bit
 {
@@ -158,6 +161,7 @@ typedef struct GDL90Initialization
 GDL90Result GDL90Initialization_init(GDL90Initialization *, GDL90Message *gdl90Message);
 uint8_t* GDL90Initialization_toBytes(GDL90Initialization *, uint8_t out[3]);
 char* GDL90Initialization_toString(GDL90Initialization *, char *out, size_t len);
+size_t GDL90Initialization_toJSON(GDL90Initialization *, char *out, size_t len);
 
 /** 3.3. UPLINK DATA MESSAGE */
 typedef struct GDL90UplinkData
@@ -174,7 +178,9 @@ typedef struct GDL90UplinkData
 } GDL90UplinkData;
 
 GDL90Result GDL90UplinkData_init(GDL90UplinkData *, GDL90Message *gdl90Message);
+uint8_t* GDL90UplinkData_toBytes(GDL90UplinkData *, uint8_t out[436]);
 char* GDL90UplinkData_toString(GDL90UplinkData *, char *out, size_t len);
+size_t GDL90UplinkData_toJSON(GDL90UplinkData *, char *out, size_t len);
 
 /** 3.7. HEIGHT ABOVE TERRAIN */
 typedef struct GDL90HeightAboveTerrain
@@ -188,6 +194,7 @@ typedef struct GDL90HeightAboveTerrain
 GDL90Result GDL90HeightAboveTerrain_init(GDL90HeightAboveTerrain *, GDL90Message *gdl90Message);
 uint8_t* GDL90HeightAboveTerrain_toBytes(GDL90HeightAboveTerrain *, uint8_t out[3]);
 char* GDL90HeightAboveTerrain_toString(GDL90HeightAboveTerrain *, char *out, size_t len);
+size_t GDL90HeightAboveTerrain_toJSON(GDL90HeightAboveTerrain *, char *out, size_t len);
 
 /** 3.8. OWNSHIP GEOMETRIC ALTITUDE MESSAGE */
 typedef struct GDL90OwnshipGeometricAltitude
@@ -205,7 +212,9 @@ typedef struct GDL90OwnshipGeometricAltitude
 } GDL90OwnshipGeometricAltitude;
 
 GDL90Result GDL90OwnshipGeometricAltitude_init(GDL90OwnshipGeometricAltitude *, GDL90Message *gdl90Message);
+uint8_t* GDL90OwnshipGeometricAltitude_toBytes(GDL90OwnshipGeometricAltitude *, uint8_t out[5]);
 char* GDL90OwnshipGeometricAltitude_toString(GDL90OwnshipGeometricAltitude *, char *out, size_t len);
+size_t GDL90OwnshipGeometricAltitude_toJSON(GDL90OwnshipGeometricAltitude *, char *out, size_t len);
 
 /** 3.5.1.1 TRAFFIC ALERT STATUS */
 typedef enum GDL90TrafficReportAlertStatusType
@@ -439,7 +448,10 @@ typedef struct GDL90TrafficReport
 } GDL90TrafficReport;
 
 GDL90Result GDL90TrafficReport_init(GDL90TrafficReport *, GDL90Message *gdl90Message);
+/** Ownship (id 10) or Traffic (id 20) Report, callsign padded with spaces */
+uint8_t* GDL90TrafficReport_toBytes(GDL90TrafficReport *, uint8_t out[28]);
 char* GDL90TrafficReport_toString(GDL90TrafficReport *, char *out, size_t len);
+size_t GDL90TrafficReport_toJSON(GDL90TrafficReport *, char *out, size_t len);
 
 /** 3.6. PASS-THROUGH REPORTS */
 typedef struct GDL90BasicReport
@@ -456,7 +468,9 @@ typedef struct GDL90BasicReport
 } GDL90BasicReport;
 
 GDL90Result GDL90BasicReport_init(GDL90BasicReport *, GDL90Message *gdl90Message);
+uint8_t* GDL90BasicReport_toBytes(GDL90BasicReport *, uint8_t out[22]);
 char* GDL90BasicReport_toString(GDL90BasicReport *, char *out, size_t len);
+size_t GDL90BasicReport_toJSON(GDL90BasicReport *, char *out, size_t len);
 
 typedef struct GDL90LongReport
 {
@@ -472,7 +486,9 @@ typedef struct GDL90LongReport
 } GDL90LongReport;
 
 GDL90Result GDL90LongReport_init(GDL90LongReport *, GDL90Message *gdl90Message);
+uint8_t* GDL90LongReport_toBytes(GDL90LongReport *, uint8_t out[38]);
 char* GDL90LongReport_toString(GDL90LongReport *, char *out, size_t len);
+size_t GDL90LongReport_toJSON(GDL90LongReport *, char *out, size_t len);
 
 typedef enum GDL90CRCResult
 {
@@ -492,6 +508,29 @@ GDL90Result GDL90CRC_init(GDL90CRC *);
 GDL90Result GDL90CRC_crc(GDL90CRC *, uint16_t *outCrc, uint8_t *data, size_t len);
 GDL90CRCResult GDL90CRC_isValid(GDL90CRC *, uint8_t *data, size_t len);
 
+/** Largest frame : flags around an escaped Uplink Data message and FCS */
+#define GDL90_FRAME_MAX_SIZE (2 + 2 * (436 + 2))
+
+/** 2.2. Frames (flag, escaped message and FCS, flag) appended to a caller supplied buffer, eg. one datagram */
+typedef struct GDL90FrameBuilder
+{
+    GDL90CRC crc;
+    uint8_t *buffer;
+    size_t capacity;
+    /** Bytes of buffer used by the frames appended since init/reset */
+    size_t length;
+    /** Frames appended since init/reset */
+    size_t frameCount;
+} GDL90FrameBuilder;
+
+GDL90Result GDL90FrameBuilder_init(GDL90FrameBuilder *, uint8_t *buffer, size_t capacity);
+/** Starts a new datagram in the same buffer */
+GDL90Result GDL90FrameBuilder_reset(GDL90FrameBuilder *);
+/** Frames the unescaped message (id and data, eg. from _toBytes) in one pass, fails leaving the buffer as it was if it doesn't fit */
+GDL90Result GDL90FrameBuilder_append(GDL90FrameBuilder *, const uint8_t *message, size_t len);
+/** Appends count messages, returns how many fit */
+size_t GDL90FrameBuilder_appendBatch(GDL90FrameBuilder *, const uint8_t *const *messages, const size_t *lens, size_t count);
+
 typedef enum GDL90StreamProcessingError
 {
     GDL90StreamProcessingErrorCRCError,
@@ -504,13 +543,42 @@ typedef void (GDL90StreamMessageHandler)(GDL90Message *, void *);
 /** Called for each error, with the contents of the unescaped GDL90 msg */
 typedef void (GDL90StreamErrorHandler)(GDL90Message *, GDL90StreamProcessingError);
 
+/** Called for each CRC validated GDL90 msg (before decoding) with the context it was set with */
+typedef void (GDL90StreamFrameHandler)(GDL90Message *, void *context);
+
 typedef struct GDL90StreamConfig
 {
     GDL90StreamMessageHandler *messageHandler;
     GDL90StreamErrorHandler *errorHandler;
+    /** Optional */
+    GDL90StreamFrameHandler *frameHandler;
+    void *frameHandlerContext;
 } GDL90StreamConfig;
 
 GDL90Result GDL90StreamConfig_init(GDL90StreamConfig *, GDL90StreamMessageHandler *messageHandler, GDL90StreamErrorHandler *errorHandler);
+/** Fails if another frame handler is set (NULL clears it), use GDL90FrameHandlers to have several */
+GDL90Result GDL90StreamConfig_setFrameHandler(GDL90StreamConfig *, GDL90StreamFrameHandler *frameHandler, void *context);
+
+typedef struct GDL90FrameHandlerEntry
+{
+    GDL90StreamFrameHandler *handler;
+    void *context;
+} GDL90FrameHandlerEntry;
+
+/** Fan-out of the frames of a stream to several frame handlers, in the order they were added */
+typedef struct GDL90FrameHandlers
+{
+    GDL90FrameHandlerEntry *entries;
+    size_t capacity;
+    size_t count;
+} GDL90FrameHandlers;
+
+/** entries[capacity] is caller supplied */
+GDL90Result GDL90FrameHandlers_init(GDL90FrameHandlers *, GDL90FrameHandlerEntry *entries, size_t capacity);
+/** Fails if full */
+GDL90Result GDL90FrameHandlers_add(GDL90FrameHandlers *, GDL90StreamFrameHandler *handler, void *context);
+/** GDL90StreamFrameHandler, use with GDL90StreamConfig_setFrameHandler(&config, GDL90FrameHandlers_handleFrame, &handlers) */
+void GDL90FrameHandlers_handleFrame(GDL90Message *gdl90Message, void *context);
 
 typedef struct GDL90Stream
 {
@@ -0,0 +1,312 @@
+//
+//  gdl90-reorder.c
+//  gdl90-reorder-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "gdl90-reorder.h"
+
+#include <string.h>
+
+#define GDL90_REORDER_NS_PER_MS 1000000ull
+#define GDL90_REORDER_NS_PER_S 1000000000ull
+#define GDL90_REORDER_S_PER_DAY 86400ull
+#define GDL90_REORDER_TOR_INVALID 0xffffff
+#define GDL90_REORDER_NONE UINT32_MAX
+
+GDL90Result GDL90ReorderBuffer_init(GDL90ReorderBuffer *self, GDL90ReorderEntry *entries, GDL90ReorderNode *nodes, uint32_t capacity, GDL90ReorderSource *sources, uint16_t sourceCount, uint32_t maxHoldMs)
+{
+    if (!self || !entries || !nodes || capacity == 0 || capacity == GDL90_REORDER_NONE || !sources || sourceCount == 0) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+    self->entries = entries;
+    self->nodes = nodes;
+    self->capacity = capacity;
+    self->sources = sources;
+    self->sourceCount = sourceCount;
+    self->maxHoldMs = maxHoldMs;
+
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        entries[i].next = i + 1 < capacity ? i + 1 : GDL90_REORDER_NONE;
+    }
+    memset(sources, 0, sizeof(*sources) * sourceCount);
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ReorderBuffer_setHandler(GDL90ReorderBuffer *self, GDL90ReorderHandler *handler, void *context)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->handler = handler;
+    self->handlerContext = context;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ReorderBuffer_setReceiveInfo(GDL90ReorderBuffer *self, uint64_t timeMs, uint16_t sourceId)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->currentTimeMs = timeMs;
+    self->currentSourceId = sourceId;
+
+    return GDL90ResultOK;
+}
+
+static inline int GDL90ReorderNode_less(const GDL90ReorderNode *a, const GDL90ReorderNode *b)
+{
+    if (a->deviceTimeNs != b->deviceTimeNs) { return a->deviceTimeNs < b->deviceTimeNs; }
+    return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+static void GDL90ReorderBuffer_siftUp(GDL90ReorderBuffer *self, uint32_t i)
+{
+    GDL90ReorderNode node = self->nodes[i];
+    while (i > 0)
+    {
+        uint32_t parent = (i - 1) / 2;
+        if (!GDL90ReorderNode_less(&node, &self->nodes[parent])) { break; }
+        self->nodes[i] = self->nodes[parent];
+        i = parent;
+    }
+    self->nodes[i] = node;
+}
+
+static void GDL90ReorderBuffer_siftDown(GDL90ReorderBuffer *self, uint32_t i)
+{
+    GDL90ReorderNode node = self->nodes[i];
+    for (;;)
+    {
+        uint32_t child = 2 * i + 1;
+        if (child >= self->count) { break; }
+        if (child + 1 < self->count && GDL90ReorderNode_less(&self->nodes[child + 1], &self->nodes[child])) { child++; }
+        if (!GDL90ReorderNode_less(&self->nodes[child], &node)) { break; }
+        self->nodes[i] = self->nodes[child];
+        i = child;
+    }
+    self->nodes[i] = node;
+}
+
+static void GDL90ReorderBuffer_emit(GDL90ReorderBuffer *self, GDL90ReorderEntry *entry)
+{
+    self->emittedCount++;
+    if (self->handler)
+    {
+        self->handler(entry, self->handlerContext);
+    }
+}
+
+/** Emits the root of the heap */
+static void GDL90ReorderBuffer_pop(GDL90ReorderBuffer *self)
+{
+    uint32_t entryIndex = self->nodes[0].entryIndex;
+    GDL90ReorderEntry *entry = &self->entries[entryIndex];
+
+    self->count--;
+    if (self->count)
+    {
+        self->nodes[0] = self->nodes[self->count];
+        GDL90ReorderBuffer_siftDown(self, 0);
+    }
+
+    self->lastDeviceTimeNs = entry->deviceTimeNs;
+    self->hasEmitted = 1;
+    GDL90ReorderBuffer_emit(self, entry);
+
+    entry->next = self->freeIndex;
+    self->freeIndex = entryIndex;
+}
+
+static void GDL90ReorderBuffer_release(GDL90ReorderBuffer *self, uint64_t timeMs)
+{
+    const uint64_t holdNs = (uint64_t)self->maxHoldMs * GDL90_REORDER_NS_PER_MS;
+    while (self->count)
+    {
+        const GDL90ReorderNode *root = &self->nodes[0];
+        const GDL90ReorderEntry *entry = &self->entries[root->entryIndex];
+        if (root->deviceTimeNs + holdNs > self->maxDeviceTimeNs && entry->timeMs + self->maxHoldMs > timeMs) { break; }
+        GDL90ReorderBuffer_pop(self);
+    }
+}
+
+/** Full UTC second of a Heartbeat time stamp (seconds since midnight), the closest to the latest one */
+static uint64_t GDL90ReorderBuffer_epoch(GDL90ReorderBuffer *self, uint32_t timestamp)
+{
+    if (!self->hasEpoch)
+    {
+        self->hasEpoch = 1;
+        self->epochS = timestamp;
+        return timestamp;
+    }
+
+    uint64_t day = self->epochS / GDL90_REORDER_S_PER_DAY;
+    uint64_t epoch = day * GDL90_REORDER_S_PER_DAY + timestamp;
+    if (epoch + GDL90_REORDER_S_PER_DAY / 2 < self->epochS) { epoch += GDL90_REORDER_S_PER_DAY; }
+    else if (epoch > self->epochS + GDL90_REORDER_S_PER_DAY / 2 && epoch >= GDL90_REORDER_S_PER_DAY) { epoch -= GDL90_REORDER_S_PER_DAY; }
+    self->epochS = epoch > self->epochS ? epoch : self->epochS;
+
+    return epoch;
+}
+
+/** Device time of a frame, 0 if its source isn't synchronized (or unknown) */
+static int GDL90ReorderBuffer_deviceTime(GDL90ReorderBuffer *self, const GDL90Message *gdl90Message, uint64_t timeMs, uint16_t sourceId, uint64_t *deviceTimeNs)
+{
+    if (sourceId >= self->sourceCount) { return 0; }
+
+    GDL90ReorderSource *source = &self->sources[sourceId];
+    const uint8_t *data = gdl90Message->data;
+
+    // 3.1.2 UTC OK, or the time stamp isn't UTC
+    if (gdl90Message->id == GDL90MessageType_Heartbeat && gdl90Message->dataLength >= 5 && (data[2] & (1<<GDL90HeartbeatStatusByte2BitUTCOK)))
+    {
+        uint32_t timestamp = ((uint32_t)(data[2] >> 7) << 16) | ((uint32_t)data[4] << 8) | data[3];
+        source->epochS = GDL90ReorderBuffer_epoch(self, timestamp);
+        source->heartbeatTimeMs = timeMs;
+        source->hasEpoch = 1;
+        *deviceTimeNs = source->epochS * GDL90_REORDER_NS_PER_S;
+        return 1;
+    }
+    if (!source->hasEpoch) { return 0; }
+
+    uint64_t elapsedMs = timeMs > source->heartbeatTimeMs ? timeMs - source->heartbeatTimeMs : 0;
+    if ((gdl90Message->id == GDL90MessageType_UplinkData || gdl90Message->id == GDL90MessageType_BasicReport || gdl90Message->id == GDL90MessageType_LongReport) && gdl90Message->dataLength >= 4)
+    {
+        uint32_t tor = (uint32_t)data[3] << 16 | (uint32_t)data[2] << 8 | data[1];
+        if (tor != GDL90_REORDER_TOR_INVALID)
+        {
+            // the second the frame was received in, or the previous one for a TOR well past the time since the Heartbeat
+            uint64_t second = source->epochS + elapsedMs / 1000;
+            uint64_t torMs = (uint64_t)tor * 80 / GDL90_REORDER_NS_PER_MS;
+            if (torMs > elapsedMs % 1000 + 500 && second > 0) { second--; }
+            *deviceTimeNs = second * GDL90_REORDER_NS_PER_S + (uint64_t)tor * 80;
+            return 1;
+        }
+    }
+
+    *deviceTimeNs = source->epochS * GDL90_REORDER_NS_PER_S + elapsedMs * GDL90_REORDER_NS_PER_MS;
+    return 1;
+}
+
+GDL90Result GDL90ReorderBuffer_push(GDL90ReorderBuffer *self, const GDL90Message *gdl90Message, uint64_t timeMs, uint16_t sourceId)
+{
+    if (!self || !gdl90Message || gdl90Message->dataLength > sizeof(gdl90Message->data)) { return GDL90ResultFailure; }
+
+    uint64_t deviceTimeNs = 0;
+    int isSynchronized = GDL90ReorderBuffer_deviceTime(self, gdl90Message, timeMs, sourceId, &deviceTimeNs);
+
+    // late and unsynchronized frames pass through before the buffer is considered, they never take
+    // a place in it (nor force one out)
+    int isLate = isSynchronized && self->hasEmitted && deviceTimeNs < self->lastDeviceTimeNs;
+    int passThrough = !isSynchronized || isLate;
+    if (!isSynchronized)
+    {
+        self->unsynchronizedCount++;
+    }
+    else if (isLate)
+    {
+        uint64_t latenessNs = self->lastDeviceTimeNs - deviceTimeNs;
+        self->lateCount++;
+        self->maxLatenessNs = latenessNs > self->maxLatenessNs ? latenessNs : self->maxLatenessNs;
+    }
+    else if (self->count == self->capacity)
+    {
+        // full : the oldest of the frame and the buffer goes first, which keeps the output in order
+        self->overflowCount++;
+        if (self->nodes[0].deviceTimeNs <= deviceTimeNs)
+        {
+            GDL90ReorderBuffer_pop(self);
+        }
+        else
+        {
+            self->lastDeviceTimeNs = deviceTimeNs;
+            self->hasEmitted = 1;
+            passThrough = 1;
+        }
+    }
+
+    if (passThrough)
+    {
+        GDL90ReorderEntry entry;
+        entry.deviceTimeNs = deviceTimeNs;
+        entry.timeMs = timeMs;
+        entry.sourceId = sourceId;
+        entry.next = GDL90_REORDER_NONE;
+        entry.message.id = gdl90Message->id;
+        entry.message.dataLength = gdl90Message->dataLength;
+        memcpy(entry.message.data, gdl90Message->data, gdl90Message->dataLength);
+        GDL90ReorderBuffer_emit(self, &entry);
+        GDL90ReorderBuffer_release(self, timeMs);
+
+        return GDL90ResultOK;
+    }
+
+    uint32_t entryIndex = self->freeIndex;
+    GDL90ReorderEntry *entry = &self->entries[entryIndex];
+    self->freeIndex = entry->next;
+
+    entry->deviceTimeNs = deviceTimeNs;
+    entry->timeMs = timeMs;
+    entry->sourceId = sourceId;
+    entry->next = GDL90_REORDER_NONE;
+    entry->message.id = gdl90Message->id;
+    entry->message.dataLength = gdl90Message->dataLength;
+    memcpy(entry->message.data, gdl90Message->data, gdl90Message->dataLength);
+
+    GDL90ReorderNode *node = &self->nodes[self->count];
+    node->deviceTimeNs = deviceTimeNs;
+    node->sequence = self->sequence++;
+    node->entryIndex = entryIndex;
+    GDL90ReorderBuffer_siftUp(self, self->count++);
+
+    self->maxDeviceTimeNs = deviceTimeNs > self->maxDeviceTimeNs ? deviceTimeNs : self->maxDeviceTimeNs;
+    GDL90ReorderBuffer_release(self, timeMs);
+
+    return GDL90ResultOK;
+}
+
+void GDL90ReorderBuffer_handleFrame(GDL90Message *gdl90Message, void *context)
+{
+    GDL90ReorderBuffer *self = (GDL90ReorderBuffer *)context;
+    (void)GDL90ReorderBuffer_push(self, gdl90Message, self->currentTimeMs, self->currentSourceId);
+}
+
+GDL90Result GDL90ReorderBuffer_advance(GDL90ReorderBuffer *self, uint64_t timeMs)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    GDL90ReorderBuffer_release(self, timeMs);
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ReorderBuffer_flush(GDL90ReorderBuffer *self)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    while (self->count)
+    {
+        GDL90ReorderBuffer_pop(self);
+    }
+
+    return GDL90ResultOK;
+}
@@ -0,0 +1,139 @@
+//
+//  gdl90-reorder.h
+//  gdl90-reorder-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Reordering of the frames of several receivers by device time.
+//
+// The device time of a frame is the UTC second of the last Heartbeat of its source plus its
+// Time of Reception (Uplink, Basic and Long Reports) or, for frames without one, the time it
+// was received after that Heartbeat. Frames are held in a min-heap and emitted in device time
+// order once the device time of the newer frames is maxHoldMs past theirs, or maxHoldMs after
+// they were received (a frame may also wait for an older one still held). Frames older than the
+// last emitted one are late and emitted at once, as are the frames of unsynchronized sources.
+// When the buffer is full the oldest frame is emitted early.
+
+#ifndef __gdl90__gdl90_reorder_h__
+#define __gdl90__gdl90_reorder_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct GDL90ReorderEntry
+{
+    /** ns since the first UTC day seen */
+    uint64_t deviceTimeNs;
+    /** Receive time (ms) */
+    uint64_t timeMs;
+    uint16_t sourceId;
+    /** Free list link, internal */
+    uint32_t next;
+    /** The unescaped, CRC validated message */
+    GDL90Message message;
+} GDL90ReorderEntry;
+
+/** Heap node, kept apart from the entries so sifting doesn't touch the messages */
+typedef struct GDL90ReorderNode
+{
+    uint64_t deviceTimeNs;
+    /** Arrival order of equal device times */
+    uint32_t sequence;
+    uint32_t entryIndex;
+} GDL90ReorderNode;
+
+typedef struct GDL90ReorderSource
+{
+    /** UTC second of the last Heartbeat with UTC OK (since the first UTC day seen) */
+    uint64_t epochS;
+    /** Receive time (ms) of that Heartbeat */
+    uint64_t heartbeatTimeMs;
+    uint8_t hasEpoch;
+} GDL90ReorderSource;
+
+/** Called with the frames in device time order, the entry is reused after the call returns */
+typedef void (GDL90ReorderHandler)(GDL90ReorderEntry *entry, void *context);
+
+typedef struct GDL90ReorderBuffer
+{
+    GDL90ReorderEntry *entries;
+    GDL90ReorderNode *nodes;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t freeIndex;
+    uint32_t sequence;
+
+    /** sources[sourceCount], indexed by source id */
+    GDL90ReorderSource *sources;
+    uint16_t sourceCount;
+
+    uint32_t maxHoldMs;
+    GDL90ReorderHandler *handler;
+    void *handlerContext;
+
+    /** Receive info of the frames of the current GDL90Stream_process call */
+    uint64_t currentTimeMs;
+    uint16_t currentSourceId;
+
+    /** Latest UTC second of all sources */
+    uint64_t epochS;
+    uint8_t hasEpoch;
+    /** Latest device time pushed and device time of the last frame emitted in order */
+    uint64_t maxDeviceTimeNs;
+    uint64_t lastDeviceTimeNs;
+    uint8_t hasEmitted;
+
+    /** Frames emitted (incl. late and unsynchronized ones) */
+    uint64_t emittedCount;
+    /** Frames older than the last emitted one */
+    uint64_t lateCount;
+    /** Largest lateness (ns) of a late frame */
+    uint64_t maxLatenessNs;
+    /** Frames emitted before their hold time as the buffer was full (the oldest of the buffer, or the new frame when it is older) */
+    uint64_t overflowCount;
+    /** Frames emitted at once as their source didn't send a Heartbeat with UTC OK yet (or is unknown) */
+    uint64_t unsynchronizedCount;
+} GDL90ReorderBuffer;
+
+GDL90Result GDL90ReorderBuffer_init(GDL90ReorderBuffer *, GDL90ReorderEntry *entries, GDL90ReorderNode *nodes, uint32_t capacity, GDL90ReorderSource *sources, uint16_t sourceCount, uint32_t maxHoldMs);
+GDL90Result GDL90ReorderBuffer_setHandler(GDL90ReorderBuffer *, GDL90ReorderHandler *handler, void *context);
+/** Sets the receive time (ms) and source of the frames of the next GDL90Stream_process call */
+GDL90Result GDL90ReorderBuffer_setReceiveInfo(GDL90ReorderBuffer *, uint64_t timeMs, uint16_t sourceId);
+/** Adds a frame, emitting the ones that are due, O(log n) */
+GDL90Result GDL90ReorderBuffer_push(GDL90ReorderBuffer *, const GDL90Message *gdl90Message, uint64_t timeMs, uint16_t sourceId);
+/** GDL90StreamFrameHandler, use with GDL90StreamConfig_setFrameHandler(&config, GDL90ReorderBuffer_handleFrame, &buffer), or GDL90FrameHandlers_add(&handlers, GDL90ReorderBuffer_handleFrame, &buffer) to share the stream */
+void GDL90ReorderBuffer_handleFrame(GDL90Message *gdl90Message, void *context);
+/** Emits the frames held for maxHoldMs at timeMs, call it periodically when the feeds are idle */
+GDL90Result GDL90ReorderBuffer_advance(GDL90ReorderBuffer *, uint64_t timeMs);
+/** Emits all the frames held */
+GDL90Result GDL90ReorderBuffer_flush(GDL90ReorderBuffer *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_reorder_h__) */
@@ -0,0 +1,1333 @@
+//
+//  gdl90-traffic.c
+//  gdl90-traffic-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "gdl90-traffic.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#define GDL90_TRAFFIC_DEG2RAD (3.14159265358979323846 / 180.0)
+
+static inline uint32_t GDL90TargetTable_slot(const GDL90TargetTable *self, uint32_t key)
+{
+    // fibonacci hashing, the high bits are the well mixed ones
+    return (uint32_t)(key * 0x9e3779b1u) >> self->hashShift;
+}
+
+static inline uint32_t GDL90TargetTable_lookup(const GDL90TargetTable *self, uint32_t key)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t i = GDL90TargetTable_slot(self, key);
+    while (self->slots[i].key != 0 && self->slots[i].key != key)
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void GDL90TargetTable_removeSlot(GDL90TargetTable *self, uint32_t i)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t j = i;
+
+    self->targets[self->slots[i].target].key = 0;
+
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (self->slots[j].key == 0) { break; }
+
+        // move j back into the hole if its home slot isn't cyclically in (i, j]
+        uint32_t home = GDL90TargetTable_slot(self, self->slots[j].key);
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            self->slots[i] = self->slots[j];
+            i = j;
+        }
+    }
+    self->slots[i].key = 0;
+    self->count--;
+}
+
+GDL90Result GDL90TargetTable_init(GDL90TargetTable *self, GDL90TargetTableSlot *slots, GDL90Target *targets, uint32_t capacity)
+{
+    if (!self || !slots || !targets || capacity < 8 || (capacity & (capacity - 1)) != 0) { return GDL90ResultFailure; }
+
+    self->slots = slots;
+    self->targets = targets;
+    self->capacity = capacity;
+    self->maxCount = capacity - capacity / 8;
+    self->hashShift = 32;
+    for (uint32_t c = capacity; c > 1; c >>= 1) { self->hashShift--; }
+    self->removalHandler = NULL;
+    self->removalHandlerContext = NULL;
+
+    return GDL90TargetTable_clear(self);
+}
+
+GDL90Result GDL90TargetTable_setRemovalHandler(GDL90TargetTable *self, GDL90TargetTableRemovalHandler *removalHandler, void *context)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->removalHandler = removalHandler;
+    self->removalHandlerContext = context;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90TargetTable_clear(GDL90TargetTable *self)
+{
+    if (!self || !self->slots) { return GDL90ResultFailure; }
+
+    for (uint32_t i = 0; i < self->capacity; i++)
+    {
+        self->slots[i].key = 0;
+        self->targets[i].key = 0;
+    }
+    self->count = 0;
+    self->allocCursor = 0;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90TargetTable_update(GDL90TargetTable *self, uint64_t timeMs, const GDL90TrafficReport *report, GDL90Target **outTarget)
+{
+    if (!self || !self->slots || !report) { return GDL90ResultFailure; }
+
+    uint32_t key = GDL90TargetTable_key(report->addressType, report->participantAddress);
+    uint32_t i = GDL90TargetTable_lookup(self, key);
+    GDL90Target *target = NULL;
+
+    if (self->slots[i].key == 0)
+    {
+        if (self->count >= self->maxCount) { return GDL90ResultFailure; }
+
+        // next fit, at most 1/8 of the targets are free so this is O(1) on average
+        uint32_t t = self->allocCursor;
+        while (self->targets[t].key != 0)
+        {
+            t = (t + 1) & (self->capacity - 1);
+        }
+        self->allocCursor = (t + 1) & (self->capacity - 1);
+
+        self->slots[i].key = key;
+        self->slots[i].target = t;
+        self->count++;
+
+        target = &self->targets[t];
+        target->key = key;
+        target->firstSeenTimeMs = timeMs;
+        target->updateCount = 0;
+    }
+    else
+    {
+        target = &self->targets[self->slots[i].target];
+    }
+
+    target->report = *report;
+    target->updateTimeMs = timeMs;
+    target->updateCount++;
+
+    if (outTarget) { *outTarget = target; }
+
+    return GDL90ResultOK;
+}
+
+GDL90Target* GDL90TargetTable_find(GDL90TargetTable *self, uint8_t addressType, uint32_t participantAddress)
+{
+    if (!self || !self->slots) { return NULL; }
+
+    uint32_t i = GDL90TargetTable_lookup(self, GDL90TargetTable_key(addressType, participantAddress));
+
+    return self->slots[i].key != 0 ? &self->targets[self->slots[i].target] : NULL;
+}
+
+GDL90Result GDL90TargetTable_remove(GDL90TargetTable *self, uint8_t addressType, uint32_t participantAddress)
+{
+    if (!self || !self->slots) { return GDL90ResultFailure; }
+
+    uint32_t i = GDL90TargetTable_lookup(self, GDL90TargetTable_key(addressType, participantAddress));
+    if (self->slots[i].key == 0) { return GDL90ResultFailure; }
+
+    if (self->removalHandler)
+    {
+        uint32_t t = self->slots[i].target;
+        self->removalHandler(&self->targets[t], t, self->removalHandlerContext);
+    }
+    GDL90TargetTable_removeSlot(self, i);
+
+    return GDL90ResultOK;
+}
+
+uint32_t GDL90TargetTable_evict(GDL90TargetTable *self, uint64_t staleTimeMs)
+{
+    if (!self || !self->slots) { return 0; }
+
+    uint32_t evicted = 0;
+    for (uint32_t t = 0; t < self->capacity; t++)
+    {
+        GDL90Target *target = &self->targets[t];
+        if (target->key == 0 || target->updateTimeMs >= staleTimeMs) { continue; }
+
+        if (self->removalHandler)
+        {
+            self->removalHandler(target, t, self->removalHandlerContext);
+        }
+        GDL90TargetTable_removeSlot(self, GDL90TargetTable_lookup(self, target->key));
+        evicted++;
+    }
+
+    return evicted;
+}
+
+GDL90Target* GDL90TargetTable_next(GDL90TargetTable *self, uint32_t *cursor)
+{
+    if (!self || !self->slots || !cursor) { return NULL; }
+
+    for (uint32_t t = *cursor; t < self->capacity; t++)
+    {
+        if (self->targets[t].key != 0)
+        {
+            *cursor = t + 1;
+            return &self->targets[t];
+        }
+    }
+    *cursor = self->capacity;
+
+    return NULL;
+}
+
+static inline int32_t floorToInt(double v)
+{
+    int32_t i = (int32_t)v;
+    return (double)i > v ? i - 1 : i;
+}
+
+static inline uint32_t GDL90SpatialGrid_bucket(const GDL90SpatialGrid *self, int32_t cellX, int32_t cellY)
+{
+    return ((uint32_t)cellX * 0x9e3779b1u ^ (uint32_t)cellY * 0x85ebca6bu) & (self->bucketCount - 1);
+}
+
+static inline int32_t GDL90SpatialGrid_cellX(const GDL90SpatialGrid *self, double longitude)
+{
+    int32_t x = floorToInt((longitude + 180.0) / self->cellSize) % self->lonCells;
+    return x < 0 ? x + self->lonCells : x;
+}
+
+static inline int32_t GDL90SpatialGrid_cellY(const GDL90SpatialGrid *self, double latitude)
+{
+    int32_t y = floorToInt((latitude + 90.0) / self->cellSize);
+    return y < 0 ? 0 : (y >= self->latCells ? self->latCells - 1 : y);
+}
+
+static void GDL90SpatialGrid_unlink(GDL90SpatialGrid *self, uint32_t index)
+{
+    GDL90SpatialGridNode *node = &self->nodes[index];
+    if (node->prev != GDL90_TRAFFIC_NONE)
+    {
+        self->nodes[node->prev].next = node->next;
+    }
+    else
+    {
+        self->buckets[GDL90SpatialGrid_bucket(self, node->cellX, node->cellY)] = node->next;
+    }
+    if (node->next != GDL90_TRAFFIC_NONE)
+    {
+        self->nodes[node->next].prev = node->prev;
+    }
+}
+
+static void GDL90SpatialGrid_link(GDL90SpatialGrid *self, uint32_t index)
+{
+    GDL90SpatialGridNode *node = &self->nodes[index];
+    uint32_t *head = &self->buckets[GDL90SpatialGrid_bucket(self, node->cellX, node->cellY)];
+    node->prev = GDL90_TRAFFIC_NONE;
+    node->next = *head;
+    if (*head != GDL90_TRAFFIC_NONE)
+    {
+        self->nodes[*head].prev = index;
+    }
+    *head = index;
+}
+
+GDL90Result GDL90SpatialGrid_init(GDL90SpatialGrid *self, double cellSize, uint32_t *buckets, uint32_t bucketCount, GDL90SpatialGridNode *nodes, uint32_t capacity)
+{
+    if (!self || !buckets || !nodes || !(cellSize > 0.0 && cellSize <= 90.0) || bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0)
+    {
+        return GDL90ResultFailure;
+    }
+
+    self->cellSize = cellSize;
+    self->lonCells = floorToInt(360.0 / cellSize);
+    self->latCells = floorToInt(180.0 / cellSize) + 1;
+    self->buckets = buckets;
+    self->bucketCount = bucketCount;
+    self->nodes = nodes;
+    self->capacity = capacity;
+    self->count = 0;
+
+    for (uint32_t i = 0; i < bucketCount; i++) { buckets[i] = GDL90_TRAFFIC_NONE; }
+    for (uint32_t i = 0; i < capacity; i++) { nodes[i].inGrid = 0; }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90SpatialGrid_update(GDL90SpatialGrid *self, uint32_t index, double latitude, double longitude, uint8_t hasValidAltitude, int32_t altitude)
+{
+    if (!self || !self->nodes || index >= self->capacity) { return GDL90ResultFailure; }
+
+    GDL90SpatialGridNode *node = &self->nodes[index];
+    int32_t cellX = GDL90SpatialGrid_cellX(self, longitude);
+    int32_t cellY = GDL90SpatialGrid_cellY(self, latitude);
+
+    if (!node->inGrid || node->cellX != cellX || node->cellY != cellY)
+    {
+        if (node->inGrid)
+        {
+            GDL90SpatialGrid_unlink(self, index);
+        }
+        else
+        {
+            self->count++;
+        }
+        node->cellX = cellX;
+        node->cellY = cellY;
+        node->inGrid = 1;
+        GDL90SpatialGrid_link(self, index);
+    }
+
+    node->latitude = latitude;
+    node->longitude = longitude;
+    node->hasValidAltitude = hasValidAltitude;
+    node->altitude = altitude;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90SpatialGrid_remove(GDL90SpatialGrid *self, uint32_t index)
+{
+    if (!self || !self->nodes || index >= self->capacity || !self->nodes[index].inGrid) { return GDL90ResultFailure; }
+
+    GDL90SpatialGrid_unlink(self, index);
+    self->nodes[index].inGrid = 0;
+    self->count--;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90SpatialGrid_updateTarget(GDL90SpatialGrid *self, const GDL90TargetTable *table, const GDL90Target *target)
+{
+    if (!self || !table || !target) { return GDL90ResultFailure; }
+
+    uint32_t index = GDL90TargetTable_index(table, target);
+    const GDL90TrafficReport *report = &target->report;
+    if (!report->hasValidPosition)
+    {
+        (void)GDL90SpatialGrid_remove(self, index);
+        return GDL90ResultOK;
+    }
+
+    return GDL90SpatialGrid_update(self, index, report->latitude, report->longitude, report->hasValidAltitude, report->altitude);
+}
+
+void GDL90SpatialGrid_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context)
+{
+    (void)target;
+    (void)GDL90SpatialGrid_remove((GDL90SpatialGrid *)context, targetIndex);
+}
+
+typedef struct GDL90SpatialGridQuery
+{
+    double minLatitude;
+    double maxLatitude;
+    double minLongitude;
+    double maxLongitude;
+    int32_t minAltitude;
+    int32_t maxAltitude;
+    /** Radius queries only */
+    double latitude;
+    double longitude;
+    double radius;
+    double lonScale;
+
+    uint32_t *out;
+    uint32_t maxCount;
+    uint32_t count;
+} GDL90SpatialGridQuery;
+
+static inline void GDL90SpatialGridQuery_check(GDL90SpatialGridQuery *query, const GDL90SpatialGridNode *node, uint32_t index)
+{
+    if (query->minAltitude != INT32_MIN || query->maxAltitude != INT32_MAX)
+    {
+        if (!node->hasValidAltitude || node->altitude < query->minAltitude || node->altitude > query->maxAltitude) { return; }
+    }
+    if (node->latitude < query->minLatitude || node->latitude > query->maxLatitude) { return; }
+
+    if (query->radius > 0)
+    {
+        double dLon = node->longitude - query->longitude;
+        if (dLon > 180.0) { dLon -= 360.0; } else if (dLon < -180.0) { dLon += 360.0; }
+        double dx = dLon * query->lonScale * 60.0;
+        double dy = (node->latitude - query->latitude) * 60.0;
+        if (dx * dx + dy * dy > query->radius * query->radius) { return; }
+    }
+    else if (query->minLongitude <= query->maxLongitude)
+    {
+        if (node->longitude < query->minLongitude || node->longitude > query->maxLongitude) { return; }
+    }
+    else
+    {
+        if (node->longitude < query->minLongitude && node->longitude > query->maxLongitude) { return; }
+    }
+
+    if (query->count < query->maxCount)
+    {
+        query->out[query->count] = index;
+    }
+    query->count++;
+}
+
+static uint32_t GDL90SpatialGrid_query(GDL90SpatialGrid *self, GDL90SpatialGridQuery *query)
+{
+    int32_t y0 = GDL90SpatialGrid_cellY(self, query->minLatitude);
+    int32_t y1 = GDL90SpatialGrid_cellY(self, query->maxLatitude);
+    int32_t x0 = GDL90SpatialGrid_cellX(self, query->minLongitude);
+    int32_t x1 = GDL90SpatialGrid_cellX(self, query->maxLongitude);
+    int32_t nx = query->minLongitude <= query->maxLongitude && (query->maxLongitude - query->minLongitude) >= 360.0
+        ? self->lonCells
+        : ((x1 - x0 + self->lonCells) % self->lonCells) + 1;
+    int32_t ny = y1 - y0 + 1;
+
+    if ((uint64_t)nx * (uint64_t)ny > self->bucketCount)
+    {
+        // more cells than buckets, checking every bucket once is cheaper
+        for (uint32_t b = 0; b < self->bucketCount; b++)
+        {
+            for (uint32_t i = self->buckets[b]; i != GDL90_TRAFFIC_NONE; i = self->nodes[i].next)
+            {
+                GDL90SpatialGridQuery_check(query, &self->nodes[i], i);
+            }
+        }
+        return query->count;
+    }
+
+    for (int32_t y = y0; y <= y1; y++)
+    {
+        for (int32_t dx = 0; dx < nx; dx++)
+        {
+            int32_t x = (x0 + dx) % self->lonCells;
+            uint32_t b = GDL90SpatialGrid_bucket(self, x, y);
+            for (uint32_t i = self->buckets[b]; i != GDL90_TRAFFIC_NONE; i = self->nodes[i].next)
+            {
+                const GDL90SpatialGridNode *node = &self->nodes[i];
+                // buckets are shared by colliding cells
+                if (node->cellX != x || node->cellY != y) { continue; }
+                GDL90SpatialGridQuery_check(query, node, i);
+            }
+        }
+    }
+
+    return query->count;
+}
+
+uint32_t GDL90SpatialGrid_queryBox(GDL90SpatialGrid *self, double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int32_t minAltitude, int32_t maxAltitude, uint32_t *out, uint32_t maxCount)
+{
+    if (!self || !self->nodes || (!out && maxCount)) { return 0; }
+
+    GDL90SpatialGridQuery query = {0};
+    query.minLatitude = minLatitude;
+    query.maxLatitude = maxLatitude;
+    query.minLongitude = minLongitude;
+    query.maxLongitude = maxLongitude;
+    query.minAltitude = minAltitude;
+    query.maxAltitude = maxAltitude;
+    query.out = out;
+    query.maxCount = maxCount;
+
+    return GDL90SpatialGrid_query(self, &query);
+}
+
+uint32_t GDL90SpatialGrid_queryRadius(GDL90SpatialGrid *self, double latitude, double longitude, double radius, int32_t minAltitude, int32_t maxAltitude, uint32_t *out, uint32_t maxCount)
+{
+    if (!self || !self->nodes || (!out && maxCount) || !(radius > 0)) { return 0; }
+
+    GDL90SpatialGridQuery query = {0};
+    double dLat = radius / 60.0;
+    query.lonScale = cos(latitude * GDL90_TRAFFIC_DEG2RAD);
+    query.minLatitude = latitude - dLat;
+    query.maxLatitude = latitude + dLat;
+    // close to the poles the box is the whole parallel
+    double dLon = query.lonScale > dLat / 180.0 ? dLat / query.lonScale : 360.0;
+    if (dLon >= 180.0)
+    {
+        query.minLongitude = -180.0;
+        query.maxLongitude = 180.0;
+    }
+    else
+    {
+        query.minLongitude = longitude - dLon < -180.0 ? longitude - dLon + 360.0 : longitude - dLon;
+        query.maxLongitude = longitude + dLon > 180.0 ? longitude + dLon - 360.0 : longitude + dLon;
+    }
+    query.minAltitude = minAltitude;
+    query.maxAltitude = maxAltitude;
+    query.latitude = latitude;
+    query.longitude = longitude;
+    query.radius = radius;
+    query.out = out;
+    query.maxCount = maxCount;
+
+    return GDL90SpatialGrid_query(self, &query);
+}
+
+GDL90Result GDL90Extrapolator_init(GDL90Extrapolator *self, void *storage, size_t storageSize, uint32_t capacity, uint32_t maxExtrapolationMs)
+{
+    if (!self || !storage || storageSize < GDL90_EXTRAPOLATOR_STORAGE_SIZE(capacity)) { return GDL90ResultFailure; }
+
+    self->capacity = capacity;
+    self->maxExtrapolationMs = maxExtrapolationMs;
+    self->maxSourceExtrapolatedMs = maxExtrapolationMs;
+    self->magneticVariation = 0.0f;
+    self->baseTimeMs = 0;
+
+    // widest types first to keep everything aligned
+    uint8_t *p = (uint8_t *)storage;
+    self->timeMs = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->horizonMs = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->latitude = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->longitude = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->altitude = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->latitudeRate = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->longitudeRate = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->altitudeRate = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->outLatitude = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->outLongitude = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->outAltitude = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->flags = p;
+
+    memset(storage, 0, GDL90_EXTRAPOLATOR_STORAGE_SIZE(capacity));
+
+    return GDL90ResultOK;
+}
+
+static uint8_t GDL90Extrapolator_rates(const GDL90Extrapolator *self, const GDL90TrafficReport *report, float *latitudeRate, float *longitudeRate, float *altitudeRate)
+{
+    uint8_t flags = GDL90ExtrapolationFlagActive;
+    *latitudeRate = 0.0f;
+    *longitudeRate = 0.0f;
+    *altitudeRate = 0.0f;
+
+    if (report->hasValidHorizontalVelocity && report->trackHeadingType != GDL90TrafficReportTrackHeadingTypeInvalid)
+    {
+        double direction = report->trackHeading;
+        if (report->trackHeadingType == GDL90TrafficReportTrackHeadingTypeHeadingMagnetic)
+        {
+            direction += self->magneticVariation;
+        }
+        // kt to degrees of latitude per second
+        double speed = (double)report->horizontalVelocity / 3600.0 / 60.0;
+        double lonScale = cos(report->latitude * GDL90_TRAFFIC_DEG2RAD);
+        *latitudeRate = (float)(speed * cos(direction * GDL90_TRAFFIC_DEG2RAD));
+        *longitudeRate = lonScale > 1e-6 ? (float)(speed * sin(direction * GDL90_TRAFFIC_DEG2RAD) / lonScale) : 0.0f;
+        flags |= GDL90ExtrapolationFlagHorizontal;
+    }
+    if (report->hasValidAltitude)
+    {
+        flags |= GDL90ExtrapolationFlagAltitude;
+        if (report->hasValidVerticalVelocity)
+        {
+            *altitudeRate = (float)report->verticalVelocity / 60.0f;
+            flags |= GDL90ExtrapolationFlagVertical;
+        }
+    }
+    if (report->reportStatus)
+    {
+        flags |= GDL90ExtrapolationFlagSourceExtrapolated;
+    }
+
+    return flags;
+}
+
+/** timeMs relative to baseTimeMs, moving the base (and the report times) forward before it gets past GDL90_EXTRAPOLATOR_REBASE_MS */
+static float GDL90Extrapolator_offsetMs(GDL90Extrapolator *self, uint64_t timeMs)
+{
+    if (timeMs >= self->baseTimeMs + GDL90_EXTRAPOLATOR_REBASE_MS)
+    {
+        uint64_t base = timeMs - GDL90_EXTRAPOLATOR_REBASE_MS / 2;
+        // past any horizon, so the exact value of the oldest times doesn't matter
+        float shift = base - self->baseTimeMs > GDL90_EXTRAPOLATOR_REBASE_MS ? (float)GDL90_EXTRAPOLATOR_REBASE_MS : (float)(base - self->baseTimeMs);
+        for (uint32_t i = 0; i < self->capacity; i++)
+        {
+            self->timeMs[i] -= shift;
+        }
+        self->baseTimeMs = base;
+    }
+    return timeMs >= self->baseTimeMs ? (float)(timeMs - self->baseTimeMs) : -(float)(self->baseTimeMs - timeMs);
+}
+
+GDL90Result GDL90Extrapolator_update(GDL90Extrapolator *self, uint32_t index, uint64_t timeMs, const GDL90TrafficReport *report)
+{
+    if (!self || !self->flags || !report || index >= self->capacity) { return GDL90ResultFailure; }
+
+    if (!report->hasValidPosition)
+    {
+        return GDL90Extrapolator_remove(self, index);
+    }
+
+    float latitudeRate, longitudeRate, altitudeRate;
+    uint8_t flags = GDL90Extrapolator_rates(self, report, &latitudeRate, &longitudeRate, &altitudeRate);
+
+    self->timeMs[index] = GDL90Extrapolator_offsetMs(self, timeMs);
+    self->horizonMs[index] = (float)(report->reportStatus ? self->maxSourceExtrapolatedMs : self->maxExtrapolationMs);
+    self->latitude[index] = (float)report->latitude;
+    self->longitude[index] = (float)report->longitude;
+    self->altitude[index] = (float)report->altitude;
+    self->latitudeRate[index] = latitudeRate;
+    self->longitudeRate[index] = longitudeRate;
+    self->altitudeRate[index] = altitudeRate;
+    self->outLatitude[index] = self->latitude[index];
+    self->outLongitude[index] = self->longitude[index];
+    self->outAltitude[index] = self->altitude[index];
+    self->flags[index] = flags;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90Extrapolator_updateTarget(GDL90Extrapolator *self, const GDL90TargetTable *table, const GDL90Target *target)
+{
+    if (!self || !table || !target) { return GDL90ResultFailure; }
+
+    return GDL90Extrapolator_update(self, GDL90TargetTable_index(table, target), target->updateTimeMs, &target->report);
+}
+
+GDL90Result GDL90Extrapolator_remove(GDL90Extrapolator *self, uint32_t index)
+{
+    if (!self || !self->flags || index >= self->capacity) { return GDL90ResultFailure; }
+
+    self->flags[index] = 0;
+    self->latitudeRate[index] = 0.0f;
+    self->longitudeRate[index] = 0.0f;
+    self->altitudeRate[index] = 0.0f;
+
+    return GDL90ResultOK;
+}
+
+void GDL90Extrapolator_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context)
+{
+    (void)target;
+    (void)GDL90Extrapolator_remove((GDL90Extrapolator *)context, targetIndex);
+}
+
+/**
+ * Branch free (selects only) so it vectorizes, inactive slots have 0 rates and their output is
+ * ignored. restrict parameters (gcc ignores them on locals) spare the alias checks.
+ */
+static void GDL90Extrapolator_projectAll(uint32_t n, float now, const float *restrict t0, const float *restrict horizon,
+    const float *restrict lat0, const float *restrict lon0, const float *restrict alt0,
+    const float *restrict latRate, const float *restrict lonRate, const float *restrict altRate,
+    float *restrict lat, float *restrict lon, float *restrict alt)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float h = horizon[i];
+        float dtMs = now - t0[i];
+        dtMs = dtMs < 0.0f ? 0.0f : dtMs;
+        dtMs = dtMs > h ? h : dtMs;
+        float dt = dtMs * 0.001f;
+        float x = lon0[i] + lonRate[i] * dt;
+        // selecting constants (not x -/+ 360) keeps it if-convertible with trapping math
+        float wrap = x > 180.0f ? 360.0f : 0.0f;
+        wrap = x < -180.0f ? -360.0f : wrap;
+        lat[i] = lat0[i] + latRate[i] * dt;
+        lon[i] = x - wrap;
+        alt[i] = alt0[i] + altRate[i] * dt;
+    }
+}
+
+GDL90Result GDL90Extrapolator_project(GDL90Extrapolator *self, uint64_t timeMs)
+{
+    if (!self || !self->flags) { return GDL90ResultFailure; }
+
+    const float now = GDL90Extrapolator_offsetMs(self, timeMs);
+    GDL90Extrapolator_projectAll(self->capacity, now, self->timeMs, self->horizonMs,
+        self->latitude, self->longitude, self->altitude,
+        self->latitudeRate, self->longitudeRate, self->altitudeRate,
+        self->outLatitude, self->outLongitude, self->outAltitude);
+
+    // the limited flag is informational, kept out of the hot loop above
+    for (uint32_t i = 0; i < self->capacity; i++)
+    {
+        uint8_t flags = self->flags[i] & ~GDL90ExtrapolationFlagLimited;
+        if (flags && now - self->timeMs[i] > self->horizonMs[i])
+        {
+            flags |= GDL90ExtrapolationFlagLimited;
+        }
+        self->flags[i] = flags;
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90ConflictProbe_init(GDL90ConflictProbe *self, void *storage, size_t storageSize, uint32_t capacity, float horizontalThreshold, float verticalThreshold, float lookahead)
+{
+    if (!self || !storage || storageSize < GDL90_CONFLICT_PROBE_STORAGE_SIZE(capacity)) { return GDL90ResultFailure; }
+
+    self->capacity = capacity;
+    self->horizontalThreshold = horizontalThreshold;
+    self->verticalThreshold = verticalThreshold;
+    self->lookahead = lookahead;
+
+    uint8_t *p = (uint8_t *)storage;
+    self->timeToCPA = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->horizontalCPA = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->verticalCPA = (float *)(void *)p; p += sizeof(float) * capacity;
+    self->conflict = p;
+
+    memset(storage, 0, GDL90_CONFLICT_PROBE_STORAGE_SIZE(capacity));
+
+    return GDL90ResultOK;
+}
+
+/**
+ * Closest point of approach in the local plane around ownship (nm, nm/s), writing the squared
+ * horizontal distance to d2. Selects only, the division has a safe denominator so it stays
+ * if-convertible with trapping math and the loop vectorizes.
+ */
+static void GDL90ConflictProbe_cpaAll(uint32_t n, float ownLatitude, float ownLongitude, float ownAltitude,
+    float cosLatitude, float sinLatitude, float ownVelocityX, float ownVelocityY, float ownAltitudeRate, float lookahead,
+    const float *restrict lat, const float *restrict lon, const float *restrict alt,
+    const float *restrict latRate, const float *restrict lonRate, const float *restrict altRate,
+    float *restrict tcpa, float *restrict d2, float *restrict vcpa)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float dLat = lat[i] - ownLatitude;
+        float dLon = lon[i] - ownLongitude;
+        float wrap = dLon > 180.0f ? 360.0f : 0.0f;
+        wrap = dLon < -180.0f ? -360.0f : wrap;
+        dLon = dLon - wrap;
+        float cosTarget = cosLatitude - sinLatitude * dLat * (float)GDL90_TRAFFIC_DEG2RAD;
+
+        float x = dLon * 60.0f * cosLatitude;
+        float y = dLat * 60.0f;
+        float vx = lonRate[i] * 60.0f * cosTarget - ownVelocityX;
+        float vy = latRate[i] * 60.0f - ownVelocityY;
+        float vz = altRate[i] - ownAltitudeRate;
+        float v2 = vx * vx + vy * vy;
+
+        float moving = v2 > 1e-12f ? 1.0f : 0.0f;
+        float t = -(x * vx + y * vy) * moving / (v2 + (1.0f - moving));
+        t = t < 0.0f ? 0.0f : t;
+        t = t > lookahead ? lookahead : t;
+
+        float cx = x + vx * t;
+        float cy = y + vy * t;
+        tcpa[i] = t;
+        d2[i] = cx * cx + cy * cy;
+        vcpa[i] = alt[i] - ownAltitude + vz * t;
+    }
+}
+
+uint32_t GDL90ConflictProbe_evaluate(GDL90ConflictProbe *self, const GDL90Extrapolator *targets, const GDL90TrafficReport *ownship)
+{
+    if (!self || !self->conflict || !targets || !targets->flags || !ownship || !ownship->hasValidPosition) { return 0; }
+
+    float ownLatitudeRate, ownLongitudeRate, ownAltitudeRate;
+    uint8_t ownFlags = GDL90Extrapolator_rates(targets, ownship, &ownLatitudeRate, &ownLongitudeRate, &ownAltitudeRate);
+
+    // local plane around ownship in nm and nm/s, the cosine of a target's latitude taken to first order from ownship's
+    const float cosLatitude = (float)cos(ownship->latitude * GDL90_TRAFFIC_DEG2RAD);
+    const float sinLatitude = (float)sin(ownship->latitude * GDL90_TRAFFIC_DEG2RAD);
+    const uint32_t n = self->capacity < targets->capacity ? self->capacity : targets->capacity;
+    GDL90ConflictProbe_cpaAll(n, (float)ownship->latitude, (float)ownship->longitude, (float)ownship->altitude,
+        cosLatitude, sinLatitude, ownLongitudeRate * 60.0f * cosLatitude, ownLatitudeRate * 60.0f, ownAltitudeRate, self->lookahead,
+        targets->outLatitude, targets->outLongitude, targets->outAltitude,
+        targets->latitudeRate, targets->longitudeRate, targets->altitudeRate,
+        self->timeToCPA, self->horizontalCPA, self->verticalCPA);
+
+    // thresholds and the square root (a libm call with errno) kept out of the vectorized pass above
+    const float hThreshold2 = self->horizontalThreshold * self->horizontalThreshold;
+    const uint8_t ownAltitudeFlag = ownFlags & GDL90ExtrapolationFlagAltitude;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float d2 = self->horizontalCPA[i];
+        float dz = self->verticalCPA[i];
+        int vertical = fabsf(dz) < self->verticalThreshold || !(targets->flags[i] & ownAltitudeFlag);
+        uint8_t c = (uint8_t)((targets->flags[i] & GDL90ExtrapolationFlagActive) && d2 < hThreshold2 && vertical);
+        self->horizontalCPA[i] = sqrtf(d2);
+        self->conflict[i] = c;
+        count += c;
+    }
+
+    return count;
+}
+
+// Sequence lock primitives. The writer makes the sequence odd, writes the snapshot and makes it
+// even again, readers retry when the sequence was odd or changed while they copied.
+#if defined(_MSC_VER) && !defined(__clang__)
+static inline uint32_t GDL90OwnshipState_loadSequence(const volatile uint32_t *sequence)
+{
+    return (uint32_t)_InterlockedCompareExchange((volatile long *)sequence, 0, 0);
+}
+
+static inline void GDL90OwnshipState_storeSequence(volatile uint32_t *sequence, uint32_t value)
+{
+    (void)_InterlockedExchange((volatile long *)sequence, (long)value);
+}
+
+static inline void GDL90OwnshipState_writeFence(void) { }
+static inline void GDL90OwnshipState_readFence(void) { }
+#else
+static inline uint32_t GDL90OwnshipState_loadSequence(const volatile uint32_t *sequence)
+{
+    return __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+}
+
+static inline void GDL90OwnshipState_storeSequence(volatile uint32_t *sequence, uint32_t value)
+{
+    __atomic_store_n(sequence, value, __ATOMIC_RELEASE);
+}
+
+static inline void GDL90OwnshipState_writeFence(void) { __atomic_thread_fence(__ATOMIC_RELEASE); }
+static inline void GDL90OwnshipState_readFence(void) { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+#endif
+
+GDL90Result GDL90OwnshipState_init(GDL90OwnshipState *self)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    memset(self, 0, sizeof(*self));
+
+    return GDL90ResultOK;
+}
+
+static void GDL90OwnshipState_setField(GDL90OwnshipSnapshot *snapshot, GDL90OwnshipField field, uint64_t timeMs)
+{
+    snapshot->validFields |= 1u << field;
+    snapshot->fieldTimeMs[field] = timeMs;
+}
+
+static void GDL90OwnshipState_publish(GDL90OwnshipState *self)
+{
+    uint32_t sequence = self->sequence;
+
+    self->working.version++;
+
+    GDL90OwnshipState_storeSequence(&self->sequence, sequence + 1);
+    GDL90OwnshipState_writeFence();
+    memcpy((void *)&self->published, &self->working, sizeof(self->published));
+    GDL90OwnshipState_storeSequence(&self->sequence, sequence + 2);
+}
+
+GDL90Result GDL90OwnshipState_update(GDL90OwnshipState *self, uint64_t timeMs, GDL90Message *gdl90Message)
+{
+    if (!self || !gdl90Message) { return GDL90ResultFailure; }
+
+    GDL90OwnshipSnapshot *working = &self->working;
+
+    switch (gdl90Message->id)
+    {
+        case GDL90MessageType_OwnshipReport:
+        {
+            GDL90TrafficReport report;
+            if (GDL90TrafficReport_init(&report, gdl90Message) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+            working->report = report;
+            if (report.hasValidPosition)
+            {
+                working->latitude = report.latitude;
+                working->longitude = report.longitude;
+                working->navigationIntegrityCategory = report.navigationIntegrityCategory;
+                working->navigationAccuracyCategoryForPosition = report.navigationAccuracyCategoryForPosition;
+                GDL90OwnshipState_setField(working, GDL90OwnshipFieldPosition, timeMs);
+            }
+            if (report.hasValidHorizontalVelocity)
+            {
+                working->horizontalVelocity = report.horizontalVelocity;
+                working->trackHeadingType = report.trackHeadingType;
+                working->trackHeading = report.trackHeading;
+                GDL90OwnshipState_setField(working, GDL90OwnshipFieldHorizontalVelocity, timeMs);
+            }
+            if (report.hasValidVerticalVelocity)
+            {
+                working->verticalVelocity = report.verticalVelocity;
+                GDL90OwnshipState_setField(working, GDL90OwnshipFieldVerticalVelocity, timeMs);
+            }
+            if (report.hasValidAltitude)
+            {
+                working->pressureAltitude = report.altitude;
+                GDL90OwnshipState_setField(working, GDL90OwnshipFieldPressureAltitude, timeMs);
+            }
+            break;
+        }
+        case GDL90MessageType_OwnshipGeometricAltitude:
+        {
+            GDL90OwnshipGeometricAltitude geometricAltitude;
+            if (GDL90OwnshipGeometricAltitude_init(&geometricAltitude, gdl90Message) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+            working->geometricAltitude = geometricAltitude.geoAltitude;
+            working->verticalFigureOfMerit = geometricAltitude.verticalFigureOfMerit;
+            working->hasValidVFOM = geometricAltitude.hasValidVFOM;
+            working->verticalWarning = geometricAltitude.verticalWarning;
+            GDL90OwnshipState_setField(working, GDL90OwnshipFieldGeometricAltitude, timeMs);
+            break;
+        }
+        case GDL90MessageType_HeightAboveTerrain:
+        {
+            GDL90HeightAboveTerrain heightAboveTerrain;
+            if (GDL90HeightAboveTerrain_init(&heightAboveTerrain, gdl90Message) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+            if (heightAboveTerrain.heightAboveTerrain == INT16_MIN)
+            {
+                // invalid, the last value only ages
+                return GDL90ResultOK;
+            }
+            working->heightAboveTerrain = heightAboveTerrain.heightAboveTerrain;
+            GDL90OwnshipState_setField(working, GDL90OwnshipFieldHeightAboveTerrain, timeMs);
+            break;
+        }
+        default:
+            return GDL90ResultOK;
+    }
+
+    GDL90OwnshipState_publish(self);
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90OwnshipState_setTime(GDL90OwnshipState *self, uint64_t timeMs)
+{
+    if (!self) { return GDL90ResultFailure; }
+
+    self->currentTimeMs = timeMs;
+
+    return GDL90ResultOK;
+}
+
+void GDL90OwnshipState_handleFrame(GDL90Message *gdl90Message, void *context)
+{
+    GDL90OwnshipState *self = (GDL90OwnshipState *)context;
+    if (!self) { return; }
+
+    (void)GDL90OwnshipState_update(self, self->currentTimeMs, gdl90Message);
+}
+
+GDL90Result GDL90OwnshipState_read(const GDL90OwnshipState *self, GDL90OwnshipSnapshot *out)
+{
+    if (!self || !out) { return GDL90ResultFailure; }
+
+    for (;;)
+    {
+        uint32_t sequence = GDL90OwnshipState_loadSequence(&self->sequence);
+        if (sequence & 1) { continue; }
+
+        memcpy(out, (const void *)&self->published, sizeof(*out));
+
+        GDL90OwnshipState_readFence();
+        if (GDL90OwnshipState_loadSequence(&self->sequence) == sequence) { break; }
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90TrafficDeduplicator_init(GDL90TrafficDeduplicator *self, GDL90TargetTable *table, GDL90SpatialGrid *grid, uint32_t *peers)
+{
+    if (!self || !table || !table->slots || !grid || !grid->nodes || grid->capacity < table->capacity || !peers) { return GDL90ResultFailure; }
+
+    // chain the handler the table had, or keep the chained one on a new init of this stage
+    GDL90TargetTableRemovalHandler *nextRemovalHandler = table->removalHandler;
+    void *nextRemovalHandlerContext = table->removalHandlerContext;
+    if (nextRemovalHandler == GDL90TrafficDeduplicator_handleTargetRemoval && nextRemovalHandlerContext == self)
+    {
+        nextRemovalHandler = self->nextRemovalHandler;
+        nextRemovalHandlerContext = self->nextRemovalHandlerContext;
+    }
+
+    memset(self, 0, sizeof(*self));
+    self->table = table;
+    self->grid = grid;
+    self->peers = peers;
+    self->gateDistance = 1.0;
+    self->gateAltitude = 300;
+    self->gateVelocity = 50;
+    self->gateTrack = 30.0;
+    self->staleMs = 10000;
+
+    for (uint32_t i = 0; i < table->capacity; i++)
+    {
+        peers[i] = GDL90_TRAFFIC_NONE;
+    }
+
+    self->nextRemovalHandler = nextRemovalHandler;
+    self->nextRemovalHandlerContext = nextRemovalHandlerContext;
+
+    return GDL90TargetTable_setRemovalHandler(table, GDL90TrafficDeduplicator_handleTargetRemoval, self);
+}
+
+static inline uint8_t GDL90TrafficDeduplicator_isICAO(uint8_t addressType)
+{
+    return addressType == GDL90TrafficReportAddressTypeADSBWithICAO || addressType == GDL90TrafficReportAddressTypeTISBWithICAO;
+}
+
+static inline uint8_t GDL90TrafficDeduplicator_isADSB(uint8_t addressType)
+{
+    return addressType == GDL90TrafficReportAddressTypeADSBWithICAO || addressType == GDL90TrafficReportAddressTypeADSBSelfAssigned;
+}
+
+static uint8_t GDL90TrafficDeduplicator_gate(const GDL90TrafficDeduplicator *self, const GDL90TrafficReport *a, const GDL90TrafficReport *b)
+{
+    // different ICAO addresses are different aircraft, and a source doesn't duplicate its own tracks
+    if (a->addressType == b->addressType) { return 0; }
+    if (GDL90TrafficDeduplicator_isICAO(a->addressType) && GDL90TrafficDeduplicator_isICAO(b->addressType)) { return 0; }
+
+    if (a->hasValidAltitude && b->hasValidAltitude)
+    {
+        int32_t dAltitude = a->altitude - b->altitude;
+        if (dAltitude > self->gateAltitude || dAltitude < -self->gateAltitude) { return 0; }
+    }
+    if (a->hasValidHorizontalVelocity && b->hasValidHorizontalVelocity)
+    {
+        uint32_t dVelocity = a->horizontalVelocity > b->horizontalVelocity ? a->horizontalVelocity - b->horizontalVelocity : b->horizontalVelocity - a->horizontalVelocity;
+        if (dVelocity > self->gateVelocity) { return 0; }
+
+        if (a->trackHeadingType != GDL90TrafficReportTrackHeadingTypeInvalid && b->trackHeadingType != GDL90TrafficReportTrackHeadingTypeInvalid)
+        {
+            double dTrack = fabs(a->trackHeading - b->trackHeading);
+            dTrack = dTrack > 180.0 ? 360.0 - dTrack : dTrack;
+            if (dTrack > self->gateTrack) { return 0; }
+        }
+    }
+
+    return 1;
+}
+
+/** 1 if a is a better source than b */
+static uint8_t GDL90TrafficDeduplicator_isBetter(const GDL90TrafficReport *a, const GDL90TrafficReport *b)
+{
+    uint32_t qa = (uint32_t)a->navigationIntegrityCategory << 4 | a->navigationAccuracyCategoryForPosition;
+    uint32_t qb = (uint32_t)b->navigationIntegrityCategory << 4 | b->navigationAccuracyCategoryForPosition;
+    if (qa != qb) { return qa > qb; }
+
+    uint8_t adsbA = GDL90TrafficDeduplicator_isADSB(a->addressType);
+    uint8_t adsbB = GDL90TrafficDeduplicator_isADSB(b->addressType);
+    if (adsbA != adsbB) { return adsbA; }
+
+    return a->addressType < b->addressType;
+}
+
+static void GDL90TrafficDeduplicator_unlink(GDL90TrafficDeduplicator *self, uint32_t index)
+{
+    uint32_t peer = self->peers[index];
+    if (peer != GDL90_TRAFFIC_NONE && self->peers[peer] == index)
+    {
+        self->peers[peer] = GDL90_TRAFFIC_NONE;
+    }
+    self->peers[index] = GDL90_TRAFFIC_NONE;
+}
+
+static uint32_t GDL90TrafficDeduplicator_correlate(GDL90TrafficDeduplicator *self, uint64_t timeMs, uint32_t index)
+{
+    GDL90TargetTable *table = self->table;
+    const GDL90TrafficReport *report = &table->targets[index].report;
+    uint64_t staleTimeMs = timeMs > self->staleMs ? timeMs - self->staleMs : 0;
+
+    if (GDL90TrafficDeduplicator_isICAO(report->addressType))
+    {
+        uint8_t otherType = report->addressType == GDL90TrafficReportAddressTypeADSBWithICAO ? GDL90TrafficReportAddressTypeTISBWithICAO : GDL90TrafficReportAddressTypeADSBWithICAO;
+        GDL90Target *other = GDL90TargetTable_find(table, otherType, report->participantAddress);
+        if (other && other->updateTimeMs >= staleTimeMs)
+        {
+            return GDL90TargetTable_index(table, other);
+        }
+    }
+
+    if (!report->hasValidPosition) { return GDL90_TRAFFIC_NONE; }
+
+    uint32_t found[16];
+    uint32_t n = GDL90SpatialGrid_queryRadius(self->grid, report->latitude, report->longitude, self->gateDistance, INT32_MIN, INT32_MAX, found, 16);
+    n = n > 16 ? 16 : n;
+
+    uint32_t best = GDL90_TRAFFIC_NONE;
+    double bestDistance = 0.0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint32_t candidate = found[i];
+        const GDL90Target *other = &table->targets[candidate];
+        if (candidate == index || other->updateTimeMs < staleTimeMs) { continue; }
+        // already correlated with a third track
+        if (self->peers[candidate] != GDL90_TRAFFIC_NONE && self->peers[candidate] != index) { continue; }
+        if (!GDL90TrafficDeduplicator_gate(self, report, &other->report)) { continue; }
+
+        double dLat = other->report.latitude - report->latitude;
+        double dLon = (other->report.longitude - report->longitude) * cos(report->latitude * GDL90_TRAFFIC_DEG2RAD);
+        double distance = dLat * dLat + dLon * dLon;
+        if (best == GDL90_TRAFFIC_NONE || distance < bestDistance)
+        {
+            best = candidate;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
+
+GDL90Result GDL90TrafficDeduplicator_update(GDL90TrafficDeduplicator *self, uint64_t timeMs, const GDL90TrafficReport *report, GDL90Target **forward)
+{
+    if (!self || !self->table || !report || !forward) { return GDL90ResultFailure; }
+
+    GDL90Target *target = NULL;
+    if (GDL90TargetTable_update(self->table, timeMs, report, &target) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+    uint32_t index = GDL90TargetTable_index(self->table, target);
+    (void)GDL90SpatialGrid_updateTarget(self->grid, self->table, target);
+
+    uint32_t peer = GDL90TrafficDeduplicator_correlate(self, timeMs, index);
+    if (peer != self->peers[index])
+    {
+        GDL90TrafficDeduplicator_unlink(self, index);
+        if (peer != GDL90_TRAFFIC_NONE)
+        {
+            GDL90TrafficDeduplicator_unlink(self, peer);
+            self->peers[index] = peer;
+            self->peers[peer] = index;
+        }
+    }
+
+    if (peer == GDL90_TRAFFIC_NONE || GDL90TrafficDeduplicator_isBetter(&target->report, &self->table->targets[peer].report))
+    {
+        *forward = target;
+        self->forwardedCount++;
+    }
+    else
+    {
+        *forward = NULL;
+        self->suppressedCount++;
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Target* GDL90TrafficDeduplicator_peer(GDL90TrafficDeduplicator *self, const GDL90Target *target)
+{
+    if (!self || !self->table || !target) { return NULL; }
+
+    uint32_t peer = self->peers[GDL90TargetTable_index(self->table, target)];
+    return peer == GDL90_TRAFFIC_NONE ? NULL : &self->table->targets[peer];
+}
+
+void GDL90TrafficDeduplicator_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context)
+{
+    GDL90TrafficDeduplicator *self = (GDL90TrafficDeduplicator *)context;
+    if (!self) { return; }
+
+    GDL90TrafficDeduplicator_unlink(self, targetIndex);
+    (void)GDL90SpatialGrid_remove(self->grid, targetIndex);
+
+    if (self->nextRemovalHandler)
+    {
+        self->nextRemovalHandler(target, targetIndex, self->nextRemovalHandlerContext);
+    }
+}
+
+GDL90Result GDL90TrafficDecimator_init(GDL90TrafficDecimator *self, GDL90TargetTable *table, GDL90TrafficDecimatorState *states, uint64_t intervalMs)
+{
+    if (!self || !table || !table->slots || !states) { return GDL90ResultFailure; }
+
+    // chain the handler the table had, or keep the chained one on a new init of this stage
+    GDL90TargetTableRemovalHandler *nextRemovalHandler = table->removalHandler;
+    void *nextRemovalHandlerContext = table->removalHandlerContext;
+    if (nextRemovalHandler == GDL90TrafficDecimator_handleTargetRemoval && nextRemovalHandlerContext == self)
+    {
+        nextRemovalHandler = self->nextRemovalHandler;
+        nextRemovalHandlerContext = self->nextRemovalHandlerContext;
+    }
+
+    memset(self, 0, sizeof(*self));
+    self->table = table;
+    self->states = states;
+    self->head = GDL90_TRAFFIC_NONE;
+    self->tail = GDL90_TRAFFIC_NONE;
+    self->intervalMs = intervalMs;
+    self->altitudeThreshold = 200;
+    self->verticalVelocityThreshold = 500;
+    self->horizontalVelocityThreshold = 20;
+    self->trackThreshold = 10.0f;
+
+    memset(states, 0, table->capacity * sizeof(*states));
+    for (uint32_t i = 0; i < table->capacity; i++)
+    {
+        states[i].previous = GDL90_TRAFFIC_NONE;
+        states[i].next = GDL90_TRAFFIC_NONE;
+    }
+
+    self->nextRemovalHandler = nextRemovalHandler;
+    self->nextRemovalHandlerContext = nextRemovalHandlerContext;
+
+    return GDL90TargetTable_setRemovalHandler(table, GDL90TrafficDecimator_handleTargetRemoval, self);
+}
+
+static void GDL90TrafficDecimator_unlink(GDL90TrafficDecimator *self, uint32_t index)
+{
+    GDL90TrafficDecimatorState *state = &self->states[index];
+    if (state->previous != GDL90_TRAFFIC_NONE) { self->states[state->previous].next = state->next; }
+    else if (self->head == index) { self->head = state->next; }
+    if (state->next != GDL90_TRAFFIC_NONE) { self->states[state->next].previous = state->previous; }
+    else if (self->tail == index) { self->tail = state->previous; }
+    state->previous = GDL90_TRAFFIC_NONE;
+    state->next = GDL90_TRAFFIC_NONE;
+}
+
+/** Marks the target forwarded at timeMs, moving it to the end of the list */
+static void GDL90TrafficDecimator_forward(GDL90TrafficDecimator *self, uint64_t timeMs, uint32_t index)
+{
+    GDL90TrafficDecimatorState *state = &self->states[index];
+    const GDL90TrafficReport *report = &self->table->targets[index].report;
+
+    GDL90TrafficDecimator_unlink(self, index);
+    state->previous = self->tail;
+    if (self->tail != GDL90_TRAFFIC_NONE) { self->states[self->tail].next = index; }
+    else { self->head = index; }
+    self->tail = index;
+
+    state->forwardTimeMs = timeMs;
+    state->altitude = report->altitude;
+    state->verticalVelocity = report->verticalVelocity;
+    state->horizontalVelocity = report->horizontalVelocity;
+    state->trackHeading = (float)report->trackHeading;
+    state->alertStatus = report->alertStatus;
+    state->emergencyPriorityCode = report->emergencyPriorityCode;
+    state->airGroundState = report->airGroundState;
+    state->pending = 0;
+    state->forwarded = 1;
+    self->forwardedCount++;
+}
+
+static uint8_t GDL90TrafficDecimator_hasChanged(const GDL90TrafficDecimator *self, const GDL90TrafficDecimatorState *state, const GDL90TrafficReport *report)
+{
+    if (report->alertStatus != state->alertStatus || report->emergencyPriorityCode != state->emergencyPriorityCode || report->airGroundState != state->airGroundState) { return 1; }
+
+    int32_t dAltitude = report->altitude - state->altitude;
+    if (report->hasValidAltitude && (dAltitude >= self->altitudeThreshold || dAltitude <= -self->altitudeThreshold)) { return 1; }
+
+    int32_t dVerticalVelocity = report->verticalVelocity - state->verticalVelocity;
+    if (report->hasValidVerticalVelocity && (dVerticalVelocity >= self->verticalVelocityThreshold || dVerticalVelocity <= -self->verticalVelocityThreshold)) { return 1; }
+
+    if (report->hasValidHorizontalVelocity)
+    {
+        uint32_t dVelocity = report->horizontalVelocity > state->horizontalVelocity ? report->horizontalVelocity - state->horizontalVelocity : state->horizontalVelocity - report->horizontalVelocity;
+        if (dVelocity >= self->horizontalVelocityThreshold) { return 1; }
+    }
+
+    if (report->trackHeadingType != GDL90TrafficReportTrackHeadingTypeInvalid)
+    {
+        float dTrack = fabsf((float)report->trackHeading - state->trackHeading);
+        dTrack = dTrack > 180.0f ? 360.0f - dTrack : dTrack;
+        if (dTrack >= self->trackThreshold) { return 1; }
+    }
+
+    return 0;
+}
+
+GDL90Result GDL90TrafficDecimator_update(GDL90TrafficDecimator *self, uint64_t timeMs, const GDL90TrafficReport *report, GDL90Target **forward)
+{
+    if (!self || !self->table || !report || !forward) { return GDL90ResultFailure; }
+
+    GDL90Target *target = NULL;
+    if (GDL90TargetTable_update(self->table, timeMs, report, &target) != GDL90ResultOK) { return GDL90ResultFailure; }
+
+    uint32_t index = GDL90TargetTable_index(self->table, target);
+    GDL90TrafficDecimatorState *state = &self->states[index];
+    self->receivedCount++;
+
+    // not target->updateCount : other stages (eg. a GDL90TrafficDeduplicator) update the same table
+    uint8_t isNew = !state->forwarded;
+    uint8_t isDue = timeMs >= state->forwardTimeMs + self->intervalMs;
+    if (isNew || isDue || report->alertStatus || report->emergencyPriorityCode || GDL90TrafficDecimator_hasChanged(self, state, report))
+    {
+        self->immediateCount += !isNew && !isDue;
+        GDL90TrafficDecimator_forward(self, timeMs, index);
+        *forward = target;
+    }
+    else
+    {
+        if (state->pending)
+        {
+            self->coalescedCount++;
+            self->savedBytes += GDL90_TRAFFIC_REPORT_FRAME_SIZE;
+        }
+        state->pending = 1;
+        *forward = NULL;
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Target* GDL90TrafficDecimator_nextDue(GDL90TrafficDecimator *self, uint64_t timeMs)
+{
+    if (!self || !self->table) { return NULL; }
+
+    while (self->head != GDL90_TRAFFIC_NONE)
+    {
+        uint32_t index = self->head;
+        GDL90TrafficDecimatorState *state = &self->states[index];
+        if (timeMs < state->forwardTimeMs + self->intervalMs) { return NULL; }
+
+        if (state->pending)
+        {
+            GDL90TrafficDecimator_forward(self, timeMs, index);
+            return &self->table->targets[index];
+        }
+        // up to date, the next report is forwarded at once
+        GDL90TrafficDecimator_unlink(self, index);
+    }
+
+    return NULL;
+}
+
+void GDL90TrafficDecimator_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context)
+{
+    GDL90TrafficDecimator *self = (GDL90TrafficDecimator *)context;
+    if (!self) { return; }
+
+    GDL90TrafficDecimator_unlink(self, targetIndex);
+    if (self->states[targetIndex].pending)
+    {
+        self->coalescedCount++;
+        self->savedBytes += GDL90_TRAFFIC_REPORT_FRAME_SIZE;
+    }
+    // the next target of the slot starts anew
+    memset(&self->states[targetIndex], 0, sizeof(self->states[targetIndex]));
+    self->states[targetIndex].previous = GDL90_TRAFFIC_NONE;
+    self->states[targetIndex].next = GDL90_TRAFFIC_NONE;
+
+    if (self->nextRemovalHandler)
+    {
+        self->nextRemovalHandler(target, targetIndex, self->nextRemovalHandlerContext);
+    }
+}
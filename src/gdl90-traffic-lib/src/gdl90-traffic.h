@@ -0,0 +1,502 @@
+//
+//  gdl90-traffic.h
+//  gdl90-traffic-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Traffic picture building blocks on top of GDL90TrafficReport.
+// Like the core lib, nothing here allocates : all storage is supplied by the
+// caller at init and capacities are fixed from then on.
+
+#ifndef __gdl90__gdl90_traffic_h__
+#define __gdl90__gdl90_traffic_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Invalid index */
+#define GDL90_TRAFFIC_NONE UINT32_MAX
+
+/** Latest known state of a target */
+typedef struct GDL90Target
+{
+    /** GDL90TargetTable_key of the target, 0 if unused */
+    uint32_t key;
+    /** Number of reports received */
+    uint32_t updateCount;
+    /** Time the last report was received (ms) */
+    uint64_t updateTimeMs;
+    /** Time the target was first seen (ms) */
+    uint64_t firstSeenTimeMs;
+    /** Last report received for the target */
+    GDL90TrafficReport report;
+} GDL90Target;
+
+/** Key of a target in a GDL90TargetTable (never 0) */
+static inline uint32_t GDL90TargetTable_key(uint8_t addressType, uint32_t participantAddress)
+{
+    return (uint32_t)1<<31 | (uint32_t)(addressType & 0x0f) << 24 | (participantAddress & 0xffffff);
+}
+
+typedef struct GDL90TargetTableSlot
+{
+    /** GDL90TargetTable_key, 0 if the slot is empty */
+    uint32_t key;
+    /** Index of the target in GDL90TargetTable.targets */
+    uint32_t target;
+} GDL90TargetTableSlot;
+
+/** Called for each target about to be removed from a GDL90TargetTable (evict, remove) */
+typedef void (GDL90TargetTableRemovalHandler)(GDL90Target *, uint32_t targetIndex, void *context);
+
+/**
+ * Open addressing (linear probing) map of (addressType, participantAddress) to GDL90Target.
+ * Slots are a dense array of 8 byte key/index pairs so a probe touches one or two cache lines,
+ * and removals use backward shift deletion so no tombstones build up.
+ * Targets themselves never move while in the table, so their index (GDL90TargetTable_index)
+ * can be used to keep per target state in other components' arrays of the same capacity.
+ */
+typedef struct GDL90TargetTable
+{
+    /** slots[capacity] */
+    GDL90TargetTableSlot *slots;
+    /** targets[capacity] */
+    GDL90Target *targets;
+    uint32_t capacity;
+    uint32_t count;
+    /** Inserts are refused above this count (7/8 of the capacity) */
+    uint32_t maxCount;
+    /** Where to start looking for a free target */
+    uint32_t allocCursor;
+    uint8_t hashShift;
+
+    GDL90TargetTableRemovalHandler *removalHandler;
+    void *removalHandlerContext;
+} GDL90TargetTable;
+
+/** slots and targets must have capacity (a power of 2, >= 8) elements */
+GDL90Result GDL90TargetTable_init(GDL90TargetTable *, GDL90TargetTableSlot *slots, GDL90Target *targets, uint32_t capacity);
+GDL90Result GDL90TargetTable_setRemovalHandler(GDL90TargetTable *, GDL90TargetTableRemovalHandler *removalHandler, void *context);
+/** Removes all targets */
+GDL90Result GDL90TargetTable_clear(GDL90TargetTable *);
+/** Inserts or updates the target of the report, fails if the table is full */
+GDL90Result GDL90TargetTable_update(GDL90TargetTable *, uint64_t timeMs, const GDL90TrafficReport *report, GDL90Target **outTarget);
+/** NULL if not found */
+GDL90Target* GDL90TargetTable_find(GDL90TargetTable *, uint8_t addressType, uint32_t participantAddress);
+GDL90Result GDL90TargetTable_remove(GDL90TargetTable *, uint8_t addressType, uint32_t participantAddress);
+/** Removes the targets not updated since staleTimeMs, returns the number removed */
+uint32_t GDL90TargetTable_evict(GDL90TargetTable *, uint64_t staleTimeMs);
+/** Iterates the targets, start with *cursor = 0, NULL at the end (removing the returned target is fine) */
+GDL90Target* GDL90TargetTable_next(GDL90TargetTable *, uint32_t *cursor);
+
+static inline uint32_t GDL90TargetTable_index(const GDL90TargetTable *self, const GDL90Target *target)
+{
+    return (uint32_t)(target - self->targets);
+}
+
+typedef struct GDL90SpatialGridNode
+{
+    double latitude;
+    double longitude;
+    int32_t altitude;
+    uint8_t hasValidAltitude;
+    /** Set while the node is in the grid */
+    uint8_t inGrid;
+    /** Cell coordinates (lon, lat) */
+    int32_t cellX;
+    int32_t cellY;
+    /** Bucket list links (GDL90_TRAFFIC_NONE terminated) */
+    uint32_t prev;
+    uint32_t next;
+} GDL90SpatialGridNode;
+
+/**
+ * Uniform lat/lon grid of nodes identified by an index in [0, capacity), typically
+ * the GDL90TargetTable_index of a target. Cells are hashed into a fixed number of
+ * buckets, so only the cells around a query are visited : the cost of a query grows
+ * with the number of targets around it, not with the number of targets in the grid.
+ */
+typedef struct GDL90SpatialGrid
+{
+    /** Cell size (degrees of latitude and longitude) */
+    double cellSize;
+    /** Number of cells around a parallel */
+    int32_t lonCells;
+    /** Number of cells from pole to pole */
+    int32_t latCells;
+    /** buckets[bucketCount] (first node of the bucket or GDL90_TRAFFIC_NONE) */
+    uint32_t *buckets;
+    uint32_t bucketCount;
+    /** nodes[capacity] */
+    GDL90SpatialGridNode *nodes;
+    uint32_t capacity;
+    uint32_t count;
+} GDL90SpatialGrid;
+
+/** cellSize in degrees (eg. 0.25), bucketCount a power of 2, nodes[capacity] */
+GDL90Result GDL90SpatialGrid_init(GDL90SpatialGrid *, double cellSize, uint32_t *buckets, uint32_t bucketCount, GDL90SpatialGridNode *nodes, uint32_t capacity);
+/** Inserts or moves a node, only relinking it if its cell changed */
+GDL90Result GDL90SpatialGrid_update(GDL90SpatialGrid *, uint32_t index, double latitude, double longitude, uint8_t hasValidAltitude, int32_t altitude);
+GDL90Result GDL90SpatialGrid_remove(GDL90SpatialGrid *, uint32_t index);
+/** Updates (or removes, if its position isn't valid) the node of a target of the table */
+GDL90Result GDL90SpatialGrid_updateTarget(GDL90SpatialGrid *, const GDL90TargetTable *table, const GDL90Target *target);
+/** GDL90TargetTableRemovalHandler, use with GDL90TargetTable_setRemovalHandler(&table, GDL90SpatialGrid_handleTargetRemoval, &grid) */
+void GDL90SpatialGrid_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context);
+/**
+ * Indexes of the nodes in the box (minLongitude > maxLongitude crosses the antimeridian)
+ * and altitude range (INT32_MIN, INT32_MAX to include nodes without a valid altitude).
+ * Writes up to maxCount indexes to out, returns the number of nodes found.
+ */
+uint32_t GDL90SpatialGrid_queryBox(GDL90SpatialGrid *, double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int32_t minAltitude, int32_t maxAltitude, uint32_t *out, uint32_t maxCount);
+/** Like GDL90SpatialGrid_queryBox, for the nodes within radius (nm) of a position */
+uint32_t GDL90SpatialGrid_queryRadius(GDL90SpatialGrid *, double latitude, double longitude, double radius, int32_t minAltitude, int32_t maxAltitude, uint32_t *out, uint32_t maxCount);
+
+typedef enum GDL90ExtrapolationFlag
+{
+    /** The slot holds a target */
+    GDL90ExtrapolationFlagActive = 1<<0,
+    /** Position is projected (valid track/heading and horizontal velocity) */
+    GDL90ExtrapolationFlagHorizontal = 1<<1,
+    /** Altitude is projected (valid altitude and vertical velocity) */
+    GDL90ExtrapolationFlagVertical = 1<<2,
+    /** The report itself was already extrapolated by the source (reportStatus) */
+    GDL90ExtrapolationFlagSourceExtrapolated = 1<<3,
+    /** The last projection hit the maximum extrapolation time */
+    GDL90ExtrapolationFlagLimited = 1<<4,
+    /** The report has a valid (pressure) altitude */
+    GDL90ExtrapolationFlagAltitude = 1<<5
+} GDL90ExtrapolationFlag;
+
+/**
+ * Dead reckoning of targets (by index, eg. GDL90TargetTable_index) between reports.
+ * The trig is done once per report, turning track and speeds into per second lat/lon/alt
+ * rates, so a projection is a couple of multiply-adds per target over struct-of-arrays
+ * float state, a branch free loop compilers vectorize (checked with gcc -O3 -fopt-info-vec).
+ */
+typedef struct GDL90Extrapolator
+{
+    uint32_t capacity;
+    /** Projections stop this long after the report (ms) */
+    uint32_t maxExtrapolationMs;
+    /** Projections of reports that were already extrapolated by the source stop this long after the report (ms) */
+    uint32_t maxSourceExtrapolatedMs;
+    /** Added to magnetic headings (degrees, east positive) */
+    float magneticVariation;
+
+    /** Times are kept as float offsets (exact ms) from this one, moved forward as time passes */
+    uint64_t baseTimeMs;
+    /** Report time (ms from baseTimeMs) */
+    float *timeMs;
+    /** Projection horizon (ms) */
+    float *horizonMs;
+    /** Report position (degrees, ft) */
+    float *latitude;
+    float *longitude;
+    float *altitude;
+    /** Rates (degrees/s, ft/s), 0 when not projected */
+    float *latitudeRate;
+    float *longitudeRate;
+    float *altitudeRate;
+    /** GDL90ExtrapolationFlag */
+    uint8_t *flags;
+
+    /** Results of the last GDL90Extrapolator_project */
+    float *outLatitude;
+    float *outLongitude;
+    float *outAltitude;
+} GDL90Extrapolator;
+
+/** Bytes of storage needed by a GDL90Extrapolator of capacity targets */
+#define GDL90_EXTRAPOLATOR_STORAGE_SIZE(capacity) ((size_t)(capacity) * (11 * sizeof(float) + sizeof(uint8_t)))
+/** Largest time offset from baseTimeMs (ms), well within the 24 bits of exact float integers */
+#define GDL90_EXTRAPOLATOR_REBASE_MS (1u << 22)
+
+/** storage (8 byte aligned) of storageSize >= GDL90_EXTRAPOLATOR_STORAGE_SIZE(capacity) */
+GDL90Result GDL90Extrapolator_init(GDL90Extrapolator *, void *storage, size_t storageSize, uint32_t capacity, uint32_t maxExtrapolationMs);
+GDL90Result GDL90Extrapolator_update(GDL90Extrapolator *, uint32_t index, uint64_t timeMs, const GDL90TrafficReport *report);
+GDL90Result GDL90Extrapolator_updateTarget(GDL90Extrapolator *, const GDL90TargetTable *table, const GDL90Target *target);
+GDL90Result GDL90Extrapolator_remove(GDL90Extrapolator *, uint32_t index);
+/** GDL90TargetTableRemovalHandler, use with GDL90TargetTable_setRemovalHandler(&table, GDL90Extrapolator_handleTargetRemoval, &extrapolator) */
+void GDL90Extrapolator_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context);
+/** Projects all targets to timeMs into outLatitude, outLongitude and outAltitude */
+GDL90Result GDL90Extrapolator_project(GDL90Extrapolator *, uint64_t timeMs);
+
+/**
+ * Closest point of approach of every target (from a GDL90Extrapolator) to ownship, assuming
+ * straight line motion in a flat plane around ownship. A target is in conflict when the
+ * horizontal miss distance and the vertical separation at that time are both under the
+ * thresholds within the lookahead time (targets without altitude only need the horizontal one).
+ */
+typedef struct GDL90ConflictProbe
+{
+    uint32_t capacity;
+    /** nm */
+    float horizontalThreshold;
+    /** ft */
+    float verticalThreshold;
+    /** s */
+    float lookahead;
+
+    /** Results of the last GDL90ConflictProbe_evaluate, by target index */
+    /** Time to CPA (s), 0 when diverging, at most lookahead */
+    float *timeToCPA;
+    /** Horizontal distance at CPA (nm) */
+    float *horizontalCPA;
+    /** Vertical separation at CPA (ft, target above ownship is positive) */
+    float *verticalCPA;
+    /** 1 when in conflict */
+    uint8_t *conflict;
+} GDL90ConflictProbe;
+
+/** Bytes of storage needed by a GDL90ConflictProbe of capacity targets */
+#define GDL90_CONFLICT_PROBE_STORAGE_SIZE(capacity) ((size_t)(capacity) * (3 * sizeof(float) + sizeof(uint8_t)))
+
+/** storage (4 byte aligned) of storageSize >= GDL90_CONFLICT_PROBE_STORAGE_SIZE(capacity), thresholds in nm and ft, lookahead in s */
+GDL90Result GDL90ConflictProbe_init(GDL90ConflictProbe *, void *storage, size_t storageSize, uint32_t capacity, float horizontalThreshold, float verticalThreshold, float lookahead);
+/**
+ * Evaluates all active targets of the extrapolator, as last projected, against ownship (the
+ * report of GDL90MessageType_OwnshipReport at the same time). Returns the number of conflicts.
+ */
+uint32_t GDL90ConflictProbe_evaluate(GDL90ConflictProbe *, const GDL90Extrapolator *targets, const GDL90TrafficReport *ownship);
+
+typedef enum GDL90OwnshipField
+{
+    /** Latitude, longitude, NIC and NACp of the Ownship Report */
+    GDL90OwnshipFieldPosition,
+    /** Horizontal velocity and track/heading of the Ownship Report */
+    GDL90OwnshipFieldHorizontalVelocity,
+    /** Vertical velocity of the Ownship Report */
+    GDL90OwnshipFieldVerticalVelocity,
+    /** Pressure altitude of the Ownship Report */
+    GDL90OwnshipFieldPressureAltitude,
+    /** Ownship Geometric Altitude (and VFOM) */
+    GDL90OwnshipFieldGeometricAltitude,
+    /** Height Above Terrain */
+    GDL90OwnshipFieldHeightAboveTerrain,
+    GDL90OwnshipFieldCount
+} GDL90OwnshipField;
+
+/** Consistent copy of the fused ownship state */
+typedef struct GDL90OwnshipSnapshot
+{
+    /** Incremented by every update, 0 before the first one */
+    uint32_t version;
+    /** Bit (1 << GDL90OwnshipField) set once the field had a valid value */
+    uint32_t validFields;
+    /** Time (ms) of the last valid value of each GDL90OwnshipField */
+    uint64_t fieldTimeMs[GDL90OwnshipFieldCount];
+
+    /** Last Ownship Report, its fields are only current when valid */
+    GDL90TrafficReport report;
+    /** Last valid position, velocity and pressure altitude, kept across reports where they are invalid */
+    double latitude;
+    double longitude;
+    uint8_t navigationIntegrityCategory;
+    uint8_t navigationAccuracyCategoryForPosition;
+    uint32_t horizontalVelocity;
+    GDL90TrafficReportTrackHeadingType trackHeadingType;
+    double trackHeading;
+    int32_t verticalVelocity;
+    int32_t pressureAltitude;
+    /** Geometric altitude (ft) */
+    int32_t geometricAltitude;
+    /** Vertical Figure of Merit (m) */
+    uint16_t verticalFigureOfMerit;
+    uint8_t hasValidVFOM;
+    uint8_t verticalWarning;
+    /** Height Above Terrain (ft) */
+    int16_t heightAboveTerrain;
+} GDL90OwnshipSnapshot;
+
+/** Age (ms) of a field at timeMs, UINT64_MAX if it never had a valid value */
+static inline uint64_t GDL90OwnshipSnapshot_age(const GDL90OwnshipSnapshot *self, GDL90OwnshipField field, uint64_t timeMs)
+{
+    if (!(self->validFields & (1u << field))) { return UINT64_MAX; }
+    return timeMs > self->fieldTimeMs[field] ? timeMs - self->fieldTimeMs[field] : 0;
+}
+
+/**
+ * Ownship Report, Ownship Geometric Altitude and Height Above Terrain fused into one state.
+ * Updated by a single thread (the one calling GDL90Stream_process) and read from any other
+ * with GDL90OwnshipState_read, a sequence lock that never blocks the writer nor returns a
+ * torn snapshot.
+ */
+typedef struct GDL90OwnshipState
+{
+    /** Odd while the published snapshot is being written */
+    volatile uint32_t sequence;
+    GDL90OwnshipSnapshot published;
+
+    /** Writer side */
+    GDL90OwnshipSnapshot working;
+    /** Receive time used by GDL90OwnshipState_handleFrame */
+    uint64_t currentTimeMs;
+} GDL90OwnshipState;
+
+GDL90Result GDL90OwnshipState_init(GDL90OwnshipState *);
+/** Updates from an Ownship Report, Ownship Geometric Altitude or Height Above Terrain message, other messages are ignored */
+GDL90Result GDL90OwnshipState_update(GDL90OwnshipState *, uint64_t timeMs, GDL90Message *gdl90Message);
+/** Sets the receive time of the frames of the next GDL90Stream_process call */
+GDL90Result GDL90OwnshipState_setTime(GDL90OwnshipState *, uint64_t timeMs);
+/** GDL90StreamFrameHandler, use with GDL90StreamConfig_setFrameHandler(&config, GDL90OwnshipState_handleFrame, &ownship), or GDL90FrameHandlers_add(&handlers, GDL90OwnshipState_handleFrame, &ownship) to share the stream */
+void GDL90OwnshipState_handleFrame(GDL90Message *gdl90Message, void *context);
+/** Copies the last published state, safe from any thread */
+GDL90Result GDL90OwnshipState_read(const GDL90OwnshipState *, GDL90OwnshipSnapshot *out);
+
+/**
+ * Suppresses the duplicate tracks of an aircraft reported by several sources (eg. ADS-B with
+ * ICAO and a TIS-B track file ID). Tracks are correlated by ICAO address between ADS-B and
+ * TIS-B, otherwise by gating position, altitude and velocity against the tracks of other
+ * address types found in a GDL90SpatialGrid. Of correlated tracks, only the one with the best
+ * NIC/NACp (then ADS-B over TIS-B) is forwarded.
+ */
+typedef struct GDL90TrafficDeduplicator
+{
+    GDL90TargetTable *table;
+    GDL90SpatialGrid *grid;
+    /** peers[table capacity], correlated track by target index (GDL90_TRAFFIC_NONE if none) */
+    uint32_t *peers;
+
+    /** Gates (defaults 1 nm, 300 ft, 50 kt, 30 degrees) */
+    double gateDistance;
+    int32_t gateAltitude;
+    uint32_t gateVelocity;
+    double gateTrack;
+    /** Tracks not updated for this long (ms) are not correlated (default 10000) */
+    uint64_t staleMs;
+
+    /** Removal handler the table had before GDL90TrafficDeduplicator_init, called after this one */
+    GDL90TargetTableRemovalHandler *nextRemovalHandler;
+    void *nextRemovalHandlerContext;
+
+    /** Statistics */
+    uint64_t forwardedCount;
+    uint64_t suppressedCount;
+} GDL90TrafficDeduplicator;
+
+/**
+ * Uses table and sets its removal handler, chaining the one it had : set other handlers (eg.
+ * GDL90Extrapolator_handleTargetRemoval) before, stages like GDL90TrafficDecimator chain this
+ * one in turn. grid must have been initialized with nodes[table capacity] and peers must have
+ * table capacity elements.
+ */
+GDL90Result GDL90TrafficDeduplicator_init(GDL90TrafficDeduplicator *, GDL90TargetTable *table, GDL90SpatialGrid *grid, uint32_t *peers);
+/**
+ * Updates the track of the report and correlates it, *forward is the updated target when it
+ * should be passed on, NULL when it is a duplicate of a better source.
+ */
+GDL90Result GDL90TrafficDeduplicator_update(GDL90TrafficDeduplicator *, uint64_t timeMs, const GDL90TrafficReport *report, GDL90Target **forward);
+/**
+ * The track correlated with target, NULL if none. When a forwarded target has a peer, the
+ * peer was the previous best source of the aircraft and should no longer be displayed.
+ */
+GDL90Target* GDL90TrafficDeduplicator_peer(GDL90TrafficDeduplicator *, const GDL90Target *target);
+/** GDL90TargetTableRemovalHandler, set by GDL90TrafficDeduplicator_init, also keeps the grid in sync and calls the chained handler */
+void GDL90TrafficDeduplicator_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context);
+
+/** Size of a framed Traffic Report (flags, id, data and CRC, unescaped) for the byte counts */
+#define GDL90_TRAFFIC_REPORT_FRAME_SIZE (1 + 1 + 27 + 2 + 1)
+
+/** Per target state of a GDL90TrafficDecimator */
+typedef struct GDL90TrafficDecimatorState
+{
+    /** Time the target was last forwarded (ms) */
+    uint64_t forwardTimeMs;
+    /** State last forwarded, to detect large changes */
+    int32_t altitude;
+    int32_t verticalVelocity;
+    uint32_t horizontalVelocity;
+    float trackHeading;
+    uint8_t alertStatus;
+    int8_t emergencyPriorityCode;
+    uint8_t airGroundState;
+    /** The target has a newer report than the one forwarded */
+    uint8_t pending;
+    /** A report of the target was forwarded, its next ones are decimated */
+    uint8_t forwarded;
+    /** Links of the list of forwarded targets, oldest first (GDL90_TRAFFIC_NONE if none) */
+    uint32_t previous;
+    uint32_t next;
+} GDL90TrafficDecimatorState;
+
+/**
+ * Limits the update rate of every target to one report per intervalMs, eg. for displays on slow
+ * links. Alerts, emergencies, new targets and large changes (altitude, vertical velocity,
+ * velocity, track, air/ground) since the report last forwarded always pass at once, the other
+ * reports are coalesced into the latest state of the target in the table, forwarded by
+ * GDL90TrafficDecimator_nextDue once the interval is over. Forwarded targets are kept in a list
+ * in forward time order, so both are O(1) per report.
+ */
+typedef struct GDL90TrafficDecimator
+{
+    GDL90TargetTable *table;
+    /** states[table capacity], by target index */
+    GDL90TrafficDecimatorState *states;
+    uint32_t head;
+    uint32_t tail;
+
+    /** Minimum time between 2 reports of a target (ms) */
+    uint64_t intervalMs;
+    /** Large changes (defaults 200 ft, 500 ft/min, 20 kt, 10 degrees) */
+    int32_t altitudeThreshold;
+    int32_t verticalVelocityThreshold;
+    uint32_t horizontalVelocityThreshold;
+    float trackThreshold;
+
+    /** Statistics */
+    uint64_t receivedCount;
+    uint64_t forwardedCount;
+    /** Of forwardedCount, reports forwarded before the end of the interval (alert, emergency, change) */
+    uint64_t immediateCount;
+    /** Reports replaced by a newer one before being forwarded, ie. not processed downstream */
+    uint64_t coalescedCount;
+    /** Bytes not sent downstream (coalescedCount Traffic Reports) */
+    uint64_t savedBytes;
+
+    /** Removal handler the table had before GDL90TrafficDecimator_init, called after this one */
+    GDL90TargetTableRemovalHandler *nextRemovalHandler;
+    void *nextRemovalHandlerContext;
+} GDL90TrafficDecimator;
+
+/** Uses table and sets its removal handler, chaining the one it had (see GDL90TrafficDeduplicator_init), states must have table capacity elements */
+GDL90Result GDL90TrafficDecimator_init(GDL90TrafficDecimator *, GDL90TargetTable *table, GDL90TrafficDecimatorState *states, uint64_t intervalMs);
+/**
+ * Updates the target of the report, *forward is the target when its report should be passed
+ * on now, NULL when it is coalesced
+ */
+GDL90Result GDL90TrafficDecimator_update(GDL90TrafficDecimator *, uint64_t timeMs, const GDL90TrafficReport *report, GDL90Target **forward);
+/** Next target with a coalesced report whose interval is over at timeMs (marked forwarded), NULL if none */
+GDL90Target* GDL90TrafficDecimator_nextDue(GDL90TrafficDecimator *, uint64_t timeMs);
+/** GDL90TargetTableRemovalHandler, set by GDL90TrafficDecimator_init, calls the chained handler */
+void GDL90TrafficDecimator_handleTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_traffic_h__) */
@@ -0,0 +1,364 @@
+//
+//  gdl90-uat.c
+//  gdl90-uat-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "gdl90-uat.h"
+
+#include <math.h>
+#include <string.h>
+
+/** Reads count (<= 24) bits starting at bit offset (MSB first) */
+static inline uint32_t GDL90UAT_bits(const uint8_t *data, uint32_t offset, uint32_t count)
+{
+    const uint8_t *p = data + (offset >> 3);
+    uint32_t v = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+    return (v << (offset & 7)) >> (32 - count);
+}
+
+GDL90Result GDL90UATUplink_init(GDL90UATUplink *self, const uint8_t *payload, size_t len)
+{
+    if (!self || !payload || len < GDL90_UAT_UPLINK_PAYLOAD_SIZE) { return GDL90ResultFailure; }
+
+    static const double latlonRes = 360.0 / (double)(1<<24);
+
+    GDL90UATUplinkHeader *header = &self->header;
+
+    uint32_t lat = (uint32_t)payload[0] << 15 | (uint32_t)payload[1] << 7 | (uint32_t)payload[2] >> 1;
+    uint32_t lon = ((uint32_t)payload[2] & 0x01) << 23 | (uint32_t)payload[3] << 15 | (uint32_t)payload[4] << 7 | (uint32_t)payload[5] >> 1;
+    header->latitude = lat * latlonRes;
+    header->latitude -= header->latitude > 90.0 ? 180.0 : 0.0;
+    header->longitude = lon * latlonRes;
+    header->longitude -= header->longitude > 180.0 ? 360.0 : 0.0;
+    header->hasValidPosition = payload[5] & 0x01;
+    header->utcCoupled = (payload[6] & 0x80) != 0;
+    header->hasValidApplicationData = (payload[6] & 0x20) != 0;
+    header->slotId = payload[6] & 0x1f;
+    header->tisbSiteId = payload[7] >> 4;
+
+    self->payload = payload;
+    self->offset = GDL90_UAT_UPLINK_HEADER_SIZE;
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90UATUplink_initWithMessage(GDL90UATUplink *self, const GDL90Message *gdl90Message)
+{
+    // id, 3 bytes of time of reception, payload, FCS
+    if (!gdl90Message || gdl90Message->id != GDL90MessageType_UplinkData || gdl90Message->dataLength < 4 + GDL90_UAT_UPLINK_PAYLOAD_SIZE) { return GDL90ResultFailure; }
+
+    return GDL90UATUplink_init(self, gdl90Message->data + 4, GDL90_UAT_UPLINK_PAYLOAD_SIZE);
+}
+
+GDL90Result GDL90UATUplink_nextFrame(GDL90UATUplink *self, GDL90UATInfoFrame *frame)
+{
+    if (!self || !self->payload || !frame || !self->header.hasValidApplicationData) { return GDL90ResultFailure; }
+
+    // 2 bytes of frame header
+    if (self->offset + 2 > GDL90_UAT_UPLINK_PAYLOAD_SIZE) { return GDL90ResultFailure; }
+
+    const uint8_t *p = self->payload + self->offset;
+    uint16_t length = (uint16_t)((uint16_t)p[0] << 1 | p[1] >> 7);
+
+    // a 0 length ends the chain, the rest is padding
+    if (length == 0 || self->offset + 2 + length > GDL90_UAT_UPLINK_PAYLOAD_SIZE) { return GDL90ResultFailure; }
+
+    frame->type = p[1] & 0x0f;
+    frame->length = length;
+    frame->data = p + 2;
+    self->offset = (uint16_t)(self->offset + 2 + length);
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90UATAPDU_init(GDL90UATAPDU *self, const GDL90UATInfoFrame *frame)
+{
+    if (!self || !frame || !frame->data || frame->type != GDL90UATInfoFrameTypeFISB || frame->length < 4) { return GDL90ResultFailure; }
+
+    // the header is at most 71 bits, read it from a padded copy so the bit reads never go past the frame
+    uint8_t header[12] = {0};
+    memcpy(header, frame->data, frame->length < 9 ? frame->length : 9);
+
+    self->aFlag = (header[0] & 0x80) != 0;
+    self->gFlag = (header[0] & 0x40) != 0;
+    self->pFlag = (header[0] & 0x20) != 0;
+    self->productId = (uint16_t)GDL90UAT_bits(header, 3, 11);
+    self->sFlag = (uint8_t)GDL90UAT_bits(header, 14, 1);
+    self->timeOption = (uint8_t)GDL90UAT_bits(header, 15, 2);
+
+    uint32_t bit = 17;
+    self->month = 0;
+    self->day = 0;
+    self->seconds = 0;
+    if (self->timeOption == GDL90UATAPDUTimeOptionMonthDayHoursMinutes || self->timeOption == GDL90UATAPDUTimeOptionMonthDayHoursMinutesSeconds)
+    {
+        self->month = (uint8_t)GDL90UAT_bits(header, bit, 4); bit += 4;
+        self->day = (uint8_t)GDL90UAT_bits(header, bit, 5); bit += 5;
+    }
+    self->hours = (uint8_t)GDL90UAT_bits(header, bit, 5); bit += 5;
+    self->minutes = (uint8_t)GDL90UAT_bits(header, bit, 6); bit += 6;
+    if (self->timeOption == GDL90UATAPDUTimeOptionHoursMinutesSeconds || self->timeOption == GDL90UATAPDUTimeOptionMonthDayHoursMinutesSeconds)
+    {
+        self->seconds = (uint8_t)GDL90UAT_bits(header, bit, 6); bit += 6;
+    }
+
+    self->productFileId = 0;
+    self->productFileLength = 0;
+    self->apduNumber = 0;
+    if (self->sFlag)
+    {
+        self->productFileId = (uint16_t)GDL90UAT_bits(header, bit, 10); bit += 10;
+        self->productFileLength = (uint16_t)GDL90UAT_bits(header, bit, 9); bit += 9;
+        self->apduNumber = (uint16_t)GDL90UAT_bits(header, bit, 9); bit += 9;
+    }
+
+    // the payload starts on the next byte
+    uint16_t headerLength = (uint16_t)((bit + 7) >> 3);
+    if (headerLength > frame->length) { return GDL90ResultFailure; }
+
+    self->data = frame->data + headerLength;
+    self->length = (uint16_t)(frame->length - headerLength);
+
+    return GDL90ResultOK;
+}
+
+#define GDL90_UAT_ADSB_BASIC_SIZE 18
+#define GDL90_UAT_ADSB_LONG_SIZE 34
+#define GDL90_UAT_RAD2DEG (180.0 / 3.14159265358979323846)
+
+static const char GDL90_UAT_BASE40[40] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
+    ' ', ' ', '.', '.'
+};
+
+static inline int32_t GDL90UAT_altitude(uint32_t raw)
+{
+    return (int32_t)raw * 25 - 1025;
+}
+
+/** 11 bit sign/magnitude velocity (kt), 0 if not available */
+static inline uint8_t GDL90UAT_velocity(uint32_t raw, uint8_t supersonic, int32_t *velocity)
+{
+    if ((raw & 0x3ff) == 0) { return 0; }
+    int32_t v = (int32_t)(raw & 0x3ff) - 1;
+    v *= supersonic ? 4 : 1;
+    *velocity = (raw & 0x400) ? -v : v;
+    return 1;
+}
+
+static void GDL90UATADSB_stateVector(GDL90UATADSB *self, const uint8_t *p)
+{
+    static const double latlonRes = 360.0 / (double)(1<<24);
+
+    uint32_t lat = (uint32_t)p[4] << 15 | (uint32_t)p[5] << 7 | (uint32_t)p[6] >> 1;
+    uint32_t lon = ((uint32_t)p[6] & 0x01) << 23 | (uint32_t)p[7] << 15 | (uint32_t)p[8] << 7 | (uint32_t)p[9] >> 1;
+    self->hasValidPosition = lat != 0 || lon != 0;
+    self->latitude = lat * latlonRes;
+    self->latitude -= self->latitude > 90.0 ? 180.0 : 0.0;
+    self->longitude = lon * latlonRes;
+    self->longitude -= self->longitude > 180.0 ? 360.0 : 0.0;
+
+    self->altitudeType = p[9] & 0x01;
+    uint32_t alt = (uint32_t)p[10] << 4 | (uint32_t)p[11] >> 4;
+    self->hasValidAltitude = alt != 0;
+    self->altitude = alt != 0 ? GDL90UAT_altitude(alt) : 0;
+    self->navigationIntegrityCategory = p[11] & 0x0f;
+
+    self->airGroundState = p[12] >> 6;
+    self->horizontalVelocity = 0;
+    self->hasValidHorizontalVelocity = 0;
+    self->trackHeadingType = GDL90TrafficReportTrackHeadingTypeInvalid;
+    self->trackHeading = 0.0;
+    self->verticalVelocity = 0;
+    self->hasValidVerticalVelocity = 0;
+    self->verticalVelocitySource = GDL90UATAltitudeTypePressure;
+
+    uint32_t first = ((uint32_t)p[12] & 0x1f) << 6 | (uint32_t)p[13] >> 2;
+    uint32_t second = ((uint32_t)p[13] & 0x03) << 9 | (uint32_t)p[14] << 1 | (uint32_t)p[15] >> 7;
+    if (self->airGroundState <= 1)
+    {
+        // north/south and east/west velocities
+        int32_t ns = 0, ew = 0;
+        uint8_t supersonic = self->airGroundState == 1;
+        if (GDL90UAT_velocity(first, supersonic, &ns) & GDL90UAT_velocity(second, supersonic, &ew))
+        {
+            self->horizontalVelocity = (uint32_t)lround(sqrt((double)ns * ns + (double)ew * ew));
+            self->hasValidHorizontalVelocity = 1;
+            if (ns != 0 || ew != 0)
+            {
+                double track = atan2((double)ew, (double)ns) * GDL90_UAT_RAD2DEG;
+                self->trackHeading = track < 0.0 ? track + 360.0 : track;
+                self->trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+            }
+        }
+
+        uint32_t vv = ((uint32_t)p[15] & 0x7f) << 4 | (uint32_t)p[16] >> 4;
+        if ((vv & 0x1ff) != 0)
+        {
+            int32_t rate = ((int32_t)(vv & 0x1ff) - 1) * 64;
+            self->verticalVelocity = (vv & 0x200) ? -rate : rate;
+            self->hasValidVerticalVelocity = 1;
+            self->verticalVelocitySource = (vv & 0x400) ? GDL90UATAltitudeTypePressure : GDL90UATAltitudeTypeGeometric;
+        }
+    }
+    else if (self->airGroundState == 2)
+    {
+        // ground speed and track/heading
+        if ((first & 0x3ff) != 0)
+        {
+            self->horizontalVelocity = (first & 0x3ff) - 1;
+            self->hasValidHorizontalVelocity = 1;
+        }
+        self->trackHeadingType = (second >> 9) & 0x03;
+        self->trackHeading = (double)(second & 0x1ff) * (360.0 / 512.0);
+    }
+
+    self->utcCoupledOrSiteId = p[16] & 0x0f;
+}
+
+static void GDL90UATADSB_modeStatus(GDL90UATADSB *self, const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[17] << 8 | p[18];
+    self->emitterCategory = (uint8_t)((v / 1600) % 40);
+    self->callsign[0] = GDL90_UAT_BASE40[(v / 40) % 40];
+    self->callsign[1] = GDL90_UAT_BASE40[v % 40];
+    v = (uint32_t)p[19] << 8 | p[20];
+    self->callsign[2] = GDL90_UAT_BASE40[(v / 1600) % 40];
+    self->callsign[3] = GDL90_UAT_BASE40[(v / 40) % 40];
+    self->callsign[4] = GDL90_UAT_BASE40[v % 40];
+    v = (uint32_t)p[21] << 8 | p[22];
+    self->callsign[5] = GDL90_UAT_BASE40[(v / 1600) % 40];
+    self->callsign[6] = GDL90_UAT_BASE40[(v / 40) % 40];
+    self->callsign[7] = GDL90_UAT_BASE40[v % 40];
+    self->callsign[8] = '\0';
+    for (int i = 7; i >= 0 && self->callsign[i] == ' '; i--)
+    {
+        self->callsign[i] = '\0';
+    }
+
+    self->emergencyPriorityCode = p[23] >> 5;
+    self->uatVersion = (p[23] >> 2) & 0x07;
+    self->sourceIntegrityLevel = p[23] & 0x03;
+    self->navigationAccuracyCategoryForPosition = p[25] >> 4;
+    self->navigationAccuracyCategoryForVelocity = (p[25] >> 1) & 0x07;
+    self->nicBaro = p[25] & 0x01;
+    self->capabilityCodes = p[26] >> 6;
+    self->operationalModes = (p[26] >> 3) & 0x07;
+    self->callsignIsFlightPlanId = (p[26] & 0x02) == 0;
+    self->hasModeStatus = 1;
+}
+
+GDL90Result GDL90UATADSB_init(GDL90UATADSB *self, const uint8_t *payload, size_t len)
+{
+    if (!self || !payload || len < GDL90_UAT_ADSB_BASIC_SIZE) { return GDL90ResultFailure; }
+
+    self->payloadType = payload[0] >> 3;
+    self->addressQualifier = payload[0] & 0x07;
+    self->address = (uint32_t)payload[1] << 16 | (uint32_t)payload[2] << 8 | payload[3];
+
+    // a basic payload is type 0, the others are long
+    if (self->payloadType != 0 && len < GDL90_UAT_ADSB_LONG_SIZE) { return GDL90ResultFailure; }
+
+    GDL90UATADSB_stateVector(self, payload);
+
+    self->hasModeStatus = 0;
+    self->hasAuxiliaryStateVector = 0;
+    self->hasValidSecondaryAltitude = 0;
+    self->secondaryAltitude = 0;
+
+    // DO-282B Table 2-10
+    if (self->payloadType == 1 || self->payloadType == 3)
+    {
+        GDL90UATADSB_modeStatus(self, payload);
+    }
+    if (self->payloadType == 1 || self->payloadType == 2 || self->payloadType == 5 || self->payloadType == 6)
+    {
+        uint32_t alt = (uint32_t)payload[29] << 4 | (uint32_t)payload[30] >> 4;
+        self->hasAuxiliaryStateVector = 1;
+        self->hasValidSecondaryAltitude = alt != 0;
+        self->secondaryAltitude = alt != 0 ? GDL90UAT_altitude(alt) : 0;
+    }
+
+    return GDL90ResultOK;
+}
+
+GDL90Result GDL90UATADSB_initWithBasicReport(GDL90UATADSB *self, const GDL90BasicReport *basicReport)
+{
+    if (!basicReport) { return GDL90ResultFailure; }
+
+    return GDL90UATADSB_init(self, basicReport->payload, sizeof(basicReport->payload));
+}
+
+GDL90Result GDL90UATADSB_initWithLongReport(GDL90UATADSB *self, const GDL90LongReport *longReport)
+{
+    if (!longReport) { return GDL90ResultFailure; }
+
+    return GDL90UATADSB_init(self, longReport->payload, sizeof(longReport->payload));
+}
+
+GDL90Result GDL90UATADSB_toTrafficReport(const GDL90UATADSB *self, GDL90TrafficReport *report)
+{
+    if (!self || !report) { return GDL90ResultFailure; }
+
+    report->id = GDL90MessageType_TrafficReport;
+    report->alertStatus = GDL90TrafficReportAlertStatusTypeNoAlert;
+    // ADS-R targets are ADS-B ones for GDL90
+    report->addressType = self->addressQualifier == 6 ? GDL90TrafficReportAddressTypeADSBWithICAO : self->addressQualifier;
+    report->participantAddress = self->address;
+    report->hasValidPosition = self->hasValidPosition;
+    report->latitude = self->latitude;
+    report->longitude = self->longitude;
+    report->navigationIntegrityCategory = self->navigationIntegrityCategory;
+
+    if (self->altitudeType == GDL90UATAltitudeTypePressure)
+    {
+        report->hasValidAltitude = self->hasValidAltitude;
+        report->altitude = self->altitude;
+    }
+    else
+    {
+        report->hasValidAltitude = self->hasValidSecondaryAltitude;
+        report->altitude = self->secondaryAltitude;
+    }
+
+    report->hasValidHorizontalVelocity = self->hasValidHorizontalVelocity;
+    report->horizontalVelocity = self->horizontalVelocity;
+    report->trackHeadingType = self->trackHeadingType;
+    report->trackHeading = self->trackHeading;
+    report->hasValidVerticalVelocity = self->hasValidVerticalVelocity;
+    report->verticalVelocity = self->verticalVelocity;
+    report->reportStatus = 0;
+    report->airGroundState = self->airGroundState != 2;
+
+    if (self->hasModeStatus)
+    {
+        report->emitterCategory = self->emitterCategory;
+        memset(report->callsign, 0, sizeof(report->callsign));
+        memcpy(report->callsign, self->callsign, strlen(self->callsign));
+        report->emergencyPriorityCode = (int8_t)self->emergencyPriorityCode;
+        report->navigationAccuracyCategoryForPosition = self->navigationAccuracyCategoryForPosition;
+    }
+
+    return GDL90ResultOK;
+}
@@ -0,0 +1,234 @@
+//
+//  gdl90-uat.h
+//  gdl90-uat-lib
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Decoding of the UAT payloads carried by GDL90 (see RTCA/DO-282B).
+//
+// Uplink Data payloads (432 bytes) are :
+//   UAT-Specific Header : ground station position, UTC coupling, slot and TIS-B site ids (8 bytes)
+//   Application Data    : chain of Information Frames (9 bit length, 4 bit type), the FIS-B
+//                         ones holding an APDU (header with product id, time and optional
+//                         segmentation, then the product data)
+//
+// Nothing is copied : the decoded frames and APDUs point into the payload, which must outlive them.
+//
+// ADS-B payloads (Basic and Long Reports) are :
+//   Header (HDR), State Vector (SV), then depending on the payload type Mode Status (MS),
+//   Auxiliary State Vector (AUXSV) and Target State elements
+
+#ifndef __gdl90__gdl90_uat_h__
+#define __gdl90__gdl90_uat_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <gdl90.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GDL90_UAT_UPLINK_PAYLOAD_SIZE 432
+#define GDL90_UAT_UPLINK_HEADER_SIZE 8
+
+/** UAT-Specific Header of an uplink */
+typedef struct GDL90UATUplinkHeader
+{
+    /** Ground station position (degrees) */
+    double latitude;
+    double longitude;
+    uint8_t hasValidPosition;
+    /** UTC coupled */
+    uint8_t utcCoupled;
+    /** Application Data valid */
+    uint8_t hasValidApplicationData;
+    /** Slot ID (transmission slot of the ground station, 0-31) */
+    uint8_t slotId;
+    /** TIS-B Site ID (0-15) */
+    uint8_t tisbSiteId;
+} GDL90UATUplinkHeader;
+
+typedef enum GDL90UATInfoFrameType
+{
+    /** FIS-B APDU */
+    GDL90UATInfoFrameTypeFISB = 0,
+    /** TIS-B/ADS-R Service Status */
+    GDL90UATInfoFrameTypeServiceStatus = 14
+} GDL90UATInfoFrameType;
+
+typedef struct GDL90UATInfoFrame
+{
+    /** GDL90UATInfoFrameType */
+    uint8_t type;
+    uint16_t length;
+    /** Points into the uplink payload */
+    const uint8_t *data;
+} GDL90UATInfoFrame;
+
+/** Iterator over an uplink payload */
+typedef struct GDL90UATUplink
+{
+    GDL90UATUplinkHeader header;
+    const uint8_t *payload;
+    /** Offset of the next Information Frame in payload */
+    uint16_t offset;
+} GDL90UATUplink;
+
+/** payload of GDL90_UAT_UPLINK_PAYLOAD_SIZE bytes (eg. GDL90UplinkData.payload) */
+GDL90Result GDL90UATUplink_init(GDL90UATUplink *, const uint8_t *payload, size_t len);
+/** Decodes straight from a GDL90MessageType_UplinkData message, without GDL90UplinkData_init's copy */
+GDL90Result GDL90UATUplink_initWithMessage(GDL90UATUplink *, const GDL90Message *gdl90Message);
+/** Next Information Frame, GDL90ResultFailure after the last one */
+GDL90Result GDL90UATUplink_nextFrame(GDL90UATUplink *, GDL90UATInfoFrame *frame);
+
+typedef enum GDL90UATAPDUTimeOption
+{
+    /** hours, minutes */
+    GDL90UATAPDUTimeOptionHoursMinutes,
+    /** hours, minutes, seconds */
+    GDL90UATAPDUTimeOptionHoursMinutesSeconds,
+    /** month, day, hours, minutes */
+    GDL90UATAPDUTimeOptionMonthDayHoursMinutes,
+    /** month, day, hours, minutes, seconds */
+    GDL90UATAPDUTimeOptionMonthDayHoursMinutesSeconds
+} GDL90UATAPDUTimeOption;
+
+/** FIS-B Application Protocol Data Unit */
+typedef struct GDL90UATAPDU
+{
+    /** Application Data Flags */
+    uint8_t aFlag;
+    uint8_t gFlag;
+    uint8_t pFlag;
+    /** FIS-B Product ID (eg. 8 NOTAM, 63/64 NEXRAD, 413 generic text) */
+    uint16_t productId;
+    /** Set if segmented (productFileId, productFileLength and apduNumber are valid) */
+    uint8_t sFlag;
+    /** GDL90UATAPDUTimeOption */
+    uint8_t timeOption;
+    /** Only with a month/day time option */
+    uint8_t month;
+    uint8_t day;
+    uint8_t hours;
+    uint8_t minutes;
+    /** Only with a seconds time option */
+    uint8_t seconds;
+
+    /** Segmentation */
+    uint16_t productFileId;
+    /** Number of segments of the product */
+    uint16_t productFileLength;
+    /** Segment number (1 based) */
+    uint16_t apduNumber;
+
+    /** APDU payload, points into the uplink payload */
+    const uint8_t *data;
+    uint16_t length;
+} GDL90UATAPDU;
+
+/** Decodes the header of the APDU of a GDL90UATInfoFrameTypeFISB frame */
+GDL90Result GDL90UATAPDU_init(GDL90UATAPDU *, const GDL90UATInfoFrame *frame);
+
+typedef enum GDL90UATAltitudeType
+{
+    GDL90UATAltitudeTypePressure,
+    GDL90UATAltitudeTypeGeometric
+} GDL90UATAltitudeType;
+
+/** Decoded ADS-B payload (HDR, SV, MS, AUXSV) */
+typedef struct GDL90UATADSB
+{
+    /** HDR */
+    uint8_t payloadType;
+    /** Address qualifier (0-5 as GDL90TrafficReportAddressType, 6 ADS-R with ICAO) */
+    uint8_t addressQualifier;
+    uint32_t address;
+
+    /** SV */
+    double latitude;
+    double longitude;
+    uint8_t hasValidPosition;
+    /** ft */
+    int32_t altitude;
+    /** GDL90UATAltitudeType */
+    uint8_t altitudeType;
+    uint8_t hasValidAltitude;
+    uint8_t navigationIntegrityCategory;
+    /** 0 airborne subsonic, 1 airborne supersonic, 2 on ground */
+    uint8_t airGroundState;
+    /** kt */
+    uint32_t horizontalVelocity;
+    uint8_t hasValidHorizontalVelocity;
+    /** GDL90TrafficReportTrackHeadingType */
+    uint8_t trackHeadingType;
+    /** Degrees */
+    double trackHeading;
+    /** ft/min */
+    int32_t verticalVelocity;
+    uint8_t hasValidVerticalVelocity;
+    /** GDL90UATAltitudeType of the vertical velocity */
+    uint8_t verticalVelocitySource;
+    /** UTC coupled (ADS-B) or TIS-B site id (TIS-B/ADS-R) */
+    uint8_t utcCoupledOrSiteId;
+
+    /** Set if the payload has a MS element */
+    uint8_t hasModeStatus;
+    uint8_t emitterCategory;
+    /** NUL terminated, trailing spaces removed */
+    char callsign[9];
+    /** Set if callsign is a flight plan id (squawk) */
+    uint8_t callsignIsFlightPlanId;
+    uint8_t emergencyPriorityCode;
+    uint8_t uatVersion;
+    uint8_t sourceIntegrityLevel;
+    uint8_t navigationAccuracyCategoryForPosition;
+    uint8_t navigationAccuracyCategoryForVelocity;
+    uint8_t nicBaro;
+    /** Capability codes (CDTI, ACAS) and operational modes (RA active, IDENT, receiving ATC services) */
+    uint8_t capabilityCodes;
+    uint8_t operationalModes;
+
+    /** Set if the payload has an AUXSV element */
+    uint8_t hasAuxiliaryStateVector;
+    /** Altitude of the other GDL90UATAltitudeType than the SV's */
+    int32_t secondaryAltitude;
+    uint8_t hasValidSecondaryAltitude;
+} GDL90UATADSB;
+
+/** payload of 18 (Basic, payload type 0) or 34 (Long) bytes */
+GDL90Result GDL90UATADSB_init(GDL90UATADSB *, const uint8_t *payload, size_t len);
+GDL90Result GDL90UATADSB_initWithBasicReport(GDL90UATADSB *, const GDL90BasicReport *basicReport);
+GDL90Result GDL90UATADSB_initWithLongReport(GDL90UATADSB *, const GDL90LongReport *longReport);
+/**
+ * Fills report (eg. for GDL90TargetTable_update) with the pressure altitude of the SV or AUXSV.
+ * MS fields (callsign, emitter category, NACp, emergency) are only written when the payload
+ * has one, pass the previous report of the target to keep them.
+ */
+GDL90Result GDL90UATADSB_toTrafficReport(const GDL90UATADSB *, GDL90TrafficReport *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(__gdl90__gdl90_uat_h__) */
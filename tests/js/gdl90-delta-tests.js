@@ -0,0 +1,62 @@
+//
+//  gdl90-delta-tests.js
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Decodes the snapshots written by `gdl90-ws -T -w prefix` with the GDL90DeltaDecoder of
+// gdl90.js and compares the last one with the targets decoded by gdl90-delta.
+//
+// node gdl90-delta-tests.js path/to/gdl90.js prefix
+
+const assert = require("assert");
+const fs = require("fs");
+
+const { GDL90DeltaDecoder } = require(process.argv[2]);
+const prefix = process.argv[3];
+
+const data = fs.readFileSync(`${prefix}.bin`);
+const expected = JSON.parse(fs.readFileSync(`${prefix}.json`, "utf8"));
+
+const decoder = new GDL90DeltaDecoder();
+let count = 0;
+for (let at = 0; at < data.length; count++) {
+    const length = data.readUInt32LE(at);
+    const sequence = decoder.decode(data.subarray(at + 4, at + 4 + length));
+    assert.ok(sequence > 0, `snapshot ${count} not decoded`);
+    at += 4 + length;
+}
+assert.ok(count > 0);
+
+// a delta of an unknown base is refused
+assert.strictEqual(new GDL90DeltaDecoder().decode(new Uint8Array([0x44, 0x02, 0x01, 0x00, 0x00])), 0);
+
+const targets = decoder.targets;
+assert.strictEqual(targets.size, expected.length);
+for (const target of expected) {
+    const decoded = targets.get(target.id);
+    assert.ok(decoded, `target ${target.id} missing`);
+    for (const key of Object.keys(target)) {
+        assert.strictEqual(decoded[key], target[key], `target ${target.id} ${key}`);
+    }
+}
+
+console.log(`${count} snapshots, ${targets.size} targets`);
@@ -0,0 +1,158 @@
+//
+//  gdl90-wasm-tests.js
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Runs the batched ring API of gdl90-wasm : queues a few thousand packets (Traffic Reports,
+// Heartbeats, Uplink Data and corrupted frames) through the input ring, decodes them with
+// processRing and checks the records read back, without any call from the module to JS.
+//
+// node gdl90-wasm-tests.js path/to/gdl90.js path/to/gdl90.wasm
+
+const assert = require("assert");
+const fs = require("fs");
+
+const { GDL90 } = require(process.argv[2]);
+const wasm = fs.readFileSync(process.argv[3]);
+
+// GDL90 2.2.3 FCS
+const CRC_TABLE = Array.from({ length: 256 }, (_, i) => {
+    let crc = i << 8;
+    for (let bit = 0; bit < 8; bit++) {
+        crc = ((crc << 1) ^ (crc & 0x8000 ? 0x1021 : 0)) & 0xffff;
+    }
+    return crc;
+});
+
+function crc(bytes) {
+    let value = 0;
+    for (const byte of bytes) {
+        value = CRC_TABLE[value >> 8] ^ ((value << 8) & 0xffff) ^ byte;
+    }
+    return value;
+}
+
+function frame(message) {
+    const value = crc(message);
+    const out = [0x7e];
+    for (const byte of [...message, value & 0xff, value >> 8]) {
+        if (byte === 0x7e || byte === 0x7d) {
+            out.push(0x7d, byte ^ 0x20);
+        } else {
+            out.push(byte);
+        }
+    }
+    out.push(0x7e);
+    return out;
+}
+
+const trafficReport = [
+    0x14, 0x00, 0xAB, 0x45, 0x49, 0x1F, 0xEF, 0x15, 0xA8, 0x89, 0x78,
+    0x0F, 0x09, 0xA9, 0x07, 0xB0, 0x01, 0x20, 0x01, 0x4E, 0x38,
+    0x32, 0x35, 0x56, 0x20, 0x20, 0x20, 0x00
+];
+const heartbeat = [0x00, 0x81, 0x80, 0x34, 0x12, 0x08 << 3, 0x7e];
+const uplinkData = [0x07, 0xff, 0xff, 0xff, ...new Array(432).fill(0x5a)];
+const corrupted = frame(trafficReport);
+corrupted[10] ^= 0x01;
+
+// the hot path must not call back into JS
+let calls = 0;
+const imports = GDL90.imports();
+for (const name of ["EXT_handleGDL90Message", "EXT_handleGDL90Error"]) {
+    const call = imports.env[name];
+    imports.env[name] = (...args) => { calls++; return call(...args); };
+}
+
+WebAssembly.instantiate(wasm, imports).then(({ instance }) => {
+    globalThis.gdl90 = new GDL90(instance);
+    gdl90.init();
+
+    const expected = { reports: 0, heartbeats: 0, uplinks: 0, errors: 0 };
+    const read = { reports: 0, heartbeats: 0, uplinks: 0 };
+    const readAll = () => {
+        for (const record of gdl90.readRecords()) {
+            if (record.id === 0x14) {
+                assert.strictEqual(record.altitude, 5000);
+                assert.strictEqual(record.callsign, "N825V");
+                assert.strictEqual(record.participantAddress, 0xAB4549);
+                read.reports++;
+            } else if (record.id === 0x07) {
+                assert.strictEqual(record.hasValidTor, false);
+                assert.strictEqual(record.payload.length, 432);
+                assert.ok(record.payload.every(byte => byte === 0x5a));
+                read.uplinks++;
+            } else {
+                assert.strictEqual(record.id, 0x00);
+                assert.strictEqual(record.timestamp, 0x11234);
+                assert.strictEqual(record.uplinkMessageCount, 8);
+                assert.strictEqual(record.basicLongMessageCount, 0x7e);
+                read.heartbeats++;
+            }
+        }
+    };
+
+    let batches = 0;
+    for (let i = 0; i < 20000; i++) {
+        // a packet of 1 to 40 frames
+        const packet = [];
+        const frames = 1 + i % 40;
+        for (let j = 0; j < frames; j++) {
+            switch ((i + j) % 23) {
+                case 0:
+                    packet.push(...frame(heartbeat));
+                    expected.heartbeats++;
+                    break;
+                case 7:
+                    packet.push(...frame(uplinkData));
+                    expected.uplinks++;
+                    break;
+                case 13:
+                    packet.push(...corrupted);
+                    expected.errors++;
+                    break;
+                default:
+                    packet.push(...frame(trafficReport));
+                    expected.reports++;
+            }
+        }
+        while (!gdl90.writePacket(packet)) {
+            gdl90.processRing();
+            readAll();
+            batches++;
+        }
+    }
+    while (gdl90.processRing()) {
+        readAll();
+        batches++;
+    }
+
+    assert.strictEqual(calls, 0);
+    assert.strictEqual(read.reports, expected.reports);
+    assert.strictEqual(read.heartbeats, expected.heartbeats);
+    assert.strictEqual(read.uplinks, expected.uplinks);
+    assert.deepStrictEqual(gdl90.ringStats, { skipped: 0, errors: expected.errors, overflows: 0, corrupted: false });
+    console.log(`${read.reports + read.heartbeats + read.uplinks} records in ${batches} batches`);
+}).catch(e => {
+    console.error(e);
+    process.exit(1);
+});
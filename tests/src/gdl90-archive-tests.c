@@ -0,0 +1,229 @@
+//
+//  gdl90-archive-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-archive.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static GDL90ArchiveWriter gdl90ArchiveWriter;
+static GDL90ArchiveReader gdl90ArchiveReader;
+/** argv[0], a file to open read only */
+static const char *executablePath;
+
+static void fillTrafficReport(GDL90TrafficReport *report, uint32_t i)
+{
+    memset(report, 0, sizeof(*report));
+    report->id = GDL90MessageType_TrafficReport;
+    report->addressType = GDL90TrafficReportAddressTypeADSBWithICAO;
+    report->participantAddress = 0xab4549 + (i % 7);
+    report->latitude = (int32_t)(0x1fef15 + i) * (180.0 / (double)(1<<23));
+    report->longitude = (int32_t)(0xa88978 - 0x1000000 - i) * (180.0 / (double)(1<<23));
+    report->altitude = 5000 + (int32_t)(i % 40) * 25;
+    report->trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report->airGroundState = 1;
+    report->navigationIntegrityCategory = GDL90TrafficReportNICTypeHPL_LT25M_VPL_LT_37p5M;
+    report->navigationAccuracyCategoryForPosition = GDL90TrafficReportNACPTypeHFOM_LT30M_VFOM_LT_45M;
+    report->horizontalVelocity = 123;
+    report->verticalVelocity = (i % 2) ? 64 : -64;
+    report->trackHeading = (double)(i % 256) * (360.0/256.0);
+    report->emitterCategory = GDL90TrafficReportEmitterCategoryLightICAO;
+    report->hasValidAltitude = 1;
+    report->hasValidPosition = 1;
+}
+
+static void testGDL90ArchiveRoundTrip(void)
+{
+    FILE *file = tmpfile();
+    assert(file);
+
+    const uint32_t count = GDL90_ARCHIVE_BLOCK_RECORDS * 2 + 100;
+
+    assert(GDL90ArchiveWriter_init(&gdl90ArchiveWriter, file) == GDL90ResultOK);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        GDL90TrafficReport report;
+        fillTrafficReport(&report, i);
+        assert(GDL90ArchiveWriter_append(&gdl90ArchiveWriter, 1700000000000ULL + i * 100, &report) == GDL90ResultOK);
+    }
+    assert(GDL90ArchiveWriter_flush(&gdl90ArchiveWriter) == GDL90ResultOK);
+
+    // columnar encoding should be well below the raw 28 bytes per report
+    assert(ftell(file) < (long)(count * 8));
+
+    rewind(file);
+    assert(GDL90ArchiveReader_init(&gdl90ArchiveReader, file) == GDL90ResultOK);
+
+    static uint64_t times[GDL90_ARCHIVE_BLOCK_RECORDS];
+    static GDL90TrafficReport reports[GDL90_ARCHIVE_BLOCK_RECORDS];
+
+    const GDL90ArchiveBlockInfo *info = NULL;
+    uint32_t read = 0;
+    while (GDL90ArchiveReader_nextBlock(&gdl90ArchiveReader, &info) == GDL90ResultOK)
+    {
+        assert(info->columns[GDL90ArchiveColumnTime].min == (int64_t)(1700000000000ULL + read * 100));
+        assert(info->columns[GDL90ArchiveColumnAltitude].min == 5000);
+        assert(info->columns[GDL90ArchiveColumnAltitude].max == 5975);
+        assert(GDL90ArchiveReader_readRecords(&gdl90ArchiveReader, times, reports) == GDL90ResultOK);
+        for (uint32_t i = 0; i < info->recordCount; i++, read++)
+        {
+            GDL90TrafficReport expected;
+            fillTrafficReport(&expected, read);
+            assert(times[i] == 1700000000000ULL + read * 100);
+            assert(reports[i].id == expected.id);
+            assert(reports[i].participantAddress == expected.participantAddress);
+            assert(reports[i].latitude == expected.latitude);
+            assert(reports[i].longitude == expected.longitude);
+            assert(reports[i].altitude == expected.altitude);
+            assert(reports[i].verticalVelocity == expected.verticalVelocity);
+            assert(reports[i].trackHeading == expected.trackHeading);
+            assert(reports[i].navigationIntegrityCategory == expected.navigationIntegrityCategory);
+            assert(reports[i].hasValidPosition == 1);
+        }
+    }
+    assert(read == count);
+
+    fclose(file);
+}
+
+static void testGDL90ArchiveColumnScan(void)
+{
+    FILE *file = tmpfile();
+    assert(file);
+
+    const uint32_t count = GDL90_ARCHIVE_BLOCK_RECORDS * 4;
+
+    assert(GDL90ArchiveWriter_init(&gdl90ArchiveWriter, file) == GDL90ResultOK);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        GDL90TrafficReport report;
+        fillTrafficReport(&report, i);
+        assert(GDL90ArchiveWriter_append(&gdl90ArchiveWriter, (uint64_t)i * 1000, &report) == GDL90ResultOK);
+    }
+    assert(GDL90ArchiveWriter_flush(&gdl90ArchiveWriter) == GDL90ResultOK);
+
+    rewind(file);
+    assert(GDL90ArchiveReader_init(&gdl90ArchiveReader, file) == GDL90ResultOK);
+
+    // count the reports in the third block's time range, reading only the time column of that block
+    static int64_t values[GDL90_ARCHIVE_BLOCK_RECORDS];
+    const int64_t from = (int64_t)GDL90_ARCHIVE_BLOCK_RECORDS * 2 * 1000;
+    const int64_t to = from + 10 * 1000;
+    const GDL90ArchiveBlockInfo *info = NULL;
+    uint32_t blocksRead = 0, matches = 0;
+    while (GDL90ArchiveReader_nextBlock(&gdl90ArchiveReader, &info) == GDL90ResultOK)
+    {
+        if (info->columns[GDL90ArchiveColumnTime].max < from || info->columns[GDL90ArchiveColumnTime].min > to) { continue; }
+        blocksRead++;
+        assert(GDL90ArchiveReader_readColumn(&gdl90ArchiveReader, GDL90ArchiveColumnTime, values) == GDL90ResultOK);
+        for (uint32_t i = 0; i < info->recordCount; i++)
+        {
+            matches += values[i] >= from && values[i] <= to;
+        }
+    }
+    assert(blocksRead == 1);
+    assert(matches == 11);
+
+    fclose(file);
+}
+
+static void testGDL90ArchiveWriteFailure(void)
+{
+    FILE *file = tmpfile();
+    FILE *readOnly = fopen(executablePath, "rb");
+    assert(file && readOnly);
+
+    assert(GDL90ArchiveWriter_init(&gdl90ArchiveWriter, file) == GDL90ResultOK);
+    GDL90TrafficReport report;
+    for (uint32_t i = 0; i < GDL90_ARCHIVE_BLOCK_RECORDS - 1; i++)
+    {
+        fillTrafficReport(&report, i);
+        assert(GDL90ArchiveWriter_append(&gdl90ArchiveWriter, (uint64_t)i * 1000, &report) == GDL90ResultOK);
+    }
+
+    // the block can't be written : the reports after it are refused, not written past the columns
+    gdl90ArchiveWriter.file = readOnly;
+    fillTrafficReport(&report, GDL90_ARCHIVE_BLOCK_RECORDS - 1);
+    assert(GDL90ArchiveWriter_append(&gdl90ArchiveWriter, (uint64_t)(GDL90_ARCHIVE_BLOCK_RECORDS - 1) * 1000, &report) != GDL90ResultOK);
+    assert(gdl90ArchiveWriter.recordCount == GDL90_ARCHIVE_BLOCK_RECORDS);
+    fillTrafficReport(&report, GDL90_ARCHIVE_BLOCK_RECORDS);
+    assert(GDL90ArchiveWriter_append(&gdl90ArchiveWriter, (uint64_t)GDL90_ARCHIVE_BLOCK_RECORDS * 1000, &report) != GDL90ResultOK);
+    assert(gdl90ArchiveWriter.recordCount == GDL90_ARCHIVE_BLOCK_RECORDS);
+
+    // writable again : the full block goes first
+    gdl90ArchiveWriter.file = file;
+    assert(GDL90ArchiveWriter_append(&gdl90ArchiveWriter, (uint64_t)GDL90_ARCHIVE_BLOCK_RECORDS * 1000, &report) == GDL90ResultOK);
+    assert(gdl90ArchiveWriter.recordCount == 1);
+    assert(GDL90ArchiveWriter_flush(&gdl90ArchiveWriter) == GDL90ResultOK);
+
+    rewind(file);
+    assert(GDL90ArchiveReader_init(&gdl90ArchiveReader, file) == GDL90ResultOK);
+    static int64_t values[GDL90_ARCHIVE_BLOCK_RECORDS];
+    const GDL90ArchiveBlockInfo *info = NULL;
+    uint32_t read = 0;
+    while (GDL90ArchiveReader_nextBlock(&gdl90ArchiveReader, &info) == GDL90ResultOK)
+    {
+        assert(GDL90ArchiveReader_readColumn(&gdl90ArchiveReader, GDL90ArchiveColumnTime, values) == GDL90ResultOK);
+        for (uint32_t i = 0; i < info->recordCount; i++, read++)
+        {
+            assert(values[i] == (int64_t)read * 1000);
+        }
+    }
+    assert(read == GDL90_ARCHIVE_BLOCK_RECORDS + 1);
+
+    fclose(readOnly);
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+    executablePath = argv[0];
+
+    if (strcmp(argv[1], "roundtrip") == 0)
+    {
+        testGDL90ArchiveRoundTrip();
+    }
+    else if (strcmp(argv[1], "scan") == 0)
+    {
+        testGDL90ArchiveColumnScan();
+    }
+    else if (strcmp(argv[1], "writefailure") == 0)
+    {
+        testGDL90ArchiveWriteFailure();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+//
+//  gdl90-capture-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-capture.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void handleGDL90Message(GDL90Message *gdl90Message, void *message)
+{
+    (void)gdl90Message;
+    (void)message;
+}
+
+static void handleGDL90Error(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    (void)error;
+}
+
+static void testGDL90CaptureSeek(void)
+{
+    // 3.5.2. Traffic Report Example
+    uint8_t data[] = {
+        0x7e,
+        0x14,
+        0x00, 0xAB, 0x45, 0x49, 0x1F, 0xEF, 0x15, 0xA8, 0x89, 0x78,
+        0x0F, 0x09, 0xA9, 0x07, 0xB0, 0x01, 0x20, 0x01, 0x4E, 0x38,
+        0x32, 0x35, 0x56, 0x20, 0x20, 0x20, 0x00,
+        0x57, 0xd6,
+        0x7e,
+        // CRC error, not recorded
+        0x7e, 0x14, 0x00, 0x00, 0x00, 0x7e
+    };
+
+    FILE *file = tmpfile();
+    assert(file);
+
+    // small index to force it to be thinned out a couple of times
+    GDL90CaptureIndexEntry index[8];
+    GDL90CaptureWriter writer;
+    assert(GDL90CaptureWriter_init(&writer, file, index, 8) == GDL90ResultOK);
+
+    GDL90StreamConfig gdl90StreamConfig = {0};
+    GDL90Stream gdl90Stream = {0};
+    assert(GDL90StreamConfig_init(&gdl90StreamConfig, handleGDL90Message, handleGDL90Error) == GDL90ResultOK);
+    assert(GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, GDL90CaptureWriter_handleFrame, &writer) == GDL90ResultOK);
+    assert(GDL90Stream_init(&gdl90Stream, &gdl90StreamConfig) == GDL90ResultOK);
+
+    const uint64_t count = 1000;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        assert(GDL90CaptureWriter_setReceiveInfo(&writer, 1000 + i * 10, (uint16_t)(i % 3)) == GDL90ResultOK);
+        assert(GDL90Stream_process(&gdl90Stream, data, sizeof(data)) == GDL90ResultOK);
+    }
+    assert(writer.recordCount == count);
+    assert(writer.indexCount <= 8);
+    assert(GDL90CaptureWriter_close(&writer) == GDL90ResultOK);
+
+    GDL90CaptureReader reader;
+    GDL90CaptureRecord record;
+    assert(GDL90CaptureReader_init(&reader, file) == GDL90ResultOK);
+    assert(reader.hasIndex);
+
+    // sequential
+    uint64_t n = 0;
+    while (GDL90CaptureReader_next(&reader, &record) == GDL90ResultOK)
+    {
+        assert(record.timeMs == 1000 + n * 10);
+        assert(record.sourceId == n % 3);
+        assert(record.message.id == GDL90MessageType_TrafficReport);
+        assert(record.message.dataLength == 30);
+        n++;
+    }
+    assert(n == count);
+
+    // exact, in between and out of range seeks
+    assert(GDL90CaptureReader_seek(&reader, 1000 + 537 * 10) == GDL90ResultOK);
+    assert(GDL90CaptureReader_next(&reader, &record) == GDL90ResultOK);
+    assert(record.timeMs == 1000 + 537 * 10);
+
+    assert(GDL90CaptureReader_seek(&reader, 1000 + 123 * 10 + 5) == GDL90ResultOK);
+    assert(GDL90CaptureReader_next(&reader, &record) == GDL90ResultOK);
+    assert(record.timeMs == 1000 + 124 * 10);
+
+    assert(GDL90CaptureReader_seek(&reader, 0) == GDL90ResultOK);
+    assert(GDL90CaptureReader_next(&reader, &record) == GDL90ResultOK);
+    assert(record.timeMs == 1000);
+
+    assert(GDL90CaptureReader_seek(&reader, 1000000) == GDL90ResultOK);
+    assert(GDL90CaptureReader_next(&reader, &record) != GDL90ResultOK);
+
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "seek") == 0)
+    {
+        testGDL90CaptureSeek();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,267 @@
+//
+//  gdl90-delta-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-delta.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TARGET_CAPACITY 1024
+
+static GDL90TargetTableSlot targetSlots[TARGET_CAPACITY];
+static GDL90Target targets[TARGET_CAPACITY];
+static GDL90DeltaState encoderStates[GDL90_DELTA_SNAPSHOT_COUNT * TARGET_CAPACITY];
+static GDL90DeltaState decoderStates[GDL90_DELTA_SNAPSHOT_COUNT * TARGET_CAPACITY];
+static uint8_t message[GDL90_DELTA_MAX_SIZE(TARGET_CAPACITY)];
+
+static void fillTrafficReport(GDL90TrafficReport *report, uint32_t i)
+{
+    memset(report, 0, sizeof(*report));
+    report->id = GDL90MessageType_TrafficReport;
+    report->addressType = GDL90TrafficReportAddressTypeADSBWithICAO;
+    report->participantAddress = 0xa00000 + i;
+    report->latitude = 45.0 + i * 0.01;
+    report->longitude = -122.0 - i * 0.01;
+    report->altitude = 5000 + (int32_t)i * 25;
+    report->hasValidAltitude = 1;
+    report->hasValidPosition = 1;
+    report->hasValidHorizontalVelocity = 1;
+    report->horizontalVelocity = 120;
+    report->hasValidVerticalVelocity = 1;
+    report->verticalVelocity = 640;
+    report->trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report->trackHeading = 90.0;
+    report->airGroundState = 1;
+    report->navigationIntegrityCategory = 8;
+    report->navigationAccuracyCategoryForPosition = 9;
+    report->emitterCategory = 1;
+    snprintf(report->callsign, sizeof(report->callsign), "N%u", (unsigned)i);
+}
+
+/** The decoded snapshot matches the table */
+static void assertSameState(const GDL90DeltaDecoder *decoder, const GDL90TargetTable *table)
+{
+    const GDL90DeltaState *states = GDL90DeltaDecoder_states(decoder);
+    assert(states);
+    for (uint32_t i = 0; i < TARGET_CAPACITY; i++)
+    {
+        const GDL90Target *target = &table->targets[i];
+        assert(states[i].present == (target->key != 0));
+        if (!target->key) { continue; }
+
+        GDL90DeltaState expected;
+        assert(GDL90DeltaState_initWithTrafficReport(&expected, &target->report) == GDL90ResultOK);
+        assert(memcmp(&expected, &states[i], sizeof(expected)) == 0);
+    }
+}
+
+static void encodeDecode(GDL90DeltaEncoder *encoder, GDL90DeltaDecoder *decoder, const GDL90TargetTable *table, uint64_t timeMs, uint8_t ack)
+{
+    size_t length = 0;
+    assert(GDL90DeltaEncoder_encode(encoder, table, timeMs, message, sizeof(message), &length) == GDL90ResultOK);
+    assert(GDL90DeltaDecoder_decode(decoder, message, length) == GDL90ResultOK);
+    assert(decoder->sequence == encoder->sequence);
+    assertSameState(decoder, table);
+    if (ack)
+    {
+        assert(GDL90DeltaEncoder_ack(encoder, decoder->sequence) == GDL90ResultOK);
+    }
+}
+
+static void testGDL90DeltaRoundTrip(void)
+{
+    GDL90TargetTable table;
+    GDL90DeltaEncoder encoder;
+    GDL90DeltaDecoder decoder;
+    GDL90TrafficReport report;
+    GDL90Target *target = NULL;
+    size_t length = 0;
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90DeltaEncoder_init(&encoder, encoderStates, TARGET_CAPACITY, 10000) == GDL90ResultOK);
+    assert(GDL90DeltaDecoder_init(&decoder, decoderStates, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90DeltaDecoder_states(&decoder) == NULL);
+
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        fillTrafficReport(&report, i);
+        assert(GDL90TargetTable_update(&table, 0, &report, &target) == GDL90ResultOK);
+    }
+
+    // keyframe, then nothing changed
+    encodeDecode(&encoder, &decoder, &table, 0, 1);
+    assert(encoder.keyframeCount == 1);
+    assert(GDL90DeltaEncoder_encode(&encoder, &table, 100, message, sizeof(message), &length) == GDL90ResultOK);
+    assert(message[0] == GDL90DeltaMessageTypeDelta);
+    assert(length == 1 + 1 + 1 + 1 + 1);
+    assert(GDL90DeltaDecoder_decode(&decoder, message, length) == GDL90ResultOK);
+    assert(GDL90DeltaEncoder_ack(&encoder, decoder.sequence) == GDL90ResultOK);
+
+    // moves, changes, removals and new targets
+    fillTrafficReport(&report, 3);
+    report.latitude += 0.001;
+    assert(GDL90TargetTable_update(&table, 200, &report, &target) == GDL90ResultOK);
+    fillTrafficReport(&report, 4);
+    report.alertStatus = 1;
+    report.emergencyPriorityCode = GDL90TrafficReportEmergencyPriorityCodeTypeGeneralEmergency;
+    memcpy(report.callsign, "EMERG   ", 8);
+    assert(GDL90TargetTable_update(&table, 200, &report, &target) == GDL90ResultOK);
+    fillTrafficReport(&report, 5);
+    report.hasValidVerticalVelocity = 0;
+    report.verticalVelocity = 0;
+    report.altitude -= 1000;
+    assert(GDL90TargetTable_update(&table, 200, &report, &target) == GDL90ResultOK);
+    assert(GDL90TargetTable_remove(&table, GDL90TrafficReportAddressTypeADSBWithICAO, 0xa00000 + 7) == GDL90ResultOK);
+    fillTrafficReport(&report, 500);
+    assert(GDL90TargetTable_update(&table, 200, &report, &target) == GDL90ResultOK);
+
+    assert(GDL90DeltaEncoder_encode(&encoder, &table, 200, message, sizeof(message), &length) == GDL90ResultOK);
+    assert(message[0] == GDL90DeltaMessageTypeDelta);
+    // 3 changed, 1 removed, 1 new
+    assert(message[5] == 5);
+    assert(GDL90DeltaDecoder_decode(&decoder, message, length) == GDL90ResultOK);
+    assertSameState(&decoder, &table);
+
+    // not acknowledged (lost) : the next ones are still relative to the acknowledged snapshot
+    fillTrafficReport(&report, 10);
+    report.altitude += 100;
+    assert(GDL90TargetTable_update(&table, 300, &report, &target) == GDL90ResultOK);
+    assert(GDL90DeltaEncoder_encode(&encoder, &table, 300, message, sizeof(message), &length) == GDL90ResultOK);
+    encodeDecode(&encoder, &decoder, &table, 400, 0);
+    assert(message[0] == GDL90DeltaMessageTypeDelta);
+    assert(message[2] == 2);
+    assert(GDL90DeltaEncoder_ack(&encoder, decoder.sequence) == GDL90ResultOK);
+
+    // acknowledgements of unknown snapshots are refused
+    assert(GDL90DeltaEncoder_ack(&encoder, 1000) != GDL90ResultOK);
+    assert(GDL90DeltaEncoder_ack(&encoder, 0) != GDL90ResultOK);
+
+    // the acknowledged snapshot got too old : keyframe
+    uint64_t keyframeCount = encoder.keyframeCount;
+    for (uint32_t i = 0; i < GDL90_DELTA_SNAPSHOT_COUNT; i++)
+    {
+        encodeDecode(&encoder, &decoder, &table, 500 + i, 0);
+    }
+    assert(encoder.keyframeCount == keyframeCount + 1);
+    assert(message[0] == GDL90DeltaMessageTypeKeyframe);
+    assert(GDL90DeltaEncoder_ack(&encoder, decoder.sequence) == GDL90ResultOK);
+
+    // periodic and requested keyframes
+    encodeDecode(&encoder, &decoder, &table, 20000, 1);
+    assert(message[0] == GDL90DeltaMessageTypeKeyframe);
+    encodeDecode(&encoder, &decoder, &table, 20100, 1);
+    assert(message[0] == GDL90DeltaMessageTypeDelta);
+    assert(GDL90DeltaEncoder_requestKeyframe(&encoder) == GDL90ResultOK);
+    encodeDecode(&encoder, &decoder, &table, 20200, 1);
+    assert(message[0] == GDL90DeltaMessageTypeKeyframe);
+
+    // a decoder that missed the base, or malformed messages
+    GDL90DeltaDecoder other;
+    static GDL90DeltaState otherStates[GDL90_DELTA_SNAPSHOT_COUNT * TARGET_CAPACITY];
+    assert(GDL90DeltaDecoder_init(&other, otherStates, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90DeltaEncoder_encode(&encoder, &table, 20300, message, sizeof(message), &length) == GDL90ResultOK);
+    assert(GDL90DeltaDecoder_decode(&other, message, length) != GDL90ResultOK);
+    assert(GDL90DeltaDecoder_decode(&decoder, message, length - 1) != GDL90ResultOK);
+    message[0] = 0;
+    assert(GDL90DeltaDecoder_decode(&decoder, message, length) != GDL90ResultOK);
+
+    // round trip of the traffic report at its resolution
+    fillTrafficReport(&report, 42);
+    GDL90DeltaState state;
+    GDL90TrafficReport decoded;
+    assert(GDL90DeltaState_initWithTrafficReport(&state, &report) == GDL90ResultOK);
+    assert(GDL90DeltaState_toTrafficReport(&state, &decoded) == GDL90ResultOK);
+    assert(decoded.participantAddress == report.participantAddress);
+    assert(decoded.latitude - report.latitude < 180.0 / (1<<23) && report.latitude - decoded.latitude < 180.0 / (1<<23));
+    assert(decoded.altitude == report.altitude);
+    assert(decoded.verticalVelocity == 640);
+    assert(decoded.trackHeading == 90.0);
+    assert(decoded.navigationAccuracyCategoryForPosition == 9);
+    assert(decoded.hasValidVerticalVelocity && decoded.airGroundState);
+    assert(strcmp(decoded.callsign, "N42") == 0);
+}
+
+static void testGDL90DeltaBandwidth(void)
+{
+    GDL90TargetTable table;
+    GDL90DeltaEncoder encoder;
+    GDL90DeltaDecoder decoder;
+    GDL90TrafficReport report;
+    GDL90Target *target = NULL;
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90DeltaEncoder_init(&encoder, encoderStates, TARGET_CAPACITY, 10000) == GDL90ResultOK);
+    assert(GDL90DeltaDecoder_init(&decoder, decoderStates, TARGET_CAPACITY) == GDL90ResultOK);
+
+    // 500 targets reporting once a second, sent to the display 5 times a second for a minute
+    for (uint64_t timeMs = 0; timeMs < 60000; timeMs += 200)
+    {
+        for (uint32_t i = 0; i < 500; i++)
+        {
+            if ((i * 7 + timeMs / 200) % 5 != 0 && timeMs != 0) { continue; }
+
+            fillTrafficReport(&report, i);
+            double t = (double)timeMs / 1000.0;
+            report.longitude += t * 0.0005;
+            report.altitude += (int32_t)(t * 10.0) / 100 * 100;
+            assert(GDL90TargetTable_update(&table, timeMs, &report, &target) == GDL90ResultOK);
+        }
+        encodeDecode(&encoder, &decoder, &table, timeMs, 1);
+    }
+
+    printf("%llu keyframes, %llu deltas, %llu bytes (%llu as keyframes)\n",
+        (unsigned long long)encoder.keyframeCount,
+        (unsigned long long)encoder.deltaCount,
+        (unsigned long long)encoder.byteCount,
+        (unsigned long long)encoder.keyframeByteCount);
+    assert(encoder.keyframeCount == 6);
+    assert(encoder.byteCount * 10 < encoder.keyframeByteCount);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "roundtrip") == 0)
+    {
+        testGDL90DeltaRoundTrip();
+    }
+    else if (strcmp(argv[1], "bandwidth") == 0)
+    {
+        testGDL90DeltaBandwidth();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,435 @@
+//
+//  gdl90-fisb-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-fisb.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t removedTiles = 0;
+
+static void handleTileRemoval(GDL90NEXRADTile *tile, uint32_t tileIndex, void *context)
+{
+    (void)tile;
+    (void)tileIndex;
+    (void)context;
+    removedTiles++;
+}
+
+static void testGDL90NEXRADCache(void)
+{
+    static GDL90NEXRADCacheSlot slots[64];
+    static GDL90NEXRADTile tiles[64];
+
+    GDL90NEXRADCache cache;
+    GDL90UATAPDU apdu = {0};
+    uint32_t cursor = 0;
+
+    assert(GDL90NEXRADCache_init(&cache, slots, tiles, 60) != GDL90ResultOK);
+    assert(GDL90NEXRADCache_init(&cache, slots, tiles, 64) == GDL90ResultOK);
+    assert(GDL90NEXRADCache_setRemovalHandler(&cache, handleTileRemoval, NULL) == GDL90ResultOK);
+
+    // block 74565 (ring 165, column 315), run length encoded : 32 bins of 0, 32 of 3, 64 of 5
+    uint8_t rle[] = { 0x80 | 0x01, 0x23, 0x45, 0xf8, 0xfb, 0xfd, 0xfd };
+    apdu.productId = GDL90FISBProductIdNEXRADRegional;
+    apdu.data = rle;
+    apdu.length = sizeof(rle);
+    assert(GDL90NEXRADCache_decode(&cache, 1000, &apdu) == GDL90ResultOK);
+
+    GDL90NEXRADTile *tile = GDL90NEXRADCache_find(&cache, GDL90FISBProductIdNEXRADRegional, 0, 0, 74565);
+    assert(tile);
+    assert(!tile->empty && tile->dirty);
+    assert(tile->bins[0] == 0 && tile->bins[31] == 0);
+    assert(tile->bins[32] == 3 && tile->bins[63] == 3);
+    assert(tile->bins[64] == 5 && tile->bins[127] == 5);
+    assert(GDL90NEXRADCache_find(&cache, GDL90FISBProductIdNEXRADCONUS, 0, 0, 74565) == NULL);
+
+    double north, west, latitudeSize, longitudeSize;
+    GDL90NEXRADTile_location(tile, &north, &west, &latitudeSize, &longitudeSize);
+    assert(north > 11.066 && north < 11.067);
+    assert(west > -108.001 && west < -107.999);
+    assert(latitudeSize > 0.0666 && latitudeSize < 0.0667);
+    assert(longitudeSize > 0.799 && longitudeSize < 0.801);
+
+    // above 60 degrees blocks are 96' wide, the west edge still counts 48' columns : block 405273 (ring 900, column 273) starts at column 272
+    GDL90NEXRADTile wideTile = {0};
+    wideTile.blockNumber = 405273;
+    GDL90NEXRADTile_location(&wideTile, &north, &west, &latitudeSize, &longitudeSize);
+    assert(north > 60.066 && north < 60.067);
+    assert(west > -142.401 && west < -142.399);
+    assert(longitudeSize > 1.599 && longitudeSize < 1.601);
+    wideTile.blockNumber = 405272;
+    GDL90NEXRADTile_location(&wideTile, &north, &west, &latitudeSize, &longitudeSize);
+    assert(west > -142.401 && west < -142.399);
+
+    // dirty tiles are returned once
+    assert(GDL90NEXRADCache_nextDirty(&cache, &cursor) == tile);
+    assert(GDL90NEXRADCache_nextDirty(&cache, &cursor) == NULL);
+
+    // the same block again is not dirty, a change is
+    assert(GDL90NEXRADCache_decode(&cache, 2000, &apdu) == GDL90ResultOK);
+    cursor = 0;
+    assert(GDL90NEXRADCache_nextDirty(&cache, &cursor) == NULL);
+    rle[3] = 0xf9;
+    assert(GDL90NEXRADCache_decode(&cache, 2000, &apdu) == GDL90ResultOK);
+    cursor = 0;
+    assert(GDL90NEXRADCache_nextDirty(&cache, &cursor) == tile);
+    assert(tile->bins[0] == 1);
+
+    // runs not adding up to a block leave the tile alone
+    rle[6] = 0x05;
+    assert(GDL90NEXRADCache_decode(&cache, 3000, &apdu) != GDL90ResultOK);
+    assert(tile->bins[127] == 5 && tile->updateTimeMs == 2000);
+
+    // empty blocks : the block itself, the next one, and the first of the bitmap (block + 4)
+    uint8_t empty[] = { 0x01, 0x23, 0x45, 0x10 | 0x20 | 1, 0x01 };
+    apdu.data = empty;
+    apdu.length = sizeof(empty);
+    assert(GDL90NEXRADCache_decode(&cache, 3000, &apdu) == GDL90ResultOK);
+    assert(cache.count == 3);
+    assert(tile->empty && tile->dirty && tile->bins[127] == 0);
+    assert(GDL90NEXRADCache_find(&cache, GDL90FISBProductIdNEXRADRegional, 0, 0, 74566));
+    assert(GDL90NEXRADCache_find(&cache, GDL90FISBProductIdNEXRADRegional, 0, 0, 74569));
+    assert(GDL90NEXRADCache_find(&cache, GDL90FISBProductIdNEXRADRegional, 0, 0, 74567) == NULL);
+
+    // other products are not NEXRAD
+    apdu.productId = 413;
+    assert(GDL90NEXRADCache_decode(&cache, 3000, &apdu) != GDL90ResultOK);
+
+    // expiry
+    apdu.productId = GDL90FISBProductIdNEXRADRegional;
+    empty[3] = 0x10;
+    assert(GDL90NEXRADCache_decode(&cache, 5000, &apdu) == GDL90ResultOK);
+    assert(GDL90NEXRADCache_evict(&cache, 4000) == 2);
+    assert(removedTiles == 2);
+    assert(cache.count == 1);
+    assert(GDL90NEXRADCache_find(&cache, GDL90FISBProductIdNEXRADRegional, 0, 0, 74565) == tile);
+}
+
+/** Packs text as DLAC codes (\t followed by a code is a tab), returns the number of bytes written */
+static size_t encodeDLAC(const char *text, uint8_t *out)
+{
+    static const char alphabet[] = "\x03" "ABCDEFGHIJKLMNOPQRSTUVWXYZ\x1a\t\x1e\n| !\"#$%&'()*+,-./0123456789:;<=>?";
+
+    uint8_t codes[1024];
+    size_t n = 0;
+    for (const char *p = text; *p; p++)
+    {
+        if (*p == '\t')
+        {
+            codes[n++] = 28;
+            codes[n++] = (uint8_t)(*++p - '0');
+            continue;
+        }
+        const char *c = memchr(alphabet, *p, 64);
+        assert(c);
+        codes[n++] = (uint8_t)(c - alphabet);
+    }
+    // padded with ETX
+    while (n % 4) { codes[n++] = 0; }
+
+    size_t len = 0;
+    for (size_t i = 0; i < n; i += 4)
+    {
+        uint32_t v = (uint32_t)codes[i] << 18 | (uint32_t)codes[i+1] << 12 | (uint32_t)codes[i+2] << 6 | codes[i+3];
+        out[len++] = (uint8_t)(v >> 16);
+        out[len++] = (uint8_t)(v >> 8);
+        out[len++] = (uint8_t)v;
+    }
+    return len;
+}
+
+static uint32_t textRecords = 0;
+
+static void handleTextRecord(const GDL90FISBTextRecord *record, void *context)
+{
+    (void)context;
+    assert(record->productId == GDL90FISBProductIdGenericText);
+    assert(record->hours == 18 && record->minutes == 53);
+    if (textRecords == 0)
+    {
+        assert(record->typeLength == 5 && memcmp(record->type, "METAR", 5) == 0);
+    }
+    else
+    {
+        assert(record->typeLength == 3 && memcmp(record->type, "TAF", 3) == 0);
+    }
+    textRecords++;
+}
+
+static void testGDL90FISBText(void)
+{
+    const char *text = "METAR KSEA 191853Z 00000KT 10SM CLR 12/03 A3012\x1eTAF KPDX 191720Z 1918/2018\t3VRB03KT P6SM SKC\x1e";
+    uint8_t dlac[256];
+    char decoded[256];
+
+    size_t len = encodeDLAC(text, dlac);
+    size_t n = GDL90FISB_decodeDLAC(dlac, len, decoded, sizeof(decoded));
+    assert(n == strlen(decoded));
+    assert(strcmp(decoded, "METAR KSEA 191853Z 00000KT 10SM CLR 12/03 A3012\x1eTAF KPDX 191720Z 1918/2018   VRB03KT P6SM SKC\x1e") == 0);
+
+    // truncated output is still terminated
+    assert(GDL90FISB_decodeDLAC(dlac, len, decoded, 6) == 5);
+    assert(strcmp(decoded, "METAR") == 0);
+
+    // records
+    GDL90UATAPDU apdu = {0};
+    apdu.productId = GDL90FISBProductIdGenericText;
+    apdu.hours = 18;
+    apdu.minutes = 53;
+    apdu.data = dlac;
+    apdu.length = (uint16_t)len;
+
+    GDL90FISBText fisbText;
+    GDL90FISBTextRecord record;
+    assert(GDL90FISBText_init(&fisbText, &apdu, decoded, sizeof(decoded)) == GDL90ResultOK);
+    assert(GDL90FISBText_next(&fisbText, &record) == GDL90ResultOK);
+    assert(record.typeLength == 5 && memcmp(record.type, "METAR", 5) == 0);
+    assert(record.locationLength == 4 && memcmp(record.location, "KSEA", 4) == 0);
+    assert(record.timeLength == 7 && memcmp(record.time, "191853Z", 7) == 0);
+    assert(record.textLength == 47 && record.text == decoded);
+    assert(GDL90FISBText_next(&fisbText, &record) == GDL90ResultOK);
+    assert(record.locationLength == 4 && memcmp(record.location, "KPDX", 4) == 0);
+    assert(record.timeLength == 7 && memcmp(record.time, "191720Z", 7) == 0);
+    assert(GDL90FISBText_next(&fisbText, &record) != GDL90ResultOK);
+
+    // from an uplink : UAT header with application data, one information frame holding the APDU
+    GDL90Message gdl90Message = {0};
+    gdl90Message.id = GDL90MessageType_UplinkData;
+    gdl90Message.data[0] = GDL90MessageType_UplinkData;
+    gdl90Message.dataLength = 4 + GDL90_UAT_UPLINK_PAYLOAD_SIZE + 2;
+    uint8_t *payload = gdl90Message.data + 4;
+    payload[6] = 0x20;
+    uint16_t frameLength = (uint16_t)(4 + len);
+    payload[8] = (uint8_t)(frameLength >> 1);
+    payload[9] = (uint8_t)((frameLength & 1) << 7 | GDL90UATInfoFrameTypeFISB);
+    // product 413, hours and minutes, 18:53
+    uint8_t *header = payload + 10;
+    header[0] = (uint8_t)(413 >> 6);
+    header[1] = (uint8_t)((413 & 0x3f) << 2);
+    header[2] = (uint8_t)(18 << 2 | 53 >> 4);
+    header[3] = (uint8_t)((53 & 0x0f) << 4);
+    memcpy(header + 4, dlac, len);
+
+    GDL90FISBTextStream textStream;
+    assert(GDL90FISBTextStream_init(&textStream, handleTextRecord, NULL) == GDL90ResultOK);
+    GDL90FISBTextStream_handleFrame(&gdl90Message, &textStream);
+    assert(textRecords == 2);
+
+    // segmented ones are left to the product cache
+    header[1] |= 0x02;
+    GDL90FISBTextStream_handleFrame(&gdl90Message, &textStream);
+    assert(textRecords == 2);
+    assert(textStream.segmentedCount == 1);
+}
+
+static uint32_t completeProducts = 0;
+static uint32_t changedProducts = 0;
+
+static void handleProduct(const GDL90FISBProduct *product, GDL90FISBProductEvent event, void *context)
+{
+    (void)context;
+    assert(product->complete);
+    if (event == GDL90FISBProductEventComplete) { completeProducts++; }
+    else { changedProducts++; }
+}
+
+static void testGDL90FISBProductCache(void)
+{
+    static GDL90FISBProductCacheSlot slots[16];
+    static GDL90FISBProduct products[16];
+    static GDL90FISBSegment arena[6];
+
+    GDL90FISBProductCache cache;
+    GDL90UATAPDU apdu = {0};
+    uint8_t data[4][8] = { "SEGMENT", "segment", "Segment", "TEXT" };
+    uint8_t out[64];
+
+    assert(GDL90FISBProductCache_init(&cache, slots, products, 16, arena, sizeof(arena)) == GDL90ResultOK);
+    assert(cache.segmentCapacity == 6);
+    assert(GDL90FISBProductCache_setHandler(&cache, handleProduct, NULL) == GDL90ResultOK);
+    assert(GDL90FISBProductCache_setValidity(&cache, GDL90FISBProductIdNEXRADRegional, 10000) == GDL90ResultOK);
+
+    // unsegmented, then repeated
+    apdu.productId = GDL90FISBProductIdGenericText;
+    apdu.hours = 18;
+    apdu.minutes = 53;
+    apdu.data = data[3];
+    apdu.length = 4;
+    assert(GDL90FISBProductCache_add(&cache, 1000, &apdu) == GDL90ResultOK);
+    assert(GDL90FISBProductCache_add(&cache, 1100, &apdu) == GDL90ResultOK);
+    assert(completeProducts == 1);
+    assert(cache.duplicateCount == 1);
+    // other text at the same time is another product
+    apdu.data = data[0];
+    assert(GDL90FISBProductCache_add(&cache, 1100, &apdu) == GDL90ResultOK);
+    assert(completeProducts == 2);
+    assert(cache.count == 2);
+
+    // 3 segments, out of order and repeated (eg. by another ground station)
+    apdu.productId = GDL90FISBProductIdNEXRADRegional;
+    apdu.sFlag = 1;
+    apdu.productFileId = 5;
+    apdu.productFileLength = 3;
+    const uint16_t order[5] = { 2, 3, 2, 3, 1 };
+    for (uint32_t k = 0; k < 5; k++)
+    {
+        apdu.apduNumber = order[k];
+        apdu.data = data[order[k] - 1];
+        apdu.length = 7;
+        assert(GDL90FISBProductCache_add(&cache, 2000, &apdu) == GDL90ResultOK);
+        assert(completeProducts == (k == 4 ? 3u : 2u));
+    }
+    assert(cache.duplicateCount == 3);
+    assert(cache.freeSegmentCount == 1);
+
+    uint32_t cursor = 0;
+    const GDL90FISBProduct *product = NULL;
+    for (uint32_t p = 0; p < 16; p++)
+    {
+        if (products[p].key != 0 && products[p].segmented) { product = &products[p]; }
+    }
+    assert(product && product->complete && product->length == 21);
+    assert(GDL90FISBProductCache_copy(&cache, product, out, 20) == 0);
+    assert(GDL90FISBProductCache_copy(&cache, product, out, sizeof(out)) == 21);
+    assert(memcmp(out, "SEGMENTsegmentSegment", 21) == 0);
+    cursor = product->firstSegment;
+    assert(GDL90FISBProductCache_nextSegment(&cache, &cursor)->apduNumber == 1);
+    assert(GDL90FISBProductCache_nextSegment(&cache, &cursor)->apduNumber == 2);
+    assert(GDL90FISBProductCache_nextSegment(&cache, &cursor)->apduNumber == 3);
+    assert(GDL90FISBProductCache_nextSegment(&cache, &cursor) == NULL);
+
+    // a newer version replaces it
+    apdu.minutes = 58;
+    for (uint16_t n = 1; n <= 3; n++)
+    {
+        apdu.apduNumber = n;
+        apdu.data = data[3 - n];
+        assert(GDL90FISBProductCache_add(&cache, 3000, &apdu) == GDL90ResultOK);
+    }
+    assert(changedProducts == 1);
+    assert(cache.count == 3);
+    assert(GDL90FISBProductCache_copy(&cache, product, out, sizeof(out)) == 21);
+    assert(memcmp(out, "SegmentsegmentSEGMENT", 21) == 0);
+
+    // the arena is bounded : 1 free segment left
+    apdu.productFileId = 6;
+    apdu.apduNumber = 1;
+    assert(GDL90FISBProductCache_add(&cache, 3000, &apdu) == GDL90ResultOK);
+    apdu.apduNumber = 2;
+    assert(GDL90FISBProductCache_add(&cache, 3000, &apdu) != GDL90ResultOK);
+    assert(cache.droppedCount == 1);
+
+    // once the NEXRAD products expired (10 s) there is room again
+    assert(GDL90FISBProductCache_add(&cache, 13000, &apdu) == GDL90ResultOK);
+    assert(cache.count == 3);
+    assert(GDL90FISBProductCache_evict(&cache, 13000 + 60 * 60 * 1000) == 3);
+    assert(cache.count == 0);
+    assert(cache.freeSegmentCount == 6);
+
+    // unsegmented products with the same hash are told apart by their bytes
+    const uint8_t collisions[2][8] = {
+        { 'T', 'E', 'X', 'T', 't', 'e', 'x', 't' },
+        { 'D', 'A', 'T', 'A', 0xa3, 0x69, 0xab, 0x1b }
+    };
+    uint64_t duplicateCount = cache.duplicateCount;
+    apdu.productId = GDL90FISBProductIdGenericText;
+    apdu.sFlag = 0;
+    apdu.length = 8;
+    apdu.data = collisions[0];
+    assert(GDL90FISBProductCache_add(&cache, 20000, &apdu) == GDL90ResultOK);
+    apdu.data = collisions[1];
+    assert(GDL90FISBProductCache_add(&cache, 20000, &apdu) == GDL90ResultOK);
+    assert(cache.count == 2 && cache.duplicateCount == duplicateCount);
+    assert(GDL90FISBProductCache_add(&cache, 20000, &apdu) == GDL90ResultOK);
+    assert(cache.count == 2 && cache.duplicateCount == duplicateCount + 1);
+
+    // only a later time replaces a segmented product, across midnight and the new year too
+    apdu.productId = GDL90FISBProductIdNEXRADRegional;
+    apdu.sFlag = 1;
+    apdu.productFileId = 7;
+    apdu.productFileLength = 1;
+    apdu.apduNumber = 1;
+    apdu.data = data[0];
+    apdu.length = 7;
+    apdu.hours = 23;
+    apdu.minutes = 59;
+    assert(GDL90FISBProductCache_add(&cache, 20000, &apdu) == GDL90ResultOK);
+    apdu.hours = 0;
+    apdu.minutes = 1;
+    assert(GDL90FISBProductCache_add(&cache, 21000, &apdu) == GDL90ResultOK);
+    assert(changedProducts == 2 && cache.staleCount == 0);
+    apdu.hours = 23;
+    apdu.minutes = 59;
+    assert(GDL90FISBProductCache_add(&cache, 22000, &apdu) == GDL90ResultOK);
+    assert(changedProducts == 2 && cache.staleCount == 1);
+
+    apdu.productFileId = 8;
+    apdu.month = 12;
+    apdu.day = 31;
+    apdu.hours = 12;
+    assert(GDL90FISBProductCache_add(&cache, 20000, &apdu) == GDL90ResultOK);
+    apdu.month = 1;
+    apdu.day = 1;
+    apdu.hours = 11;
+    assert(GDL90FISBProductCache_add(&cache, 21000, &apdu) == GDL90ResultOK);
+    assert(changedProducts == 3 && cache.staleCount == 1);
+    apdu.month = 12;
+    apdu.day = 31;
+    apdu.hours = 13;
+    assert(GDL90FISBProductCache_add(&cache, 22000, &apdu) == GDL90ResultOK);
+    assert(changedProducts == 3 && cache.staleCount == 2);
+    assert(cache.count == 4);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "nexrad") == 0)
+    {
+        testGDL90NEXRADCache();
+    }
+    else if (strcmp(argv[1], "text") == 0)
+    {
+        testGDL90FISBText();
+    }
+    else if (strcmp(argv[1], "products") == 0)
+    {
+        testGDL90FISBProductCache();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+//
+//  gdl90-latency-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-latency.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NS_PER_S 1000000000ull
+// 2024-01-01T00:00:00Z
+#define DAY_NS (19723ull * 86400ull * NS_PER_S)
+
+typedef struct LatencyTestContext
+{
+    GDL90LatencyMonitor *monitor;
+    uint64_t callbackTimeNs;
+} LatencyTestContext;
+
+static LatencyTestContext *latencyTestContext = NULL;
+
+static void handleGDL90Message(GDL90Message *gdl90Message, void *message)
+{
+    (void)message;
+    assert(GDL90LatencyMonitor_recordCurrentCallback(latencyTestContext->monitor, gdl90Message->id, latencyTestContext->callbackTimeNs) == GDL90ResultOK);
+}
+
+static void handleGDL90Error(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    (void)error;
+    assert(0);
+}
+
+static void testGDL90LatencyHistogram(void)
+{
+    GDL90LatencyHistogram histogram;
+    char json[256];
+    assert(GDL90LatencyHistogram_reset(&histogram) == GDL90ResultOK);
+    assert(GDL90LatencyHistogram_percentile(&histogram, 50.0) == 0);
+    assert(GDL90LatencyHistogram_toJSON(&histogram, json, sizeof(json)) > 0);
+    assert(strcmp(json, "{\"count\":0,\"min\":0,\"max\":0,\"mean\":0,\"p50\":0,\"p90\":0,\"p99\":0,\"p999\":0}") == 0);
+
+    // 1 us .. 1 ms
+    for (uint64_t i = 1; i <= 1000; i++)
+    {
+        GDL90LatencyHistogram_record(&histogram, i * 1000);
+    }
+    assert(histogram.count == 1000);
+    assert(histogram.min == 1000);
+    assert(histogram.max == 1000000);
+    assert(histogram.sum / histogram.count == 500500);
+
+    // within the bucket precision (1/16)
+    uint64_t p50 = GDL90LatencyHistogram_percentile(&histogram, 50.0);
+    assert(p50 >= 500000 && p50 <= 500000 + 500000 / 16);
+    uint64_t p99 = GDL90LatencyHistogram_percentile(&histogram, 99.0);
+    assert(p99 >= 990000 && p99 <= 1000000);
+    assert(GDL90LatencyHistogram_percentile(&histogram, 100.0) == 1000000);
+
+    // small values are exact, huge ones are clamped in the last bucket
+    GDL90LatencyHistogram other;
+    assert(GDL90LatencyHistogram_reset(&other) == GDL90ResultOK);
+    GDL90LatencyHistogram_record(&other, 3);
+    GDL90LatencyHistogram_record(&other, UINT64_MAX / 2);
+    assert(other.counts[3] == 1);
+    assert(other.counts[GDL90_LATENCY_BUCKETS - 1] == 1);
+    assert(GDL90LatencyHistogram_percentile(&other, 0.0) == 3);
+
+    assert(GDL90LatencyHistogram_merge(&histogram, &other) == GDL90ResultOK);
+    assert(histogram.count == 1002);
+    assert(histogram.min == 3);
+    assert(histogram.max == UINT64_MAX / 2);
+
+    // doesn't fit
+    assert(GDL90LatencyHistogram_toJSON(&histogram, json, 16) == 0);
+    assert(json[0] == '\0');
+}
+
+static void appendBasicReport(GDL90FrameBuilder *builder, uint32_t tor)
+{
+    uint8_t message[22] = {0};
+    message[0] = GDL90MessageType_BasicReport;
+    message[1] = tor & 0xff;
+    message[2] = (tor >> 8) & 0xff;
+    message[3] = (tor >> 16) & 0xff;
+    assert(GDL90FrameBuilder_append(builder, message, sizeof(message)) == GDL90ResultOK);
+}
+
+static void appendHeartbeat(GDL90FrameBuilder *builder, uint32_t timestamp)
+{
+    uint8_t message[7] = {0};
+    message[0] = GDL90MessageType_Heartbeat;
+    message[2] = (uint8_t)(((timestamp >> 16) & 1) << 7) | (1<<GDL90HeartbeatStatusByte2BitUTCOK);
+    message[3] = timestamp & 0xff;
+    message[4] = (timestamp >> 8) & 0xff;
+    assert(GDL90FrameBuilder_append(builder, message, sizeof(message)) == GDL90ResultOK);
+}
+
+static void testGDL90LatencyMonitor(void)
+{
+    GDL90LatencySource sources[2];
+    GDL90LatencyMonitor monitor;
+    assert(GDL90LatencyMonitor_init(&monitor, sources, 2) == GDL90ResultOK);
+
+    LatencyTestContext context = { &monitor, 0 };
+    latencyTestContext = &context;
+
+    GDL90StreamConfig gdl90StreamConfig = {0};
+    GDL90Stream gdl90Stream = {0};
+    assert(GDL90StreamConfig_init(&gdl90StreamConfig, handleGDL90Message, handleGDL90Error) == GDL90ResultOK);
+    assert(GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, GDL90LatencyMonitor_handleFrame, &monitor) == GDL90ResultOK);
+    assert(GDL90Stream_init(&gdl90Stream, &gdl90StreamConfig) == GDL90ResultOK);
+
+    uint8_t buffer[256];
+    GDL90FrameBuilder builder;
+    assert(GDL90FrameBuilder_init(&builder, buffer, sizeof(buffer)) == GDL90ResultOK);
+
+    // source 0 : host UTC, Heartbeat of 01:00:00 received 2 ms late
+    appendHeartbeat(&builder, 3600);
+    assert(GDL90LatencyMonitor_setReceiveInfo(&monitor, 10 * NS_PER_S, DAY_NS + 3600 * NS_PER_S + 2000000, 0) == GDL90ResultOK);
+    context.callbackTimeNs = 10 * NS_PER_S + 5000;
+    assert(GDL90Stream_process(&gdl90Stream, builder.buffer, (uint16_t)builder.length) == GDL90ResultOK);
+
+    // TOR .250 s received at .2501 s
+    assert(GDL90FrameBuilder_reset(&builder) == GDL90ResultOK);
+    appendBasicReport(&builder, 3125000);
+    assert(GDL90LatencyMonitor_setReceiveInfo(&monitor, 11 * NS_PER_S, DAY_NS + 3601 * NS_PER_S + 250100000, 0) == GDL90ResultOK);
+    context.callbackTimeNs = 11 * NS_PER_S + 20000;
+    assert(GDL90Stream_process(&gdl90Stream, builder.buffer, (uint16_t)builder.length) == GDL90ResultOK);
+
+    // TOR .999 s received in the next second, and an invalid TOR
+    assert(GDL90FrameBuilder_reset(&builder) == GDL90ResultOK);
+    appendBasicReport(&builder, 12487500);
+    appendBasicReport(&builder, 0xffffff);
+    assert(GDL90LatencyMonitor_setReceiveInfo(&monitor, 12 * NS_PER_S, DAY_NS + 3602 * NS_PER_S + 500000, 0) == GDL90ResultOK);
+    context.callbackTimeNs = 12 * NS_PER_S + 20000;
+    assert(GDL90Stream_process(&gdl90Stream, builder.buffer, (uint16_t)builder.length) == GDL90ResultOK);
+
+    GDL90LatencySource *source = &sources[0];
+    GDL90LatencyHistogram *heartbeat = &source->deviceToHost[GDL90LatencyTypeHeartbeat];
+    GDL90LatencyHistogram *basic = &source->deviceToHost[GDL90LatencyTypeBasicReport];
+    assert(heartbeat->count == 1);
+    assert(heartbeat->min == 2000000);
+    assert(basic->count == 2);
+    assert(basic->min == 100000);
+    assert(basic->max == 1500000);
+    assert(source->hostToCallback[GDL90LatencyTypeHeartbeat].count == 1);
+    assert(source->hostToCallback[GDL90LatencyTypeHeartbeat].max == 5000);
+    assert(source->hostToCallback[GDL90LatencyTypeBasicReport].count == 3);
+    assert(source->hostToCallback[GDL90LatencyTypeBasicReport].max == 20000);
+
+    // source 1 : no host UTC, TOR relative to the Heartbeat
+    assert(GDL90FrameBuilder_reset(&builder) == GDL90ResultOK);
+    appendBasicReport(&builder, 2500);
+    assert(GDL90LatencyMonitor_setReceiveInfo(&monitor, 4 * NS_PER_S, 0, 1) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, builder.buffer, (uint16_t)builder.length) == GDL90ResultOK);
+    assert(sources[1].deviceToHost[GDL90LatencyTypeBasicReport].count == 0);
+
+    assert(GDL90FrameBuilder_reset(&builder) == GDL90ResultOK);
+    appendHeartbeat(&builder, 3600);
+    assert(GDL90LatencyMonitor_setReceiveInfo(&monitor, 5 * NS_PER_S, 0, 1) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, builder.buffer, (uint16_t)builder.length) == GDL90ResultOK);
+    assert(sources[1].heartbeatTimeNs == 5 * NS_PER_S);
+    assert(sources[1].deviceToHost[GDL90LatencyTypeHeartbeat].count == 0);
+
+    // TOR 200 us received 300 us after the Heartbeat
+    assert(GDL90FrameBuilder_reset(&builder) == GDL90ResultOK);
+    appendBasicReport(&builder, 2500);
+    assert(GDL90LatencyMonitor_setReceiveInfo(&monitor, 5 * NS_PER_S + 300000, 0, 1) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, builder.buffer, (uint16_t)builder.length) == GDL90ResultOK);
+    assert(sources[1].deviceToHost[GDL90LatencyTypeBasicReport].count == 1);
+    assert(sources[1].deviceToHost[GDL90LatencyTypeBasicReport].min == 100000);
+
+    // unknown source
+    assert(GDL90LatencyMonitor_setReceiveInfo(&monitor, 6 * NS_PER_S, 0, 7) == GDL90ResultOK);
+    assert(GDL90LatencyMonitor_recordCurrentCallback(&monitor, GDL90MessageType_BasicReport, 6 * NS_PER_S) != GDL90ResultOK);
+    assert(monitor.unknownSourceCount == 1);
+    assert(monitor.negativeCount == 0);
+
+    assert(GDL90LatencyMonitor_reset(&monitor) == GDL90ResultOK);
+    assert(sources[0].deviceToHost[GDL90LatencyTypeBasicReport].count == 0);
+    assert(sources[1].heartbeatTimeNs == 0);
+
+    latencyTestContext = NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "histogram") == 0)
+    {
+        testGDL90LatencyHistogram();
+    }
+    else if (strcmp(argv[1], "monitor") == 0)
+    {
+        testGDL90LatencyMonitor();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
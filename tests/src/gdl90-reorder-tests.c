@@ -0,0 +1,248 @@
+//
+//  gdl90-reorder-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-reorder.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NS_PER_S 1000000000ull
+
+typedef struct ReorderTestOutput
+{
+    uint64_t deviceTimeNs[64];
+    uint16_t sourceId[64];
+    uint8_t id[64];
+    uint32_t count;
+} ReorderTestOutput;
+
+static void handleReorderEntry(GDL90ReorderEntry *entry, void *context)
+{
+    ReorderTestOutput *output = (ReorderTestOutput *)context;
+    assert(output->count < 64);
+    output->deviceTimeNs[output->count] = entry->deviceTimeNs;
+    output->sourceId[output->count] = entry->sourceId;
+    output->id[output->count] = entry->message.id;
+    output->count++;
+}
+
+static void initHeartbeat(GDL90Message *message, uint32_t timestamp)
+{
+    memset(message, 0, sizeof(*message));
+    message->id = GDL90MessageType_Heartbeat;
+    message->data[0] = GDL90MessageType_Heartbeat;
+    message->data[2] = (uint8_t)(((timestamp >> 16) & 1) << 7) | (1<<GDL90HeartbeatStatusByte2BitUTCOK);
+    message->data[3] = timestamp & 0xff;
+    message->data[4] = (timestamp >> 8) & 0xff;
+    message->dataLength = 7 + 2;
+}
+
+/** TOR in us */
+static void initBasicReport(GDL90Message *message, uint32_t torUs)
+{
+    uint32_t tor = torUs * 1000 / 80;
+    memset(message, 0, sizeof(*message));
+    message->id = GDL90MessageType_BasicReport;
+    message->data[0] = GDL90MessageType_BasicReport;
+    message->data[1] = tor & 0xff;
+    message->data[2] = (tor >> 8) & 0xff;
+    message->data[3] = (tor >> 16) & 0xff;
+    message->dataLength = 22 + 2;
+}
+
+static void testGDL90ReorderBufferOrder(void)
+{
+    GDL90ReorderEntry entries[16];
+    GDL90ReorderNode nodes[16];
+    GDL90ReorderSource sources[2];
+    GDL90ReorderBuffer buffer;
+    ReorderTestOutput output = {0};
+    GDL90Message message;
+
+    assert(GDL90ReorderBuffer_init(&buffer, entries, nodes, 16, sources, 2, 100) == GDL90ResultOK);
+    assert(GDL90ReorderBuffer_setHandler(&buffer, handleReorderEntry, &output) == GDL90ResultOK);
+
+    // not synchronized yet : at once
+    initBasicReport(&message, 1000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 900, 0) == GDL90ResultOK);
+    assert(output.count == 1);
+    assert(buffer.unsynchronizedCount == 1);
+
+    // both receivers at 12:00:00, the second one 20 ms behind
+    initHeartbeat(&message, 43200);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1000, 0) == GDL90ResultOK);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1020, 1) == GDL90ResultOK);
+
+    initBasicReport(&message, 30000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1040, 0) == GDL90ResultOK);
+    initBasicReport(&message, 10000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1045, 1) == GDL90ResultOK);
+    initBasicReport(&message, 20000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1050, 1) == GDL90ResultOK);
+    initBasicReport(&message, 40000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1055, 0) == GDL90ResultOK);
+    assert(output.count == 1);
+    assert(buffer.count == 6);
+
+    // held for 100 ms after the receive time
+    assert(GDL90ReorderBuffer_advance(&buffer, 1099) == GDL90ResultOK);
+    assert(output.count == 1);
+    assert(GDL90ReorderBuffer_advance(&buffer, 1120) == GDL90ResultOK);
+    assert(output.count == 3);
+    // 1040 + 100 is past, but it waits for the older frame received at 1045
+    assert(GDL90ReorderBuffer_advance(&buffer, 1144) == GDL90ResultOK);
+    assert(output.count == 3);
+    assert(GDL90ReorderBuffer_advance(&buffer, 1155) == GDL90ResultOK);
+    assert(output.count == 7);
+    assert(buffer.count == 0);
+
+    const uint64_t epochNs = 43200 * NS_PER_S;
+    assert(output.id[1] == GDL90MessageType_Heartbeat && output.sourceId[1] == 0);
+    assert(output.id[2] == GDL90MessageType_Heartbeat && output.sourceId[2] == 1);
+    assert(output.deviceTimeNs[3] == epochNs + 10000000 && output.sourceId[3] == 1);
+    assert(output.deviceTimeNs[4] == epochNs + 20000000 && output.sourceId[4] == 1);
+    assert(output.deviceTimeNs[5] == epochNs + 30000000 && output.sourceId[5] == 0);
+    assert(output.deviceTimeNs[6] == epochNs + 40000000 && output.sourceId[6] == 0);
+    for (uint32_t i = 2; i < output.count; i++)
+    {
+        assert(output.deviceTimeNs[i - 1] <= output.deviceTimeNs[i]);
+    }
+
+    // late
+    initBasicReport(&message, 35000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1130, 1) == GDL90ResultOK);
+    assert(output.count == 8);
+    assert(buffer.lateCount == 1);
+    assert(buffer.maxLatenessNs == 5000000);
+
+    // TOR .990 s received just after the Heartbeat of the next second : previous second
+    initHeartbeat(&message, 43201);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 2000, 0) == GDL90ResultOK);
+    initBasicReport(&message, 990000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 2005, 0) == GDL90ResultOK);
+    assert(buffer.lateCount == 1);
+    assert(GDL90ReorderBuffer_flush(&buffer) == GDL90ResultOK);
+    assert(output.count == 10);
+    assert(output.deviceTimeNs[8] == epochNs + 990000000);
+    assert(output.deviceTimeNs[9] == epochNs + NS_PER_S);
+
+    // released by the device time of newer frames
+    initBasicReport(&message, 100000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 2100, 0) == GDL90ResultOK);
+    initBasicReport(&message, 250000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 2101, 0) == GDL90ResultOK);
+    assert(output.count == 11);
+    assert(output.deviceTimeNs[10] == epochNs + NS_PER_S + 100000000);
+    assert(buffer.emittedCount == 11);
+}
+
+static void testGDL90ReorderBufferOverflow(void)
+{
+    GDL90ReorderEntry entries[4];
+    GDL90ReorderNode nodes[4];
+    GDL90ReorderSource sources[1];
+    GDL90ReorderBuffer buffer;
+    ReorderTestOutput output = {0};
+    GDL90Message message;
+
+    assert(GDL90ReorderBuffer_init(&buffer, entries, nodes, 4, sources, 1, 1000) == GDL90ResultOK);
+    assert(GDL90ReorderBuffer_setHandler(&buffer, handleReorderEntry, &output) == GDL90ResultOK);
+
+    // around midnight
+    initHeartbeat(&message, 86399);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 0, 0) == GDL90ResultOK);
+    initHeartbeat(&message, 0);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1000, 0) == GDL90ResultOK);
+    assert(sources[0].epochS == 86400);
+
+    const uint32_t tors[] = { 500000, 400000, 300000, 200000, 100000 };
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        initBasicReport(&message, tors[i]);
+        assert(GDL90ReorderBuffer_push(&buffer, &message, 1001 + i, 0) == GDL90ResultOK);
+    }
+    // full, the Heartbeat had to go first, then the last report is older than all the buffer holds
+    assert(buffer.overflowCount == 2);
+    assert(buffer.lateCount == 0);
+    assert(output.count == 3);
+    assert(output.deviceTimeNs[0] == 86399 * NS_PER_S);
+    assert(output.deviceTimeNs[1] == 86400 * NS_PER_S);
+    assert(output.deviceTimeNs[2] == 86400 * NS_PER_S + 100000000);
+
+    assert(GDL90ReorderBuffer_flush(&buffer) == GDL90ResultOK);
+    assert(output.count == 7);
+    for (uint32_t i = 1; i < output.count; i++)
+    {
+        assert(output.deviceTimeNs[i - 1] <= output.deviceTimeNs[i]);
+    }
+
+    // a late frame doesn't push anything out of a full buffer
+    const uint32_t laterTors[] = { 600000, 700000, 800000, 900000 };
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        initBasicReport(&message, laterTors[i]);
+        assert(GDL90ReorderBuffer_push(&buffer, &message, 1400 + i, 0) == GDL90ResultOK);
+    }
+    assert(buffer.count == 4);
+    initBasicReport(&message, 50000);
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 1420, 0) == GDL90ResultOK);
+    assert(buffer.lateCount == 1);
+    assert(buffer.overflowCount == 2);
+    assert(buffer.count == 4);
+    assert(output.count == 8);
+    assert(output.deviceTimeNs[7] == 86400 * NS_PER_S + 50000000);
+    assert(GDL90ReorderBuffer_flush(&buffer) == GDL90ResultOK);
+    assert(output.count == 12);
+
+    // unknown source
+    assert(GDL90ReorderBuffer_push(&buffer, &message, 2000, 3) == GDL90ResultOK);
+    assert(buffer.unsynchronizedCount == 1);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "order") == 0)
+    {
+        testGDL90ReorderBufferOrder();
+    }
+    else if (strcmp(argv[1], "overflow") == 0)
+    {
+        testGDL90ReorderBufferOverflow();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,272 @@
+//
+//  gdl90-simd-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Runs gdl90.c's __wasm_simd128__ paths natively: this target compiles gdl90.c with
+// __wasm_simd128__ defined and wasm-simd128/wasm_simd128.h standing in for the intrinsics,
+// and checks GDL90Message_init and GDL90Stream_process against a byte-at-a-time reference.
+
+#include <gdl90.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FLAG 0x7e
+#define ESCAPE 0x7d
+
+#if !defined(__wasm_simd128__)
+#error "gdl90-simd-tests must be built with __wasm_simd128__ defined"
+#endif
+
+typedef struct GuardedMessage
+{
+    GDL90Message message;
+    uint8_t canary[32];
+} GuardedMessage;
+
+static uint32_t randomState = 0x9e3779b9;
+
+static uint32_t nextRandom(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/** Random byte that is neither a flag nor an escape */
+static uint8_t plainByte(void)
+{
+    uint8_t b;
+    do { b = (uint8_t)nextRandom(); } while (b == FLAG || b == ESCAPE);
+    return b;
+}
+
+/** Scalar reference for GDL90Message_init, returns the unescaped length */
+static uint16_t referenceUnescape(const uint8_t *data, uint16_t dataLength, uint8_t *out)
+{
+    uint16_t length = 0;
+    for (uint16_t j = 1; j < dataLength - 1; j++)
+    {
+        out[length++] = data[j] == ESCAPE ? data[++j] ^ 0x20 : data[j];
+    }
+    return length;
+}
+
+static void assertUnescape(const uint8_t *frame, uint16_t frameLength)
+{
+    uint8_t expected[sizeof(((GDL90Message *)0)->data) + 16];
+    uint16_t expectedLength = referenceUnescape(frame, frameLength, expected);
+    assert(expectedLength <= sizeof(((GDL90Message *)0)->data));
+
+    GuardedMessage guarded;
+    memset(&guarded, 0, sizeof(guarded));
+    memset(guarded.canary, 0xa5, sizeof(guarded.canary));
+    assert(GDL90Message_init(&guarded.message, frame, frameLength) == GDL90ResultOK);
+    assert(guarded.message.dataLength == expectedLength);
+    assert(memcmp(guarded.message.data, expected, expectedLength) == 0);
+    assert(guarded.message.id == expected[0]);
+    for (size_t i = 0; i < sizeof(guarded.canary); i++)
+    {
+        assert(guarded.canary[i] == 0xa5);
+    }
+}
+
+/** Frame of frameLength bytes with flags at both ends and no escapes */
+static void initFrame(uint8_t *frame, uint16_t frameLength)
+{
+    frame[0] = FLAG;
+    for (uint16_t i = 1; i < frameLength - 1; i++)
+    {
+        frame[i] = plainByte();
+    }
+    frame[frameLength - 1] = FLAG;
+}
+
+static void testGDL90SIMDUnescape(void)
+{
+    // frames up to 2 + sizeof(data), so the unescaped payload reaches the end of data
+    uint8_t frame[2 + (1<<9)];
+
+    for (uint16_t frameLength = 3; frameLength <= sizeof(frame); frameLength++)
+    {
+        initFrame(frame, frameLength);
+        assertUnescape(frame, frameLength);
+
+        // a single escape at every offset: every lane of every 16-byte block, and right
+        // before the closing flag (the escaped byte is then the flag itself)
+        for (uint16_t p = 1; p < frameLength - 1; p++)
+        {
+            initFrame(frame, frameLength);
+            frame[p] = ESCAPE;
+            if (p + 1 < frameLength - 1)
+            {
+                frame[p + 1] = (nextRandom() & 1) ? FLAG ^ 0x20 : ESCAPE ^ 0x20;
+            }
+            assertUnescape(frame, frameLength);
+
+            // back to back escape sequences, and an escaped escape byte
+            if (p + 3 < frameLength - 1)
+            {
+                frame[p + 2] = ESCAPE;
+                frame[p + 3] = ESCAPE ^ 0x20;
+                assertUnescape(frame, frameLength);
+                frame[p + 1] = ESCAPE;
+                assertUnescape(frame, frameLength);
+            }
+        }
+    }
+
+    // dense escapes, every block mixes copied and unescaped bytes
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        uint16_t frameLength = (uint16_t)(3 + nextRandom() % (sizeof(frame) - 2));
+        initFrame(frame, frameLength);
+        for (uint16_t p = 1; p < frameLength - 1; p++)
+        {
+            if (nextRandom() % 8 == 0) { frame[p] = ESCAPE; }
+        }
+        assertUnescape(frame, frameLength);
+    }
+}
+
+typedef struct FlagsTestOutput
+{
+    uint32_t count;
+    uint16_t dataLength[256];
+    uint8_t data[256][1<<9];
+} FlagsTestOutput;
+
+static FlagsTestOutput flagsOutput;
+
+static void recordMessage(GDL90Message *message)
+{
+    assert(flagsOutput.count < 256);
+    flagsOutput.dataLength[flagsOutput.count] = message->dataLength;
+    memcpy(flagsOutput.data[flagsOutput.count], message->data, message->dataLength);
+    flagsOutput.count++;
+}
+
+static void handleFlagsMessage(GDL90Message *message, void *context)
+{
+    (void)context;
+    recordMessage(message);
+}
+
+static void handleFlagsError(GDL90Message *message, GDL90StreamProcessingError error)
+{
+    (void)error;
+    recordMessage(message);
+}
+
+/** Every frame GDL90Stream_process hands on, checked against a scalar flag scan */
+static void assertFlags(GDL90Stream *stream, const uint8_t *datagram, uint16_t datagramLength)
+{
+    memset(&flagsOutput, 0, sizeof(flagsOutput.count));
+    assert(GDL90Stream_process(stream, datagram, datagramLength) == GDL90ResultOK);
+
+    uint32_t count = 0;
+    uint16_t curMessageOffset = 0;
+    for (uint16_t i = 0; i < datagramLength; i++)
+    {
+        if (datagram[i] != FLAG) { continue; }
+        if (i > curMessageOffset)
+        {
+            uint16_t frameLength = (uint16_t)(i - curMessageOffset + 1);
+            uint8_t expected[1<<9];
+            uint16_t expectedLength = frameLength < 3 ? 0 : referenceUnescape(&datagram[curMessageOffset], frameLength, expected);
+            assert(count < flagsOutput.count);
+            assert(flagsOutput.dataLength[count] == expectedLength);
+            assert(memcmp(flagsOutput.data[count], expected, expectedLength) == 0);
+            count++;
+            curMessageOffset = (uint16_t)(i + 1);
+        }
+    }
+    assert(flagsOutput.count == count);
+}
+
+static void testGDL90SIMDFlags(void)
+{
+    GDL90StreamConfig config;
+    GDL90Stream stream;
+    assert(GDL90StreamConfig_init(&config, handleFlagsMessage, handleFlagsError) == GDL90ResultOK);
+    assert(GDL90Stream_init(&stream, &config) == GDL90ResultOK);
+
+    uint8_t datagram[1500];
+
+    // one and two flags at every offset, on and across 16-byte block boundaries
+    for (uint16_t length = 1; length <= 64; length++)
+    {
+        for (uint16_t i = 0; i < length; i++)
+        {
+            for (uint16_t k = i; k < length; k++)
+            {
+                for (uint16_t p = 0; p < length; p++) { datagram[p] = plainByte(); }
+                datagram[i] = FLAG;
+                datagram[k] = FLAG;
+                assertFlags(&stream, datagram, length);
+            }
+        }
+    }
+
+    // random flag and escape placement, frames kept short enough to fit GDL90Message
+    for (int iteration = 0; iteration < 5000; iteration++)
+    {
+        uint16_t length = (uint16_t)(1 + nextRandom() % sizeof(datagram));
+        uint16_t sinceFlag = 0;
+        for (uint16_t p = 0; p < length; p++)
+        {
+            uint32_t r = nextRandom() % 64;
+            datagram[p] = r == 0 || sinceFlag == 400 ? FLAG : r == 1 ? ESCAPE : plainByte();
+            sinceFlag = datagram[p] == FLAG ? 0 : (uint16_t)(sinceFlag + 1);
+        }
+        assertFlags(&stream, datagram, length);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "unescape") == 0)
+    {
+        testGDL90SIMDUnescape();
+    }
+    else if (strcmp(argv[1], "flags") == 0)
+    {
+        testGDL90SIMDFlags();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,836 @@
+//
+//  gdl90-traffic-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-traffic.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TARGET_CAPACITY 8192
+
+static GDL90TargetTableSlot targetSlots[TARGET_CAPACITY];
+static GDL90Target targets[TARGET_CAPACITY];
+
+static void fillTrafficReport(GDL90TrafficReport *report, uint8_t addressType, uint32_t participantAddress)
+{
+    memset(report, 0, sizeof(*report));
+    report->id = GDL90MessageType_TrafficReport;
+    report->addressType = addressType;
+    report->participantAddress = participantAddress;
+    report->latitude = 44.90708;
+    report->longitude = -122.99488;
+    report->altitude = 5000;
+    report->hasValidAltitude = 1;
+    report->hasValidPosition = 1;
+}
+
+static void testGDL90TargetTable(void)
+{
+    GDL90TargetTable table;
+    GDL90TrafficReport report;
+    GDL90Target *target = NULL;
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, 1000) != GDL90ResultOK);
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+
+    // same address, different address types are different targets
+    for (uint32_t i = 0; i < 3000; i++)
+    {
+        fillTrafficReport(&report, (uint8_t)(i % 2), 052642511 + i / 2);
+        assert(GDL90TargetTable_update(&table, i, &report, &target) == GDL90ResultOK);
+        assert(target->updateCount == 1);
+    }
+    assert(table.count == 3000);
+
+    // updates
+    for (uint32_t i = 0; i < 3000; i += 2)
+    {
+        fillTrafficReport(&report, 0, 052642511 + i / 2);
+        report.altitude = 6000;
+        assert(GDL90TargetTable_update(&table, 10000 + i, &report, &target) == GDL90ResultOK);
+        assert(target->updateCount == 2);
+        assert(target->firstSeenTimeMs == i);
+    }
+    assert(table.count == 3000);
+
+    target = GDL90TargetTable_find(&table, 0, 052642511);
+    assert(target && target->report.altitude == 6000);
+    target = GDL90TargetTable_find(&table, 1, 052642511);
+    assert(target && target->report.altitude == 5000);
+    assert(GDL90TargetTable_find(&table, 2, 052642511) == NULL);
+
+    // evict the address type 1 targets, that weren't updated
+    assert(GDL90TargetTable_evict(&table, 10000) == 1500);
+    assert(table.count == 1500);
+    for (uint32_t i = 0; i < 3000; i++)
+    {
+        target = GDL90TargetTable_find(&table, (uint8_t)(i % 2), 052642511 + i / 2);
+        assert((target != NULL) == (i % 2 == 0));
+    }
+
+    uint32_t cursor = 0, iterated = 0;
+    while ((target = GDL90TargetTable_next(&table, &cursor)) != NULL)
+    {
+        assert(target->report.addressType == 0);
+        iterated++;
+    }
+    assert(iterated == 1500);
+
+    assert(GDL90TargetTable_remove(&table, 0, 052642511) == GDL90ResultOK);
+    assert(GDL90TargetTable_remove(&table, 0, 052642511) != GDL90ResultOK);
+    assert(GDL90TargetTable_find(&table, 0, 052642511) == NULL);
+    assert(table.count == 1499);
+
+    // fixed capacity
+    assert(GDL90TargetTable_clear(&table) == GDL90ResultOK);
+    uint32_t inserted = 0;
+    for (uint32_t i = 0; i < TARGET_CAPACITY; i++)
+    {
+        fillTrafficReport(&report, 0, i);
+        inserted += GDL90TargetTable_update(&table, 0, &report, NULL) == GDL90ResultOK;
+    }
+    assert(inserted == table.maxCount);
+}
+
+static void testGDL90SpatialGrid(void)
+{
+    static GDL90SpatialGridNode nodes[TARGET_CAPACITY];
+    static uint32_t buckets[4096];
+    static uint32_t found[TARGET_CAPACITY];
+
+    GDL90TargetTable table;
+    GDL90SpatialGrid grid;
+    GDL90TrafficReport report;
+    GDL90Target *target = NULL;
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_init(&grid, 0.25, buckets, 4096, nodes, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90TargetTable_setRemovalHandler(&table, GDL90SpatialGrid_handleTargetRemoval, &grid) == GDL90ResultOK);
+
+    // 70 x 70 targets every 0.1 degrees from 40N 100W, 100 ft apart
+    for (uint32_t i = 0; i < 4900; i++)
+    {
+        fillTrafficReport(&report, 0, i);
+        report.latitude = 40.0 + (i / 70) * 0.1;
+        report.longitude = -100.0 + (i % 70) * 0.1;
+        report.altitude = (int32_t)(i % 100) * 100;
+        assert(GDL90TargetTable_update(&table, 0, &report, &target) == GDL90ResultOK);
+        assert(GDL90SpatialGrid_updateTarget(&grid, &table, target) == GDL90ResultOK);
+    }
+    assert(grid.count == 4900);
+
+    // 3 x 3 targets
+    uint32_t n = GDL90SpatialGrid_queryBox(&grid, 42.85, -97.15, 43.15, -96.85, INT32_MIN, INT32_MAX, found, TARGET_CAPACITY);
+    assert(n == 9);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const GDL90TrafficReport *r = &targets[found[i]].report;
+        assert(r->latitude > 42.85 && r->latitude < 43.15);
+        assert(r->longitude > -97.15 && r->longitude < -96.85);
+    }
+
+    // 0.1 degree of latitude is 6 nm, but 0.1 degree of longitude is only 4.4 nm at 43N : the center and the 2 targets east and west
+    n = GDL90SpatialGrid_queryRadius(&grid, 43.0, -97.0, 5.0, INT32_MIN, INT32_MAX, found, TARGET_CAPACITY);
+    assert(n == 3);
+
+    // altitude filter
+    uint32_t all = GDL90SpatialGrid_queryBox(&grid, 39.0, -101.0, 48.0, -92.0, INT32_MIN, INT32_MAX, found, TARGET_CAPACITY);
+    assert(all == 4900);
+    n = GDL90SpatialGrid_queryBox(&grid, 39.0, -101.0, 48.0, -92.0, 0, 900, found, TARGET_CAPACITY);
+    assert(n == 490);
+
+    // truncated output still counts
+    assert(GDL90SpatialGrid_queryBox(&grid, 39.0, -101.0, 48.0, -92.0, INT32_MIN, INT32_MAX, found, 10) == 4900);
+
+    // moving and evicting keeps the grid in sync
+    target = GDL90TargetTable_find(&table, 0, 0);
+    report = target->report;
+    report.latitude = 10.0;
+    assert(GDL90TargetTable_update(&table, 1, &report, &target) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_updateTarget(&grid, &table, target) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_queryRadius(&grid, 10.0, -100.0, 1.0, INT32_MIN, INT32_MAX, found, TARGET_CAPACITY) == 1);
+    assert(GDL90TargetTable_evict(&table, 1) == 4899);
+    assert(grid.count == 1);
+    assert(GDL90SpatialGrid_queryBox(&grid, -90.0, -180.0, 90.0, 180.0, INT32_MIN, INT32_MAX, found, TARGET_CAPACITY) == 1);
+
+    // across the antimeridian
+    fillTrafficReport(&report, 0, 1);
+    report.latitude = 0.0;
+    report.longitude = 179.95;
+    assert(GDL90TargetTable_update(&table, 1, &report, &target) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_updateTarget(&grid, &table, target) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_queryRadius(&grid, 0.0, -179.95, 10.0, INT32_MIN, INT32_MAX, found, TARGET_CAPACITY) == 1);
+    assert(GDL90SpatialGrid_queryBox(&grid, -1.0, 179.0, 1.0, -179.0, INT32_MIN, INT32_MAX, found, TARGET_CAPACITY) == 1);
+}
+
+static void testGDL90Extrapolator(void)
+{
+    static uint64_t storage[GDL90_EXTRAPOLATOR_STORAGE_SIZE(TARGET_CAPACITY) / sizeof(uint64_t) + 1];
+
+    GDL90TargetTable table;
+    GDL90Extrapolator extrapolator;
+    GDL90TrafficReport report;
+    GDL90Target *target = NULL;
+
+    assert(GDL90Extrapolator_init(&extrapolator, storage, 100, TARGET_CAPACITY, 30000) != GDL90ResultOK);
+    assert(GDL90Extrapolator_init(&extrapolator, storage, sizeof(storage), TARGET_CAPACITY, 30000) == GDL90ResultOK);
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90TargetTable_setRemovalHandler(&table, GDL90Extrapolator_handleTargetRemoval, &extrapolator) == GDL90ResultOK);
+
+    // 360 kt east at 45N, climbing 600 fpm
+    fillTrafficReport(&report, 0, 1);
+    report.latitude = 45.0;
+    report.longitude = -100.0;
+    report.hasValidHorizontalVelocity = 1;
+    report.horizontalVelocity = 360;
+    report.hasValidVerticalVelocity = 1;
+    report.verticalVelocity = 600;
+    report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report.trackHeading = 90.0;
+    GDL90TrafficReport movingReport = report;
+    assert(GDL90TargetTable_update(&table, 1000, &report, &target) == GDL90ResultOK);
+    assert(GDL90Extrapolator_updateTarget(&extrapolator, &table, target) == GDL90ResultOK);
+    uint32_t moving = GDL90TargetTable_index(&table, target);
+
+    // same, with no valid track
+    fillTrafficReport(&report, 0, 2);
+    report.latitude = 45.0;
+    report.longitude = -100.0;
+    report.hasValidHorizontalVelocity = 1;
+    report.horizontalVelocity = 360;
+    report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeInvalid;
+    assert(GDL90TargetTable_update(&table, 1000, &report, &target) == GDL90ResultOK);
+    assert(GDL90Extrapolator_updateTarget(&extrapolator, &table, target) == GDL90ResultOK);
+    uint32_t stationary = GDL90TargetTable_index(&table, target);
+    assert(extrapolator.flags[stationary] == (GDL90ExtrapolationFlagActive | GDL90ExtrapolationFlagAltitude));
+
+    // 6 nm a minute is 0.1414 degrees of longitude a minute at 45N
+    assert(GDL90Extrapolator_project(&extrapolator, 1000 + 20000) == GDL90ResultOK);
+    assert(extrapolator.outLatitude[moving] > 44.9999f && extrapolator.outLatitude[moving] < 45.0001f);
+    assert(extrapolator.outLongitude[moving] > -100.0f + 0.0471f && extrapolator.outLongitude[moving] < -100.0f + 0.0472f);
+    assert(extrapolator.outAltitude[moving] > 5199.0f && extrapolator.outAltitude[moving] < 5201.0f);
+    assert(extrapolator.outLongitude[stationary] == -100.0f);
+    assert(!(extrapolator.flags[moving] & GDL90ExtrapolationFlagLimited));
+
+    // clamped to 30 s
+    assert(GDL90Extrapolator_project(&extrapolator, 1000 + 60000) == GDL90ResultOK);
+    assert(extrapolator.outLongitude[moving] > -100.0f + 0.0706f && extrapolator.outLongitude[moving] < -100.0f + 0.0708f);
+    assert(extrapolator.outAltitude[moving] > 5299.0f && extrapolator.outAltitude[moving] < 5301.0f);
+    assert(extrapolator.flags[moving] & GDL90ExtrapolationFlagLimited);
+
+    // not before the report
+    assert(GDL90Extrapolator_project(&extrapolator, 0) == GDL90ResultOK);
+    assert(extrapolator.outLongitude[moving] == -100.0f);
+
+    // removal from the table clears the slot
+    assert(GDL90TargetTable_evict(&table, 2000) == 2);
+    assert(extrapolator.flags[moving] == 0);
+    assert(extrapolator.flags[stationary] == 0);
+
+    // epoch times : the base of the float times moves forward with them, keeping them exact
+    const uint64_t epochMs = 1700000000000ULL;
+    for (uint64_t timeMs = epochMs; timeMs < epochMs + 3 * GDL90_EXTRAPOLATOR_REBASE_MS; timeMs += GDL90_EXTRAPOLATOR_REBASE_MS / 3 + 1)
+    {
+        assert(GDL90Extrapolator_update(&extrapolator, moving, timeMs, &movingReport) == GDL90ResultOK);
+        assert(GDL90Extrapolator_project(&extrapolator, timeMs + 20000) == GDL90ResultOK);
+        assert(extrapolator.outLongitude[moving] > -100.0f + 0.0471f && extrapolator.outLongitude[moving] < -100.0f + 0.0472f);
+        assert(!(extrapolator.flags[moving] & GDL90ExtrapolationFlagLimited));
+        assert(GDL90Extrapolator_project(&extrapolator, timeMs + 30001) == GDL90ResultOK);
+        assert(extrapolator.flags[moving] & GDL90ExtrapolationFlagLimited);
+    }
+    assert(extrapolator.baseTimeMs > epochMs);
+}
+
+static void testGDL90ConflictProbe(void)
+{
+    static uint64_t storage[GDL90_EXTRAPOLATOR_STORAGE_SIZE(TARGET_CAPACITY) / sizeof(uint64_t) + 1];
+    static float probeStorage[GDL90_CONFLICT_PROBE_STORAGE_SIZE(TARGET_CAPACITY) / sizeof(float) + 1];
+
+    GDL90TargetTable table;
+    GDL90Extrapolator extrapolator;
+    GDL90ConflictProbe probe;
+    GDL90TrafficReport ownship, report;
+    GDL90Target *target = NULL;
+    uint32_t index[6];
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90Extrapolator_init(&extrapolator, storage, sizeof(storage), TARGET_CAPACITY, 30000) == GDL90ResultOK);
+    assert(GDL90ConflictProbe_init(&probe, probeStorage, 10, TARGET_CAPACITY, 1.0f, 600.0f, 120.0f) != GDL90ResultOK);
+    assert(GDL90ConflictProbe_init(&probe, probeStorage, sizeof(probeStorage), TARGET_CAPACITY, 1.0f, 600.0f, 120.0f) == GDL90ResultOK);
+
+    // ownship north bound at 120 kt
+    fillTrafficReport(&ownship, 0, 0);
+    ownship.id = GDL90MessageType_OwnshipReport;
+    ownship.latitude = 45.0;
+    ownship.longitude = -100.0;
+    ownship.hasValidHorizontalVelocity = 1;
+    ownship.horizontalVelocity = 120;
+    ownship.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    ownship.trackHeading = 0.0;
+
+    // 5000 targets more than 2 degrees away
+    for (uint32_t i = 0; i < 5000; i++)
+    {
+        fillTrafficReport(&report, 1, i);
+        report.latitude = 48.0 + (i / 100) * 0.05;
+        report.longitude = -105.0 + (i % 100) * 0.05;
+        report.hasValidHorizontalVelocity = 1;
+        report.horizontalVelocity = 150;
+        report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+        report.trackHeading = (double)(i % 360);
+        assert(GDL90TargetTable_update(&table, 0, &report, &target) == GDL90ResultOK);
+        assert(GDL90Extrapolator_updateTarget(&extrapolator, &table, target) == GDL90ResultOK);
+    }
+
+    // 0 : head on 5 nm ahead, 1 : same 1000 ft above, 2 : 5 nm behind going away, 3 : 3 nm abeam in formation,
+    // 4 : head on 20 nm ahead, too far for the lookahead, 5 : head on 5 nm ahead without altitude
+    const double latitudes[6] = { 45.0 + 5.0 / 60.0, 45.0 + 5.0 / 60.0, 45.0 - 5.0 / 60.0, 45.0, 45.0 + 20.0 / 60.0, 45.0 + 5.0 / 60.0 };
+    const double longitudes[6] = { -100.0, -100.0, -100.0, -100.0 + 3.0 / 60.0 / 0.70710678, -100.0, -100.0 };
+    const double tracks[6] = { 180.0, 180.0, 180.0, 0.0, 180.0, 180.0 };
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        fillTrafficReport(&report, 0, i);
+        report.latitude = latitudes[i];
+        report.longitude = longitudes[i];
+        report.altitude = i == 1 ? 6000 : 5000;
+        report.hasValidAltitude = i != 5;
+        report.hasValidHorizontalVelocity = 1;
+        report.horizontalVelocity = 120;
+        report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+        report.trackHeading = tracks[i];
+        assert(GDL90TargetTable_update(&table, 0, &report, &target) == GDL90ResultOK);
+        assert(GDL90Extrapolator_updateTarget(&extrapolator, &table, target) == GDL90ResultOK);
+        index[i] = GDL90TargetTable_index(&table, target);
+    }
+
+    assert(GDL90Extrapolator_project(&extrapolator, 0) == GDL90ResultOK);
+    assert(GDL90ConflictProbe_evaluate(&probe, &extrapolator, &ownship) == 2);
+
+    // closing at 240 kt
+    assert(probe.conflict[index[0]]);
+    assert(probe.timeToCPA[index[0]] > 74.0f && probe.timeToCPA[index[0]] < 76.0f);
+    assert(probe.horizontalCPA[index[0]] < 0.01f);
+
+    assert(!probe.conflict[index[1]]);
+    assert(probe.verticalCPA[index[1]] == 1000.0f);
+
+    assert(!probe.conflict[index[2]]);
+    assert(probe.timeToCPA[index[2]] == 0.0f);
+    assert(probe.horizontalCPA[index[2]] > 4.99f && probe.horizontalCPA[index[2]] < 5.01f);
+
+    assert(!probe.conflict[index[3]]);
+    assert(probe.horizontalCPA[index[3]] > 2.99f && probe.horizontalCPA[index[3]] < 3.01f);
+
+    assert(!probe.conflict[index[4]]);
+    assert(probe.timeToCPA[index[4]] == 120.0f);
+    assert(probe.horizontalCPA[index[4]] > 11.9f && probe.horizontalCPA[index[4]] < 12.1f);
+
+    assert(probe.conflict[index[5]]);
+
+    // inactive slots never conflict
+    assert(GDL90TargetTable_setRemovalHandler(&table, GDL90Extrapolator_handleTargetRemoval, &extrapolator) == GDL90ResultOK);
+    assert(GDL90TargetTable_remove(&table, 0, 0) == GDL90ResultOK);
+    assert(GDL90ConflictProbe_evaluate(&probe, &extrapolator, &ownship) == 1);
+}
+
+static void handleGDL90Message(GDL90Message *gdl90Message, void *message)
+{
+    (void)gdl90Message;
+    (void)message;
+}
+
+static void handleGDL90Error(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    (void)error;
+}
+
+/** Flags, CRC and escapes payload into out, returns the frame length */
+static size_t frameGDL90Message(uint8_t *out, const uint8_t *payload, size_t len)
+{
+    GDL90CRC crc;
+    uint16_t value = 0;
+    uint8_t message[64];
+    memcpy(message, payload, len);
+    assert(GDL90CRC_init(&crc) == GDL90ResultOK);
+    assert(GDL90CRC_crc(&crc, &value, message, len) == GDL90ResultOK);
+    message[len++] = (uint8_t)(value & 0xff);
+    message[len++] = (uint8_t)(value >> 8);
+
+    size_t n = 0;
+    out[n++] = 0x7e;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (message[i] == 0x7e || message[i] == 0x7d)
+        {
+            out[n++] = 0x7d;
+            out[n++] = message[i] ^ 0x20;
+        }
+        else
+        {
+            out[n++] = message[i];
+        }
+    }
+    out[n++] = 0x7e;
+    return n;
+}
+
+static void testGDL90OwnshipState(void)
+{
+    // 3.5.2. Traffic Report Example as an Ownship Report
+    uint8_t ownshipReport[] = {
+        0x0a,
+        0x00, 0xAB, 0x45, 0x49, 0x1F, 0xEF, 0x15, 0xA8, 0x89, 0x78,
+        0x0F, 0x09, 0xA9, 0x07, 0xB0, 0x01, 0x20, 0x01, 0x4E, 0x38,
+        0x32, 0x35, 0x56, 0x20, 0x20, 0x20, 0x00
+    };
+    // 1000 ft, VFOM 10 m
+    uint8_t geometricAltitude[] = { 0x0b, 0x00, 0xc8, 0x00, 0x0a };
+    // 500 ft, then invalid
+    uint8_t heightAboveTerrain[] = { 0x09, 0x01, 0xf4 };
+    uint8_t invalidHeightAboveTerrain[] = { 0x09, 0x80, 0x00 };
+
+    uint8_t data[256];
+    size_t len = 0;
+
+    static GDL90OwnshipState ownship;
+    GDL90OwnshipSnapshot snapshot;
+
+    assert(GDL90OwnshipState_init(&ownship) == GDL90ResultOK);
+    assert(GDL90OwnshipState_read(&ownship, &snapshot) == GDL90ResultOK);
+    assert(snapshot.version == 0);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldPosition, 0) == UINT64_MAX);
+
+    GDL90StreamConfig gdl90StreamConfig = {0};
+    GDL90Stream gdl90Stream = {0};
+    assert(GDL90StreamConfig_init(&gdl90StreamConfig, handleGDL90Message, handleGDL90Error) == GDL90ResultOK);
+    assert(GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, GDL90OwnshipState_handleFrame, &ownship) == GDL90ResultOK);
+    assert(GDL90Stream_init(&gdl90Stream, &gdl90StreamConfig) == GDL90ResultOK);
+
+    len = frameGDL90Message(data, ownshipReport, sizeof(ownshipReport));
+    len += frameGDL90Message(data + len, geometricAltitude, sizeof(geometricAltitude));
+    assert(GDL90OwnshipState_setTime(&ownship, 1000) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, data, len) == GDL90ResultOK);
+
+    len = frameGDL90Message(data, heightAboveTerrain, sizeof(heightAboveTerrain));
+    assert(GDL90OwnshipState_setTime(&ownship, 1500) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, data, len) == GDL90ResultOK);
+
+    assert(GDL90OwnshipState_read(&ownship, &snapshot) == GDL90ResultOK);
+    assert((ownship.sequence & 1) == 0);
+    assert(snapshot.version == 3);
+    assert(snapshot.report.id == GDL90MessageType_OwnshipReport);
+    assert((int32_t)snapshot.latitude == 44);
+    assert(snapshot.pressureAltitude == 5000);
+    assert(snapshot.horizontalVelocity == 123);
+    assert(snapshot.verticalVelocity == 64);
+    assert(snapshot.geometricAltitude == 1000);
+    assert(snapshot.hasValidVFOM && snapshot.verticalFigureOfMerit == 10);
+    assert(snapshot.heightAboveTerrain == 500);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldPosition, 2000) == 1000);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldGeometricAltitude, 2000) == 1000);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldHeightAboveTerrain, 2000) == 500);
+
+    // an invalid HAT keeps the last value, which keeps aging
+    len = frameGDL90Message(data, invalidHeightAboveTerrain, sizeof(invalidHeightAboveTerrain));
+    assert(GDL90OwnshipState_setTime(&ownship, 3000) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, data, len) == GDL90ResultOK);
+    assert(GDL90OwnshipState_read(&ownship, &snapshot) == GDL90ResultOK);
+    assert(snapshot.heightAboveTerrain == 500);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldHeightAboveTerrain, 3000) == 1500);
+
+    // a report without position or altitude only refreshes the velocity
+    ownshipReport[5] = ownshipReport[6] = ownshipReport[7] = ownshipReport[8] = ownshipReport[9] = ownshipReport[10] = 0;
+    ownshipReport[11] = 0xff;
+    ownshipReport[12] = (ownshipReport[12] & 0x0f) | 0xf0;
+    ownshipReport[13] &= 0x0f;
+    len = frameGDL90Message(data, ownshipReport, sizeof(ownshipReport));
+    assert(GDL90OwnshipState_setTime(&ownship, 4000) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, data, len) == GDL90ResultOK);
+    assert(GDL90OwnshipState_read(&ownship, &snapshot) == GDL90ResultOK);
+    assert(!snapshot.report.hasValidPosition && !snapshot.report.hasValidAltitude);
+    assert((int32_t)snapshot.latitude == 44);
+    assert(snapshot.pressureAltitude == 5000);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldPosition, 4000) == 3000);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldPressureAltitude, 4000) == 3000);
+    assert(GDL90OwnshipSnapshot_age(&snapshot, GDL90OwnshipFieldHorizontalVelocity, 4000) == 0);
+}
+
+static void testGDL90TrafficDeduplicator(void)
+{
+    static GDL90SpatialGridNode nodes[TARGET_CAPACITY];
+    static uint32_t buckets[4096];
+    static uint32_t peers[TARGET_CAPACITY];
+
+    GDL90TargetTable table;
+    GDL90SpatialGrid grid;
+    GDL90TrafficDeduplicator dedup;
+    GDL90TrafficReport report;
+    GDL90Target *forward = NULL;
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_init(&grid, 0.25, buckets, 4096, nodes, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90TrafficDeduplicator_init(&dedup, &table, &grid, peers) == GDL90ResultOK);
+
+    // ADS-B, then TIS-B of the same ICAO address with a worse NIC
+    fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBWithICAO, 0xabcdef);
+    report.navigationIntegrityCategory = 8;
+    report.navigationAccuracyCategoryForPosition = 9;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 1000, &report, &forward) == GDL90ResultOK);
+    assert(forward && forward->report.addressType == GDL90TrafficReportAddressTypeADSBWithICAO);
+    assert(GDL90TrafficDeduplicator_peer(&dedup, forward) == NULL);
+    GDL90Target *adsb = forward;
+
+    report.addressType = GDL90TrafficReportAddressTypeTISBWithICAO;
+    report.latitude += 0.05;
+    report.navigationIntegrityCategory = 6;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 1100, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+    assert(GDL90TrafficDeduplicator_peer(&dedup, adsb)->report.addressType == GDL90TrafficReportAddressTypeTISBWithICAO);
+
+    // ADS-B with a self assigned address and a TIS-B track file of the same aircraft, gated on position/altitude/velocity
+    fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBSelfAssigned, 0x123456);
+    report.latitude = 40.0;
+    report.longitude = -100.0;
+    report.hasValidHorizontalVelocity = 1;
+    report.horizontalVelocity = 150;
+    report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report.trackHeading = 10.0;
+    report.navigationIntegrityCategory = 7;
+    report.navigationAccuracyCategoryForPosition = 8;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2000, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+
+    GDL90TrafficReport tisb = report;
+    tisb.addressType = GDL90TrafficReportAddressTypeTISBWithTrackFileID;
+    tisb.participantAddress = 0x000042;
+    tisb.latitude += 0.005;
+    tisb.altitude += 100;
+    tisb.horizontalVelocity = 160;
+    tisb.trackHeading = 355.0;
+    tisb.navigationIntegrityCategory = 6;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2100, &tisb, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+
+    // the TIS-B track file gets a better NIC : it takes over, replacing its peer
+    tisb.navigationIntegrityCategory = 9;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2200, &tisb, &forward) == GDL90ResultOK);
+    assert(forward && forward->report.addressType == GDL90TrafficReportAddressTypeTISBWithTrackFileID);
+    assert(GDL90TrafficDeduplicator_peer(&dedup, forward)->report.participantAddress == 0x123456);
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2300, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+
+    // outside the gates
+    GDL90TrafficReport other = tisb;
+    other.participantAddress = 0x000043;
+    other.altitude += 1000;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2400, &other, &forward) == GDL90ResultOK);
+    assert(forward && GDL90TrafficDeduplicator_peer(&dedup, forward) == NULL);
+    other = tisb;
+    other.participantAddress = 0x000044;
+    other.trackHeading = 90.0;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2400, &other, &forward) == GDL90ResultOK);
+    assert(forward && GDL90TrafficDeduplicator_peer(&dedup, forward) == NULL);
+
+    // two ICAO addresses are never the same aircraft
+    fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBWithICAO, 0x111111);
+    report.latitude = 30.0;
+    report.longitude = -90.0;
+    report.navigationIntegrityCategory = 8;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2500, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    report.addressType = GDL90TrafficReportAddressTypeTISBWithICAO;
+    report.participantAddress = 0x222222;
+    report.navigationIntegrityCategory = 0;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 2500, &report, &forward) == GDL90ResultOK);
+    assert(forward && GDL90TrafficDeduplicator_peer(&dedup, forward) == NULL);
+
+    // removal unlinks the peer
+    assert(GDL90TargetTable_remove(&table, GDL90TrafficReportAddressTypeTISBWithICAO, 0xabcdef) == GDL90ResultOK);
+    assert(GDL90TrafficDeduplicator_peer(&dedup, adsb) == NULL);
+    assert(grid.count == table.count);
+
+    assert(dedup.forwardedCount == 7);
+    assert(dedup.suppressedCount == 3);
+}
+
+static void testGDL90TrafficDecimator(void)
+{
+    static GDL90TrafficDecimatorState states[TARGET_CAPACITY];
+
+    GDL90TargetTable table;
+    GDL90TrafficDecimator decimator;
+    GDL90TrafficReport report;
+    GDL90Target *forward = NULL;
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90TrafficDecimator_init(&decimator, &table, states, 1000) == GDL90ResultOK);
+
+    // new targets pass, then one report per second
+    fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBWithICAO, 0xabcdef);
+    assert(GDL90TrafficDecimator_update(&decimator, 0, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    for (uint64_t t = 100; t < 1000; t += 100)
+    {
+        report.altitude += 10;
+        assert(GDL90TrafficDecimator_update(&decimator, t, &report, &forward) == GDL90ResultOK);
+        assert(forward == NULL);
+    }
+    assert(GDL90TrafficDecimator_nextDue(&decimator, 999) == NULL);
+    forward = GDL90TrafficDecimator_nextDue(&decimator, 1000);
+    // the latest state
+    assert(forward && forward->report.altitude == 5090);
+    assert(GDL90TrafficDecimator_nextDue(&decimator, 1000) == NULL);
+    assert(decimator.coalescedCount == 8);
+    assert(decimator.savedBytes == 8 * GDL90_TRAFFIC_REPORT_FRAME_SIZE);
+
+    // alerts, emergencies and large changes pass at once
+    report.alertStatus = 1;
+    assert(GDL90TrafficDecimator_update(&decimator, 1100, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    assert(GDL90TrafficDecimator_update(&decimator, 1200, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    report.alertStatus = 0;
+    assert(GDL90TrafficDecimator_update(&decimator, 1300, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    report.emergencyPriorityCode = GDL90TrafficReportEmergencyPriorityCodeTypeGeneralEmergency;
+    assert(GDL90TrafficDecimator_update(&decimator, 1400, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    report.emergencyPriorityCode = 0;
+    assert(GDL90TrafficDecimator_update(&decimator, 1500, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    report.altitude += 150;
+    assert(GDL90TrafficDecimator_update(&decimator, 1600, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+    report.altitude += 100;
+    assert(GDL90TrafficDecimator_update(&decimator, 1700, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    report.trackHeadingType = GDL90TrafficReportTrackHeadingTypeTrueTrackAngle;
+    report.trackHeading = 340.0;
+    assert(GDL90TrafficDecimator_update(&decimator, 1800, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    GDL90Target *target = forward;
+    report.trackHeading = 345.0;
+    assert(GDL90TrafficDecimator_update(&decimator, 1900, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+    assert(decimator.immediateCount == 7);
+
+    // up to date targets leave the list, their next report passes at once
+    assert(GDL90TrafficDecimator_nextDue(&decimator, 2800) == target);
+    assert(GDL90TrafficDecimator_nextDue(&decimator, 5000) == NULL);
+    assert(decimator.head == GDL90_TRAFFIC_NONE);
+    assert(GDL90TrafficDecimator_update(&decimator, 5100, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+
+    // removed while pending
+    assert(GDL90TrafficDecimator_update(&decimator, 5200, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+    assert(GDL90TargetTable_remove(&table, GDL90TrafficReportAddressTypeADSBWithICAO, 0xabcdef) == GDL90ResultOK);
+    assert(decimator.head == GDL90_TRAFFIC_NONE && decimator.tail == GDL90_TRAFFIC_NONE);
+    assert(GDL90TrafficDecimator_nextDue(&decimator, 10000) == NULL);
+
+    // many targets : 10 Hz reports for 10 s at 1 Hz
+    uint64_t receivedCount = decimator.receivedCount;
+    uint64_t forwardedCount = decimator.forwardedCount;
+    for (uint64_t t = 20000; t < 30000; t += 100)
+    {
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBWithICAO, 0x100000 + i);
+            assert(GDL90TrafficDecimator_update(&decimator, t + i, &report, &forward) == GDL90ResultOK);
+        }
+        while ((forward = GDL90TrafficDecimator_nextDue(&decimator, t + 99)) != NULL) {}
+    }
+    assert(decimator.receivedCount - receivedCount == 10000);
+    assert(decimator.forwardedCount - forwardedCount == 1000);
+}
+
+static void countTargetRemoval(GDL90Target *target, uint32_t targetIndex, void *context)
+{
+    (void)target;
+    (void)targetIndex;
+    (*(uint32_t *)context)++;
+}
+
+static void testGDL90TrafficRemovalChain(void)
+{
+    static GDL90SpatialGridNode nodes[TARGET_CAPACITY];
+    static uint32_t buckets[4096];
+    static uint32_t peers[TARGET_CAPACITY];
+    static GDL90TrafficDecimatorState states[TARGET_CAPACITY];
+
+    GDL90TargetTable table;
+    GDL90SpatialGrid grid;
+    GDL90TrafficDeduplicator dedup;
+    GDL90TrafficDecimator decimator;
+    GDL90TrafficReport report;
+    GDL90Target *forward = NULL;
+    uint32_t removedCount = 0;
+
+    // a handler of the application, then both stages on the same table
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_init(&grid, 0.25, buckets, 4096, nodes, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90TargetTable_setRemovalHandler(&table, countTargetRemoval, &removedCount) == GDL90ResultOK);
+    assert(GDL90TrafficDeduplicator_init(&dedup, &table, &grid, peers) == GDL90ResultOK);
+    assert(GDL90TrafficDecimator_init(&decimator, &table, states, 1000) == GDL90ResultOK);
+    // a new init of a stage keeps the chain
+    assert(GDL90TrafficDecimator_init(&decimator, &table, states, 1000) == GDL90ResultOK);
+    assert(decimator.nextRemovalHandler == GDL90TrafficDeduplicator_handleTargetRemoval);
+
+    // ADS-B forwarded, the TIS-B track of the same ICAO address suppressed, then a coalesced ADS-B report
+    fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBWithICAO, 0xabcdef);
+    report.navigationIntegrityCategory = 8;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 1000, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    assert(GDL90TrafficDecimator_update(&decimator, 1000, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    GDL90Target *adsb = forward;
+    uint32_t adsbIndex = GDL90TargetTable_index(&table, adsb);
+
+    report.addressType = GDL90TrafficReportAddressTypeTISBWithICAO;
+    report.navigationIntegrityCategory = 6;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 1100, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+
+    report.addressType = GDL90TrafficReportAddressTypeADSBWithICAO;
+    report.navigationIntegrityCategory = 8;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 1200, &report, &forward) == GDL90ResultOK);
+    assert(forward == adsb);
+    assert(GDL90TrafficDecimator_update(&decimator, 1200, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+    assert(grid.count == 2 && peers[adsbIndex] != GDL90_TRAFFIC_NONE);
+    assert(decimator.head == adsbIndex && states[adsbIndex].pending);
+
+    // evicted : every stage cleans up
+    assert(GDL90TargetTable_evict(&table, 5000) == 2);
+    assert(removedCount == 2);
+    assert(grid.count == 0);
+    assert(peers[adsbIndex] == GDL90_TRAFFIC_NONE);
+    assert(decimator.head == GDL90_TRAFFIC_NONE && decimator.tail == GDL90_TRAFFIC_NONE);
+    assert(!states[adsbIndex].pending && decimator.coalescedCount == 1);
+    assert(GDL90TrafficDecimator_nextDue(&decimator, 10000) == NULL);
+}
+
+static void testGDL90TrafficDecimatorChain(void)
+{
+    static GDL90SpatialGridNode nodes[TARGET_CAPACITY];
+    static uint32_t buckets[4096];
+    static uint32_t peers[TARGET_CAPACITY];
+    static GDL90TrafficDecimatorState states[TARGET_CAPACITY];
+
+    GDL90TargetTable table;
+    GDL90SpatialGrid grid;
+    GDL90TrafficDeduplicator dedup;
+    GDL90TrafficDecimator decimator;
+    GDL90TrafficReport report;
+    GDL90Target *forward = NULL;
+
+    assert(GDL90TargetTable_init(&table, targetSlots, targets, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90SpatialGrid_init(&grid, 0.25, buckets, 4096, nodes, TARGET_CAPACITY) == GDL90ResultOK);
+    assert(GDL90TrafficDeduplicator_init(&dedup, &table, &grid, peers) == GDL90ResultOK);
+    assert(GDL90TrafficDecimator_init(&decimator, &table, states, 1000) == GDL90ResultOK);
+
+    // both stages update the table : the first report of a target still passes at once
+    fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBWithICAO, 0xabcdef);
+    assert(GDL90TrafficDeduplicator_update(&dedup, 100, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    assert(GDL90TrafficDecimator_update(&decimator, 100, &report, &forward) == GDL90ResultOK);
+    assert(forward && forward->updateCount == 2);
+    uint32_t index = GDL90TargetTable_index(&table, forward);
+
+    report.altitude += 10;
+    assert(GDL90TrafficDeduplicator_update(&dedup, 200, &report, &forward) == GDL90ResultOK);
+    assert(forward);
+    assert(GDL90TrafficDecimator_update(&decimator, 200, &report, &forward) == GDL90ResultOK);
+    assert(forward == NULL);
+    assert(decimator.forwardedCount == 1 && decimator.immediateCount == 0);
+
+    // removed : the next target of the slot isn't decimated against its history
+    assert(GDL90TargetTable_remove(&table, GDL90TrafficReportAddressTypeADSBWithICAO, 0xabcdef) == GDL90ResultOK);
+    assert(!states[index].forwarded && states[index].forwardTimeMs == 0 && states[index].altitude == 0);
+    // next fit from the freed slot
+    table.allocCursor = index;
+    fillTrafficReport(&report, GDL90TrafficReportAddressTypeADSBWithICAO, 0x123456);
+    assert(GDL90TrafficDeduplicator_update(&dedup, 300, &report, &forward) == GDL90ResultOK);
+    assert(forward && GDL90TargetTable_index(&table, forward) == index);
+    assert(GDL90TrafficDecimator_update(&decimator, 300, &report, &forward) == GDL90ResultOK);
+    assert(forward && forward->report.participantAddress == 0x123456);
+    assert(decimator.forwardedCount == 2 && decimator.immediateCount == 0);
+    assert(states[index].forwardTimeMs == 300);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "targettable") == 0)
+    {
+        testGDL90TargetTable();
+    }
+    else if (strcmp(argv[1], "spatialgrid") == 0)
+    {
+        testGDL90SpatialGrid();
+    }
+    else if (strcmp(argv[1], "extrapolation") == 0)
+    {
+        testGDL90Extrapolator();
+    }
+    else if (strcmp(argv[1], "conflictprobe") == 0)
+    {
+        testGDL90ConflictProbe();
+    }
+    else if (strcmp(argv[1], "ownship") == 0)
+    {
+        testGDL90OwnshipState();
+    }
+    else if (strcmp(argv[1], "dedup") == 0)
+    {
+        testGDL90TrafficDeduplicator();
+    }
+    else if (strcmp(argv[1], "decimation") == 0)
+    {
+        testGDL90TrafficDecimator();
+    }
+    else if (strcmp(argv[1], "removalchain") == 0)
+    {
+        testGDL90TrafficRemovalChain();
+    }
+    else if (strcmp(argv[1], "decimationchain") == 0)
+    {
+        testGDL90TrafficDecimatorChain();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
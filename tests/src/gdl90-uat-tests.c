@@ -0,0 +1,290 @@
+//
+//  gdl90-uat-tests.c
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <gdl90-uat.h>
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Writes count bits of v at bit offset (MSB first), returns the offset past them */
+static uint32_t putBits(uint8_t *data, uint32_t offset, uint32_t count, uint32_t v)
+{
+    for (uint32_t i = 0; i < count; i++, offset++)
+    {
+        if ((v >> (count - 1 - i)) & 1)
+        {
+            data[offset >> 3] |= (uint8_t)(0x80 >> (offset & 7));
+        }
+    }
+    return offset;
+}
+
+/** Writes an Information Frame header at offset, returns the offset of its data */
+static uint32_t putFrameHeader(uint8_t *payload, uint32_t offset, uint16_t length, uint8_t type)
+{
+    putBits(payload, offset * 8, 9, length);
+    putBits(payload, offset * 8 + 12, 4, type);
+    return offset + 2;
+}
+
+static void testGDL90UATUplink(void)
+{
+    uint8_t message[4 + GDL90_UAT_UPLINK_PAYLOAD_SIZE + 2] = { GDL90MessageType_UplinkData, 0xff, 0xff, 0xff };
+    uint8_t *payload = message + 4;
+
+    // UAT-Specific Header : 44.90708, -122.99488, valid, UTC coupled, application data valid, slot 7, site 3
+    putBits(payload, 0, 23, (uint32_t)(44.90708 / (360.0 / (1<<24))));
+    putBits(payload, 23, 24, (uint32_t)((360.0 - 122.99488) / (360.0 / (1<<24))));
+    putBits(payload, 47, 1, 1);
+    payload[6] = 0x80 | 0x20 | 7;
+    payload[7] = 3 << 4;
+
+    // generic text, 12:34
+    uint32_t offset = putFrameHeader(payload, 8, 4 + 5, GDL90UATInfoFrameTypeFISB);
+    uint32_t bit = putBits(payload, offset * 8, 3, 0x4);
+    bit = putBits(payload, bit, 11, 413);
+    bit = putBits(payload, bit, 1, 0);
+    bit = putBits(payload, bit, 2, GDL90UATAPDUTimeOptionHoursMinutes);
+    bit = putBits(payload, bit, 5, 12);
+    bit = putBits(payload, bit, 6, 34);
+    memcpy(payload + offset + 4, "HELLO", 5);
+    offset += 4 + 5;
+
+    // segment 2 of 3 of NOTAM file 5, 10/19 12:34:56 : 43 bits of header and 28 of segmentation
+    uint32_t start = offset;
+    offset = putFrameHeader(payload, offset, 9 + 2, GDL90UATInfoFrameTypeFISB);
+    bit = putBits(payload, offset * 8, 3, 0);
+    bit = putBits(payload, bit, 11, 8);
+    bit = putBits(payload, bit, 1, 1);
+    bit = putBits(payload, bit, 2, GDL90UATAPDUTimeOptionMonthDayHoursMinutesSeconds);
+    bit = putBits(payload, bit, 4, 10);
+    bit = putBits(payload, bit, 5, 19);
+    bit = putBits(payload, bit, 5, 12);
+    bit = putBits(payload, bit, 6, 34);
+    bit = putBits(payload, bit, 6, 56);
+    bit = putBits(payload, bit, 10, 5);
+    bit = putBits(payload, bit, 9, 3);
+    bit = putBits(payload, bit, 9, 2);
+    assert(bit == (offset + 9) * 8 - 1);
+    payload[offset + 9] = 0xaa;
+    payload[offset + 10] = 0x55;
+    offset += 9 + 2;
+    assert(offset - start == 13);
+
+    // service status
+    offset = putFrameHeader(payload, offset, 4, GDL90UATInfoFrameTypeServiceStatus);
+
+    GDL90Message gdl90Message = {0};
+    gdl90Message.id = GDL90MessageType_UplinkData;
+    memcpy(gdl90Message.data, message, sizeof(message));
+    gdl90Message.dataLength = sizeof(message);
+
+    GDL90UATUplink uplink;
+    GDL90UATInfoFrame frame;
+    GDL90UATAPDU apdu;
+
+    assert(GDL90UATUplink_init(&uplink, payload, 100) != GDL90ResultOK);
+    assert(GDL90UATUplink_initWithMessage(&uplink, &gdl90Message) == GDL90ResultOK);
+    assert(uplink.payload == gdl90Message.data + 4);
+    assert(uplink.header.latitude > 44.9070 && uplink.header.latitude < 44.9071);
+    assert(uplink.header.longitude > -122.9949 && uplink.header.longitude < -122.9948);
+    assert(uplink.header.hasValidPosition);
+    assert(uplink.header.utcCoupled);
+    assert(uplink.header.hasValidApplicationData);
+    assert(uplink.header.slotId == 7);
+    assert(uplink.header.tisbSiteId == 3);
+
+    assert(GDL90UATUplink_nextFrame(&uplink, &frame) == GDL90ResultOK);
+    assert(frame.type == GDL90UATInfoFrameTypeFISB);
+    assert(frame.length == 9);
+    assert(GDL90UATAPDU_init(&apdu, &frame) == GDL90ResultOK);
+    assert(apdu.aFlag && !apdu.gFlag && !apdu.pFlag && !apdu.sFlag);
+    assert(apdu.productId == 413);
+    assert(apdu.timeOption == GDL90UATAPDUTimeOptionHoursMinutes);
+    assert(apdu.hours == 12 && apdu.minutes == 34);
+    assert(apdu.length == 5);
+    assert(memcmp(apdu.data, "HELLO", 5) == 0);
+    // zero copy
+    assert(apdu.data == gdl90Message.data + 4 + 8 + 2 + 4);
+
+    assert(GDL90UATUplink_nextFrame(&uplink, &frame) == GDL90ResultOK);
+    assert(GDL90UATAPDU_init(&apdu, &frame) == GDL90ResultOK);
+    assert(apdu.productId == 8);
+    assert(apdu.sFlag);
+    assert(apdu.month == 10 && apdu.day == 19 && apdu.hours == 12 && apdu.minutes == 34 && apdu.seconds == 56);
+    assert(apdu.productFileId == 5 && apdu.productFileLength == 3 && apdu.apduNumber == 2);
+    assert(apdu.length == 2 && apdu.data[0] == 0xaa && apdu.data[1] == 0x55);
+
+    assert(GDL90UATUplink_nextFrame(&uplink, &frame) == GDL90ResultOK);
+    assert(frame.type == GDL90UATInfoFrameTypeServiceStatus);
+    assert(GDL90UATAPDU_init(&apdu, &frame) != GDL90ResultOK);
+
+    // then padding
+    assert(GDL90UATUplink_nextFrame(&uplink, &frame) != GDL90ResultOK);
+
+    // no application data
+    payload[6] &= (uint8_t)~0x20;
+    assert(GDL90UATUplink_init(&uplink, payload, GDL90_UAT_UPLINK_PAYLOAD_SIZE) == GDL90ResultOK);
+    assert(GDL90UATUplink_nextFrame(&uplink, &frame) != GDL90ResultOK);
+
+    // a frame longer than the payload
+    payload[6] |= 0x20;
+    memset(payload + 8, 0, GDL90_UAT_UPLINK_PAYLOAD_SIZE - 8);
+    putFrameHeader(payload, 8, 500, GDL90UATInfoFrameTypeFISB);
+    assert(GDL90UATUplink_init(&uplink, payload, GDL90_UAT_UPLINK_PAYLOAD_SIZE) == GDL90ResultOK);
+    assert(GDL90UATUplink_nextFrame(&uplink, &frame) != GDL90ResultOK);
+}
+
+static void testGDL90UATADSB(void)
+{
+    GDL90UATADSB adsb;
+    GDL90TrafficReport report;
+    uint8_t payload[34] = { 0 };
+
+    // long payload type 1 (HDR, SV, MS, AUXSV), ADS-B with ICAO
+    uint32_t bit = putBits(payload, 0, 5, 1);
+    bit = putBits(payload, bit, 3, 0);
+    bit = putBits(payload, bit, 24, 0xa1b2c3);
+    bit = putBits(payload, bit, 23, (uint32_t)(44.90708 / (360.0 / (1<<24))));
+    bit = putBits(payload, bit, 24, (uint32_t)((360.0 - 122.99488) / (360.0 / (1<<24))));
+    bit = putBits(payload, bit, 1, 0); // pressure altitude
+    bit = putBits(payload, bit, 12, (5000 + 1025) / 25);
+    bit = putBits(payload, bit, 4, 8); // NIC
+    bit = putBits(payload, bit, 2, 0); // airborne subsonic
+    bit = putBits(payload, bit, 1, 0);
+    bit = putBits(payload, bit, 11, 0x400 | (100 + 1)); // 100 kt south
+    bit = putBits(payload, bit, 11, 100 + 1); // 100 kt east
+    bit = putBits(payload, bit, 11, 0x200 | (10 + 1)); // 640 ft/min down, geometric
+    bit = putBits(payload, bit, 4, 1); // UTC coupled
+    // MS : emitter category 1, "N123AB"
+    const char *base40 = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ  ..";
+    const char *callsign = "N123AB  ";
+    uint32_t c[9] = { 1 };
+    for (int i = 0; i < 8; i++) { c[i + 1] = (uint32_t)(strchr(base40, callsign[i]) - base40); }
+    for (int i = 0; i < 3; i++) { bit = putBits(payload, bit, 16, c[i * 3] * 1600 + c[i * 3 + 1] * 40 + c[i * 3 + 2]); }
+    bit = putBits(payload, bit, 3, 0); // no emergency
+    bit = putBits(payload, bit, 3, 2); // UAT version
+    bit = putBits(payload, bit, 2, 3); // SIL
+    bit = putBits(payload, bit, 8, 0);
+    bit = putBits(payload, bit, 4, 10); // NACp
+    bit = putBits(payload, bit, 3, 2); // NACv
+    bit = putBits(payload, bit, 1, 1); // NICbaro
+    bit = putBits(payload, bit, 2, 1); // CDTI
+    bit = putBits(payload, bit, 3, 0);
+    bit = putBits(payload, bit, 1, 0);
+    bit = putBits(payload, bit, 1, 1); // callsign
+    // AUXSV : geometric altitude
+    putBits(payload, 29 * 8, 12, (5200 + 1025) / 25);
+
+    assert(GDL90UATADSB_init(&adsb, payload, sizeof(payload)) == GDL90ResultOK);
+    assert(adsb.payloadType == 1);
+    assert(adsb.addressQualifier == 0);
+    assert(adsb.address == 0xa1b2c3);
+    assert(adsb.hasValidPosition);
+    assert(fabs(adsb.latitude - 44.90708) < 0.0001);
+    assert(fabs(adsb.longitude + 122.99488) < 0.0001);
+    assert(adsb.hasValidAltitude && adsb.altitudeType == GDL90UATAltitudeTypePressure && adsb.altitude == 5000);
+    assert(adsb.navigationIntegrityCategory == 8);
+    assert(adsb.airGroundState == 0);
+    assert(adsb.hasValidHorizontalVelocity && adsb.horizontalVelocity == 141);
+    assert(adsb.trackHeadingType == GDL90TrafficReportTrackHeadingTypeTrueTrackAngle);
+    assert(fabs(adsb.trackHeading - 135.0) < 0.001);
+    assert(adsb.hasValidVerticalVelocity && adsb.verticalVelocity == -640);
+    assert(adsb.verticalVelocitySource == GDL90UATAltitudeTypeGeometric);
+    assert(adsb.utcCoupledOrSiteId == 1);
+    assert(adsb.hasModeStatus);
+    assert(adsb.emitterCategory == 1);
+    assert(strcmp(adsb.callsign, "N123AB") == 0);
+    assert(!adsb.callsignIsFlightPlanId);
+    assert(adsb.uatVersion == 2 && adsb.sourceIntegrityLevel == 3);
+    assert(adsb.navigationAccuracyCategoryForPosition == 10);
+    assert(adsb.navigationAccuracyCategoryForVelocity == 2);
+    assert(adsb.nicBaro == 1 && adsb.capabilityCodes == 1);
+    assert(adsb.hasAuxiliaryStateVector && adsb.hasValidSecondaryAltitude && adsb.secondaryAltitude == 5200);
+
+    memset(&report, 0, sizeof(report));
+    assert(GDL90UATADSB_toTrafficReport(&adsb, &report) == GDL90ResultOK);
+    assert(report.id == GDL90MessageType_TrafficReport);
+    assert(report.addressType == GDL90TrafficReportAddressTypeADSBWithICAO);
+    assert(report.participantAddress == 0xa1b2c3);
+    assert(report.hasValidAltitude && report.altitude == 5000);
+    assert(report.airGroundState == 1);
+    assert(report.horizontalVelocity == 141 && report.verticalVelocity == -640);
+    assert(report.navigationIntegrityCategory == 8 && report.navigationAccuracyCategoryForPosition == 10);
+    assert(memcmp(report.callsign, "N123AB\0\0", 8) == 0);
+
+    // basic payload (HDR, SV) of an ADS-R target on the ground keeps the MS fields of the report
+    uint8_t basic[18];
+    memcpy(basic, payload, sizeof(basic));
+    basic[0] = 6;
+    memset(basic + 12, 0, 4);
+    putBits(basic, 12 * 8, 2, 2);
+    putBits(basic, 12 * 8 + 4, 10, 15 + 1); // 15 kt
+    putBits(basic, 13 * 8 + 6, 2, GDL90TrafficReportTrackHeadingTypeHeadingTrue);
+    putBits(basic, 14 * 8, 9, 256); // 180 degrees
+    assert(GDL90UATADSB_init(&adsb, basic, sizeof(basic)) == GDL90ResultOK);
+    assert(adsb.payloadType == 0 && adsb.addressQualifier == 6);
+    assert(!adsb.hasModeStatus && !adsb.hasAuxiliaryStateVector);
+    assert(adsb.airGroundState == 2);
+    assert(adsb.horizontalVelocity == 15);
+    assert(adsb.trackHeadingType == GDL90TrafficReportTrackHeadingTypeHeadingTrue);
+    assert(fabs(adsb.trackHeading - 180.0) < 0.001);
+    assert(GDL90UATADSB_toTrafficReport(&adsb, &report) == GDL90ResultOK);
+    assert(report.addressType == GDL90TrafficReportAddressTypeADSBWithICAO);
+    assert(report.airGroundState == 0);
+    assert(memcmp(report.callsign, "N123AB", 6) == 0);
+
+    // a long payload type needs 34 bytes
+    basic[0] = 1 << 3;
+    assert(GDL90UATADSB_init(&adsb, basic, sizeof(basic)) != GDL90ResultOK);
+    assert(GDL90UATADSB_init(&adsb, payload, 10) != GDL90ResultOK);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "uplink") == 0)
+    {
+        testGDL90UATUplink();
+    }
+    else if (strcmp(argv[1], "adsb") == 0)
+    {
+        testGDL90UATADSB();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
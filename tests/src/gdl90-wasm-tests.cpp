@@ -0,0 +1,319 @@
+//
+//  gdl90-wasm-tests.cpp
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Ring encoding of gdl90-wasm, built natively : the module's source with the JS imports stubbed
+// out, the packets written and the records read the way gdl90.js does it.
+
+#include "../../examples/gdl90-wasm/src/gdl90-wasm.cpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+// the ring API never calls into JS
+extern "C" void EXT_write_stdout(const char *, size_t) { abort(); }
+extern "C" void EXT_handleGDL90Message(GDL90Message *, void *) { abort(); }
+extern "C" void EXT_handleGDL90Error(GDL90Message *, GDL90StreamProcessingError) { abort(); }
+
+/** gdl90.js writePacket : false if the input ring is full */
+static bool writePacket(const uint8_t *data, uint16_t length)
+{
+    uint32_t head = gdl90InputRingHead;
+    uint32_t offset = head % GDL90_WASM_INPUT_RING_SIZE;
+    uint32_t wrap = offset + 2 + length > GDL90_WASM_INPUT_RING_SIZE ? GDL90_WASM_INPUT_RING_SIZE - offset : 0;
+    if (head - gdl90InputRingTail + wrap + 2 + length > GDL90_WASM_INPUT_RING_SIZE)
+    {
+        return false;
+    }
+    if (wrap)
+    {
+        if (wrap >= 2)
+        {
+            gdl90InputRing[offset] = gdl90InputRing[offset + 1] = 0;
+        }
+        head += wrap;
+        offset = 0;
+    }
+    gdl90InputRing[offset] = length & 0xff;
+    gdl90InputRing[offset + 1] = length >> 8;
+    memcpy(&gdl90InputRing[offset + 2], data, length);
+    gdl90InputRingHead = head + 2 + length;
+    return true;
+}
+
+/** gdl90.js readRecords : the next record, releasing its Uplink Data */
+static GDL90WasmRecord *readRecord(void)
+{
+    assert(gdl90OutputRingTail != gdl90OutputRingHead);
+    GDL90WasmRecord *record = &gdl90OutputRing[gdl90OutputRingTail++ % GDL90_WASM_OUTPUT_RING_CAPACITY];
+    if (record->id == GDL90MessageType_UplinkData)
+    {
+        assert(record->message.uplink == gdl90UplinkRingTail);
+        gdl90UplinkRingTail = record->message.uplink + 1;
+    }
+    return record;
+}
+
+typedef struct WasmTestFrames
+{
+    uint8_t heartbeat[7];
+    uint8_t trafficReport[28];
+    uint8_t uplinkData[436];
+} WasmTestFrames;
+
+static void initFrames(WasmTestFrames *frames)
+{
+    GDL90Heartbeat gdl90Heartbeat = {};
+    gdl90Heartbeat.id = GDL90MessageType_Heartbeat;
+    gdl90Heartbeat.timestamp = 0x11234;
+    gdl90Heartbeat.uplinkMessageCount = 8;
+    GDL90Heartbeat_toBytes(&gdl90Heartbeat, frames->heartbeat);
+
+    GDL90TrafficReport gdl90TrafficReport = {};
+    gdl90TrafficReport.id = GDL90MessageType_TrafficReport;
+    gdl90TrafficReport.participantAddress = 0xab4549;
+    gdl90TrafficReport.hasValidPosition = 1;
+    memcpy(gdl90TrafficReport.callsign, "N825V", 5);
+    GDL90TrafficReport_toBytes(&gdl90TrafficReport, frames->trafficReport);
+
+    GDL90UplinkData gdl90UplinkData = {};
+    gdl90UplinkData.id = GDL90MessageType_UplinkData;
+    gdl90UplinkData.timeOfReception = 80 * 1000;
+    gdl90UplinkData.hasValidTor = 1;
+    for (size_t i = 0; i < sizeof(gdl90UplinkData.payload); i++)
+    {
+        gdl90UplinkData.payload[i] = (uint8_t)i;
+    }
+    GDL90UplinkData_toBytes(&gdl90UplinkData, frames->uplinkData);
+}
+
+static void testGDL90WasmRingRecords(void)
+{
+    GDL90_init();
+    WasmTestFrames frames;
+    initFrames(&frames);
+
+    uint8_t packet[2 * GDL90_FRAME_MAX_SIZE];
+    GDL90FrameBuilder gdl90FrameBuilder = {};
+    assert(GDL90FrameBuilder_init(&gdl90FrameBuilder, packet, sizeof(packet)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, frames.heartbeat, sizeof(frames.heartbeat)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, frames.uplinkData, sizeof(frames.uplinkData)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, frames.trafficReport, sizeof(frames.trafficReport)) == GDL90ResultOK);
+    uint16_t length = (uint16_t)gdl90FrameBuilder.length;
+
+    // a packet ending 1 byte before the end of the input ring, the next one wraps without a marker
+    gdl90InputRingHead = gdl90InputRingTail = GDL90_WASM_INPUT_RING_SIZE - 2 - length - 1;
+    assert(writePacket(packet, length));
+    assert(writePacket(packet, length));
+    assert(gdl90InputRingHead == GDL90_WASM_INPUT_RING_SIZE + 2u + length);
+
+    assert(GDL90_processRing() == 6);
+    assert(gdl90InputRingTail == gdl90InputRingHead);
+    assert(gdl90UplinkRingHead == 2);
+    assert(gdl90RingSkippedCount == 0);
+    assert(gdl90RingErrorCount == 0);
+    assert(gdl90RingOverflowCount == 0);
+
+    // in stream order, Uplink Data by their uplink ring index
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        GDL90WasmRecord *record = readRecord();
+        assert(record->id == GDL90MessageType_Heartbeat);
+        assert(record->message.heartbeat.timestamp == 0x11234);
+        assert(record->message.heartbeat.uplinkMessageCount == 8);
+
+        record = readRecord();
+        assert(record->id == GDL90MessageType_UplinkData);
+        assert(record->message.uplink == i);
+        GDL90UplinkData *uplinkData = &gdl90UplinkRing[i % GDL90_WASM_UPLINK_RING_CAPACITY];
+        assert(uplinkData->id == GDL90MessageType_UplinkData);
+        assert(uplinkData->hasValidTor && uplinkData->timeOfReception == 80 * 1000);
+        for (size_t j = 0; j < sizeof(uplinkData->payload); j++)
+        {
+            assert(uplinkData->payload[j] == (uint8_t)j);
+        }
+
+        record = readRecord();
+        assert(record->id == GDL90MessageType_TrafficReport);
+        assert(record->message.trafficReport.participantAddress == 0xab4549);
+        assert(strcmp(record->message.trafficReport.callsign, "N825V") == 0);
+    }
+    assert(gdl90OutputRingTail == gdl90OutputRingHead);
+    assert(gdl90UplinkRingTail == gdl90UplinkRingHead);
+
+    // a packet that doesn't fit before the end : zero length marker, and a corrupted Traffic Report
+    uint32_t offset = GDL90_WASM_INPUT_RING_SIZE - 2 - length + 10;
+    gdl90InputRingHead = gdl90InputRingTail = 2 * GDL90_WASM_INPUT_RING_SIZE + offset;
+    packet[length - 10] ^= 0x01;
+    assert(writePacket(packet, length));
+    assert(gdl90InputRing[offset] == 0 && gdl90InputRing[offset + 1] == 0);
+    assert(gdl90InputRingHead == 3u * GDL90_WASM_INPUT_RING_SIZE + 2 + length);
+
+    assert(GDL90_processRing() == 2);
+    assert(gdl90InputRingTail == gdl90InputRingHead);
+    assert(gdl90RingErrorCount == 1);
+    assert(readRecord()->id == GDL90MessageType_Heartbeat);
+    GDL90WasmRecord *record = readRecord();
+    assert(record->id == GDL90MessageType_UplinkData && record->message.uplink == 2);
+    assert(gdl90UplinkRingTail == gdl90UplinkRingHead);
+}
+
+static void testGDL90WasmRingOverflow(void)
+{
+    GDL90_init();
+    WasmTestFrames frames;
+    initFrames(&frames);
+
+    static uint8_t packet[GDL90_WASM_INPUT_RING_SIZE / 2];
+    GDL90FrameBuilder gdl90FrameBuilder = {};
+
+    // packets of 16 Traffic Reports : processRing stops before a packet that wouldn't fit
+    assert(GDL90FrameBuilder_init(&gdl90FrameBuilder, packet, sizeof(packet)) == GDL90ResultOK);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, frames.trafficReport, sizeof(frames.trafficReport)) == GDL90ResultOK);
+    }
+    uint32_t written = 0;
+    while (writePacket(packet, (uint16_t)gdl90FrameBuilder.length))
+    {
+        written++;
+    }
+    assert(written * 16 > GDL90_WASM_OUTPUT_RING_CAPACITY);
+    uint32_t read = 0;
+    for (uint32_t count; (count = GDL90_processRing()) != 0; read += count)
+    {
+        assert(count <= GDL90_WASM_OUTPUT_RING_CAPACITY);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            assert(readRecord()->id == GDL90MessageType_TrafficReport);
+        }
+    }
+    assert(read == written * 16);
+    assert(gdl90RingOverflowCount == 0);
+
+    // packets of an Uplink Data : bounded by the uplink ring
+    assert(GDL90FrameBuilder_reset(&gdl90FrameBuilder) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, frames.uplinkData, sizeof(frames.uplinkData)) == GDL90ResultOK);
+    for (uint32_t i = 0; i < 2 * GDL90_WASM_UPLINK_RING_CAPACITY; i++)
+    {
+        assert(writePacket(packet, (uint16_t)gdl90FrameBuilder.length));
+    }
+    assert(GDL90_processRing() == GDL90_WASM_UPLINK_RING_CAPACITY);
+    assert(gdl90InputRingTail != gdl90InputRingHead);
+    for (uint32_t i = 0; i < GDL90_WASM_UPLINK_RING_CAPACITY; i++)
+    {
+        assert(readRecord()->id == GDL90MessageType_UplinkData);
+    }
+    assert(GDL90_processRing() == GDL90_WASM_UPLINK_RING_CAPACITY);
+    assert(gdl90InputRingTail == gdl90InputRingHead);
+    while (gdl90OutputRingTail != gdl90OutputRingHead)
+    {
+        readRecord();
+    }
+    assert(gdl90RingOverflowCount == 0);
+
+    // a single packet larger than the uplink ring is still decoded into empty rings
+    assert(GDL90FrameBuilder_reset(&gdl90FrameBuilder) == GDL90ResultOK);
+    for (uint32_t i = 0; i < GDL90_WASM_UPLINK_RING_CAPACITY + 6; i++)
+    {
+        assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, frames.uplinkData, sizeof(frames.uplinkData)) == GDL90ResultOK);
+    }
+    assert(writePacket(packet, (uint16_t)gdl90FrameBuilder.length));
+    assert(GDL90_processRing() == GDL90_WASM_UPLINK_RING_CAPACITY);
+    assert(gdl90InputRingTail == gdl90InputRingHead);
+    assert(gdl90RingOverflowCount == 6);
+}
+
+static void testGDL90WasmRingCorrupted(void)
+{
+    GDL90_init();
+    WasmTestFrames frames;
+    initFrames(&frames);
+
+    uint8_t packet[GDL90_FRAME_MAX_SIZE];
+    GDL90FrameBuilder gdl90FrameBuilder = {};
+    assert(GDL90FrameBuilder_init(&gdl90FrameBuilder, packet, sizeof(packet)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, frames.heartbeat, sizeof(frames.heartbeat)) == GDL90ResultOK);
+    uint16_t length = (uint16_t)gdl90FrameBuilder.length;
+
+    // a packet then a length past the head : the packet is decoded, processRing stops at the length
+    assert(writePacket(packet, length));
+    uint32_t tail = gdl90InputRingHead;
+    gdl90InputRing[tail] = 100;
+    gdl90InputRing[tail + 1] = 0;
+    gdl90InputRingHead = tail + 2 + 99;
+    assert(GDL90_processRing() == 1);
+    assert(gdl90InputRingTail == tail);
+    assert(gdl90InputRingCorrupted);
+    assert(GDL90_processRing() == 1);
+    assert(gdl90InputRingTail == tail);
+    assert(readRecord()->id == GDL90MessageType_Heartbeat);
+
+    // gdl90.js resetInputRing
+    gdl90InputRingTail = gdl90InputRingHead;
+    gdl90InputRingCorrupted = 0;
+
+    // a wrap marker past the head
+    gdl90InputRingHead = gdl90InputRingTail = GDL90_WASM_INPUT_RING_SIZE - 10;
+    gdl90InputRing[GDL90_WASM_INPUT_RING_SIZE - 10] = gdl90InputRing[GDL90_WASM_INPUT_RING_SIZE - 9] = 0;
+    gdl90InputRingHead += 9;
+    assert(GDL90_processRing() == 0);
+    assert(gdl90InputRingTail == GDL90_WASM_INPUT_RING_SIZE - 10);
+    assert(gdl90InputRingCorrupted);
+    gdl90InputRingTail = gdl90InputRingHead;
+    gdl90InputRingCorrupted = 0;
+
+    // and the ring works on
+    assert(writePacket(packet, length));
+    assert(GDL90_processRing() == 1);
+    assert(!gdl90InputRingCorrupted);
+    assert(readRecord()->id == GDL90MessageType_Heartbeat);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "records") == 0)
+    {
+        testGDL90WasmRingRecords();
+    }
+    else if (strcmp(argv[1], "overflow") == 0)
+    {
+        testGDL90WasmRingOverflow();
+    }
+    else if (strcmp(argv[1], "corrupted") == 0)
+    {
+        testGDL90WasmRingCorrupted();
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -45,6 +45,14 @@
     assert(CLASS ## _init(&INSTANCE, &gdl90Message) == GDL90ResultOK); \
 } while(0)
 
+/** Asserts that _toBytes gives back the bytes (without the FCS) INSTANCE was decoded from */
+#define AssertGDL90RoundTrip(CLASS,INSTANCE,SIZE) do {\
+    uint8_t bytes[SIZE] = {0}; \
+    assert(CLASS ## _toBytes(&INSTANCE, bytes) == bytes); \
+    assert(gdl90Message.dataLength == SIZE + 2); \
+    assert(memcmp(bytes, gdl90Message.data, SIZE) == 0); \
+} while(0)
+
 static void testGDL90Heartbeat(void)
 {
     // 3.1. HEARTBEAT MESSAGE
@@ -84,6 +92,15 @@ static void testGDL90Heartbeat(void)
     // 3.1.3. UAT Time Stamp 
 
     // 3.1.4. Received Message Counts 
+
+    AssertGDL90RoundTrip(GDL90Heartbeat, gdl90Heartbeat, 7);
+
+    char json[256] = {0};
+    size_t jsonLength = GDL90Heartbeat_toJSON(&gdl90Heartbeat, json, sizeof(json));
+    assert(jsonLength == strlen(json));
+    assert(strcmp(json, "{\"id\":0,\"status1\":136,\"status2\":129,\"timestamp\":130831,\"uplinkMessageCount\":0,\"basicLongMessageCount\":511}") == 0);
+    // doesn't fit
+    assert(GDL90Heartbeat_toJSON(&gdl90Heartbeat, json, jsonLength) == 0);
 }
 
 static void testGDL90Initialization(void)
@@ -143,6 +160,13 @@ static void testGDL90UplinkData(void)
     // A TOR of "all ONES" (0xFFFFFF, or 16,777,21510) indicates that the TOR value is not valid
     UpdateGDL90Bytes3(GDL90UplinkData, gdl90UplinkData, 1, 0xff, 0xff, 0xff);
     assert(!gdl90UplinkData.hasValidTor);
+    AssertGDL90RoundTrip(GDL90UplinkData, gdl90UplinkData, 436);
+
+    // 1 s in 80 ns units
+    gdl90Message.data[100] = 0x7e;
+    UpdateGDL90Bytes3(GDL90UplinkData, gdl90UplinkData, 1, 0x20, 0xbc, 0xbe);
+    assert(gdl90UplinkData.hasValidTor && gdl90UplinkData.timeOfReception == 1000000000);
+    AssertGDL90RoundTrip(GDL90UplinkData, gdl90UplinkData, 436);
 
     // 3.3.2. Uplink Payload (not implemented; needs RTCA/DO-282)
 }
@@ -176,6 +200,7 @@ static void testGDL90HeightAboveTerrain(void)
     // Special Value: The value 0x8000 indicates that the Height Above Terrain data is invalid.
     UpdateGDL90Bytes2(GDL90HeightAboveTerrain, gdl90HeightAboveTerrain, 1, 0x80, 0x00);
     assert(gdl90HeightAboveTerrain.heightAboveTerrain == -32768);
+    AssertGDL90RoundTrip(GDL90HeightAboveTerrain, gdl90HeightAboveTerrain, 3);
 }
 
 static void testGDL90OwnshipGeometricAltitude(void)
@@ -205,6 +230,7 @@ static void testGDL90OwnshipGeometricAltitude(void)
     // -1,000 feet 0xFF38
     UpdateGDL90Bytes2(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 1, 0xff, 0x38);
     assert(gdl90OwnshipGeometricAltitude.geoAltitude == -1000);
+    AssertGDL90RoundTrip(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 5);
     // 0 feet 0x0000
     UpdateGDL90Bytes2(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 1, 0x00, 0x00);
     assert(gdl90OwnshipGeometricAltitude.geoAltitude == 0);
@@ -224,6 +250,7 @@ static void testGDL90OwnshipGeometricAltitude(void)
     UpdateGDL90Bytes2(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 3, 0xff, 0xff);
     assert(gdl90OwnshipGeometricAltitude.verticalWarning == 1);
     assert(gdl90OwnshipGeometricAltitude.hasValidVFOM == 0);
+    AssertGDL90RoundTrip(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 5);
     // No Vertical Warning, VFOM = 40,000 meters 0x7FFE (max value represantable is 32,766)
     UpdateGDL90Bytes2(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 3, 0x7f, 0xfe);
     assert(gdl90OwnshipGeometricAltitude.verticalWarning == 0);
@@ -236,6 +263,7 @@ static void testGDL90OwnshipGeometricAltitude(void)
     UpdateGDL90Bytes2(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 3, 0x80, 0x32);
     assert(gdl90OwnshipGeometricAltitude.verticalWarning == 1);
     assert(gdl90OwnshipGeometricAltitude.verticalFigureOfMerit == 50);
+    AssertGDL90RoundTrip(GDL90OwnshipGeometricAltitude, gdl90OwnshipGeometricAltitude, 5);
 }
 
 static void testGDL90TrafficReport(void)
@@ -290,6 +318,23 @@ static void testGDL90TrafficReport(void)
     // // Tail Number: N825V
     assert(strncmp(gdl90TrafficReport.callsign, "N825V", 8) == 0);
 
+    char json[1024] = {0};
+    size_t jsonLength = GDL90TrafficReport_toJSON(&gdl90TrafficReport, json, sizeof(json));
+    assert(jsonLength == strlen(json));
+    assert(strstr(json, "\"latitude\":44.907067,\"longitude\":-122.994862,\"altitude\":5000,") != NULL);
+    assert(strstr(json, "\"trackHeading\":45.00,") != NULL);
+    assert(strstr(json, "\"verticalVelocity\":64,") != NULL);
+    assert(strstr(json, "\"callsign\":\"N825V\",") != NULL);
+
+    // framed again, FCS included
+    uint8_t frame[GDL90_FRAME_MAX_SIZE] = {0};
+    uint8_t bytes[28] = {0};
+    GDL90FrameBuilder gdl90FrameBuilder = {0};
+    assert(GDL90FrameBuilder_init(&gdl90FrameBuilder, frame, sizeof(frame)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, GDL90TrafficReport_toBytes(&gdl90TrafficReport, bytes), sizeof(bytes)) == GDL90ResultOK);
+    assert(gdl90FrameBuilder.length == sizeof(data));
+    assert(memcmp(frame, data, sizeof(data)) == 0);
+
     // 3.5.1.7 HORIZONTAL VELOCITY
 
     // 0xFFE = 4094
@@ -337,16 +382,235 @@ static void testGDL90TrafficReport(void)
     // +101,350 feet 0xFFE
     UpdateGDL90Bytes2(GDL90TrafficReport, gdl90TrafficReport, 11, 0xff, 0xe0);
     assert(gdl90TrafficReport.altitude == 101350);
+    AssertGDL90RoundTrip(GDL90TrafficReport, gdl90TrafficReport, 28);
+}
+
+static void testGDL90TrafficReportValidity(void)
+{
+    // 3.5.2. Traffic Report Example
+    uint8_t data[] = {
+        0x7e, 0x14,
+        0x00, 0xAB, 0x45, 0x49, 0x1F, 0xEF, 0x15, 0xA8, 0x89, 0x78,
+        0x0F, 0x09, 0xA9, 0x07, 0xB0, 0x01, 0x20, 0x01, 0x4E, 0x38,
+        0x32, 0x35, 0x56, 0x20, 0x20, 0x20, 0x00,
+        0x57, 0xd6, 0x7e
+    };
+
+    GDL90Message gdl90Message = {0};
+    assert(GDL90Message_init(&gdl90Message, data, sizeof(data)) == GDL90ResultOK);
+
+    GDL90TrafficReport gdl90TrafficReport = {0};
+    assert(GDL90TrafficReport_init(&gdl90TrafficReport, &gdl90Message) == GDL90ResultOK);
+    assert(gdl90TrafficReport.hasValidPosition == 1);
+    assert(gdl90TrafficReport.hasValidAltitude == 1);
+    assert(gdl90TrafficReport.hasValidHorizontalVelocity == 1);
+
+    // 3.5.1.7 : 0xFFF = no horizontal velocity information, the altitude stays valid
+    UpdateGDL90Bytes2(GDL90TrafficReport, gdl90TrafficReport, 14, 0xff, 0xf0);
+    assert(gdl90TrafficReport.hasValidHorizontalVelocity == 0);
+    assert(gdl90TrafficReport.horizontalVelocity == 0);
+    assert(gdl90TrafficReport.hasValidAltitude == 1);
+    // 0 kt is a valid velocity
+    UpdateGDL90Bytes2(GDL90TrafficReport, gdl90TrafficReport, 14, 0x00, 0x00);
+    assert(gdl90TrafficReport.hasValidHorizontalVelocity == 1);
+    assert(gdl90TrafficReport.horizontalVelocity == 0);
+
+    // 3.5.1.3 : only lat, lon and NIC all 0 mean no valid position
+    UpdateGDL90Bytes3(GDL90TrafficReport, gdl90TrafficReport, 5, 0x00, 0x00, 0x00);
+    assert(gdl90TrafficReport.hasValidPosition == 1);
+    UpdateGDL90Bytes3(GDL90TrafficReport, gdl90TrafficReport, 8, 0x00, 0x00, 0x00);
+    assert(gdl90TrafficReport.hasValidPosition == 1);
+    gdl90Message.data[13] &= 0x0f;
+    assert(GDL90TrafficReport_init(&gdl90TrafficReport, &gdl90Message) == GDL90ResultOK);
+    assert(gdl90TrafficReport.hasValidPosition == 0);
+    // on the prime meridian, NIC 0
+    UpdateGDL90Bytes3(GDL90TrafficReport, gdl90TrafficReport, 5, 0x1F, 0xEF, 0x15);
+    assert(gdl90TrafficReport.hasValidPosition == 1);
 }
 
 static void testGDL90BasicReport(void)
 {
+    // 3.6. PASS-THROUGH REPORTS
 
+    uint8_t data[1 + 22 + 2 + 1] = {0};
+    data[0] = 0x7e;
+    data[1] = 0x1e;
+    for (size_t i = 5; i < 23; i++) { data[i] = (uint8_t)(i * 11); }
+    data[25] = 0x7e;
+
+    GDL90Message gdl90Message = {0};
+    assert(GDL90Message_init(&gdl90Message, data, sizeof(data)) == GDL90ResultOK);
+
+    GDL90BasicReport gdl90BasicReport = {0};
+    UpdateGDL90Bytes3(GDL90BasicReport, gdl90BasicReport, 1, 0x01, 0x00, 0x00);
+    assert(gdl90BasicReport.hasValidTor && gdl90BasicReport.timeOfReception == 80);
+    AssertGDL90RoundTrip(GDL90BasicReport, gdl90BasicReport, 22);
+
+    UpdateGDL90Bytes3(GDL90BasicReport, gdl90BasicReport, 1, 0xff, 0xff, 0xff);
+    assert(!gdl90BasicReport.hasValidTor);
+    AssertGDL90RoundTrip(GDL90BasicReport, gdl90BasicReport, 22);
 }
 
 static void testGDL90LongReport(void)
 {
+    // 3.6. PASS-THROUGH REPORTS
+
+    uint8_t data[1 + 38 + 2 + 1] = {0};
+    data[0] = 0x7e;
+    data[1] = 0x1f;
+    for (size_t i = 5; i < 39; i++) { data[i] = (uint8_t)(i * 13); }
+    data[41] = 0x7e;
+
+    GDL90Message gdl90Message = {0};
+    assert(GDL90Message_init(&gdl90Message, data, sizeof(data)) == GDL90ResultOK);
+
+    GDL90LongReport gdl90LongReport = {0};
+    UpdateGDL90Bytes3(GDL90LongReport, gdl90LongReport, 1, 0x10, 0x27, 0x00);
+    assert(gdl90LongReport.hasValidTor && gdl90LongReport.timeOfReception == 800000);
+    AssertGDL90RoundTrip(GDL90LongReport, gdl90LongReport, 38);
+}
+
+static size_t gdl90FrameBuilderMessageCount = 0;
+static size_t gdl90FrameBuilderErrorCount = 0;
+static GDL90UplinkData gdl90FrameBuilderUplinkData;
+
+static void handleFrameBuilderMessage(GDL90Message *gdl90Message, void *message)
+{
+    gdl90FrameBuilderMessageCount++;
+    if (gdl90Message->id == GDL90MessageType_UplinkData)
+    {
+        gdl90FrameBuilderUplinkData = *(GDL90UplinkData *)message;
+    }
+}
+
+static void handleFrameBuilderError(GDL90Message *gdl90Message, GDL90StreamProcessingError error)
+{
+    (void)gdl90Message;
+    (void)error;
+    gdl90FrameBuilderErrorCount++;
+}
+
+static void testGDL90FrameBuilder(void)
+{
+    // 2.2. MESSAGE STRUCTURE OVERVIEW
+
+    GDL90Heartbeat gdl90Heartbeat = {0};
+    gdl90Heartbeat.id = GDL90MessageType_Heartbeat;
+    gdl90Heartbeat.status1 = 1<<GDL90HeartbeatStatusByte1BitGPSPosValid;
+    gdl90Heartbeat.timestamp = 0x17e7d;
+
+    GDL90TrafficReport gdl90TrafficReport = {0};
+    gdl90TrafficReport.id = GDL90MessageType_OwnshipReport;
+    gdl90TrafficReport.participantAddress = 0x7e7d7e;
+    gdl90TrafficReport.latitude = 44.90708;
+    gdl90TrafficReport.longitude = -122.99488;
+    gdl90TrafficReport.hasValidPosition = 1;
+    gdl90TrafficReport.navigationIntegrityCategory = 10;
+    memcpy(gdl90TrafficReport.callsign, "N825V", 5);
+
+    // escape heavy
+    GDL90UplinkData gdl90UplinkData = {0};
+    gdl90UplinkData.id = GDL90MessageType_UplinkData;
+    for (size_t i = 0; i < sizeof(gdl90UplinkData.payload); i++)
+    {
+        gdl90UplinkData.payload[i] = (i & 1) ? 0x7e : 0x7d;
+    }
+
+    uint8_t heartbeat[7], trafficReport[28], uplinkData[436];
+    const uint8_t *messages[] = {
+        GDL90Heartbeat_toBytes(&gdl90Heartbeat, heartbeat),
+        GDL90TrafficReport_toBytes(&gdl90TrafficReport, trafficReport),
+        GDL90UplinkData_toBytes(&gdl90UplinkData, uplinkData)
+    };
+    const size_t lens[] = { sizeof(heartbeat), sizeof(trafficReport), sizeof(uplinkData) };
+
+    // one datagram
+    uint8_t datagram[2 * GDL90_FRAME_MAX_SIZE];
+    GDL90FrameBuilder gdl90FrameBuilder = {0};
+    assert(GDL90FrameBuilder_init(&gdl90FrameBuilder, datagram, sizeof(datagram)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_appendBatch(&gdl90FrameBuilder, messages, lens, 3) == 3);
+    assert(gdl90FrameBuilder.frameCount == 3);
+    assert(datagram[0] == 0x7e && datagram[gdl90FrameBuilder.length - 1] == 0x7e);
+    for (size_t i = 1; i < gdl90FrameBuilder.length - 1; i++)
+    {
+        // only flags between frames
+        assert(datagram[i] != 0x7e || datagram[i-1] == 0x7e || datagram[i+1] == 0x7e);
+    }
 
+    GDL90StreamConfig gdl90StreamConfig = {0};
+    assert(GDL90StreamConfig_init(&gdl90StreamConfig, handleFrameBuilderMessage, handleFrameBuilderError) == GDL90ResultOK);
+    GDL90Stream gdl90Stream = {0};
+    assert(GDL90Stream_init(&gdl90Stream, &gdl90StreamConfig) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, datagram, (uint16_t)gdl90FrameBuilder.length) == GDL90ResultOK);
+    assert(gdl90FrameBuilderMessageCount == 3);
+    assert(gdl90FrameBuilderErrorCount == 0);
+    assert(memcmp(gdl90FrameBuilderUplinkData.payload, gdl90UplinkData.payload, sizeof(gdl90UplinkData.payload)) == 0);
+
+    // doesn't fit, nothing written
+    uint8_t small[64];
+    assert(GDL90FrameBuilder_init(&gdl90FrameBuilder, small, sizeof(small)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_appendBatch(&gdl90FrameBuilder, messages, lens, 3) == 2);
+    size_t length = gdl90FrameBuilder.length;
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, uplinkData, sizeof(uplinkData)) != GDL90ResultOK);
+    assert(gdl90FrameBuilder.length == length && gdl90FrameBuilder.frameCount == 2);
+
+    // the next datagram
+    assert(GDL90FrameBuilder_reset(&gdl90FrameBuilder) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, heartbeat, sizeof(heartbeat)) == GDL90ResultOK);
+    assert(gdl90FrameBuilder.frameCount == 1);
+}
+
+static uint32_t gdl90FrameHandlerCounts[2];
+static uint8_t gdl90FrameHandlerOrder[4];
+static size_t gdl90FrameHandlerCalls;
+
+static void handleFrameCount(GDL90Message *gdl90Message, void *context)
+{
+    uint32_t *count = (uint32_t *)context;
+    assert(gdl90Message->id == GDL90MessageType_Heartbeat);
+    (*count)++;
+    if (gdl90FrameHandlerCalls < sizeof(gdl90FrameHandlerOrder))
+    {
+        gdl90FrameHandlerOrder[gdl90FrameHandlerCalls] = (uint8_t)(count - gdl90FrameHandlerCounts);
+    }
+    gdl90FrameHandlerCalls++;
+}
+
+static void testGDL90FrameHandlers(void)
+{
+    GDL90StreamConfig gdl90StreamConfig = {0};
+    assert(GDL90StreamConfig_init(&gdl90StreamConfig, handleFrameBuilderMessage, handleFrameBuilderError) == GDL90ResultOK);
+
+    // one slot : a second handler doesn't replace the first
+    assert(GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, handleFrameCount, &gdl90FrameHandlerCounts[0]) == GDL90ResultOK);
+    assert(GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, handleFrameCount, &gdl90FrameHandlerCounts[1]) != GDL90ResultOK);
+    assert(gdl90StreamConfig.frameHandlerContext == &gdl90FrameHandlerCounts[0]);
+    assert(GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, NULL, NULL) == GDL90ResultOK);
+
+    GDL90FrameHandlerEntry entries[2];
+    GDL90FrameHandlers handlers = {0};
+    assert(GDL90FrameHandlers_init(&handlers, entries, 2) == GDL90ResultOK);
+    assert(GDL90FrameHandlers_add(&handlers, handleFrameCount, &gdl90FrameHandlerCounts[0]) == GDL90ResultOK);
+    assert(GDL90FrameHandlers_add(&handlers, handleFrameCount, &gdl90FrameHandlerCounts[1]) == GDL90ResultOK);
+    assert(GDL90FrameHandlers_add(&handlers, handleFrameCount, &gdl90FrameHandlerCounts[1]) != GDL90ResultOK);
+    assert(GDL90StreamConfig_setFrameHandler(&gdl90StreamConfig, GDL90FrameHandlers_handleFrame, &handlers) == GDL90ResultOK);
+
+    GDL90Stream gdl90Stream = {0};
+    assert(GDL90Stream_init(&gdl90Stream, &gdl90StreamConfig) == GDL90ResultOK);
+
+    GDL90Heartbeat gdl90Heartbeat = {0};
+    uint8_t heartbeat[7];
+    uint8_t datagram[64];
+    GDL90FrameBuilder gdl90FrameBuilder = {0};
+    assert(GDL90FrameBuilder_init(&gdl90FrameBuilder, datagram, sizeof(datagram)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, GDL90Heartbeat_toBytes(&gdl90Heartbeat, heartbeat), sizeof(heartbeat)) == GDL90ResultOK);
+    assert(GDL90FrameBuilder_append(&gdl90FrameBuilder, heartbeat, sizeof(heartbeat)) == GDL90ResultOK);
+    assert(GDL90Stream_process(&gdl90Stream, datagram, (uint16_t)gdl90FrameBuilder.length) == GDL90ResultOK);
+
+    // every handler gets every frame, in the order they were added
+    assert(gdl90FrameHandlerCounts[0] == 2 && gdl90FrameHandlerCounts[1] == 2);
+    assert(gdl90FrameHandlerOrder[0] == 0 && gdl90FrameHandlerOrder[1] == 1);
+    assert(gdl90FrameHandlerOrder[2] == 0 && gdl90FrameHandlerOrder[3] == 1);
 }
 
 int main(int argc, char *argv[])
@@ -356,6 +620,22 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    if (strcmp(argv[1], "framebuilder") == 0)
+    {
+        testGDL90FrameBuilder();
+        return EXIT_SUCCESS;
+    }
+    if (strcmp(argv[1], "trafficreportvalidity") == 0)
+    {
+        testGDL90TrafficReportValidity();
+        return EXIT_SUCCESS;
+    }
+    if (strcmp(argv[1], "framehandlers") == 0)
+    {
+        testGDL90FrameHandlers();
+        return EXIT_SUCCESS;
+    }
+
     switch (atoi(argv[1]))
     {
         case GDL90MessageType_Heartbeat:
@@ -0,0 +1,79 @@
+//
+//  wasm_simd128.h
+//  gdl90-tests
+//
+// Copyright (c) 2024 wry
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Portable stand-in for the wasm_simd128.h intrinsics gdl90.c uses, so its __wasm_simd128__
+// paths build and run natively (see gdl90-simd-tests.c). Lane semantics only, not fast.
+
+#ifndef __gdl90__wasm_simd128_h__
+#define __gdl90__wasm_simd128_h__
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct v128_t
+{
+    uint8_t lanes[16];
+} v128_t;
+
+static inline v128_t wasm_v128_load(const void *mem)
+{
+    v128_t v;
+    memcpy(v.lanes, mem, 16);
+    return v;
+}
+
+static inline void wasm_v128_store(void *mem, v128_t v)
+{
+    memcpy(mem, v.lanes, 16);
+}
+
+static inline v128_t wasm_i8x16_splat(int8_t x)
+{
+    v128_t v;
+    memset(v.lanes, (uint8_t)x, 16);
+    return v;
+}
+
+static inline v128_t wasm_i8x16_eq(v128_t a, v128_t b)
+{
+    v128_t v;
+    for (int i = 0; i < 16; i++)
+    {
+        v.lanes[i] = a.lanes[i] == b.lanes[i] ? 0xff : 0x00;
+    }
+    return v;
+}
+
+static inline uint32_t wasm_i8x16_bitmask(v128_t a)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        mask |= (uint32_t)(a.lanes[i] >> 7) << i;
+    }
+    return mask;
+}
+
+#endif /* defined(__gdl90__wasm_simd128_h__) */